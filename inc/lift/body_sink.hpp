@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace lift
+{
+class request;
+class response;
+
+/**
+ * Receives a response body incrementally as it is downloaded instead of it being buffered into
+ * the lift::response, see lift::request::body_sink().  Chunks are delivered on the thread driving
+ * the transfer, for asynchronous requests that is the client's event loop thread so a sink must
+ * not block.
+ */
+class body_sink
+{
+public:
+    body_sink()                                    = default;
+    body_sink(const body_sink&)                    = default;
+    body_sink(body_sink&&)                         = default;
+    auto operator=(const body_sink&) -> body_sink& = default;
+    auto operator=(body_sink&&) -> body_sink&      = default;
+    virtual ~body_sink()                           = default;
+
+    /**
+     * Called once the final response's headers have arrived, before the first chunk of its body.  This
+     * is called again if the request is retried before any of the body was written.
+     * @param req The request the body belongs to.
+     * @param resp The final response's status and headers, e.g. to presize for its Content-Length.
+     */
+    virtual auto start(const request& req, const response& resp) -> void;
+
+    /**
+     * Called for each chunk of the response body in order as it arrives.
+     * @param req The request the body belongs to.
+     * @param chunk The next chunk of the body, it is only valid for the duration of the call.
+     * @return True to continue the transfer, false to abort it, the request then completes with
+     *         lift_status::download_error.
+     */
+    virtual auto write(const request& req, std::string_view chunk) -> bool = 0;
+
+    /**
+     * Called once after the last chunk when the request's final response is known, before the
+     * request's on complete handler is invoked.  This is also called when the transfer failed,
+     * timed out or was cancelled so the sink can release any partial state.
+     * @param req The request the body belongs to.
+     * @param resp The final response's status and headers.
+     */
+    virtual auto finish(const request& req, const response& resp) -> void;
+};
+
+/**
+ * Decodes newline delimited records (e.g. NDJSON) from a response body as it streams in.  Each
+ * line is delivered without its "\n" or "\r\n" terminator, empty lines are skipped and a final
+ * line without a terminator is delivered when a successful transfer finishes.
+ */
+class ndjson_decoder final : public body_sink
+{
+public:
+    /**
+     * @param record The line, it is only valid for the duration of the call.
+     * @return True to continue decoding, false to abort the transfer.
+     */
+    using record_handler_type = std::function<bool(std::string_view record)>;
+
+    /// The default maximum length of a single line.
+    static constexpr std::size_t default_max_record_bytes = 16 * 1024 * 1024;
+
+    /**
+     * @param handler Called with each decoded line.
+     * @param max_record_bytes The transfer is aborted if a single line grows beyond this length.
+     */
+    explicit ndjson_decoder(record_handler_type handler, std::size_t max_record_bytes = default_max_record_bytes);
+    ~ndjson_decoder() override = default;
+
+    auto write(const request& req, std::string_view chunk) -> bool override;
+    auto finish(const request& req, const response& resp) -> void override;
+
+    /**
+     * @return The number of lines delivered.
+     */
+    [[nodiscard]] auto records() const -> uint64_t { return m_records; }
+
+private:
+    /// The user's line handler.
+    record_handler_type m_handler;
+    /// The maximum length of a single line.
+    std::size_t m_max_record_bytes{default_max_record_bytes};
+    /// The start of a line that spans chunks.
+    std::string m_partial{};
+    /// The number of lines delivered.
+    uint64_t m_records{0};
+
+    /**
+     * Delivers the line unless it is empty.
+     */
+    auto deliver(std::string_view line) -> bool;
+};
+
+/**
+ * Decodes length prefixed records from a response body as it streams in, each record is an
+ * unsigned big endian length followed by that many bytes.
+ */
+class length_prefixed_decoder final : public body_sink
+{
+public:
+    /**
+     * @param record The record's bytes without the length prefix, it is only valid for the duration of the call.
+     * @return True to continue decoding, false to abort the transfer.
+     */
+    using record_handler_type = std::function<bool(std::string_view record)>;
+
+    /// The default maximum length of a single record.
+    static constexpr std::size_t default_max_record_bytes = 16 * 1024 * 1024;
+
+    /**
+     * @throw std::invalid_argument If prefix_bytes is not 1, 2, 4 or 8.
+     * @param handler Called with each decoded record.
+     * @param prefix_bytes The width of the length prefix in bytes.
+     * @param max_record_bytes The transfer is aborted if a record's length is beyond this.
+     */
+    explicit length_prefixed_decoder(
+        record_handler_type handler,
+        uint8_t             prefix_bytes     = 4,
+        std::size_t         max_record_bytes = default_max_record_bytes);
+    ~length_prefixed_decoder() override = default;
+
+    auto write(const request& req, std::string_view chunk) -> bool override;
+    auto finish(const request& req, const response& resp) -> void override;
+
+    /**
+     * @return The number of records delivered.
+     */
+    [[nodiscard]] auto records() const -> uint64_t { return m_records; }
+
+    /**
+     * @return True if the body ended part way through a record.
+     */
+    [[nodiscard]] auto truncated() const -> bool { return m_truncated; }
+
+private:
+    /// The user's record handler.
+    record_handler_type m_handler;
+    /// The width of the length prefix in bytes.
+    uint8_t m_prefix_bytes{4};
+    /// The maximum length of a single record.
+    std::size_t m_max_record_bytes{default_max_record_bytes};
+    /// The start of a record, including its prefix, that spans chunks.
+    std::string m_partial{};
+    /// The number of records delivered.
+    uint64_t m_records{0};
+    /// Did the body end part way through a record?
+    bool m_truncated{false};
+
+    /**
+     * @param data Bytes starting at a record's length prefix.
+     * @return The length of the record, or std::nullopt if the prefix isn't complete.
+     */
+    auto record_size(std::string_view data) const -> std::optional<uint64_t>;
+};
+
+} // namespace lift
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lift
+{
+struct buffer_pool_options
+{
+    /// Buffers smaller than this are not pooled, they are allocated and freed normally.
+    std::size_t m_min_buffer_bytes{4 * 1024};
+    /// Buffers larger than this are not pooled, they are allocated and freed normally.
+    std::size_t m_max_buffer_bytes{64 * 1024 * 1024};
+    /// The maximum number of bytes of idle buffers kept for re-use, beyond this released buffers are freed.
+    std::size_t m_max_idle_bytes{256 * 1024 * 1024};
+    /// Should buffers of at least 2 MiB be aligned and advised to be backed by transparent huge pages?
+    bool m_huge_pages{false};
+};
+
+/**
+ * Recycles the buffers holding a response's body and header bytes so a client at steady state receives
+ * them without calling malloc for each response.  Only those byte buffers are pooled, the small book
+ * keeping a response keeps beside them (its header index, the list of its body segments, its digest and
+ * its error message) is still allocated normally.
+ *
+ * Buffers are pooled in power of two size classes, a released buffer is kept idle for the next
+ * allocation of its size class until the pool holds its maximum number of idle bytes.
+ *
+ * Buffers are allocated and released from any thread, a buffer is released when the response
+ * holding it is destroyed so the pool must outlive every response allocated from it, responses
+ * keep a reference to their pool for this reason.
+ */
+class buffer_pool
+{
+public:
+    /**
+     * @param options The size classes and idle cap of the pool.
+     */
+    explicit buffer_pool(buffer_pool_options options = buffer_pool_options{});
+    ~buffer_pool();
+
+    buffer_pool(const buffer_pool&)                    = delete;
+    buffer_pool(buffer_pool&&)                         = delete;
+    auto operator=(const buffer_pool&) -> buffer_pool& = delete;
+    auto operator=(buffer_pool&&) -> buffer_pool&      = delete;
+
+    /**
+     * @param bytes The size of the buffer, it is rounded up to its size class.
+     * @return The buffer, recycled if an idle buffer of its size class is available.
+     */
+    auto allocate(std::size_t bytes) -> void*;
+
+    /**
+     * @param buffer The buffer to release, it must have been allocated from this pool.
+     * @param bytes The size the buffer was allocated with.
+     */
+    auto deallocate(void* buffer, std::size_t bytes) -> void;
+
+    /**
+     * A pooled buffer is the size of its size class, a container reserving this many bytes rather than
+     * the size it needs uses the entire buffer instead of leaving its tail unused.
+     * @param bytes The size of a buffer.
+     * @return The size of the buffer allocate() leases for this size, bytes itself if it isn't pooled.
+     */
+    [[nodiscard]] auto lease_bytes(std::size_t bytes) const -> std::size_t;
+
+    /**
+     * @return The number of bytes of idle buffers held for re-use.
+     */
+    [[nodiscard]] auto idle_bytes() const -> std::size_t;
+
+    /**
+     * @return The total number of pooled allocations served by an idle buffer.
+     */
+    [[nodiscard]] auto hits() const -> uint64_t { return m_hits.load(std::memory_order_acquire); }
+
+    /**
+     * @return The total number of pooled allocations that had to allocate a new buffer.
+     */
+    [[nodiscard]] auto misses() const -> uint64_t { return m_misses.load(std::memory_order_acquire); }
+
+private:
+    /// The size classes and idle cap.
+    buffer_pool_options m_options{};
+    /// Guards m_idle and m_idle_bytes.
+    mutable std::mutex m_lock{};
+    /// The idle buffers of each size class, the smallest class is m_options.m_min_buffer_bytes.
+    std::vector<std::vector<void*>> m_idle{};
+    /// The number of bytes of idle buffers.
+    std::size_t m_idle_bytes{0};
+    /// The total number of pooled allocations served by an idle buffer.
+    std::atomic<uint64_t> m_hits{0};
+    /// The total number of pooled allocations that allocated a new buffer.
+    std::atomic<uint64_t> m_misses{0};
+
+    /**
+     * @param bytes The size of a buffer.
+     * @return The index of the buffer's size class, or m_idle.size() if buffers this size aren't pooled.
+     */
+    auto size_class(std::size_t bytes) const -> std::size_t;
+
+    /**
+     * @param index A size class.
+     * @return The size of the buffers in the size class.
+     */
+    auto class_bytes(std::size_t index) const -> std::size_t;
+
+    /**
+     * @param bytes The size of a pooled buffer.
+     * @return The alignment pooled buffers of this size are allocated with.
+     */
+    auto alignment(std::size_t bytes) const -> std::size_t;
+};
+
+/**
+ * A standard allocator that allocates from a buffer_pool, or from the heap if it has no pool.
+ * The allocator keeps its pool alive.
+ */
+template<typename type>
+class pool_allocator
+{
+public:
+    using value_type                             = type;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    pool_allocator() noexcept = default;
+    explicit pool_allocator(std::shared_ptr<buffer_pool> pool) noexcept : m_pool(std::move(pool)) {}
+    /// Allocators must compare equal after being moved from so there is intentionally no move constructor.
+    pool_allocator(const pool_allocator&) noexcept                    = default;
+    ~pool_allocator()                                                 = default;
+    auto operator=(const pool_allocator&) noexcept -> pool_allocator& = default;
+
+    template<typename other_type>
+    pool_allocator(const pool_allocator<other_type>& other) noexcept : m_pool(other.pool())
+    {
+    }
+
+    auto allocate(std::size_t n) -> type*
+    {
+        if (m_pool == nullptr)
+        {
+            return std::allocator<type>{}.allocate(n);
+        }
+        return static_cast<type*>(m_pool->allocate(n * sizeof(type)));
+    }
+
+    auto deallocate(type* p, std::size_t n) -> void
+    {
+        if (m_pool == nullptr)
+        {
+            std::allocator<type>{}.deallocate(p, n);
+            return;
+        }
+        m_pool->deallocate(p, n * sizeof(type));
+    }
+
+    /**
+     * @return The pool this allocator allocates from, or nullptr if it uses the heap.
+     */
+    auto pool() const noexcept -> const std::shared_ptr<buffer_pool>& { return m_pool; }
+
+    template<typename other_type>
+    auto operator==(const pool_allocator<other_type>& other) const noexcept -> bool
+    {
+        return m_pool == other.pool();
+    }
+
+    template<typename other_type>
+    auto operator!=(const pool_allocator<other_type>& other) const noexcept -> bool
+    {
+        return m_pool != other.pool();
+    }
+
+private:
+    /// The pool to allocate from, or nullptr to use the heap.
+    std::shared_ptr<buffer_pool> m_pool{nullptr};
+};
+
+} // namespace lift
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lift
+{
+class client;
+
+/**
+ * A handle to cancel an asynchronous request that has been started on a lift::client.  The token
+ * is cheap to copy and does not own the request, it must not outlive the client that issued it.
+ */
+class cancellation_token
+{
+public:
+    /**
+     * @param c The client the request was started on.
+     * @param request_id The identifier of the request to cancel, see lift::request::id().
+     */
+    cancellation_token(client& c, uint64_t request_id);
+    ~cancellation_token() = default;
+
+    cancellation_token(const cancellation_token&)                        = default;
+    cancellation_token(cancellation_token&&) noexcept                    = default;
+    auto operator=(const cancellation_token&) -> cancellation_token&     = default;
+    auto operator=(cancellation_token&&) noexcept -> cancellation_token& = default;
+
+    /**
+     * Requests the client to cancel the request.  If the request is still executing it is completed
+     * with lift_status::cancelled, if it has already completed this does nothing.
+     *
+     * This function is thread safe and can be called from any thread.
+     */
+    auto cancel() const -> void;
+
+    /**
+     * @return The identifier of the request this token cancels.
+     */
+    [[nodiscard]] auto request_id() const noexcept -> uint64_t { return m_request_id; }
+
+private:
+    /// The client the request was started on.
+    client* m_client{nullptr};
+    /// The identifier of the request to cancel.
+    uint64_t m_request_id{0};
+};
+
+} // namespace lift
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lift
+{
+using namespace std::chrono_literals;
+
+enum class circuit_breaker_state : uint8_t
+{
+    /// Requests flow normally and their outcomes are tracked.
+    closed,
+    /// The failure rate was exceeded, requests fail immediately without being executed.
+    open,
+    /// The open duration has elapsed, a limited number of probe requests are allowed through.
+    half_open
+};
+
+/**
+ * @param state Convert the circuit breaker state to a human readable string.
+ * @return String representation of the state.
+ */
+auto to_string(circuit_breaker_state state) -> const std::string&;
+
+struct circuit_breaker_policy
+{
+    /// The number of most recent request outcomes the failure rate is calculated over.
+    uint32_t m_window_size{20};
+    /// The minimum number of outcomes in the window before the breaker is allowed to open.
+    uint32_t m_min_requests{10};
+    /// The failure rate in the range (0, 1] at which the breaker opens.
+    double m_failure_rate_threshold{0.5};
+    /// The amount of time the breaker stays open before allowing probe requests through.
+    std::chrono::milliseconds m_open_duration{5s};
+    /// The maximum number of probe requests in flight while half open.
+    uint32_t m_half_open_max_probes{1};
+    /// The minimum amount of time between starting probe requests while half open.
+    std::chrono::milliseconds m_half_open_probe_interval{100ms};
+    /// The number of successful probe requests required to close the breaker.
+    uint32_t m_half_open_success_threshold{1};
+};
+
+/**
+ * A closed/open/half-open circuit breaker for a single upstream host.  The breaker opens when
+ * the failure rate over the most recent request outcomes exceeds the policy's threshold, fails
+ * requests immediately while open and then lets a rate limited number of probes through to decide
+ * if it should close again or stay open.
+ *
+ * This class is not thread safe, a lift::client only accesses it from its event loop thread.
+ */
+class circuit_breaker
+{
+public:
+    /// Millisecond steady clock time points, the same as the lift::client's event loop.
+    using time_point = uint64_t;
+
+    /**
+     * @param policy The thresholds and durations for this breaker.
+     */
+    explicit circuit_breaker(circuit_breaker_policy policy);
+    ~circuit_breaker() = default;
+
+    circuit_breaker(const circuit_breaker&)                        = default;
+    circuit_breaker(circuit_breaker&&) noexcept                    = default;
+    auto operator=(const circuit_breaker&) -> circuit_breaker&     = default;
+    auto operator=(circuit_breaker&&) noexcept -> circuit_breaker& = default;
+
+    /**
+     * Determines if a request is allowed to execute.  If the open duration has elapsed this moves
+     * the breaker into half open, requests allowed while half open are probes and their outcome
+     * must be recorded or abandoned.
+     * @param now The current time.
+     * @return True if the request may execute, false if it should fail immediately.
+     */
+    auto allow(time_point now) -> bool;
+
+    /**
+     * Records the outcome of a request that was allowed to execute.
+     * @param now The current time.
+     * @param failure True if the request failed in a way that indicates the upstream is unhealthy.
+     */
+    auto record(time_point now, bool failure) -> void;
+
+    /**
+     * Releases a request that was allowed to execute but will never have an outcome, e.g. it was cancelled.
+     */
+    auto abandon() -> void;
+
+    /**
+     * @return The current state of the breaker.
+     */
+    [[nodiscard]] auto state() const noexcept -> circuit_breaker_state { return m_state; }
+
+    /**
+     * @return The policy for this breaker.
+     */
+    [[nodiscard]] auto policy() const noexcept -> const circuit_breaker_policy& { return m_policy; }
+
+private:
+    /// The thresholds and durations for this breaker.
+    circuit_breaker_policy m_policy{};
+    /// The current state of this breaker.
+    circuit_breaker_state m_state{circuit_breaker_state::closed};
+    /// Ring buffer of the most recent outcomes while closed, true is a failure.
+    std::vector<bool> m_outcomes{};
+    /// The total number of outcomes recorded while closed.
+    uint64_t m_outcome_count{0};
+    /// The number of failures currently in the ring buffer.
+    uint32_t m_failure_count{0};
+    /// The time the breaker last opened.
+    time_point m_opened_at{0};
+    /// The time the last probe was allowed through while half open.
+    time_point m_last_probe_at{0};
+    /// The number of probes currently in flight while half open.
+    uint32_t m_probes_in_flight{0};
+    /// The number of successful probes while half open.
+    uint32_t m_probe_successes{0};
+
+    /**
+     * Moves the breaker into the given state and resets the book keeping for that state.
+     */
+    auto transition(time_point now, circuit_breaker_state state) -> void;
+};
+
+} // namespace lift
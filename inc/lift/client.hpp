@@ -1,8 +1,18 @@
 #pragma once
 
+#include "lift/buffer_pool.hpp"
+#include "lift/cancellation_token.hpp"
+#include "lift/circuit_breaker.hpp"
+#include "lift/concurrency_limiter.hpp"
+#include "lift/decode_pool.hpp"
 #include "lift/executor.hpp"
+#include "lift/impl/host_state.hpp"
+#include "lift/ranged_download.hpp"
 #include "lift/request.hpp"
 #include "lift/resolve_host.hpp"
+#include "lift/response_cache.hpp"
+#include "lift/spill_file.hpp"
+#include "lift/token_bucket.hpp"
 
 #include <curl/curl.h>
 #include <uv.h>
@@ -13,13 +23,18 @@
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <random>
+#include <set>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace lift
 {
 class curl_context;
 using curl_context_ptr = std::unique_ptr<curl_context>;
+class request_source;
+using request_source_ptr = std::unique_ptr<request_source>;
 
 class client
 {
@@ -33,6 +48,23 @@ public:
     /// Functor type for on background thread creation/deletion.
     using on_thread_callback_type = std::function<void()>;
 
+    /**
+     * Pull based request source functor.  This is always called from the client's background
+     * event loop thread whenever the source has fewer requests in flight than its target concurrency.
+     * @return The next request to execute, or nullptr to signal the source is exhausted.
+     */
+    using request_source_type = std::function<request_ptr()>;
+
+    /**
+     * Circuit breaker state change functor.  This is always called from the client's background
+     * event loop thread whenever a host's circuit breaker changes state.
+     * @param host The "host:port" whose circuit breaker changed state, see impl::url_host().
+     * @param from The previous state of the circuit breaker.
+     * @param to The new state of the circuit breaker.
+     */
+    using circuit_breaker_callback_type =
+        std::function<void(std::string_view host, circuit_breaker_state from, circuit_breaker_state to)>;
+
     struct options
     {
         /// The number of connections to prepare (reserve) for execution.
@@ -56,6 +88,50 @@ public:
         /// thread starting and thread stopping.  This can be used to set the
         /// thread's priority/niceness or possibly changes its thread name.
         on_thread_callback_type on_thread_callback{nullptr};
+        /// The maximum amount of extra load hedged requests are allowed to add, as a percentage of
+        /// all requests started on this client.  Hedges that would exceed the budget are not issued.
+        double hedge_budget_percent{10.0};
+        /// The maximum number of retries this client will issue, as a percentage of all requests
+        /// started on this client.  Retries that would exceed the budget are not issued and the
+        /// failed outcome is delivered instead.
+        double retry_budget_percent{20.0};
+        /// If set every host this client sends requests to gets its own circuit breaker with this policy.
+        /// While a host's breaker is open its requests fail immediately with lift_status::circuit_open.
+        std::optional<circuit_breaker_policy> circuit_breaker{std::nullopt};
+        /// If this functor is provided it is called whenever a host's circuit breaker changes state.
+        circuit_breaker_callback_type on_circuit_breaker_callback{nullptr};
+        /// If set every host this client sends requests to gets its own adaptive concurrency limiter
+        /// with this policy.  Requests beyond a host's limit wait in the client's per host queue.
+        std::optional<concurrency_limit_policy> concurrency_limit{std::nullopt};
+        /// If set caps the rate at which this client starts requests across every host.
+        std::optional<rate_limit> global_rate_limit{std::nullopt};
+        /// If set every host this client sends requests to gets its own rate limit.
+        std::optional<rate_limit> host_rate_limit{std::nullopt};
+        /// Rate limits applied to requests by their tag, requests without a matching tag are not limited.
+        /// Requests exceeding any of their rate limits wait in the client's per host queue.
+        std::map<std::string, rate_limit, std::less<>> tag_rate_limits{};
+        /// The circuit breaker, concurrency limit, rate limit and latencies of a host without any
+        /// requests for this long are forgotten, as if the host had never been seen.  Hosts with an open
+        /// circuit breaker are kept.  std::nullopt keeps every host for the lifetime of the client.
+        std::optional<std::chrono::milliseconds> host_idle_timeout{std::chrono::minutes{5}};
+        /// If set identical GET requests started while one is already in flight wait for and share its
+        /// response rather than each making their own transfer.  Requests are identical when their url
+        /// and the values of these request header names (compared case insensitively) match.
+        std::optional<std::vector<std::string>> single_flight_headers{std::nullopt};
+        /// If set fresh responses to GET requests are served from this cache without touching the event
+        /// loop, see start_request() for details.  The same cache can be shared between clients.
+        std::shared_ptr<response_cache> cache{nullptr};
+        /// If set response bodies and header blocks are received into buffers recycled through this pool,
+        /// a buffer is returned to the pool when the response holding it is destroyed.  The header index
+        /// is held within the response and the header field offsets, a few hundred bytes for a typical
+        /// response, are smaller than any size class so they are still allocated from the heap.
+        std::shared_ptr<lift::buffer_pool> buffer_pool{nullptr};
+        /// If set response bodies too large to hold in memory are spilled into unlinked temporary files
+        /// as they are received, response::data() then views the file mapped into memory.
+        std::optional<spill_options> spill{std::nullopt};
+        /// If set response bodies of requests that accept an encoding are received encoded and decoded on
+        /// this pool's worker threads, rather than by curl on the event loop, before the request completes.
+        std::shared_ptr<lift::decode_pool> decode_pool{nullptr};
     };
 
     /**
@@ -64,11 +140,25 @@ public:
      */
     explicit client(
         options opts = options{
-            std::nullopt, // reserve connections
-            std::nullopt, // max connections
-            std::nullopt, // connect timeout
-            std::nullopt, // resolve hosts
-            nullptr       // on thread callback
+            std::nullopt,            // reserve connections
+            std::nullopt,            // max connections
+            std::nullopt,            // connect timeout
+            std::nullopt,            // resolve hosts
+            nullptr,                 // on thread callback
+            10.0,                    // hedge budget percent
+            20.0,                    // retry budget percent
+            std::nullopt,            // circuit breaker
+            nullptr,                 // on circuit breaker callback
+            std::nullopt,            // concurrency limit
+            std::nullopt,            // global rate limit
+            std::nullopt,            // host rate limit
+            {},                      // tag rate limits
+            std::chrono::minutes{5}, // host idle timeout
+            std::nullopt,            // single flight headers
+            nullptr,                 // cache
+            nullptr,                 // buffer pool
+            std::nullopt,            // spill
+            nullptr                  // decode pool
         });
 
     ~client();
@@ -95,7 +185,8 @@ public:
 
     /**
      * @return Gets the number of active HTTP requests currently running.  This includes
-     *         the number of pending requests that haven't been started yet (if any).
+     *         the number of pending requests that haven't been started yet (if any) and
+     *         any registered request sources that have not yet been exhausted.
      */
     [[nodiscard]] auto size() const -> std::size_t { return m_active_request_count.load(std::memory_order_acquire); }
 
@@ -104,6 +195,135 @@ public:
      */
     [[nodiscard]] auto empty() const -> bool { return size() == 0; }
 
+    /**
+     * @return The total number of hedged duplicate requests issued by this client.
+     */
+    [[nodiscard]] auto hedges_issued() const -> uint64_t { return m_hedges_issued.load(std::memory_order_acquire); }
+
+    /**
+     * @return The total number of hedged duplicate requests whose response was delivered instead of the original.
+     */
+    [[nodiscard]] auto hedges_won() const -> uint64_t { return m_hedges_won.load(std::memory_order_acquire); }
+
+    /**
+     * @return The total number of retries issued by this client.
+     */
+    [[nodiscard]] auto retries_issued() const -> uint64_t { return m_retries_issued.load(std::memory_order_acquire); }
+
+    /**
+     * @return The total number of requests completed with lift_status::cancelled by this client.
+     */
+    [[nodiscard]] auto requests_cancelled() const -> uint64_t
+    {
+        return m_requests_cancelled.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The total number of requests served from the response cache, including stale responses
+     *         served while they are revalidated.
+     */
+    [[nodiscard]] auto cache_hits() const -> uint64_t { return m_cache_hits.load(std::memory_order_acquire); }
+
+    /**
+     * @return The total number of cacheable requests that had no usable response in the cache.
+     */
+    [[nodiscard]] auto cache_misses() const -> uint64_t { return m_cache_misses.load(std::memory_order_acquire); }
+
+    /**
+     * @return The total number of conditional requests issued to revalidate stale cached responses.
+     */
+    [[nodiscard]] auto cache_revalidations() const -> uint64_t
+    {
+        return m_cache_revalidations.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The total number of requests that shared an identical in flight request's response
+     *         instead of making their own transfer.
+     */
+    [[nodiscard]] auto requests_coalesced() const -> uint64_t
+    {
+        return m_requests_coalesced.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The total number of times a host's circuit breaker has opened on this client.
+     */
+    [[nodiscard]] auto circuit_breaker_opens() const -> uint64_t
+    {
+        return m_circuit_breaker_opens.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The total number of requests failed immediately because their host's circuit breaker was open.
+     */
+    [[nodiscard]] auto circuit_breaker_rejections() const -> uint64_t
+    {
+        return m_circuit_breaker_rejections.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The number of body bytes the in flight transfers are holding in memory, this is capped by
+     *         client::options::spill's maximum and only counted when spilling is enabled.
+     */
+    [[nodiscard]] auto body_memory_bytes() const -> uint64_t
+    {
+        return m_body_memory_bytes.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The total number of response bodies spilled into temporary files.
+     */
+    [[nodiscard]] auto bodies_spilled() const -> uint64_t { return m_bodies_spilled.load(std::memory_order_acquire); }
+
+    /**
+     * This function is thread safe and can be called from any thread.
+     * @param host The "host:port" to get the circuit breaker state of.  The port is required, the host is case
+     *             insensitive.
+     * @return The state of the host's circuit breaker, hosts without a breaker are always closed.
+     */
+    [[nodiscard]] auto host_circuit_breaker_state(std::string_view host) const -> circuit_breaker_state;
+
+    /**
+     * This function is thread safe and can be called from any thread.
+     * @param host The "host:port" to get the live concurrency limit of.  The port is required, the host is case
+     *             insensitive.
+     * @return The host's current adaptive concurrency limit, or std::nullopt if the host isn't limited.
+     */
+    [[nodiscard]] auto host_concurrency_limit(std::string_view host) const -> std::optional<uint32_t>;
+
+    /**
+     * This function is thread safe and can be called from any thread.
+     * @param host The "host:port" to get the number of queued requests of.  The port is required, the host is case
+     *             insensitive.
+     * @return The number of requests waiting in the host's queue to be admitted for execution.
+     */
+    [[nodiscard]] auto host_requests_queued(std::string_view host) const -> std::size_t;
+
+    /**
+     * This function is thread safe and can be called from any thread.
+     * @return The number of hosts this client is keeping circuit breaker, concurrency limit, rate limit
+     *         or latency state for, see client::options::host_idle_timeout.
+     */
+    [[nodiscard]] auto host_count() const -> std::size_t;
+
+    /**
+     * @return The total number of requests waiting in any host's queue to be admitted for execution.
+     *         These are included in size().
+     */
+    [[nodiscard]] auto requests_queued() const -> std::size_t
+    {
+        return m_requests_queued.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @return The total number of requests that have had to wait in a host's queue for a rate limit.
+     */
+    [[nodiscard]] auto requests_rate_limited() const -> uint64_t
+    {
+        return m_requests_rate_limited.load(std::memory_order_acquire);
+    }
+
     /**
      * Starts processing the given request.  The ownership of the request is transferred into the
      * client's background event loop thread during execution and is returned to the user when
@@ -111,6 +331,9 @@ public:
      *
      * This function is thread safe and can be called from any thread to start processing a request.
      *
+     * The request can be cancelled with cancel_request() and its id, see start_cancellable_request() for
+     * a token to cancel it with.
+     *
      * @throw std::runtime_error If the request_ptr is nullptr.
      * @param request_ptr The request to process.
      * @return A future that will be fulfilled upon the request completing processing.
@@ -124,11 +347,55 @@ public:
      *
      * This function is thread safe and can be called from any thread to start processing a request.
      *
+     * If the client has a response cache and it holds a fresh response for the request then the callback
+     * is invoked immediately on the calling thread and the request never reaches the event loop.  The
+     * same applies to the futures of the other start_request functions.
+     *
      * @throw std::runtime_error If the request_ptr or callback are nullptr.
      * @param request_ptr The request to process.  This request will have its OnComplete() handler
      *                    called when its completed/error'ed/etc.
+     * @return A token that can be used to cancel the request while it is executing.
+     */
+    auto start_request(request_ptr&& request_ptr, request::async_callback_type callback) -> cancellation_token;
+
+    /**
+     * Starts processing the given request like start_request(request_ptr&&) but also returns a token
+     * to cancel it, the future is fulfilled with lift_status::cancelled if the token is used while
+     * the request is executing.
+     *
+     * This function is thread safe and can be called from any thread to start processing a request.
+     *
+     * @throw std::runtime_error If the request_ptr is nullptr.
+     * @param request_ptr The request to process.
+     * @return A future that will be fulfilled upon the request completing processing, and a token that
+     *         can be used to cancel the request while it is executing.
      */
-    auto start_request(request_ptr&& request_ptr, request::async_callback_type callback) -> void;
+    [[nodiscard]] auto start_cancellable_request(request_ptr&& request_ptr)
+        -> std::pair<request::async_future_type, cancellation_token>;
+
+    /**
+     * Cancels every executing request with the given identifier, see lift::request::id().  Each
+     * cancelled request has its transfer removed from the event loop and is completed with
+     * lift_status::cancelled.  Requests that have already completed are unaffected.
+     *
+     * This function is thread safe and can be called from any thread, the cancellation is
+     * applied asynchronously on the client's background event loop thread.
+     *
+     * @param request_id The identifier of the request to cancel.
+     */
+    auto cancel_request(uint64_t request_id) -> void;
+
+    /**
+     * Cancels every executing request with the given tag, see lift::request::tag().  Each
+     * cancelled request has its transfer removed from the event loop and is completed with
+     * lift_status::cancelled.
+     *
+     * This function is thread safe and can be called from any thread, the cancellation is
+     * applied asynchronously on the client's background event loop thread.
+     *
+     * @param tag The tag of the requests to cancel.
+     */
+    auto cancel_requests(std::string tag) -> void;
 
     /**
      * Starts processing the set of given requests.  The ownership of the requests are transferred
@@ -208,6 +475,69 @@ public:
         start_requests_common(std::move(requests), amount);
     }
 
+    /**
+     * Registers a pull based request source with the client.  Rather than materializing every request
+     * up front the client's background event loop thread will pull requests from the source whenever
+     * the number of in flight requests for this source drops below the target concurrency.  This gives
+     * constant memory usage and natural backpressure for very large batches of requests.
+     *
+     * Each request pulled from the source has the given callback used as its on complete handler.  Like
+     * any other request it is served from the response cache when possible, in which case the callback
+     * is invoked right away on the event loop thread.
+     *
+     * If the source throws it is treated as exhausted, the exception is discarded and the requests
+     * already pulled from it are left to complete.
+     *
+     * The source counts as a single active request against size() until it is exhausted and all of
+     * its in flight requests have completed.  If the client is stopped the source is no longer pulled
+     * from and is released once its in flight requests complete.
+     *
+     * This function is thread safe and can be called from any thread to register a request source.
+     *
+     * @throw std::runtime_error If the source or callback are nullptr or the concurrency is zero.
+     * @param source The request source to pull requests from, return nullptr when exhausted.
+     * @param callback The on complete handler for every request pulled from the source.
+     * @param concurrency The maximum number of in flight requests from this source at any given time.
+     */
+    auto start_request_source(
+        request_source_type source, request::async_callback_type callback, std::size_t concurrency) -> void;
+
+    /**
+     * Downloads a large object into a file over several connections.  The object's size is found with a
+     * HEAD request, then it is split into byte ranges that are requested concurrently and each range is
+     * written into the file at its offset as it is received.  Ranges are sized from the throughput of the
+     * ranges already downloaded, a failed range is retried from its last written byte, and the callback
+     * receives the download's aggregate result once.  A server that doesn't accept byte ranges is downloaded
+     * with a single request.  If the download fails the file is left partially written.
+     *
+     * The callback is invoked on the client's background event loop thread.  If the client is stopped
+     * the download fails.
+     *
+     * This function is thread safe and can be called from any thread to start a download.
+     *
+     * @throw std::runtime_error If the callback is nullptr.
+     * @param url The object to download.
+     * @param path The file to write the object into, it is created or truncated.
+     * @param callback Invoked once with the download's result.
+     * @param options The download's concurrency, range sizing and retry options.
+     */
+    auto start_download(
+        std::string             url,
+        std::filesystem::path   path,
+        download_callback_type  callback,
+        ranged_download_options options = ranged_download_options{}) -> void;
+
+    /**
+     * Downloads a large object into a file over several connections, see start_download() above.
+     * @param url The object to download.
+     * @param path The file to write the object into, it is created or truncated.
+     * @param options The download's concurrency, range sizing and retry options.
+     * @return A future that will be fulfilled with the download's result.
+     */
+    [[nodiscard]] auto start_download(
+        std::string url, std::filesystem::path path, ranged_download_options options = ranged_download_options{})
+        -> std::future<ranged_download_result>;
+
 private:
     /// Set to true if the client is currently running.
     std::atomic<bool> m_is_running{false};
@@ -222,6 +552,8 @@ private:
     uv_async_t m_uv_async{};
     /// The async trigger to let uv_run() know its being shutdown
     uv_async_t m_uv_async_shutdown_pipe{};
+    /// The async trigger for delivering responses decoded on the decode pool.
+    uv_async_t m_uv_async_decoded{};
     /// libcurl requires a single timer to drive internal timeouts/wake-ups.
     uv_timer_t m_uv_timer_curl{};
     /// If set, the amount of time connections are allowed to connect, this can be
@@ -229,6 +561,14 @@ private:
     std::optional<std::chrono::milliseconds> m_connect_timeout{std::nullopt};
     /// Timeout timer.
     uv_timer_t m_uv_timer_timeout{};
+    /// Hedge timer, fires when the next hedged request should issue its duplicate.
+    uv_timer_t m_uv_timer_hedge{};
+    /// Retry timer, fires when the next request waiting on its backoff should be retried.
+    uv_timer_t m_uv_timer_retry{};
+    /// Rate limit timer, fires when the earliest rate limited request could next be admitted.
+    uv_timer_t m_uv_timer_rate_limit{};
+    /// Wait timer, fires when the next request waiting on an identical request or in a host's queue times out.
+    uv_timer_t m_uv_timer_wait_timeout{};
     /// The libcurl multi handle for driving multiple easy handles at once.
     CURLM* m_cmh{curl_multi_init()};
 
@@ -246,6 +586,18 @@ private:
     std::vector<request_ptr> m_pending_requests{};
     /// Only accessible from within the client thread.
     std::vector<request_ptr> m_grabbed_requests{};
+    /// Pending request sources are stored here until picked up on the next uv loop iteration,
+    /// this is also guarded by the m_pending_requests_lock.
+    std::vector<request_source_ptr> m_pending_request_sources{};
+    /// The currently registered request sources, only accessible from within the client thread.
+    std::vector<request_source_ptr> m_request_sources{};
+    /// Pending cancellations by request identifier, guarded by the m_pending_requests_lock.
+    std::vector<uint64_t> m_pending_cancel_ids{};
+    /// Pending cancellations by request tag, guarded by the m_pending_requests_lock.
+    std::vector<std::string> m_pending_cancel_tags{};
+    /// The cancellations being applied, only accessible from within the client thread.
+    std::vector<uint64_t>    m_grabbed_cancel_ids{};
+    std::vector<std::string> m_grabbed_cancel_tags{};
 
     /// The background thread spawned to drive the event loop.
     std::thread m_background_thread{};
@@ -267,6 +619,133 @@ private:
     /// Functor to call on background thread start/stop.
     on_thread_callback_type m_on_thread_callback{nullptr};
 
+    /// Requests with a hedge policy waiting to issue their hedged duplicate.
+    std::multimap<time_point, executor*> m_hedges{};
+    /// The maximum percentage of extra load hedged requests may add.
+    double m_hedge_budget_percent{10.0};
+    /// The total number of requests started on this client, only accessible from within the client thread.
+    uint64_t m_requests_started{0};
+    /// The total number of hedged duplicates issued.
+    std::atomic<uint64_t> m_hedges_issued{0};
+    /// The total number of hedged duplicates that delivered the final response.
+    std::atomic<uint64_t> m_hedges_won{0};
+
+    /// Requests waiting on their retry backoff to expire.
+    std::multimap<time_point, executor*> m_retries{};
+    /// The maximum percentage of requests that may be retried.
+    double m_retry_budget_percent{20.0};
+    /// The total number of retries issued.
+    std::atomic<uint64_t> m_retries_issued{0};
+    /// Random source for retry backoff jitter, only accessible from within the client thread.
+    std::minstd_rand m_retry_jitter{std::random_device{}()};
+
+    /// The executor delivering each executing request's response keyed by the request's identifier.
+    /// Only accessible from within the client thread.
+    std::multimap<uint64_t, executor*> m_cancellables{};
+    /// The total number of requests cancelled.
+    std::atomic<uint64_t> m_requests_cancelled{0};
+
+    /// The circuit breaker policy applied to every host, if any.
+    std::optional<circuit_breaker_policy> m_circuit_breaker_policy{std::nullopt};
+    /// Functor to call on circuit breaker state changes.
+    circuit_breaker_callback_type m_on_circuit_breaker_callback{nullptr};
+    /// The total number of times a host's circuit breaker has opened.
+    std::atomic<uint64_t> m_circuit_breaker_opens{0};
+    /// The total number of requests rejected by an open circuit breaker.
+    std::atomic<uint64_t> m_circuit_breaker_rejections{0};
+
+    /// The adaptive concurrency limit policy applied to every host, if any.
+    std::optional<concurrency_limit_policy> m_concurrency_limit_policy{std::nullopt};
+    /// The total number of requests waiting in the per host queues.
+    std::atomic<std::size_t> m_requests_queued{0};
+
+    /// The rate limit applied to every host, if any.
+    std::optional<rate_limit> m_host_rate_limit{std::nullopt};
+    /// The bucket limiting every request this client starts, if any.
+    std::optional<token_bucket> m_global_bucket{std::nullopt};
+    /// The buckets limiting tagged requests keyed by tag.  Only accessible from within the client thread.
+    std::map<std::string, token_bucket, std::less<>> m_tag_buckets{};
+    /// When the rate limit timer is scheduled to fire, if it is active.
+    std::optional<time_point> m_rate_limit_wake{std::nullopt};
+    /// The total number of requests that have waited on a rate limit.
+    std::atomic<uint64_t> m_requests_rate_limited{0};
+
+    /**
+     * An in flight request that identical requests are waiting on.  The leading request's completion
+     * handler is swapped out for one that completes the flight, the user's handler is kept here.
+     */
+    struct flight
+    {
+        /// The leading request's original completion handler.
+        request::async_handlers_type m_handler{std::monostate{}};
+        /// The identical requests waiting on the leading request's response.
+        std::vector<impl::queued_request> m_waiters{};
+    };
+
+    /// The request header names that are part of a single flight key, single flight is disabled if not set.
+    std::optional<std::vector<std::string>> m_single_flight_headers{std::nullopt};
+    /// The in flight requests keyed by their single flight key.  Only accessible from within the client thread.
+    std::map<std::string, flight, std::less<>> m_flights{};
+    /// Waiters whose leading request was cancelled, they are re-added on the next loop iteration.
+    std::vector<impl::queued_request> m_flight_orphans{};
+    /// Single flight waiters and queued requests with a timeout keyed by their deadline.
+    std::multimap<time_point, impl::wait_timeout> m_wait_timeouts{};
+    /// The total number of requests that shared another request's response.
+    std::atomic<uint64_t> m_requests_coalesced{0};
+
+    /// The pool response bodies are allocated from, if any.
+    std::shared_ptr<lift::buffer_pool> m_buffer_pool{nullptr};
+
+    /// The response cache, if any.
+    std::shared_ptr<response_cache> m_cache{nullptr};
+    /// Guards m_cache_revalidating.
+    std::mutex m_cache_lock{};
+    /// The cache keys being revalidated in the background while their stale responses are served.
+    std::set<std::string, std::less<>> m_cache_revalidating{};
+    /// The total number of requests served from the cache.
+    std::atomic<uint64_t> m_cache_hits{0};
+    /// The total number of cacheable requests not served from the cache.
+    std::atomic<uint64_t> m_cache_misses{0};
+    /// The total number of conditional requests issued to revalidate cached responses.
+    std::atomic<uint64_t> m_cache_revalidations{0};
+
+    /// The spill thresholds, response bodies are always held in memory if not set.
+    std::optional<spill_options> m_spill_options{std::nullopt};
+    /// The number of body bytes the in flight transfers are holding in memory.
+    std::atomic<uint64_t> m_body_memory_bytes{0};
+    /// The total number of response bodies spilled into temporary files.
+    std::atomic<uint64_t> m_bodies_spilled{0};
+
+    /// A completed request whose response body is being decoded on the decode pool.
+    struct decoded_request
+    {
+        /// The request's completion handler.
+        request::async_handlers_type m_handler{std::monostate{}};
+        /// The completed request.
+        request_ptr m_request{nullptr};
+        /// The response, decoded once it is handed back to the event loop.
+        response m_response{};
+    };
+
+    /// The pool response bodies are decoded on, if any.
+    std::shared_ptr<lift::decode_pool> m_decode_pool{nullptr};
+    /// Guards m_decoded_requests.
+    std::mutex m_decoded_lock{};
+    /// Requests whose responses have been decoded and are waiting to be delivered on the event loop.
+    std::vector<decoded_request> m_decoded_requests{};
+    /// The decoded requests being delivered, only accessible from within the client thread.
+    std::vector<decoded_request> m_grabbed_decoded_requests{};
+
+    /// Guards inserting into m_hosts so other threads can safely look up a host's live values.
+    mutable std::mutex m_hosts_lock{};
+    /// Per host state, keyed by the "host:port" of each request's url.  Only modified from within
+    /// the client thread.
+    std::map<std::string, impl::host_state, std::less<>> m_hosts{};
+    /// How long in milliseconds a host must go unused before its state is evicted, if ever.
+    std::optional<uint64_t> m_host_idle_timeout{std::nullopt};
+    /// The loop time the hosts are next checked for idle state to evict.
+    uint64_t m_next_host_eviction{0};
+
     /**
      * Common code between future and callback start request functions.
      */
@@ -288,6 +767,17 @@ private:
             return;
         }
 
+        if (m_cache != nullptr)
+        {
+            for (auto& request_ptr : requests)
+            {
+                if (request_ptr != nullptr && serve_from_cache(request_ptr))
+                {
+                    --amount;
+                }
+            }
+        }
+
         m_active_request_count.fetch_add(amount, std::memory_order_release);
 
         {
@@ -306,6 +796,25 @@ private:
         uv_async_send(&m_uv_async);
     }
 
+    /**
+     * Serves the request from the response cache if it holds a usable response, otherwise prepares the
+     * request to store its response and, if the cached response is stale, to revalidate it.  This is
+     * called on the thread starting the request.
+     * @param request_ptr The request to serve, this is only moved from if it was served.
+     * @return True if the request was completed from the cache.
+     */
+    auto serve_from_cache(request_ptr& request_ptr) -> bool;
+
+    /**
+     * Swaps the request's completion handler for one that stores or revalidates its response in the cache
+     * before notifying the user.
+     * @param request The request to cache the response of.
+     * @param key The request's cache key.
+     * @param entry The stale entry being revalidated by this request, if any.
+     * @param background True if this is a background revalidation nobody is waiting on.
+     */
+    auto cache_on_complete(request& request, std::string key, cache_entry_ptr entry, bool background) -> void;
+
     /**
      * Utility function to notify the user correctly when a request fails to start.
      */
@@ -353,6 +862,138 @@ private:
      */
     auto check_actions(curl_socket_t socket, int event_bitmask) -> void;
 
+    /**
+     * Admits the request on the client thread.  If the request's host has no room it waits in the host's
+     * queue, otherwise it starts executing immediately.
+     * @param request_ptr The request to start executing.
+     * @param source The request source this request was pulled from, if any.
+     */
+    auto add_request(request_ptr&& request_ptr, request_source* source = nullptr) -> void;
+
+    /**
+     * Starts executing the request on the client thread.  This acquires an executor, prepares it
+     * and adds it to the curl multi handle.
+     * @param request_ptr The request to start executing.
+     * @param source The request source this request was pulled from, if any.
+     * @param concurrency_acquired True if a slot in the host's concurrency limiter is held for this request.
+     */
+    auto execute_request(request_ptr&& request_ptr, request_source* source, bool concurrency_acquired) -> void;
+
+    /**
+     * @param request The request to build the single flight key of.
+     * @return The key identifying identical requests, or std::nullopt if the request can't be coalesced.
+     */
+    auto single_flight_key(const request& request) const -> std::optional<std::string>;
+
+    /**
+     * Attaches the request to an identical in flight request, or makes it the leader of a new flight.
+     * @param request_ptr The request to coalesce, this is only moved from if it joined a flight.
+     * @param source The request source this request was pulled from, if any.
+     * @return True if the request joined an existing flight and will be completed with its response.
+     */
+    auto join_flight(request_ptr& request_ptr, request_source* source) -> bool;
+
+    /**
+     * Delivers the leading request's response to every waiter and then to the leader's original handler.
+     * If the leader was cancelled the waiters are re-added instead since they weren't cancelled.
+     * @param key The flight's single flight key.
+     * @param leader The leading request.
+     * @param leader_response The leading request's response.
+     */
+    auto complete_flight(const std::string& key, request_ptr leader, response leader_response) -> void;
+
+    /**
+     * Registers the deadline of a request that waits without an executor, it is set from the request's
+     * timeout unless it already has one.  Does nothing if the request has neither.
+     * @param waiter The waiting request.
+     * @param key The single flight key of the flight, or the host of the queue, it waits in.
+     * @param host_queue True if it waits in a host's queue, false if it waits on a flight.
+     */
+    auto add_wait_timeout(impl::queued_request& waiter, std::string key, bool host_queue) -> void;
+
+    /**
+     * Unregisters the waiter's deadline, if it has one.
+     * @param waiter The waiter leaving its flight or host queue.
+     */
+    auto remove_wait_timeout(const impl::queued_request& waiter) -> void;
+
+    /**
+     * Updates the event loop wait timer information.
+     */
+    auto update_wait_timeouts() -> void;
+
+    /**
+     * Completes every waiter whose deadline has passed with lift_status::timeout, the flight they were
+     * waiting on keeps going and a queued request is removed from its host's queue.
+     */
+    auto complete_wait_timeouts() -> void;
+
+    /**
+     * Invokes a request's completion handler.
+     * @param handler The completion handler to invoke.
+     * @param request_ptr The completed request.
+     * @param response The completed request's response.
+     */
+    static auto notify(request::async_handlers_type& handler, request_ptr request_ptr, response response) -> void;
+
+    /// The outcome of checking a request against its host's concurrency and rate limits.
+    enum class admission
+    {
+        /// The request may execute, its concurrency slot and rate limit tokens have been taken.
+        admitted,
+        /// The host's concurrency limit is reached, a completing request will make room.
+        concurrency_limited,
+        /// A rate limit is exhausted, the rate limit timer will make room.
+        rate_limited
+    };
+
+    /**
+     * Checks every rate limit the request is subject to and then its host's concurrency limit, taking
+     * the rate limit tokens and concurrency slot only if all of them have room.
+     * @param host The request's host.
+     * @param request The request to admit.
+     * @return The admission outcome.
+     */
+    auto try_admit(impl::host_state& host, const request& request) -> admission;
+
+    /**
+     * @param host The request's host.
+     * @param request The rate limited request.
+     * @return The time in milliseconds until every rate limit the request is subject to has a token.
+     */
+    auto rate_limit_wait(impl::host_state& host, const request& request) -> uint64_t;
+
+    /**
+     * Schedules the rate limit timer to fire after the wait unless it is already scheduled to fire sooner.
+     * @param wait The time in milliseconds until a rate limited request can be admitted.
+     */
+    auto schedule_rate_limit(uint64_t wait) -> void;
+
+    /**
+     * @param queued A request waiting in its host's queue.
+     * @param wait The number of milliseconds until the rate limits could admit it, see rate_limit_wait().
+     * @return True if the request would time out before the rate limits admit it.
+     */
+    auto outlives_deadline(const impl::queued_request& queued, uint64_t wait) -> bool;
+
+    /**
+     * Completes a request that timed out while waiting in its host's queue with lift_status::timeout.
+     * @param queued The request, already removed from the queue and its wait timeout.
+     */
+    auto complete_queued_timeout(impl::queued_request& queued) -> void;
+
+    /**
+     * Starts executing queued requests for every host that has room for them.  Each host's queue is
+     * strictly FIFO, a rate limited request at the front holds back the requests behind it.
+     */
+    auto drain_host_queues() -> void;
+
+    /**
+     * Pulls requests from each registered request source until their target concurrency is reached
+     * and releases any sources that are exhausted with nothing left in flight.
+     */
+    auto pull_request_sources() -> void;
+
     /**
      * Completes a request to pass ownership back to the user land.
      * Manages internal state accordingly, always call this function rather
@@ -362,6 +1003,173 @@ private:
      */
     auto complete_request_normal(executor_ptr exe_ptr, CURLcode curl_code) -> void;
 
+    /**
+     * Hands the completed request's encoded response to the decode pool, the request is delivered on the
+     * event loop once it is decoded.
+     * @param handler The request's completion handler.
+     * @param request_ptr The completed request.
+     * @param response The request's encoded response.
+     */
+    auto decode_offloaded(request::async_handlers_type handler, request_ptr request_ptr, response response) -> void;
+
+    /**
+     * Decodes the response in place, bounded by the decode pool's limit.  A body that is corrupt completes with
+     * CURLE_BAD_CONTENT_ENCODING and one that decodes past the limit with lift_status::download_error.  This is
+     * called on the event loop or a decode pool worker thread.
+     * @param response The request's encoded response.
+     */
+    auto decode_response(response& response) const -> void;
+
+    /**
+     * Aborts an executing request by removing it from the curl multi handle and any pending timers.
+     * The user is not notified, the caller is responsible for the returned executor.
+     * @param exe The executor to abort.
+     * @return The aborted executor.
+     */
+    auto abort_executor(executor& exe) -> executor_ptr;
+
+    /**
+     * Registers the executor as the one delivering its request's response so it can be cancelled.
+     */
+    auto add_cancellable(executor& exe) -> void;
+
+    /**
+     * Unregisters the executor from being cancelled, if it is registered.
+     */
+    auto remove_cancellable(executor& exe) -> void;
+
+    /**
+     * Applies all the pending cancellations to the executing requests.
+     * @param ids The request identifiers to cancel.
+     * @param tags The request tags to cancel.
+     */
+    auto cancel_executors(const std::vector<uint64_t>& ids, const std::vector<std::string>& tags) -> void;
+
+    /**
+     * Aborts the executing request and any hedge racing it and completes it with the given status.
+     * @param exe The executor delivering the request's response.
+     * @param status The status to complete the request with.
+     * @return True if the user was notified, false if the request had already timed out to the user.
+     */
+    auto complete_request_aborted(executor& exe, lift_status status) -> bool;
+
+    /**
+     * Completes a request that is waiting in a host's queue or on a single flight with the given status,
+     * it has no executor and never reached curl.  A lift_status::timeout is reported like an executing
+     * request's timeout.
+     * @param queued The waiting request, its request is moved into the user's notification.
+     * @param status The status to complete the request with.
+     */
+    auto complete_request_aborted(impl::queued_request& queued, lift_status status) -> void;
+
+    /**
+     * Asks the host's circuit breaker if the executor's next attempt may execute.
+     * @param exe The executor about to start an attempt.
+     * @return True if the attempt may execute, false if it should fail immediately.
+     */
+    auto circuit_breaker_admit(executor& exe) -> bool;
+
+    /**
+     * Records the outcome of the executor's attempt with its host's circuit breaker, if it was admitted.
+     * @param exe The executor that has completed an attempt.
+     * @param failure True if the attempt failed in a way that indicates the host is unhealthy.
+     */
+    auto circuit_breaker_record(executor& exe, bool failure) -> void;
+
+    /**
+     * @param curl_handle The curl handle of the completed attempt.
+     * @param curl_code The status of the completed attempt.
+     * @return True if the attempt's outcome indicates its host is unhealthy or overloaded, connect errors,
+     *         timeouts and 5xx responses all count against the host's circuit breaker and concurrency limit.
+     */
+    static auto is_host_failure(CURL* curl_handle, CURLcode curl_code) -> bool;
+
+    /**
+     * Mirrors the host's circuit breaker state and notifies the user if it changed.
+     * @param url The url of the request that interacted with the breaker.
+     * @param host The host state owning the breaker.
+     * @param from The state of the breaker before the interaction.
+     */
+    auto circuit_breaker_changed(std::string_view url, impl::host_state& host, circuit_breaker_state from) -> void;
+
+    /**
+     * @param url The url to find the host state for.
+     * @return The host state for the url's "host:port", created if it doesn't exist yet.
+     */
+    auto find_host_state(std::string_view url) -> impl::host_state&;
+
+    /**
+     * @param exe The executor to find the host state for, it is cached on the executor after the first lookup.
+     * @return The host state for the executor's request.
+     */
+    auto find_host_state(executor& exe) -> impl::host_state&;
+
+    /**
+     * Evicts the state of every host that has been idle for the host idle timeout.  This is only
+     * called at the start of an event loop callback since it invalidates references to the evicted
+     * hosts, the hosts are checked at most once per idle timeout.
+     */
+    auto evict_idle_hosts() -> void;
+
+    /**
+     * Schedules the hedged duplicate for the request if it has a hedge policy.
+     * @param exe The executor of the original request that was just started.
+     */
+    auto add_hedge(executor& exe) -> void;
+
+    /**
+     * Removes the pending hedge for the request, if any.
+     */
+    auto remove_hedge(executor& exe) -> std::multimap<uint64_t, executor*>::iterator;
+
+    /**
+     * Updates the event loop hedge timer information.
+     */
+    auto update_hedges() -> void;
+
+    /**
+     * Issues the hedged duplicate for the original request if it is still executing and the
+     * hedge budget allows for it.
+     * @param exe The executor of the original request.
+     */
+    auto start_hedge(executor& exe) -> void;
+
+    /**
+     * Decides the outcome of a completed executor that is racing a hedge.
+     * @param exe The executor that has completed.
+     * @param curl_code The status of the executor when completing.
+     * @return True if this executor delivers the final response to the user, false if it lost
+     *         and the peer is still running.
+     */
+    auto complete_request_hedged(executor& exe, CURLcode curl_code) -> bool;
+
+    /**
+     * Determines if the completed request should be retried per its retry policy and if so schedules
+     * the retry on the event loop, the executor is kept and re-used for the next attempt.
+     * @param exe The executor of the request that has completed an attempt.
+     * @param curl_code The status of the attempt.
+     * @return True if a retry was scheduled and the user should not be notified yet.
+     */
+    auto add_retry(executor& exe, CURLcode curl_code) -> bool;
+
+    /**
+     * Updates the event loop retry timer information.
+     */
+    auto update_retries() -> void;
+
+    /**
+     * Starts the next attempt of a request that was waiting on its retry backoff.  The attempt is subject
+     * to the same concurrency and rate limits as a new request and is queued behind the host's requests.
+     * @param exe The executor of the request to retry.
+     */
+    auto start_retry(executor& exe) -> void;
+
+    /**
+     * Adds the retry's curl handle back into the curl multi handle once it has been admitted.
+     * @param exe The executor of the request to retry.
+     */
+    auto execute_retry(executor& exe) -> void;
+
     /**
      * Completes a request that has timed out but still has connection time remaining.
      * @param exe The request to timeout.
@@ -471,7 +1279,16 @@ private:
 
     friend auto on_uv_shutdown_async(uv_async_t* handle) -> void;
 
+    friend auto on_uv_decoded_async(uv_async_t* handle) -> void;
+
     friend auto on_uv_timesup_callback(uv_timer_t* handle) -> void;
+
+    friend auto on_uv_hedge_callback(uv_timer_t* handle) -> void;
+
+    friend auto on_uv_retry_callback(uv_timer_t* handle) -> void;
+    friend auto on_uv_wait_timeout_callback(uv_timer_t* handle) -> void;
+
+    friend auto on_uv_rate_limit_callback(uv_timer_t* handle) -> void;
 };
 
 } // namespace lift
@@ -36,7 +36,23 @@ public:
     [[nodiscard]] auto empty() const -> bool { return size() == 0; }
 
     [[nodiscard]] auto start_request(request_ptr&& request_ptr) -> request::async_future_type;
-    auto               start_request(request_ptr&& request_ptr, request::async_callback_type callback) -> void;
+    auto               start_request(request_ptr&& request_ptr, request::async_callback_type callback)
+        -> cancellation_token;
+    [[nodiscard]] auto start_cancellable_request(request_ptr&& request_ptr)
+        -> std::pair<request::async_future_type, cancellation_token>;
+
+    /**
+     * Downloads a large object into a file with its ranges spread across the pool's clients, see
+     * lift::client::start_download().
+     */
+    auto start_download(
+        std::string             url,
+        std::filesystem::path   path,
+        download_callback_type  callback,
+        ranged_download_options options = ranged_download_options{}) -> void;
+    [[nodiscard]] auto start_download(
+        std::string url, std::filesystem::path path, ranged_download_options options = ranged_download_options{})
+        -> std::future<ranged_download_result>;
 
     template<typename container_type>
     auto start_requests(container_type&& requests) -> std::vector<request::async_future_type>
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace lift
+{
+enum class concurrency_limit_algorithm : uint8_t
+{
+    /// Additive increase, multiplicative decrease.  The limit grows by one per healthy sample and backs
+    /// off by the backoff ratio on a failure or when latency exceeds the tolerance over the minimum latency.
+    aimd,
+    /// The limit follows the ratio between the minimum latency and the observed latency, plus a small
+    /// allowance for queueing, similar to TCP Vegas.
+    gradient
+};
+
+/**
+ * @param algorithm Convert the concurrency limit algorithm to a human readable string.
+ * @return String representation of the algorithm.
+ */
+auto to_string(concurrency_limit_algorithm algorithm) -> const std::string&;
+
+struct concurrency_limit_policy
+{
+    /// The algorithm used to adjust the limit.
+    concurrency_limit_algorithm m_algorithm{concurrency_limit_algorithm::aimd};
+    /// The limit before any samples have been taken.
+    uint32_t m_initial_limit{20};
+    /// The limit will never drop below this value.
+    uint32_t m_min_limit{1};
+    /// The limit will never grow above this value.
+    uint32_t m_max_limit{1000};
+    /// The multiplier applied to the limit on a failure, or by aimd on a latency above the tolerance.
+    double m_backoff_ratio{0.9};
+    /// Latency above the minimum latency multiplied by this tolerance is considered congestion.
+    double m_latency_tolerance{2.0};
+    /// Gradient only, how much of each newly calculated limit is blended into the current limit, (0, 1].
+    double m_smoothing{0.2};
+    /// The minimum latency is re-measured after this many samples so it can follow the upstream.
+    uint32_t m_min_latency_window{1000};
+};
+
+/**
+ * Adaptive concurrency limiter for a single upstream host.  Every request acquires a slot before
+ * executing and releases it when done, the latency of each completed request is sampled against the
+ * minimum observed latency to grow or shrink the number of slots.
+ *
+ * This class is not thread safe, a lift::client only accesses it from its event loop thread.
+ */
+class concurrency_limiter
+{
+public:
+    /**
+     * @param policy The algorithm and bounds for this limiter.
+     */
+    explicit concurrency_limiter(concurrency_limit_policy policy);
+    ~concurrency_limiter() = default;
+
+    concurrency_limiter(const concurrency_limiter&)                        = default;
+    concurrency_limiter(concurrency_limiter&&) noexcept                    = default;
+    auto operator=(const concurrency_limiter&) -> concurrency_limiter&     = default;
+    auto operator=(concurrency_limiter&&) noexcept -> concurrency_limiter& = default;
+
+    /**
+     * @return True if a slot was acquired and the request may execute, false if the limit is reached.
+     */
+    auto try_acquire() -> bool;
+
+    /**
+     * Releases a previously acquired slot.
+     */
+    auto release() -> void;
+
+    /**
+     * Adjusts the limit from a completed request, this should be called before its slot is released.
+     * @param latency The total time of the completed request.
+     * @param failure True if the request failed in a way that indicates the upstream is overloaded.
+     */
+    auto sample(std::chrono::milliseconds latency, bool failure) -> void;
+
+    /**
+     * @return The current number of requests allowed in flight.
+     */
+    [[nodiscard]] auto limit() const noexcept -> uint32_t { return static_cast<uint32_t>(m_limit); }
+
+    /**
+     * @return The current number of requests in flight.
+     */
+    [[nodiscard]] auto in_flight() const noexcept -> uint32_t { return m_in_flight; }
+
+    /**
+     * @return The minimum observed latency, or std::nullopt if no samples have been taken.
+     */
+    [[nodiscard]] auto min_latency() const noexcept -> std::optional<std::chrono::milliseconds>;
+
+private:
+    /// The algorithm and bounds for this limiter.
+    concurrency_limit_policy m_policy{};
+    /// The current limit, fractional so small adjustments accumulate.
+    double m_limit{0};
+    /// The current number of requests in flight.
+    uint32_t m_in_flight{0};
+    /// The minimum latency in milliseconds, or a negative value if there are no samples yet.
+    double m_min_latency{-1};
+    /// The minimum latency observed in the current window.
+    double m_window_min_latency{-1};
+    /// The number of samples taken in the current window.
+    uint32_t m_window_samples{0};
+};
+
+} // namespace lift
@@ -1,10 +1,22 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace lift
 {
 static constexpr uint64_t header_default_memory_bytes = 4096;
 static constexpr uint64_t header_default_count        = 16;
+/// The number of slots in a response's case insensitive header index, a power of two.
+static constexpr std::size_t header_index_slots = 64;
+/// The number of header fields indexed, later fields are found by scanning so the index stays half empty.
+static constexpr std::size_t header_index_max_count = header_index_slots / 2;
+
+/// The largest Content-Length a response body is presized for, larger bodies are chained in segments.
+static constexpr uint64_t body_presize_max_bytes = 256 * 1024 * 1024;
+/// The size of the first segment of a response body of unknown length, each segment doubles in size.
+static constexpr uint64_t body_segment_min_bytes = 16 * 1024;
+/// The largest segment of a response body of unknown length.
+static constexpr uint64_t body_segment_max_bytes = 1024 * 1024;
 
 } // namespace lift
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lift
+{
+struct decode_pool_options
+{
+    /// The number of worker threads decoding response bodies.
+    std::size_t m_threads{2};
+    /// Encoded bodies smaller than this are decoded on the client's event loop, handing them to a worker
+    /// costs more than decoding them.
+    std::size_t m_min_offload_bytes{64 * 1024};
+    /// Encoded bodies that decode to more than this complete with lift_status::download_error rather than
+    /// decoding without bound, a small body from an untrusted server can decode to gigabytes.
+    std::size_t m_max_decoded_bytes{1024 * 1024 * 1024};
+};
+
+/**
+ * Decodes compressed response bodies off of the clients' event loop threads, see client::options::decode_pool.
+ * Requests that accept an encoding are received still encoded and each large body is decoded on one of the
+ * pool's worker threads before its request completes, the event loop only moves bytes and decoding throughput
+ * scales with the number of workers.  A pool can be shared between clients.
+ */
+class decode_pool
+{
+public:
+    using job_type = std::function<void()>;
+
+    /**
+     * Starts the worker threads.
+     * @param options The number of workers and the smallest body worth handing to them.
+     */
+    explicit decode_pool(decode_pool_options options = decode_pool_options{});
+
+    /**
+     * Runs every job already submitted and joins the worker threads.
+     */
+    ~decode_pool();
+
+    decode_pool(const decode_pool&)                    = delete;
+    decode_pool(decode_pool&&)                         = delete;
+    auto operator=(const decode_pool&) -> decode_pool& = delete;
+    auto operator=(decode_pool&&) -> decode_pool&      = delete;
+
+    /**
+     * This function is thread safe and can be called from any thread.
+     * @param job The job to run on one of the worker threads.
+     */
+    auto submit(job_type job) -> void;
+
+    /**
+     * @return The number of workers and the smallest body worth handing to them.
+     */
+    [[nodiscard]] auto options() const -> const decode_pool_options& { return m_options; }
+
+    /**
+     * @return The total number of jobs submitted.
+     */
+    [[nodiscard]] auto jobs_submitted() const -> uint64_t { return m_jobs_submitted.load(std::memory_order_acquire); }
+
+private:
+    /// The number of workers and the smallest body worth handing to them.
+    decode_pool_options m_options{};
+    /// Guards m_jobs and m_stopping.
+    std::mutex m_lock{};
+    /// Wakes a worker when a job is submitted or the pool is stopping.
+    std::condition_variable m_wake{};
+    /// The jobs waiting for a worker.
+    std::deque<job_type> m_jobs{};
+    /// Set when the pool is destroyed, the workers exit once m_jobs is empty.
+    bool m_stopping{false};
+    /// The total number of jobs submitted.
+    std::atomic<uint64_t> m_jobs_submitted{0};
+    /// The worker threads.
+    std::vector<std::thread> m_workers{};
+
+    /**
+     * Runs jobs until the pool is stopping and there are none left.
+     */
+    auto run() -> void;
+};
+
+} // namespace lift
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace lift
+{
+enum class digest_algorithm : uint8_t
+{
+    /// CRC-32C (Castagnoli), computed with the CPU's CRC32 instructions where available.
+    crc32c,
+    /// xxHash64 with a zero seed.
+    xxhash64,
+    /// SHA-256.
+    sha256,
+    /// MD5, only for verifying legacy Content-MD5 headers.
+    md5
+};
+
+/**
+ * @param algorithm The digest algorithm.
+ * @return The algorithm's name as used in Digest and Repr-Digest headers, e.g. "sha-256".
+ */
+auto to_string(digest_algorithm algorithm) -> std::string_view;
+
+namespace impl
+{
+struct crc32c_state
+{
+    uint32_t m_crc{0xFFFFFFFF};
+};
+
+/// SHA-256 and MD5 both hash 64 byte blocks.
+template<std::size_t word_count>
+struct block_state
+{
+    std::array<uint32_t, word_count> m_words{};
+    std::array<uint8_t, 64>          m_block{};
+    std::size_t                      m_buffered{0};
+    uint64_t                         m_total{0};
+};
+
+struct xxhash64_state
+{
+    std::array<uint64_t, 4> m_accumulators{};
+    std::array<uint8_t, 32> m_stripe{};
+    std::size_t             m_buffered{0};
+    uint64_t                m_total{0};
+};
+
+using sha256_state = block_state<8>;
+using md5_state    = block_state<4>;
+
+} // namespace impl
+
+/**
+ * Computes a digest incrementally so a body is hashed one chunk at a time as it is received,
+ * rather than in a second pass over the complete body.
+ */
+class hasher
+{
+public:
+    /**
+     * @param algorithm The digest algorithm to compute.
+     */
+    explicit hasher(digest_algorithm algorithm);
+
+    /**
+     * @param data The next bytes to hash.
+     */
+    auto update(std::string_view data) -> void;
+
+    /**
+     * Completes the digest, the hasher must not be updated afterwards.
+     * @return The digest in its canonical byte order, e.g. big endian for CRC-32C and xxHash64.
+     */
+    auto finish() -> std::vector<uint8_t>;
+
+    /**
+     * @return The digest algorithm being computed.
+     */
+    [[nodiscard]] auto algorithm() const -> digest_algorithm { return static_cast<digest_algorithm>(m_state.index()); }
+
+private:
+    /// The state of the digest being computed, the alternatives are in digest_algorithm order.
+    std::variant<impl::crc32c_state, impl::xxhash64_state, impl::sha256_state, impl::md5_state> m_state;
+};
+
+/**
+ * @param digest The digest bytes.
+ * @return The digest as lower case hex.
+ */
+auto to_hex(const std::vector<uint8_t>& digest) -> std::string;
+
+/**
+ * @param encoded Base64 encoded bytes, e.g. a Content-MD5 header value.
+ * @return The decoded bytes, or std::nullopt if the encoding is invalid.
+ */
+auto from_base64(std::string_view encoded) -> std::optional<std::vector<uint8_t>>;
+
+/**
+ * Finds the algorithm's digest in a Repr-Digest (RFC 9530) or Digest (RFC 3230) header value,
+ * e.g. "sha-256=:X48E9qOokqqrvdts8nOJRJN3OWDUoyWxBf7kbu9DBPE=:".
+ * @param value The header value.
+ * @param algorithm The digest algorithm to find.
+ * @return The decoded digest, or std::nullopt if the header doesn't have one for the algorithm.
+ */
+auto parse_digest_header(std::string_view value, digest_algorithm algorithm) -> std::optional<std::vector<uint8_t>>;
+
+} // namespace lift
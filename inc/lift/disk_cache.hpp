@@ -0,0 +1,171 @@
+#pragma once
+
+#include "lift/response_cache.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace lift
+{
+enum class disk_cache_mode : uint8_t
+{
+    /// This process owns the cache file, it stores, erases and compacts entries.  Only one process
+    /// can open a cache file for writing at a time.
+    read_write,
+    /// This process only serves entries from the cache file, picking up entries stored by the
+    /// writing process as they are appended.  Any number of processes can share a cache file this way.
+    shared_read
+};
+
+struct disk_cache_options
+{
+    /// The cache file, the writer also creates "<path>.lock" next to it.
+    std::filesystem::path m_path{};
+    /// Whether this process writes to or only reads from the cache file.
+    disk_cache_mode m_mode{disk_cache_mode::read_write};
+    /// The cache file is compacted, dropping the oldest entries, once it would grow beyond this size.
+    uint64_t m_max_bytes{1024 * 1024 * 1024};
+};
+
+/**
+ * A persistent response_cache backed by an append only file that is memory mapped for reading.
+ * Responses served from the cache view their body directly in the mapping rather than copying it.
+ *
+ * Every record carries a checksum, when the cache file is opened the records are scanned to rebuild
+ * the index by cache key and a torn record left by a crash ends the scan and is discarded.  Compaction
+ * writes the live records to a new file which then atomically replaces the cache file, so a crash
+ * mid compaction leaves the previous cache file intact.  Readers notice the replacement and re-map.
+ *
+ * Each cache key holds the most recently stored variant, its Vary values are stored in the record and
+ * checked by the client on lookup.
+ */
+class disk_cache final : public response_cache
+{
+public:
+    /**
+     * Opens, or for the writer creates, the cache file.
+     * @throw std::runtime_error If the cache file can't be opened, isn't a cache file or another process
+     *                           already has it open for writing.
+     * @param options The cache file and mode.
+     */
+    explicit disk_cache(disk_cache_options options);
+    ~disk_cache() override;
+
+    auto find(std::string_view key) -> cache_entry_ptr override;
+    auto store(std::string_view key, cache_entry_ptr entry) -> void override;
+    auto erase(std::string_view key) -> void override;
+
+    /**
+     * Rewrites the cache file with only its live entries, this is a no-op for readers.
+     */
+    auto compact() -> void;
+
+    /**
+     * @return The number of entries held.
+     */
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /**
+     * @return The size of the cache file in bytes.
+     */
+    [[nodiscard]] auto file_bytes() const -> uint64_t;
+
+    /**
+     * @return The number of bytes of live records in the cache file.
+     */
+    [[nodiscard]] auto live_bytes() const -> uint64_t;
+
+private:
+    /// Where a live record is in the cache file.
+    struct record_location
+    {
+        /// The offset of the record's header in the cache file.
+        uint64_t m_offset{0};
+        /// The total size of the record including its header.
+        uint64_t m_size{0};
+        /// The decoded entry once it has been looked up, it views the body in the mapping it was decoded from.
+        cache_entry_ptr m_entry{nullptr};
+    };
+
+    /// The cache file and mode.
+    disk_cache_options m_options{};
+    /// Guards every member below.
+    mutable std::mutex m_lock{};
+    /// The open cache file, -1 if a reader is waiting on the writer to create it.
+    int m_fd{-1};
+    /// The writer's lock file, held for the writer's lifetime.
+    int m_lock_fd{-1};
+    /// The inode of the open cache file, a reader re-opens when compaction replaces the file.
+    uint64_t m_inode{0};
+    /// The number of bytes of the cache file that have been scanned into the index.
+    uint64_t m_file_bytes{0};
+    /// The number of bytes of live records.
+    uint64_t m_live_bytes{0};
+    /// The current read only mapping of the cache file, responses keep old mappings alive until released.
+    std::shared_ptr<const char> m_mapping{nullptr};
+    /// The number of bytes of the cache file in m_mapping.
+    uint64_t m_mapping_bytes{0};
+    /// The live records keyed by cache key.
+    std::map<std::string, record_location, std::less<>> m_index{};
+
+    /**
+     * Opens the cache file and rebuilds the index from it, the lock must be held.
+     */
+    auto open_locked() -> void;
+
+    /**
+     * Releases the cache file and mapping and clears the index, the lock must be held.
+     */
+    auto close_locked() -> void;
+
+    /**
+     * Indexes any records appended since the last scan and re-opens the cache file if it was replaced,
+     * the lock must be held.
+     */
+    auto refresh_locked() -> void;
+
+    /**
+     * Scans and indexes the records from m_file_bytes up to the end of the file, the lock must be held.
+     * @return The offset of the end of the last valid record.
+     */
+    auto scan_locked() -> uint64_t;
+
+    /**
+     * Maps the cache file if the current mapping is too small, the lock must be held.
+     * @param bytes The number of bytes of the cache file that must be mapped.
+     */
+    auto remap_locked(uint64_t bytes) -> void;
+
+    /**
+     * Appends a record to the cache file and indexes it, the lock must be held.
+     * @param key The record's cache key.
+     * @param entry The entry to store, or nullptr to append a tombstone erasing the key.
+     */
+    auto append_locked(std::string_view key, const cache_entry* entry) -> void;
+
+    /**
+     * Rewrites the cache file keeping the newest live records that fit in the budget, the lock must be held.
+     * @param keep_bytes The maximum number of bytes of records to keep.
+     */
+    auto compact_locked(uint64_t keep_bytes) -> void;
+
+    /**
+     * @param entry The entry to encode.
+     * @return The entry's response status, headers and freshness information, everything except the body.
+     */
+    static auto encode(const cache_entry& entry) -> std::string;
+
+    /**
+     * @param meta The encoded entry.
+     * @param entry The entry to decode into.
+     * @return True if the encoded entry was valid.
+     */
+    static auto decode(std::string_view meta, cache_entry& entry) -> bool;
+};
+
+} // namespace lift
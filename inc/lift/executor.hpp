@@ -1,7 +1,9 @@
 #pragma once
 
+#include "lift/digest.hpp"
 #include "lift/request.hpp"
 #include "lift/response.hpp"
+#include "lift/spill_file.hpp"
 
 #include <curl/curl.h>
 
@@ -11,6 +13,11 @@ namespace lift
 {
 class request;
 class client;
+class request_source;
+namespace impl
+{
+class host_state;
+} // namespace impl
 
 /**
  * This class's design is to encapsulate executing either a synchronous
@@ -55,12 +62,71 @@ private:
 
     /// If async request the client executing this request.
     client* m_client{nullptr};
+    /// If async request pulled from a request source, the source it belongs to.
+    request_source* m_request_source{nullptr};
     /// If async request the pointer to the request.
     request_ptr m_request_async{nullptr};
     /// If the async request has a timeout set then this is the position to delete when completed.
     std::optional<std::multimap<uint64_t, executor*>::iterator> m_timeout_iterator{};
     // Has the on complete handler already been processed?
     bool m_on_complete_handler_processed{false};
+    /// The time the async request was started on the client's event loop.
+    uint64_t m_start_time{0};
+    /// The loop time the async request times out at, set by its first attempt so retries share it.
+    std::optional<uint64_t> m_deadline{std::nullopt};
+
+    /// If a hedge is scheduled then this is the position to delete when completed.
+    std::optional<std::multimap<uint64_t, executor*>::iterator> m_hedge_iterator{};
+    /// If the request has been hedged then this is the other executor racing it.
+    executor* m_hedge_peer{nullptr};
+    /// Is this executor running the hedged duplicate rather than the original request?
+    bool m_is_hedge{false};
+    /// If this is the hedged duplicate and it now owns delivering the response, the user's original request.
+    request_ptr m_hedge_original{nullptr};
+
+    /// The current attempt number of the async request, greater than one if it has been retried.
+    uint32_t m_attempt{1};
+    /// If a retry is scheduled then this is the position to delete when it fires.
+    std::optional<std::multimap<uint64_t, executor*>::iterator> m_retry_iterator{};
+
+    /// If this executor delivers its request's response then this is its cancellation registration.
+    std::optional<std::multimap<uint64_t, executor*>::iterator> m_cancel_iterator{};
+
+    /// The per host state of this executor's request once it has been looked up, the request's url
+    /// can't be used after the request has been handed back to the user.  The host is referenced
+    /// until the executor is returned so it isn't evicted from under it.
+    impl::host_state* m_host_state{nullptr};
+    /// Set when the host's circuit breaker allowed this attempt and is waiting on its outcome.
+    bool m_circuit_breaker_admitted{false};
+    /// Set when this executor holds a slot in its host's concurrency limiter.
+    bool m_concurrency_acquired{false};
+
+    /// The number of response body bytes written to the request's body sink during this attempt.
+    uint64_t m_body_bytes_streamed{0};
+    /// Set once the request's body sink has been finished, any late chunks are dropped.
+    bool m_body_sink_finished{false};
+
+    /// Set once the final response's headers have arrived during this attempt.
+    bool m_headers_complete{false};
+    /// Set if the request's headers handler aborted the transfer.
+    bool m_headers_aborted{false};
+    /// Set if the current response has a Location header, i.e. it is a redirect curl could follow.
+    bool m_hop_has_location{false};
+    /// Set if the current response's Content-Length is beyond the spill threshold, its body is spilled
+    /// from the first byte.
+    bool m_spill_early{false};
+
+    /// Hashes the response body as it is received, created by the first chunk when the request has an
+    /// integrity policy.
+    std::optional<hasher> m_hasher{};
+
+    /// The response body once it is spilled out of memory, see client::options::spill.
+    spill_file m_spill{};
+    /// The number of body bytes this transfer holds in memory against the client's spill cap.
+    uint64_t m_body_memory_bytes{0};
+
+    /// libcurl writes the network error message here, it is copied into the response only if the request fails.
+    char m_curl_error_buffer[CURL_ERROR_SIZE]{};
 
     /// Used internally to point at one of the sync or async requests.
     request* m_request{nullptr};
@@ -115,6 +181,70 @@ private:
      */
     auto set_timesup_response(std::chrono::milliseconds total_time) -> void;
 
+    /**
+     * Finishes the request's body sink with the final response if it has one, this is only done once.
+     */
+    auto finish_body_sink() -> void;
+
+    /**
+     * @param name The name of a response header.
+     * @return Does the request's capture policy keep the header?
+     */
+    auto captures_header(std::string_view name) const -> bool;
+
+    /**
+     * Called at the end of each response's headers, once they are the final response's headers the
+     * time to first byte is recorded and the request's headers handler is called.
+     * @return False to abort the transfer.
+     */
+    auto on_headers_complete() -> bool;
+
+    /**
+     * @return The time to first byte of the current transfer in milliseconds.
+     */
+    auto first_byte_time() const -> uint32_t;
+
+    /**
+     * Appends to the response body, once the body is too large to hold in memory, or the client's in memory
+     * cap is reached, the body is moved into the spill file and the rest of it is appended there.
+     * @param chunk The body bytes to append.
+     * @return False if the body couldn't be spilled, the transfer is aborted.
+     */
+    auto append_body(std::string_view chunk) -> bool;
+
+    /**
+     * @return Is the response body received encoded and decoded on the client's decode pool rather than by curl?
+     */
+    auto offloads_decoding() const -> bool;
+
+    /**
+     * @return The body size beyond which the client spills response bodies, or std::nullopt if it doesn't.
+     */
+    auto spill_threshold() const -> std::optional<std::size_t>;
+
+    /**
+     * @return The number of body bytes kept, in memory or spilled.
+     */
+    auto body_size() const -> uint64_t;
+
+    /**
+     * Hands a spilled body to the response as a read only mapping of the spill file and releases the
+     * body's in memory bytes from the client's spill cap.
+     */
+    auto finish_body() -> void;
+
+    /**
+     * Discards the spill file and releases the body's in memory bytes from the client's spill cap.
+     */
+    auto release_body() -> void;
+
+    /**
+     * Finishes the body's digest into the response and verifies it against the integrity policy's expected
+     * digest and the response's digest headers.
+     * @return False if the body's digest doesn't match.
+     */
+    auto verify_digest() -> bool;
+
     auto reset() -> void;
 
     /**
@@ -142,6 +272,10 @@ private:
     /// For Timesup.
     friend auto on_uv_timesup_callback(uv_timer_t* handle) -> void;
 
+    friend auto on_uv_hedge_callback(uv_timer_t* handle) -> void;
+
+    friend auto on_uv_retry_callback(uv_timer_t* handle) -> void;
+
     /// libcurl will call this function when the request has debug function enabled.
     friend auto curl_debug_info_callback(CURL* handle, curl_infotype type, char* data, size_t size, void* userptr)
         -> int;
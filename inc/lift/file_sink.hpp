@@ -0,0 +1,131 @@
+#pragma once
+
+#include "lift/body_sink.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace lift
+{
+struct file_sink_options
+{
+    /// The body is written in batches of this size, rounded up to a multiple of the 4 KiB write alignment.
+    std::size_t m_batch_bytes{1024 * 1024};
+    /// Should the file be written with O_DIRECT, bypassing the page cache?  Falls back to buffered writes
+    /// if the file system doesn't support it.  Only used when the sink opens the file itself, a sink given a
+    /// file descriptor writes through it as it was opened.
+    bool m_direct_io{false};
+    /// Should the file's blocks be allocated up front from the response's Content-Length?
+    bool m_preallocate{true};
+    /// Should the CRC-32 of the body be computed as it is written, see file_sink::crc32()?
+    bool m_crc32{false};
+};
+
+/**
+ * Writes a response body straight into a file as it is downloaded rather than buffering it in the
+ * lift::response, see lift::request::body_sink().  The body is batched into aligned buffers that are
+ * written with pwrite(), optionally computing its CRC-32 as it streams through.
+ *
+ * A file_sink receives a single transfer.  If a write fails the transfer is aborted and the errno is
+ * available from error().
+ */
+class file_sink final : public body_sink
+{
+public:
+    /**
+     * Creates, or truncates, the file the body is written to.
+     * @throw std::runtime_error If the file can't be opened.
+     * @param path The file to write the body into.
+     * @param options The write batching and allocation options.
+     */
+    explicit file_sink(const std::filesystem::path& path, file_sink_options options = file_sink_options{});
+
+    /**
+     * Writes the body into an already open file at an offset, e.g. one range of a larger file.  The
+     * file descriptor is not closed and the file is not truncated.  It can't be open with O_DIRECT, the
+     * final write would be padded over whatever follows the body in the file.
+     * @throw std::runtime_error If the file descriptor is invalid or open with O_DIRECT.
+     * @param fd The file descriptor to write the body into.
+     * @param offset The offset in the file to write the body at.
+     * @param options The write batching and allocation options.
+     */
+    file_sink(int fd, uint64_t offset, file_sink_options options = file_sink_options{});
+
+    file_sink(const file_sink&)                    = delete;
+    file_sink(file_sink&&)                         = delete;
+    auto operator=(const file_sink&) -> file_sink& = delete;
+    auto operator=(file_sink&&) -> file_sink&      = delete;
+    ~file_sink() override;
+
+    auto start(const request& req, const response& resp) -> void override;
+    auto write(const request& req, std::string_view chunk) -> bool override;
+    auto finish(const request& req, const response& resp) -> void override;
+
+    /**
+     * @return The number of body bytes written into the file so far, all of them once finished.
+     */
+    [[nodiscard]] auto bytes_written() const -> uint64_t { return m_bytes_written; }
+
+    /**
+     * @return The CRC-32 of the body bytes received, zero unless file_sink_options::m_crc32 is set.
+     */
+    [[nodiscard]] auto crc32() const -> uint32_t { return m_crc32; }
+
+    /**
+     * @return The errno of the write that failed, or zero.
+     */
+    [[nodiscard]] auto error() const -> int { return m_error; }
+
+    /**
+     * @return Is the file being written with O_DIRECT?
+     */
+    [[nodiscard]] auto direct_io() const -> bool { return m_direct_io; }
+
+private:
+    struct aligned_delete
+    {
+        auto operator()(char* buffer) const -> void;
+    };
+
+    /// The file being written.
+    int m_fd{-1};
+    /// Did this sink open m_fd?
+    bool m_owns_fd{false};
+    /// Is m_fd open with O_DIRECT?
+    bool m_direct_io{false};
+    /// The write batching and allocation options.
+    file_sink_options m_options{};
+    /// The offset in the file the body starts at.
+    uint64_t m_offset{0};
+    /// The batch buffer.
+    std::unique_ptr<char, aligned_delete> m_buffer{nullptr};
+    /// The number of bytes in the batch buffer.
+    std::size_t m_buffered{0};
+    /// The number of body bytes received.
+    uint64_t m_bytes_received{0};
+    /// The number of body bytes written into the file.
+    uint64_t m_bytes_written{0};
+    /// The CRC-32 of the body bytes received.
+    uint32_t m_crc32{0};
+    /// The errno of the write that failed, or zero.
+    int m_error{0};
+
+    /**
+     * Writes the batch buffer's bytes at the end of the bytes written so far.
+     * @param bytes The number of bytes to write, with O_DIRECT this may include padding beyond the body.
+     * @return True if every byte was written.
+     */
+    auto flush(std::size_t bytes) -> bool;
+
+    /**
+     * @param data The bytes to write.
+     * @param size The number of bytes to write.
+     * @param offset The offset in the file to write them at.
+     * @return True if every byte was written.
+     */
+    auto write_at(const char* data, std::size_t size, uint64_t offset) -> bool;
+};
+
+} // namespace lift
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <string_view>
 
@@ -64,4 +67,117 @@ private:
     std::size_t m_colon_pos{0};
 };
 
+/**
+ * A non-owning view of a header field, it is only valid while the headers it views are alive and unmodified.
+ */
+class header_view
+{
+public:
+    header_view() = default;
+    header_view(std::string_view name, std::string_view value) : m_name(name), m_value(value) {}
+
+    /**
+     * @return The header's name.
+     */
+    [[nodiscard]] auto name() const -> std::string_view { return m_name; }
+
+    /**
+     * @return The header's value or empty if it doesn't have a value.
+     */
+    [[nodiscard]] auto value() const -> std::string_view { return m_value; }
+
+    friend auto operator<<(std::ostream& os, const header_view& h) -> std::ostream&
+    {
+        os << h.m_name << ": " << h.m_value;
+        return os;
+    }
+
+private:
+    std::string_view m_name{};
+    std::string_view m_value{};
+};
+
+/// Where a header field's name and value are within a block of header fields.
+struct header_offsets
+{
+    uint32_t m_name_offset{0};
+    uint32_t m_name_size{0};
+    uint32_t m_value_offset{0};
+    uint32_t m_value_size{0};
+};
+
+/**
+ * The header fields of a block of header fields in the order they were received, this is a
+ * lightweight view and is only valid while the headers it views are alive and unmodified.
+ */
+class header_range
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = header_view;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = header_view;
+
+        iterator() = default;
+        iterator(std::string_view block, const header_offsets* offsets) : m_block(block), m_offsets(offsets) {}
+
+        auto operator*() const -> header_view
+        {
+            return header_view{
+                m_block.substr(m_offsets->m_name_offset, m_offsets->m_name_size),
+                m_block.substr(m_offsets->m_value_offset, m_offsets->m_value_size)};
+        }
+
+        auto operator++() -> iterator&
+        {
+            ++m_offsets;
+            return *this;
+        }
+
+        auto operator++(int) -> iterator
+        {
+            auto previous = *this;
+            ++m_offsets;
+            return previous;
+        }
+
+        auto operator==(const iterator& other) const -> bool { return m_offsets == other.m_offsets; }
+        auto operator!=(const iterator& other) const -> bool { return m_offsets != other.m_offsets; }
+
+    private:
+        std::string_view      m_block{};
+        const header_offsets* m_offsets{nullptr};
+    };
+
+    header_range(std::string_view block, const header_offsets* offsets, std::size_t size)
+        : m_block(block),
+          m_offsets(offsets),
+          m_size(size)
+    {
+    }
+
+    [[nodiscard]] auto begin() const -> iterator { return iterator{m_block, m_offsets}; }
+    [[nodiscard]] auto end() const -> iterator { return iterator{m_block, m_offsets + m_size}; }
+    [[nodiscard]] auto size() const -> std::size_t { return m_size; }
+    [[nodiscard]] auto empty() const -> bool { return m_size == 0; }
+
+    /**
+     * @param index The position of the header field, it must be less than size().
+     * @return The header field.
+     */
+    [[nodiscard]] auto operator[](std::size_t index) const -> header_view
+    {
+        return *iterator{m_block, m_offsets + index};
+    }
+
+private:
+    std::string_view      m_block{};
+    const header_offsets* m_offsets{nullptr};
+    std::size_t           m_size{0};
+};
+
 } // namespace lift
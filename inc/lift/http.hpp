@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 
 #include <curl/curl.h>
 
@@ -319,6 +321,12 @@ enum class content_type : uint16_t
 
 auto to_string(content_type ct) -> const std::string&;
 
+/**
+ * @param value A Content-Type header value, its parameters such as the charset are ignored.
+ * @return The media type, no_content if the value is empty or unknown if it is not a known media type.
+ */
+auto to_content_type(std::string_view value) -> content_type;
+
 inline const std::string connection_type_unknown{"unknown"};
 inline const std::string connection_type_close{"close"};
 inline const std::string connection_type_keep_alive{"keep-alive"};
@@ -333,4 +341,10 @@ enum class connection_type : uint8_t
 
 auto to_string(connection_type ct) -> const std::string&;
 
+/**
+ * @param value A Connection header value.
+ * @return The first known connection type in the value, or std::nullopt if it has none.
+ */
+auto to_connection_type(std::string_view value) -> std::optional<connection_type>;
+
 } // namespace lift::http
@@ -0,0 +1,326 @@
+#pragma once
+
+#include "lift/circuit_breaker.hpp"
+#include "lift/concurrency_limiter.hpp"
+#include "lift/request.hpp"
+#include "lift/token_bucket.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lift
+{
+class executor;
+class request_source;
+} // namespace lift
+
+namespace lift::impl
+{
+/**
+ * A request waiting in its host's queue to be admitted for execution.
+ */
+struct queued_request
+{
+    /// The request waiting to execute.
+    request_ptr m_request{nullptr};
+    /// The request source the request was pulled from, if any.
+    request_source* m_source{nullptr};
+    /// True once the request has been held back by a rate limit, so it is only counted once.
+    bool m_rate_limited{false};
+    /// Set if this is the next attempt of a retried request, its executor keeps the curl handle prepared
+    /// while the request waits here.
+    executor* m_retry{nullptr};
+    /// The loop time the request times out at while it waits, if it has a timeout.
+    std::optional<uint64_t> m_deadline{std::nullopt};
+};
+
+/**
+ * Where a request without an executor waits until its deadline, see queued_request::m_deadline.
+ */
+struct wait_timeout
+{
+    /// The single flight key of the flight, or the host of the queue, the request waits in.
+    std::string m_key{};
+    /// The waiting request.
+    const request* m_request{nullptr};
+    /// True if the request waits in a host's queue, false if it waits on an identical in flight request.
+    bool m_host_queue{false};
+};
+
+/**
+ * Per host book keeping for a lift::client, keyed by the "host:port" of each request's url, see url_host().
+ * This is only ever accessed from within the client's background event loop thread, except for
+ * the atomic mirrors of its live values which can be read from any thread.
+ */
+class host_state
+{
+public:
+    /// The number of most recent latencies kept per host for deriving percentiles.
+    static constexpr std::size_t latency_window_size = 128;
+    /// The minimum number of latency samples before a percentile is considered meaningful.
+    static constexpr std::size_t latency_min_samples = 16;
+
+    /**
+     * @param latency Records the total time of a successfully completed request to this host.
+     */
+    auto record_latency(std::chrono::milliseconds latency) -> void
+    {
+        m_latencies[m_latency_count % latency_window_size] = static_cast<uint32_t>(latency.count());
+        ++m_latency_count;
+    }
+
+    /**
+     * @param percentile The percentile to calculate in the range [0, 100].
+     * @return The observed latency at the given percentile, or std::nullopt if there are too few samples.
+     */
+    auto latency_percentile(double percentile) const -> std::optional<std::chrono::milliseconds>
+    {
+        const auto samples = std::min(m_latency_count, latency_window_size);
+        if (samples < latency_min_samples)
+        {
+            return std::nullopt;
+        }
+
+        auto sorted = m_latencies;
+        auto rank =
+            static_cast<std::size_t>(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(samples - 1));
+        auto first = sorted.begin();
+        std::nth_element(
+            first, first + static_cast<std::ptrdiff_t>(rank), first + static_cast<std::ptrdiff_t>(samples));
+        return std::chrono::milliseconds{sorted[rank]};
+    }
+
+    /**
+     * An executor caching this host keeps it from being evicted until the executor is returned.
+     */
+    auto add_reference() -> void { ++m_references; }
+
+    /**
+     * @param now The loop time the executor referencing this host was returned.
+     */
+    auto remove_reference(uint64_t now) -> void
+    {
+        --m_references;
+        m_last_used = now;
+    }
+
+    /**
+     * @param now The loop time this host was looked up.
+     */
+    auto touch(uint64_t now) -> void { m_last_used = now; }
+
+    /**
+     * @param now The current loop time.
+     * @param idle_timeout How long in milliseconds a host must go unused before it can be evicted.
+     * @return True if nothing references this host or waits in its queue, its circuit breaker is closed
+     *         and it hasn't been used for the idle timeout.  Its limits and latencies are then no
+     *         different from a newly created host's.
+     */
+    auto evictable(uint64_t now, uint64_t idle_timeout) const -> bool
+    {
+        return m_references == 0 && m_queue.empty() && breaker_state() == circuit_breaker_state::closed &&
+               now - m_last_used >= idle_timeout;
+    }
+
+    /**
+     * @return This host's circuit breaker, if the client has a circuit breaker policy.
+     */
+    auto breaker() -> std::optional<circuit_breaker>& { return m_breaker; }
+
+    /**
+     * @return The state of this host's circuit breaker, this is safe to call from any thread.
+     */
+    auto breaker_state() const -> circuit_breaker_state { return m_breaker_state.load(std::memory_order_acquire); }
+
+    /**
+     * @param state Mirrors the circuit breaker's new state for readers on other threads.
+     */
+    auto breaker_state(circuit_breaker_state state) -> void
+    {
+        m_breaker_state.store(state, std::memory_order_release);
+    }
+
+    /**
+     * @return This host's adaptive concurrency limiter, if the client has a concurrency limit policy.
+     */
+    auto limiter() -> std::optional<concurrency_limiter>& { return m_limiter; }
+
+    /**
+     * @return The live concurrency limit of this host, this is safe to call from any thread.
+     */
+    auto concurrency_limit() const -> uint32_t { return m_concurrency_limit.load(std::memory_order_acquire); }
+
+    /**
+     * @param limit Mirrors the limiter's new limit for readers on other threads.
+     */
+    auto concurrency_limit(uint32_t limit) -> void { m_concurrency_limit.store(limit, std::memory_order_release); }
+
+    /**
+     * @return This host's rate limit bucket, if the client has a host rate limit.
+     */
+    auto bucket() -> std::optional<token_bucket>& { return m_bucket; }
+
+    /**
+     * @return The request at the front of this host's queue, the queue must not be empty.
+     */
+    auto front() -> queued_request& { return m_queue.front(); }
+
+    /**
+     * @return True if there are no requests waiting in this host's queue.
+     */
+    auto queue_empty() const -> bool { return m_queue.empty(); }
+
+    /**
+     * @param queued Adds the request to the back of this host's queue.
+     */
+    auto enqueue(queued_request queued) -> void
+    {
+        m_queue.emplace_back(std::move(queued));
+        m_queued_count.store(m_queue.size(), std::memory_order_release);
+    }
+
+    /**
+     * @return Removes and returns the request at the front of this host's queue, the queue must not be empty.
+     */
+    auto dequeue() -> queued_request
+    {
+        auto queued = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_queued_count.store(m_queue.size(), std::memory_order_release);
+        return queued;
+    }
+
+    /**
+     * Removes every queued request matching the predicate while preserving the order of the rest.
+     * @param predicate Functor taking a const request& returning true to remove the request.
+     * @return The removed requests.
+     */
+    template<typename predicate_type>
+    auto extract_queued(predicate_type predicate) -> std::vector<queued_request>
+    {
+        std::vector<queued_request> extracted{};
+        std::deque<queued_request>  kept{};
+        for (auto& queued : m_queue)
+        {
+            if (predicate(static_cast<const request&>(*queued.m_request)))
+            {
+                extracted.emplace_back(std::move(queued));
+            }
+            else
+            {
+                kept.emplace_back(std::move(queued));
+            }
+        }
+        m_queue.swap(kept);
+        m_queued_count.store(m_queue.size(), std::memory_order_release);
+        return extracted;
+    }
+
+    /**
+     * @return The number of requests waiting in this host's queue, this is safe to call from any thread.
+     */
+    auto queued_count() const -> std::size_t { return m_queued_count.load(std::memory_order_acquire); }
+
+private:
+    /// Ring buffer of the most recent request latencies in milliseconds.
+    std::array<uint32_t, latency_window_size> m_latencies{};
+    /// The total number of latencies recorded.
+    std::size_t m_latency_count{0};
+    /// The circuit breaker for this host, if enabled.
+    std::optional<circuit_breaker> m_breaker{};
+    /// The circuit breaker's state mirrored for readers on other threads.
+    std::atomic<circuit_breaker_state> m_breaker_state{circuit_breaker_state::closed};
+    /// The adaptive concurrency limiter for this host, if enabled.
+    std::optional<concurrency_limiter> m_limiter{};
+    /// The concurrency limit mirrored for readers on other threads.
+    std::atomic<uint32_t> m_concurrency_limit{0};
+    /// The rate limit bucket for this host, if enabled.
+    std::optional<token_bucket> m_bucket{};
+    /// Requests waiting to be admitted for execution in arrival order.
+    std::deque<queued_request> m_queue{};
+    /// The size of the queue mirrored for readers on other threads.
+    std::atomic<std::size_t> m_queued_count{0};
+    /// The number of executors caching this host.
+    std::size_t m_references{0};
+    /// The loop time this host was last looked up or released by an executor.
+    uint64_t m_last_used{0};
+};
+
+/**
+ * @param host A "host[:port]".
+ * @return The host lower cased, host names are case insensitive.
+ */
+inline auto host_key(std::string_view host) -> std::string
+{
+    std::string key{host};
+    std::transform(
+        key.begin(),
+        key.end(),
+        key.begin(),
+        [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return key;
+}
+
+/**
+ * @param url The url to extract the host from.
+ * @return The "host:port" authority of the url without any user info.  The host is lower cased and the
+ *         scheme's default port is filled in, so every spelling of a url shares its host's state.
+ */
+inline auto url_host(std::string_view url) -> std::string
+{
+    // curl assumes http for a url without a scheme.
+    std::string_view scheme{"http"};
+    auto             scheme_end = url.find("://");
+    if (scheme_end != std::string_view::npos)
+    {
+        scheme = url.substr(0, scheme_end);
+        url.remove_prefix(scheme_end + 3);
+    }
+
+    url = url.substr(0, url.find_first_of("/?#"));
+
+    auto user_info_end = url.rfind('@');
+    if (user_info_end != std::string_view::npos)
+    {
+        url.remove_prefix(user_info_end + 1);
+    }
+
+    auto key = host_key(url);
+
+    // An IPv6 literal's colons are inside its brackets.
+    auto port_start = key.rfind(':');
+    if (port_start != std::string::npos && (key.find(']') == std::string::npos || port_start > key.rfind(']')))
+    {
+        if (port_start + 1 == key.size())
+        {
+            // An empty port is the default port, RFC 3986 section 6.2.3.
+            key.pop_back();
+        }
+        else
+        {
+            return key;
+        }
+    }
+
+    auto lower_scheme = host_key(scheme);
+    if (lower_scheme == "http")
+    {
+        key.append(":80");
+    }
+    else if (lower_scheme == "https")
+    {
+        key.append(":443");
+    }
+    return key;
+}
+
+} // namespace lift::impl
@@ -1,15 +1,28 @@
 #pragma once
 
+#include "lift/body_sink.hpp"
+#include "lift/buffer_pool.hpp"
+#include "lift/cancellation_token.hpp"
+#include "lift/circuit_breaker.hpp"
 #include "lift/client.hpp"
 #include "lift/client_pool.hpp"
+#include "lift/concurrency_limiter.hpp"
 #include "lift/const.hpp"
+#include "lift/decode_pool.hpp"
+#include "lift/digest.hpp"
+#include "lift/disk_cache.hpp"
 #include "lift/escape.hpp"
 #include "lift/executor.hpp"
+#include "lift/file_sink.hpp"
 #include "lift/header.hpp"
 #include "lift/init.hpp"
 #include "lift/lift_status.hpp"
 #include "lift/mime_field.hpp"
 #include "lift/query_builder.hpp"
+#include "lift/ranged_download.hpp"
 #include "lift/request.hpp"
 #include "lift/resolve_host.hpp"
 #include "lift/response.hpp"
+#include "lift/response_cache.hpp"
+#include "lift/spill_file.hpp"
+#include "lift/token_bucket.hpp"
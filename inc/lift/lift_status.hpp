@@ -40,7 +40,14 @@ enum class lift_status : uint8_t
     /// The request had an error and failed to start, did the event loop shutdown?
     error_failed_to_start,
     /// The request had an error when attempting to read data off the socket.
-    download_error
+    download_error,
+
+    /// The request was cancelled by the user before it completed, see lift::client::cancel_request().
+    cancelled,
+    /// The request failed immediately without being executed because its host's circuit breaker is open.
+    circuit_open,
+    /// The response body's digest didn't match the request's expected digest or the response's digest header.
+    integrity_mismatch
 };
 
 /**
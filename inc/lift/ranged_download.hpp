@@ -0,0 +1,88 @@
+#pragma once
+
+#include "lift/file_sink.hpp"
+#include "lift/http.hpp"
+#include "lift/lift_status.hpp"
+#include "lift/request.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+namespace lift
+{
+struct ranged_download_options
+{
+    /// The maximum number of ranges downloaded concurrently, each over its own connection.
+    std::size_t m_connections{4};
+    /// The size of the first ranges, later ranges are resized towards m_target_range_time.
+    uint64_t m_initial_range_bytes{8 * 1024 * 1024};
+    /// The smallest range requested, except for the object's final bytes.
+    uint64_t m_min_range_bytes{1024 * 1024};
+    /// The largest range requested.
+    uint64_t m_max_range_bytes{256 * 1024 * 1024};
+    /// Ranges are sized from the throughput of the ranges already completed so each one takes about this
+    /// long, long enough to amortize a request's latency and short enough that a retry doesn't cost much.
+    std::chrono::milliseconds m_target_range_time{std::chrono::seconds{2}};
+    /// The number of times each range is retried before the download fails, a retry resumes the range
+    /// from the last byte written.
+    uint32_t m_max_range_retries{3};
+    /// The timeout for the HEAD request and each range request.
+    std::chrono::milliseconds m_timeout{std::chrono::seconds{60}};
+    /// How each range is written into the file.
+    file_sink_options m_sink{};
+};
+
+struct ranged_download_result
+{
+    /// success if the entire object was written into the file, otherwise the status of the request that
+    /// failed the download.
+    lift::lift_status m_lift_status{lift::lift_status::building};
+    /// The HTTP status code of the request that failed the download, or the HEAD request's if it succeeded.
+    http::status_code m_status_code{http::status_code::http_unknown};
+    /// The object's size in bytes.
+    uint64_t m_size{0};
+    /// The number of body bytes received over every request, this includes the bytes of failed attempts.
+    uint64_t m_bytes_received{0};
+    /// The number of requests made to download the body, including retries but not the HEAD request.
+    uint64_t m_requests{0};
+    /// The number of ranges that were retried.
+    uint64_t m_retries{0};
+    /// Was the object downloaded in ranges?  A server that doesn't accept byte ranges or report the
+    /// object's size is downloaded with a single request.
+    bool m_ranged{false};
+    /// Did the object change during the download?  Each range is requested If-Range the ETag, or
+    /// Last-Modified date, the HEAD request found, a range of another version fails the download.
+    bool m_object_changed{false};
+    /// The time from the HEAD request starting until the download completed.
+    std::chrono::milliseconds m_total_time{0};
+};
+
+using download_callback_type = std::function<void(ranged_download_result result)>;
+
+namespace impl
+{
+/// Starts a request with an on complete callback, e.g. on a client or one of a client pool's clients.
+using request_starter_type = std::function<void(request_ptr request_ptr, request::async_callback_type callback)>;
+
+/**
+ * Downloads the url into the file, see lift::client::start_download().
+ * @param starter Starts each of the download's requests.
+ * @param url The object to download.
+ * @param path The file to write the object into, it is created or truncated.
+ * @param callback Invoked once with the download's result.
+ * @param options The download's concurrency, range sizing and retry options.
+ */
+auto start_ranged_download(
+    request_starter_type    starter,
+    std::string             url,
+    std::filesystem::path   path,
+    download_callback_type  callback,
+    ranged_download_options options) -> void;
+
+} // namespace impl
+
+} // namespace lift
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "lift/body_sink.hpp"
+#include "lift/digest.hpp"
 #include "lift/header.hpp"
 #include "lift/http.hpp"
 #include "lift/impl/copy_util.hpp"
@@ -11,6 +13,7 @@
 #include <chrono>
 #include <functional>
 #include <future>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -64,6 +67,95 @@ struct proxy_data
     std::optional<std::vector<http_auth_type>> m_auth_types;
 };
 
+struct hedge_policy
+{
+    /// The amount of time to wait for the original request before issuing the hedged duplicate.
+    /// If a percentile is also set this is used until enough latency samples have been observed.
+    std::chrono::milliseconds m_delay{std::chrono::milliseconds{100}};
+    /// If set the delay is derived from this percentile of the observed latencies to the request's
+    /// host on the client, e.g. 95.0 will hedge any request running longer than the host's p95.
+    std::optional<double> m_percentile{std::nullopt};
+    /// If set the hedged duplicate is sent to this url instead of the original request's url.
+    std::optional<std::string> m_alternate_url{std::nullopt};
+    /// Only GET, HEAD and OPTIONS requests are hedged by default.  PUT and DELETE are idempotent but not
+    /// safe, set this if the server tolerates them being applied twice.  Any other method is never hedged.
+    bool m_idempotent_writes{false};
+};
+
+struct retry_policy
+{
+    /// The maximum number of attempts including the original request, e.g. 3 allows for 2 retries.
+    uint32_t m_max_attempts{3};
+    /// The lift statuses that should be retried.
+    std::vector<lift_status> m_retry_on_lift_status{
+        lift_status::connect_error, lift_status::timeout, lift_status::response_empty, lift_status::download_error};
+    /// The HTTP status codes that should be retried when the request otherwise completed successfully.
+    std::vector<http::status_code> m_retry_on_status_codes{
+        http::status_code::http_429_too_many_requests,
+        http::status_code::http_502_bad_gateway,
+        http::status_code::http_503_service_unavailable,
+        http::status_code::http_504_gateway_timeout};
+    /// The backoff before the first retry, this doubles for each subsequent attempt.
+    std::chrono::milliseconds m_base_backoff{std::chrono::milliseconds{100}};
+    /// The maximum backoff between any two attempts.
+    std::chrono::milliseconds m_max_backoff{std::chrono::seconds{10}};
+    /// Should the backoff be randomized between zero and the exponential backoff ("full jitter")?
+    /// This spreads out retries from many clients so a brownout isn't amplified.
+    bool m_jitter{true};
+    /// Should a server's Retry-After header be honored?  If the server asks for a longer wait than
+    /// the maximum backoff the request is not retried.
+    bool m_respect_retry_after{true};
+};
+
+enum class header_capture
+{
+    /// Every response header is kept.
+    all,
+    /// No response headers are kept, the status code and transfer stats are still reported.
+    none,
+    /// Only the response headers named in the capture policy's allowlist are kept.
+    allowlist
+};
+
+enum class body_overflow
+{
+    /// The body is truncated to the maximum, the rest of it is received and discarded.
+    truncate,
+    /// The transfer is aborted with lift_status::download_error.
+    abort
+};
+
+struct capture_policy
+{
+    /// Which response headers are kept.
+    header_capture m_headers{header_capture::all};
+    /// The case insensitive names of the headers kept when m_headers is header_capture::allowlist.
+    std::vector<std::string> m_header_allowlist{};
+    /// The maximum number of body bytes kept in the response, zero discards the body, or std::nullopt for no limit.
+    std::optional<uint64_t> m_max_body_bytes{std::nullopt};
+    /// What happens when the body is larger than m_max_body_bytes.
+    body_overflow m_body_overflow{body_overflow::truncate};
+};
+
+struct integrity_policy
+{
+    /// The digest computed over the response body as it is received, see response::digest().
+    digest_algorithm m_algorithm{digest_algorithm::crc32c};
+    /// The expected digest as hex, a body with a different digest completes with lift_status::integrity_mismatch.
+    std::optional<std::string> m_expected_hex{std::nullopt};
+    /// Should the digest also be verified against the response's Repr-Digest or Digest header, or its Content-MD5
+    /// header for md5, when it has one for the algorithm?
+    bool m_verify_header{false};
+};
+
+enum class header_action
+{
+    /// Receive the response body.
+    proceed,
+    /// Abort the transfer, the request completes with lift_status::download_error and the headers received.
+    abort
+};
+
 enum class debug_info_type
 {
     /// The data is information text.
@@ -84,6 +176,14 @@ enum class debug_info_type
 
 auto to_string(debug_info_type type) -> const std::string&;
 
+enum class header_retention
+{
+    /// Only the final response's headers are kept, the headers of redirects and interim responses are dropped.
+    final_hop,
+    /// The headers of every response received are kept, see lift::response::header_hops().
+    all_hops
+};
+
 /**
  * Debug information callback signature type, the first argument is the type of debug information
  * and the second argument is the raw byte data.
@@ -127,6 +227,16 @@ public:
         int64_t        upload_total_bytes,
         int64_t        upload_now_bytes)>;
 
+    /**
+     * Headers handler callback signature, called once the final response's headers have arrived and
+     * before its body is received.  The request may be modified, e.g. to stream the body into a
+     * body_sink() or to cap it with a capture() policy, before the body is received.
+     * @param request The request being executed.
+     * @param response The response with its status code, headers and time to first byte.
+     * @return Whether to receive the body or abort the transfer.
+     */
+    using headers_handler_type = std::function<header_action(request& request, const response& response)>;
+
     /**
      * Creates a new request with the given url, possible timeout and possible on complete handler.
      * Note that synchronous requests do not require on complete handlers as the Perfom() function
@@ -178,6 +288,20 @@ public:
      */
     auto transfer_progress_handler(std::optional<transfer_progress_handler_type> transfer_progress_handler) -> void;
 
+    /**
+     * Sets or unsets a headers handler callback, called once the final response's headers have arrived
+     * so the body can be declined, e.g. on an unexpected status code, Content-Type or Content-Length.
+     * Requests with a headers handler are never hedged, shared via single flight or cached, and are not
+     * retried if the handler aborted them.
+     * @param headers_handler If an empty optional then the headers handler is disabled.
+     */
+    auto headers_handler(std::optional<headers_handler_type> headers_handler) -> void;
+
+    /**
+     * @return Does this request have a headers handler?
+     */
+    auto has_headers_handler() const -> bool { return m_on_headers_handler != nullptr; }
+
     /**
      * @return The amount of time for the request to connect, or std::nullopt signals the default, 300s.
      */
@@ -386,6 +510,20 @@ public:
      */
     auto accept_encoding_all_available() -> void { m_accept_encodings = std::vector<std::string>{}; }
 
+    /**
+     * Sets whether curl decodes a response body sent with a Content-Encoding, e.g. gzip, before it is
+     * delivered.  With decoding disabled the body is delivered exactly as the server encoded it so it can be
+     * forwarded without being decompressed and compressed again, response::decode_data() decodes it on
+     * demand.  Requests that don't decode are never shared via single flight or cached.
+     * @param decode Should the response body be decoded?  Defaults to true.
+     */
+    auto content_decoding(bool decode) -> void { m_content_decoding = decode; }
+
+    /**
+     * @return Is the response body decoded from its Content-Encoding?
+     */
+    auto content_decoding() const -> bool { return m_content_decoding; }
+
     /**
      * @return Custom `host:port => ip_addr` resolve hosts for this request.
      */
@@ -488,11 +626,141 @@ public:
      */
     auto cookie_file(std::optional<std::filesystem::path> cookie_file) -> void { m_cookie_file = cookie_file; }
 
+    /**
+     * Hedging only applies to asynchronous requests executed through a lift::client.  If the request
+     * hasn't completed after the policy's delay a duplicate is issued, the first successful response
+     * is delivered and the other transfer is cancelled.  The amount of extra load hedging may add is
+     * capped by the client's hedge budget, and the duplicate is subject to the same circuit breaker,
+     * concurrency limit and rate limits as any other request; if it isn't admitted it isn't issued.
+     * @param policy The hedge policy for this request, or std::nullopt to disable hedging.
+     */
+    auto hedge(std::optional<hedge_policy> policy) -> void { m_hedge_policy = std::move(policy); }
+
+    /**
+     * @return The hedge policy for this request if set.
+     */
+    auto hedge() const -> const std::optional<hedge_policy>& { return m_hedge_policy; }
+
+    /**
+     * Retries only apply to asynchronous requests executed through a lift::client.  Each retry is
+     * scheduled on the client's event loop with the same executor and only the final outcome is
+     * delivered to the user, see response::num_attempts().  Each attempt has the request's full
+     * timeout and the total number of retries is capped by the client's retry budget.
+     * @param policy The retry policy for this request, or std::nullopt to disable retries.
+     */
+    auto retry(std::optional<retry_policy> policy) -> void { m_retry_policy = std::move(policy); }
+
+    /**
+     * @return The retry policy for this request if set.
+     */
+    auto retry() const -> const std::optional<retry_policy>& { return m_retry_policy; }
+
+    /**
+     * Every constructed request is given a process wide unique identifier, copies of a request share
+     * the same identifier.  Use this to cancel the request once it has been started on a lift::client.
+     * @return The identifier of this request.
+     */
+    auto id() const -> uint64_t { return m_id; }
+
+    /**
+     * @param tag A user defined tag to group requests so they can be cancelled in bulk via
+     *            lift::client::cancel_requests(), or std::nullopt to clear the tag.
+     */
+    auto tag(std::optional<std::string> tag) -> void { m_tag = std::move(tag); }
+
+    /**
+     * @return The user defined tag for this request if set.
+     */
+    auto tag() const -> const std::optional<std::string>& { return m_tag; }
+
+    /**
+     * Streams the response body into the sink as it is downloaded rather than buffering it, only the
+     * response's status and headers are kept in the lift::response.  Requests with a sink are never
+     * hedged, shared via single flight or cached, and are only retried if no body bytes were written
+     * to the sink since those can't be taken back.
+     * @param sink The sink to write the body into, or nullptr to buffer the body in the response.
+     * @param buffer_body Should the body also be buffered in the response as it is written to the sink?
+     */
+    auto body_sink(std::shared_ptr<lift::body_sink> sink, bool buffer_body = false) -> void
+    {
+        m_body_sink   = std::move(sink);
+        m_buffer_body = buffer_body;
+    }
+
+    /**
+     * @return The sink the response body is streamed into if set.
+     */
+    auto body_sink() const -> const std::shared_ptr<lift::body_sink>& { return m_body_sink; }
+
+    /**
+     * @return Is the response body buffered in the response?  Always true if there is no body sink.
+     */
+    auto buffer_body() const -> bool { return m_body_sink == nullptr || m_buffer_body; }
+
+    /**
+     * Sets whether a buffered body whose length wasn't known up front is delivered as the chain of segments
+     * it was received into, see response::data_segments(), rather than flattened into one contiguous buffer
+     * when the request completes.  This saves copying a large body that is read segment by segment.
+     * @param segmented Should the body be delivered in segments?  Defaults to false.
+     */
+    auto segmented_body(bool segmented) -> void { m_segmented_body = segmented; }
+
+    /**
+     * @return Is a body of unknown length delivered in segments rather than flattened?
+     */
+    auto segmented_body() const -> bool { return m_segmented_body; }
+
+    /**
+     * Sets which parts of the response are kept, e.g. a health check only needs the status code.  The
+     * response's transfer stats are always reported.  Requests with a capture policy are never shared via
+     * single flight or cached, and a body that overflowed the policy's maximum is never retried.
+     * @param policy The capture policy, or std::nullopt to keep the entire response.
+     */
+    auto capture(std::optional<capture_policy> policy) -> void { m_capture_policy = std::move(policy); }
+
+    /**
+     * @return The capture policy for this request if set.
+     */
+    auto capture() const -> const std::optional<capture_policy>& { return m_capture_policy; }
+
+    /**
+     * Sets the digest computed over the response body while it is received, every chunk is hashed as curl
+     * delivers it so verifying a large download doesn't need a second pass over the body.  Requests with an
+     * integrity policy are never shared via single flight or cached.
+     * @param policy The integrity policy, or std::nullopt to not compute a digest.
+     */
+    auto integrity(std::optional<integrity_policy> policy) -> void { m_integrity_policy = std::move(policy); }
+
+    /**
+     * @return The integrity policy for this request if set.
+     */
+    auto integrity() const -> const std::optional<integrity_policy>& { return m_integrity_policy; }
+
+    /**
+     * Sets which responses' headers are kept when redirects are followed or interim responses, like
+     * 100 Continue, are received.  By default only the final response's headers are kept.
+     * @param retention The headers to keep.
+     */
+    auto header_retention(lift::header_retention retention) -> void { m_header_retention = retention; }
+
+    /**
+     * @return Which responses' headers are kept.
+     */
+    auto header_retention() const -> lift::header_retention { return m_header_retention; }
+
 private:
+    /**
+     * @return The next process wide unique request identifier.
+     */
+    static auto next_id() -> uint64_t;
+
+
     /// The on complete handler callback or promise to fulfill, this is only used for async requests.
     impl::copy_but_actually_move<async_handlers_type> m_on_complete_handler{std::monostate{}};
     /// The transfer progress handler callback.
     transfer_progress_handler_type m_on_transfer_progress_handler{nullptr};
+    /// The headers handler callback.
+    headers_handler_type m_on_headers_handler{nullptr};
     /// The timeout to connect, or none.
     std::optional<std::chrono::milliseconds> m_connect_timeout{};
     /// The timeout for the request, or none.
@@ -529,6 +797,8 @@ private:
     std::optional<proxy_data> m_proxy_data{};
     /// Specific Accept-Encoding header fields.
     std::optional<std::vector<std::string>> m_accept_encodings{};
+    /// Should curl decode the response body from its Content-Encoding?
+    bool m_content_decoding{true};
     /// A set of host:port to ip addresses that will be resolved before DNS.
     std::vector<lift::resolve_host> m_resolve_hosts{};
     /// The request headers preformatted into the curl "Header: value\0" format.
@@ -545,6 +815,26 @@ private:
     debug_info_callback_type m_debug_info_handler{nullptr};
     // The filename to read cookies from.
     std::optional<std::filesystem::path> m_cookie_file;
+    /// The hedge policy if this request should be hedged when executed asynchronously.
+    std::optional<hedge_policy> m_hedge_policy{};
+    /// The retry policy if this request should be retried when executed asynchronously.
+    std::optional<retry_policy> m_retry_policy{};
+    /// The identifier of this request, used to cancel it.
+    uint64_t m_id{next_id()};
+    /// The user defined tag of this request, used to cancel requests in bulk.
+    std::optional<std::string> m_tag{};
+    /// The sink the response body is streamed into, or nullptr to buffer it in the response.
+    std::shared_ptr<lift::body_sink> m_body_sink{nullptr};
+    /// Should the body also be buffered in the response when streamed into a sink?
+    bool m_buffer_body{false};
+    /// Is a body of unknown length delivered in segments rather than flattened?
+    bool m_segmented_body{false};
+    /// Which responses' headers are kept.
+    lift::header_retention m_header_retention{lift::header_retention::final_hop};
+    /// Which parts of the response are kept, or std::nullopt for all of it.
+    std::optional<capture_policy> m_capture_policy{std::nullopt};
+    /// The digest computed over the response body, or std::nullopt for none.
+    std::optional<integrity_policy> m_integrity_policy{std::nullopt};
 
     /**
      * Used by the client to set an async callback for on completion notification to the user.
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "lift/buffer_pool.hpp"
+#include "lift/const.hpp"
 #include "lift/header.hpp"
 #include "lift/http.hpp"
 #include "lift/lift_status.hpp"
@@ -7,8 +9,10 @@
 #include <curl/curl.h>
 #include <uv.h>
 
+#include <array>
 #include <chrono>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -18,11 +22,15 @@ namespace lift
 {
 class client;
 class executor;
+class cache_policy;
+class disk_cache;
 
 class response
 {
     friend client;
     friend executor;
+    friend cache_policy;
+    friend disk_cache;
 
 public:
     response();
@@ -54,19 +62,151 @@ public:
     [[nodiscard]] auto status_code() const -> http::status_code { return m_status_code; }
 
     /**
-     * @return The HTTP response headers.
+     * The headers view the response, they are only valid while the response is alive and unmodified.
+     * @return The final HTTP response's headers in the order they were received.
      */
-    [[nodiscard]] auto headers() const -> const std::vector<header>& { return m_headers; }
+    [[nodiscard]] auto headers() const -> header_range { return hop_headers(m_header_hops.size()); }
 
     /**
-     * @return The header if it exists on this response, otherwise std::nullopt.
+     * @return The number of responses whose headers were kept, this is only more than one when the request
+     *         kept the headers of all hops and redirects were followed or interim responses were received.
      */
-    [[nodiscard]] auto header(std::string_view name) const -> std::optional<std::reference_wrapper<const lift::header>>;
+    [[nodiscard]] auto header_hops() const -> std::size_t { return m_header_hops.size() + 1; }
 
     /**
+     * @param hop The response in the order they were received, the last hop is the final response.
+     * @return The hop's headers in the order they were received.
+     */
+    [[nodiscard]] auto hop_headers(std::size_t hop) const -> header_range;
+
+    /**
+     * @param hop The response in the order they were received, the last hop is the final response.
+     * @return The hop's status code.
+     */
+    [[nodiscard]] auto hop_status_code(std::size_t hop) const -> http::status_code;
+
+    /**
+     * Looks the header up by its case insensitive name through the response's header index, this doesn't
+     * allocate.  The header views the response, it is only valid while the response is alive and unmodified.
+     * @param name The name of the header.
+     * @return The first header with the name if it exists on this response, otherwise std::nullopt.
+     */
+    [[nodiscard]] auto header(std::string_view name) const -> std::optional<header_view>;
+
+    /**
+     * The well known headers are parsed once as they are received, these never scan the headers.
+     * @return The Content-Length if the response has a valid one.
+     */
+    [[nodiscard]] auto content_length() const -> std::optional<uint64_t> { return m_content_length; }
+
+    /**
+     * @return The media type of the Content-Type, no_content if the response doesn't have one or unknown
+     *         if it isn't a known media type.
+     */
+    [[nodiscard]] auto content_type() const -> http::content_type { return m_content_type; }
+
+    /**
+     * @return The Connection type if the response has a known one.
+     */
+    [[nodiscard]] auto connection() const -> std::optional<http::connection_type> { return m_connection; }
+
+    /**
+     * @return The ETag if the response has one.
+     */
+    [[nodiscard]] auto etag() const -> std::optional<std::string_view>;
+
+    /**
+     * @return The Last-Modified date if the response has one.
+     */
+    [[nodiscard]] auto last_modified() const -> std::optional<std::string_view>;
+
+    /**
+     * @return The Content-Encoding, e.g. "gzip", if the response has one.
+     */
+    [[nodiscard]] auto content_encoding() const -> std::optional<std::string_view>;
+
+    /**
+     * @return The first Cache-Control header's directives if the response has one.
+     */
+    [[nodiscard]] auto cache_control() const -> std::optional<std::string_view>;
+
+    /**
+     * @return How long the server asked to wait before retrying if the response has a valid Retry-After,
+     *         a date in the past is zero.
+     */
+    [[nodiscard]] auto retry_after() const -> std::optional<std::chrono::milliseconds>;
+
+    /**
+     * A body whose length wasn't known up front is received into a chain of segments, they are flattened
+     * when the request completes unless it asked for request::segmented_body().  A const response can't
+     * flatten itself, if the payload is still in segments this only views the first of them.
+     * @return The HTTP download payload.
+     */
+    [[nodiscard]] auto data() const -> std::string_view;
+
+    /**
+     * A body whose length wasn't known up front is received into a chain of segments, they are flattened
+     * into one contiguous buffer first, see flatten().  Use data_segments() to read the body without the copy.
      * @return The HTTP download payload.
      */
-    [[nodiscard]] auto data() const -> std::string_view { return std::string_view{m_data.data(), m_data.size()}; }
+    [[nodiscard]] auto data() -> std::string_view;
+
+    /**
+     * Joins the payload's segments into one contiguous buffer, this invalidates the views previously
+     * returned by data_segments().  Does nothing if the payload is already contiguous.
+     */
+    auto flatten() -> void;
+
+    /**
+     * @return The HTTP download payload as its contiguous segments in order, this never copies the payload.
+     */
+    [[nodiscard]] auto data_segments() const -> std::vector<std::string_view>;
+
+    /**
+     * @return The size of the HTTP download payload in bytes.
+     */
+    [[nodiscard]] auto data_size() const -> std::size_t;
+
+    /**
+     * @return The number of body bytes received, this includes any bytes not kept by the request's capture policy.
+     */
+    [[nodiscard]] auto download_size() const -> uint64_t { return m_download_size; }
+
+    /**
+     * @return Was the body larger than the request's capture policy keeps?
+     */
+    [[nodiscard]] auto body_truncated() const -> bool { return m_body_truncated; }
+
+    /**
+     * The body is delivered encoded if the request disabled content decoding, or didn't send an
+     * Accept-Encoding and the server encoded it anyway.
+     * @return Is data() still encoded with the response's Content-Encoding?
+     */
+    [[nodiscard]] auto content_encoded() const -> bool { return m_content_encoded; }
+
+    /**
+     * Decodes the HTTP download payload from its Content-Encoding.  The body is decoded on each call, it is
+     * never decoded into the response, so data() always returns the body as it was received.
+     * @param max_bytes The most bytes the payload may decode to, or std::nullopt for no limit.  Bound this
+     *                  when the body comes from an untrusted server, a small body can decode to gigabytes.
+     * @return The decoded payload, data() itself if it isn't encoded, or std::nullopt if it is encoded with an
+     *         unsupported encoding (only gzip and deflate are supported), is corrupt or truncated, or decodes
+     *         to more than max_bytes.
+     */
+    [[nodiscard]] auto decode_data(std::optional<std::size_t> max_bytes = std::nullopt) const
+        -> std::optional<std::string>;
+
+    /**
+     * The digest is computed over the body as it was received, before a capture policy truncated it and after
+     * curl decoded it, see request::integrity().
+     * @return The body's digest, empty if the request had no integrity policy.
+     */
+    [[nodiscard]] auto digest() const -> const std::vector<uint8_t>& { return m_digest; }
+
+    /**
+     * @return The body's digest as lower case hex, empty if the request had no integrity policy.
+     */
+    [[nodiscard]] auto digest_hex() const -> std::string;
 
     /**
      * @return The total HTTP request time in milliseconds.
@@ -76,6 +216,15 @@ public:
         return std::chrono::milliseconds{m_total_time};
     }
 
+    /**
+     * This is set once the final response's headers have arrived, before its body is received.
+     * @return The time from the start of the request until the first byte of the response was received.
+     */
+    [[nodiscard]] auto time_to_first_byte() const -> std::chrono::milliseconds
+    {
+        return std::chrono::milliseconds{m_time_to_first_byte};
+    }
+
     /**
      * @return The number of connections made to make this request
      */
@@ -86,6 +235,12 @@ public:
      */
     [[nodiscard]] auto num_redirects() const -> uint8_t { return m_num_redirects; }
 
+    /**
+     * @return The number of attempts made to execute this request, this is greater than one
+     *         if the request had a retry policy and was retried and zero if it was served from a cache.
+     */
+    [[nodiscard]] auto num_attempts() const -> uint8_t { return m_num_attempts; }
+
     /**
      * @return The network error message for diagnostics in case of a network request failure (if enabled).
      */
@@ -99,13 +254,69 @@ public:
 private:
     /// Ordered by sizeof() since response gets std::moved()'ed back to the client.
 
-    /// The response headers.
-    std::vector<lift::header> m_headers{};
+    /// Response data buffers are allocated from the client's buffer pool if it has one.
+    using data_buffer = std::vector<char, pool_allocator<char>>;
+
+    /// Every response header field back to back in one buffer, allocated from the buffer pool like the data.
+    data_buffer m_header_block{};
+    /// Where each header field is within m_header_block, in the order they were received.
+    std::vector<header_offsets> m_header_offsets{};
+    /// Open addressed index of the first header_index_max_count header fields by their case insensitive
+    /// name, each slot is the position of the first field with the name plus one, or zero if it is empty.
+    std::array<uint8_t, header_index_slots> m_header_index{};
+
+    struct header_hop
+    {
+        /// The position in m_header_offsets of the hop's first header field.
+        uint32_t m_first_header{0};
+        /// The hop's status code.
+        http::status_code m_status_code{http::status_code::http_unknown};
+    };
+
+    /// The hops before the final response whose headers were kept, this is only allocated if they are kept.
+    std::vector<header_hop> m_header_hops{};
+    /// The position in m_header_offsets of the final response's first header field, the index is relative to it.
+    uint32_t m_final_hop_header{0};
+
+    /// The headers parsed as they are received, each is the first field with its name.
+    enum class known_header : uint8_t
+    {
+        content_length,
+        content_type,
+        connection,
+        etag,
+        cache_control,
+        retry_after,
+        last_modified,
+        content_encoding,
+        count
+    };
+
+    /// The position plus one of the first field of each known header, or zero if the response doesn't have it.
+    std::array<uint16_t, static_cast<std::size_t>(known_header::count)> m_known_headers{};
+    /// The parsed Content-Length.
+    std::optional<uint64_t> m_content_length{std::nullopt};
+    /// The parsed Content-Type.
+    http::content_type m_content_type{http::content_type::no_content};
+    /// The parsed Connection.
+    std::optional<http::connection_type> m_connection{std::nullopt};
     /// The response data if any.
-    std::vector<char> m_data{};
+    data_buffer m_data{};
+    /// The response data received after m_data, each segment is allocated once and never grows.
+    std::vector<data_buffer> m_data_segments{};
+    /// The network error message for diagnostics, only set from the executor's error buffer when the request failed.
+    std::string m_network_error_message{};
+    /// Keeps the shared response data alive, if set the data is m_shared_view rather than m_data.
+    std::shared_ptr<const void> m_shared_owner{nullptr};
+    /// The response data when it is shared between responses, e.g. coalesced or cached responses.
+    std::string_view m_shared_view{};
+    /// The number of body bytes received.
+    uint64_t m_download_size{0};
     /// The total time in milliseconds to execute the request, stored as uint32_t since that is enough
     /// time for 49~ days and saves 4 bytes from std::chrono::milliseconds.
     uint32_t m_total_time{0};
+    /// The time in milliseconds until the first byte of the response was received.
+    uint32_t m_time_to_first_byte{0};
     /// The HTTP response status code.
     lift::http::status_code m_status_code{lift::http::status_code::http_unknown};
     /// The status of this HTTP request.
@@ -116,10 +327,104 @@ private:
     uint8_t m_num_connects{0};
     /// The number of redirects traversed while processing the request.
     uint8_t m_num_redirects{0};
+    /// The number of attempts made to execute the request.
+    uint8_t m_num_attempts{1};
+    /// Was the body larger than the request's capture policy keeps?
+    bool m_body_truncated{false};
+    /// Is the response data still encoded with its Content-Encoding?
+    bool m_content_encoded{false};
     // The curl error code in case of a network request failure.
     CURLcode m_curl_code{CURLcode::CURLE_OK};
-    // The network error message for diagnostics in case of a network request failure.
-    char m_network_error_message[CURL_ERROR_SIZE];
+    /// The body's digest computed by the request's integrity policy.
+    std::vector<uint8_t> m_digest{};
+
+    /**
+     * Creates a response whose data buffers are allocated from, and returned to, the buffer pool.
+     * @param pool The buffer pool, or nullptr to allocate from the heap.
+     */
+    explicit response(std::shared_ptr<buffer_pool> pool);
+
+    /**
+     * Appends a header field to the header block and indexes it.
+     * @param name The name of the header.
+     * @param value The value of the header.
+     * @return The header.
+     */
+    auto add_header(std::string_view name, std::string_view value) -> header_view;
+
+    /**
+     * Appends a received "<name>: <value>" header field, a field without a colon is kept with an empty value.
+     * @param field The header field without its trailing CRLF.
+     * @return The header.
+     */
+    auto add_header(std::string_view field) -> header_view;
+
+    /**
+     * Starts a new hop's headers, the header index then only finds the new hop's header fields.
+     * @param status_line The "HTTP/<version> <code> <reason>" status line without its trailing CRLF.
+     * @param keep_previous_hops Should the previous hops' headers be kept rather than dropped?
+     */
+    auto add_status_line(std::string_view status_line, bool keep_previous_hops) -> void;
+
+    /**
+     * Removes every header field.
+     */
+    auto clear_headers() -> void;
+
+    /**
+     * Clears the header index and the known headers parsed from the final hop's header fields.
+     */
+    auto clear_header_index() -> void;
+
+    /**
+     * Looks the name up in a perfect hash of the known header names, only the one candidate is compared.
+     * @param name The name of a header.
+     * @return The known header, or std::nullopt if it isn't one.
+     */
+    static auto to_known_header(std::string_view name) -> std::optional<known_header>;
+
+    /**
+     * @param known A known header.
+     * @return The first field of the known header if the response has it.
+     */
+    auto known_header_field(known_header known) const -> std::optional<header_view>;
+
+    /**
+     * Moves the response data into a reference counted buffer so copies of this response share
+     * the data rather than copying it.
+     */
+    auto share_data() -> void;
+
+    /**
+     * Presizes the response data for a body of a known length so it is received without reallocating.
+     * @param size The length of the body.
+     */
+    auto reserve_data(uint64_t size) -> void;
+
+    /**
+     * Appends to the response data, chaining a new segment rather than reallocating when it is full.
+     * @param chunk The data to append.
+     */
+    auto append_data(std::string_view chunk) -> void;
+
+    /**
+     * Replaces the response data with its decoded payload, see decode_data().
+     * @param max_bytes The most bytes the payload may decode to, or std::nullopt for no limit.
+     * @return CURLE_OK if the payload was decoded, or wasn't encoded, CURLE_FILESIZE_EXCEEDED if it decodes
+     *         to more than max_bytes, otherwise CURLE_BAD_CONTENT_ENCODING.
+     */
+    auto decode_in_place(std::optional<std::size_t> max_bytes) -> CURLcode;
+
+    /**
+     * @param coding A single content coding.
+     * @return Can decode_data() undo the coding?
+     */
+    static auto decodable(std::string_view coding) -> bool;
+
+    /**
+     * Drops the response data, returning its buffers to the pool.
+     */
+    auto clear_data() -> void;
 
     /// libcurl will call this function when a header is received for the HTTP request.
     friend auto curl_write_header(char* buffer, size_t size, size_t nitems, void* user_ptr) -> size_t;
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "lift/request.hpp"
+#include "lift/response.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace lift
+{
+/**
+ * A response stored in a response_cache along with everything needed to decide whether it can be
+ * served for a later request per RFC 9111.
+ */
+struct cache_entry
+{
+    using time_point = std::chrono::system_clock::time_point;
+
+    /// The stored response, its body is shared with every response served from this entry.
+    response m_response{};
+    /// The lower case names and values of the request headers the response varies on.
+    std::vector<std::pair<std::string, std::string>> m_vary{};
+    /// When the response was received.
+    time_point m_response_time{};
+    /// The age of the response when it was received.
+    std::chrono::seconds m_initial_age{0};
+    /// How long the response is fresh for.
+    std::chrono::seconds m_freshness_lifetime{0};
+    /// How long past its freshness lifetime the response may be served while it is revalidated.
+    std::chrono::seconds m_stale_while_revalidate{0};
+    /// The response must be revalidated before every use.
+    bool m_no_cache{false};
+    /// The response must not be served stale.
+    bool m_must_revalidate{false};
+    /// The response's ETag validator, if any.
+    std::optional<std::string> m_etag{std::nullopt};
+    /// The response's Last-Modified validator, if any.
+    std::optional<std::string> m_last_modified{std::nullopt};
+
+    /**
+     * @param now The current time.
+     * @return The current age of the response.
+     */
+    auto age(time_point now) const -> std::chrono::seconds;
+
+    /**
+     * @param now The current time.
+     * @return True if the response can be served without revalidating it.
+     */
+    auto fresh(time_point now) const -> bool;
+
+    /**
+     * @param now The current time.
+     * @return True if the stale response can be served while it is revalidated in the background.
+     */
+    auto stale_while_revalidate(time_point now) const -> bool;
+
+    /**
+     * @return True if the response can be revalidated with a conditional request.
+     */
+    auto has_validator() const -> bool { return m_etag.has_value() || m_last_modified.has_value(); }
+
+    /**
+     * @param request The request to check.
+     * @return True if the request's headers match the headers this response varies on.
+     */
+    auto matches(const request& request) const -> bool;
+
+    /**
+     * @return The approximate number of bytes this entry occupies.
+     */
+    auto size() const -> std::size_t;
+};
+
+using cache_entry_ptr = std::shared_ptr<const cache_entry>;
+
+/**
+ * Interface for the storage behind a lift::client's HTTP response cache.  The client decides what
+ * is stored, when entries are fresh and how they are revalidated, implementations only need to hold
+ * entries by key and decide which ones to evict.
+ *
+ * Implementations must be thread safe, a client looks up entries from the threads starting requests
+ * and stores them from its event loop thread.  A single cache can be shared by many clients.
+ */
+class response_cache
+{
+public:
+    response_cache()          = default;
+    virtual ~response_cache() = default;
+
+    response_cache(const response_cache&)                    = delete;
+    response_cache(response_cache&&)                         = delete;
+    auto operator=(const response_cache&) -> response_cache& = delete;
+    auto operator=(response_cache&&) -> response_cache&      = delete;
+
+    /**
+     * @param key The cache key to find.
+     * @return The stored entry, or nullptr if there isn't one.
+     */
+    virtual auto find(std::string_view key) -> cache_entry_ptr = 0;
+
+    /**
+     * Stores the entry, replacing any existing entry for the key.
+     * @param key The cache key to store the entry under.
+     * @param entry The entry to store.
+     */
+    virtual auto store(std::string_view key, cache_entry_ptr entry) -> void = 0;
+
+    /**
+     * @param key The cache key to remove.
+     */
+    virtual auto erase(std::string_view key) -> void = 0;
+};
+
+/**
+ * A size bounded, least recently used in memory response_cache.
+ */
+class memory_cache final : public response_cache
+{
+public:
+    /// The default maximum number of bytes held by a memory_cache.
+    static constexpr std::size_t default_max_bytes = 64 * 1024 * 1024;
+
+    /**
+     * @param max_bytes The maximum approximate number of bytes of entries held before evicting the
+     *                  least recently used, entries larger than this are never stored.
+     */
+    explicit memory_cache(std::size_t max_bytes = default_max_bytes);
+    ~memory_cache() override = default;
+
+    auto find(std::string_view key) -> cache_entry_ptr override;
+    auto store(std::string_view key, cache_entry_ptr entry) -> void override;
+    auto erase(std::string_view key) -> void override;
+
+    /**
+     * @return The number of entries held.
+     */
+    [[nodiscard]] auto size() const -> std::size_t;
+
+    /**
+     * @return The approximate number of bytes of entries held.
+     */
+    [[nodiscard]] auto bytes() const -> std::size_t;
+
+    /**
+     * @return The total number of entries evicted to make room for newer entries.
+     */
+    [[nodiscard]] auto evictions() const -> uint64_t;
+
+private:
+    using lru_list = std::list<std::pair<std::string, cache_entry_ptr>>;
+
+    /// Guards every member below.
+    mutable std::mutex m_lock{};
+    /// The maximum approximate number of bytes held.
+    std::size_t m_max_bytes{default_max_bytes};
+    /// The approximate number of bytes held.
+    std::size_t m_bytes{0};
+    /// The total number of entries evicted.
+    uint64_t m_evictions{0};
+    /// The entries in most recently used order.
+    lru_list m_lru{};
+    /// The entries keyed by cache key.
+    std::map<std::string, lru_list::iterator, std::less<>> m_entries{};
+
+    /**
+     * Removes the entry, the lock must be held.
+     */
+    auto erase_locked(std::map<std::string, lru_list::iterator, std::less<>>::iterator iter) -> void;
+};
+
+/**
+ * Layers a fast cache, usually a memory_cache, in front of a larger one such as a disk_cache.  Entries
+ * are stored in both tiers and entries found only in the larger tier are promoted into the fast tier.
+ */
+class tiered_cache final : public response_cache
+{
+public:
+    /**
+     * @param near The fast tier, looked up first.
+     * @param far The larger tier, looked up when near misses.
+     */
+    tiered_cache(std::shared_ptr<response_cache> near, std::shared_ptr<response_cache> far);
+    ~tiered_cache() override = default;
+
+    auto find(std::string_view key) -> cache_entry_ptr override;
+    auto store(std::string_view key, cache_entry_ptr entry) -> void override;
+    auto erase(std::string_view key) -> void override;
+
+private:
+    /// The fast tier.
+    std::shared_ptr<response_cache> m_near{nullptr};
+    /// The larger tier.
+    std::shared_ptr<response_cache> m_far{nullptr};
+};
+
+/**
+ * The RFC 9111 rules a lift::client applies to decide what is cached and for how long.  Only
+ * responses to GET requests without a body are cached, the client acts as a private cache.
+ */
+class cache_policy
+{
+public:
+    using time_point = cache_entry::time_point;
+
+    /**
+     * @param request The request to build a cache key for.
+     * @return The cache key, or std::nullopt if responses to the request are never cached.
+     */
+    static auto key(const request& request) -> std::optional<std::string>;
+
+    /**
+     * @param request The request to check.
+     * @return True if the request must not be served from, or stored in, the cache (Cache-Control: no-store
+     *         or the body is streamed into a body sink).
+     */
+    static auto bypass(const request& request) -> bool;
+
+    /**
+     * @param entry The stored entry.
+     * @param request The request that could be served by the entry.
+     * @param now The current time.
+     * @return True if the entry is fresh enough to serve the request without revalidating it.
+     */
+    static auto fresh(const cache_entry& entry, const request& request, time_point now) -> bool;
+
+    /**
+     * @param request The request to check.
+     * @return True if the request forbids serving a stale response (Cache-Control: no-cache).
+     */
+    static auto requires_validation(const request& request) -> bool;
+
+    /**
+     * Makes the request conditional on the entry's validators.
+     * @param entry The stale entry being revalidated.
+     * @param request The request to add If-None-Match and If-Modified-Since headers to.
+     */
+    static auto add_validators(const cache_entry& entry, request& request) -> void;
+
+    /**
+     * Builds an entry for the response if it is storable, the response's body is moved into a buffer
+     * that is shared between the response and the entry.
+     * @param request The request the response is for.
+     * @param response The response to store.
+     * @param now The time the response was received.
+     * @return The entry to store, or nullptr if the response must not be stored.
+     */
+    static auto make_entry(const request& request, response& response, time_point now) -> cache_entry_ptr;
+
+    /**
+     * Updates a stored entry with the headers of a 304 Not Modified response to its revalidation.
+     * @param request The conditional request.
+     * @param entry The stored entry that was revalidated.
+     * @param not_modified The 304 response.
+     * @param now The time the 304 response was received.
+     * @return The stored response updated with the new headers and the entry to replace the stored entry
+     *         with, or nullptr if the updated response must no longer be stored.
+     */
+    static auto revalidate(
+        const request& request, const cache_entry& entry, const response& not_modified, time_point now)
+        -> std::pair<response, cache_entry_ptr>;
+
+    /**
+     * @param entry The entry to serve.
+     * @return A response sharing the entry's body.
+     */
+    static auto serve(const cache_entry& entry) -> response;
+};
+
+} // namespace lift
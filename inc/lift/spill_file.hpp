@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace lift
+{
+struct spill_options
+{
+    /// A response body larger than this is moved out of memory into a temporary file as it is received.
+    std::size_t m_memory_threshold_bytes{16 * 1024 * 1024};
+    /// The maximum number of body bytes the client's in flight transfers hold in memory, a body that would
+    /// exceed it is spilled into a temporary file even if it is below m_memory_threshold_bytes.
+    std::size_t m_max_memory_bytes{256 * 1024 * 1024};
+    /// The directory the temporary files are created in, empty for std::filesystem::temp_directory_path().
+    /// The files are unlinked from the start, nothing is left behind if the process dies.
+    std::filesystem::path m_directory{};
+};
+
+/**
+ * An unlinked temporary file a response body is appended to once it is too large to be held in memory,
+ * see client::options::spill.  Once the body is complete the file is mapped read only and the response
+ * views the mapping, the file's blocks are released when the last response viewing it is destroyed.
+ */
+class spill_file
+{
+public:
+    spill_file() = default;
+    ~spill_file();
+
+    spill_file(const spill_file&)                    = delete;
+    spill_file(spill_file&&)                         = delete;
+    auto operator=(const spill_file&) -> spill_file& = delete;
+    auto operator=(spill_file&&) -> spill_file&      = delete;
+
+    /**
+     * Creates the unlinked file with O_TMPFILE, or with mkstemp() and unlink() if the file system
+     * doesn't support O_TMPFILE.
+     * @param directory The directory to create the file in, empty for the system's temporary directory.
+     * @return True if the file was created.
+     */
+    auto open(const std::filesystem::path& directory) -> bool;
+
+    /**
+     * @return Is the file open?
+     */
+    [[nodiscard]] auto is_open() const -> bool { return m_fd != -1; }
+
+    /**
+     * @param data The bytes to append to the file.
+     * @return True if every byte was written.
+     */
+    auto append(std::string_view data) -> bool;
+
+    /**
+     * @return The number of bytes appended to the file.
+     */
+    [[nodiscard]] auto size() const -> uint64_t { return m_size; }
+
+    /**
+     * Maps the file read only and closes it, the mapping stays valid until the returned pointer's last
+     * copy is released.
+     * @return The mapping, or nullptr if the file is empty or couldn't be mapped.
+     */
+    auto map() -> std::shared_ptr<const char>;
+
+    /**
+     * Closes the file, discarding its contents.
+     */
+    auto close() -> void;
+
+private:
+    /// The unlinked file, or -1.
+    int m_fd{-1};
+    /// The number of bytes appended to the file.
+    uint64_t m_size{0};
+};
+
+} // namespace lift
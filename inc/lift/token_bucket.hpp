@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace lift
+{
+struct rate_limit
+{
+    /// The sustained number of requests per second that are allowed to start.
+    double m_requests_per_second{100.0};
+    /// The maximum number of requests that can start back to back after being idle, at least 1.
+    double m_burst{1.0};
+};
+
+/**
+ * A token bucket refilled continuously at a rate_limit's requests per second up to its burst.
+ * Each request that starts takes a single token.
+ *
+ * This class is not thread safe, a lift::client only accesses it from its event loop thread.
+ */
+class token_bucket
+{
+public:
+    /// Millisecond steady clock time points, the same as the lift::client's event loop.
+    using time_point = uint64_t;
+    /// The wait_time() of a bucket with a zero rate, it never refills.
+    static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+    /**
+     * Creates a full bucket.
+     * @param limit The rate and burst of this bucket.
+     * @param now The current time.
+     */
+    token_bucket(rate_limit limit, time_point now);
+    ~token_bucket() = default;
+
+    token_bucket(const token_bucket&)                        = default;
+    token_bucket(token_bucket&&) noexcept                    = default;
+    auto operator=(const token_bucket&) -> token_bucket&     = default;
+    auto operator=(token_bucket&&) noexcept -> token_bucket& = default;
+
+    /**
+     * @param now The current time.
+     * @return True if there is at least one token available.
+     */
+    auto available(time_point now) -> bool;
+
+    /**
+     * Takes a single token, this should only be called after available() has returned true.
+     */
+    auto consume() -> void { m_tokens -= 1.0; }
+
+    /**
+     * @param now The current time.
+     * @return True if a token was available and taken.
+     */
+    auto try_acquire(time_point now) -> bool;
+
+    /**
+     * @param now The current time.
+     * @return The number of milliseconds until a token is available, zero if one is available now or
+     *         never if the bucket has a zero rate.
+     */
+    auto wait_time(time_point now) -> uint64_t;
+
+    /**
+     * @return The rate and burst of this bucket.
+     */
+    [[nodiscard]] auto limit() const noexcept -> const rate_limit& { return m_limit; }
+
+private:
+    /// The rate and burst of this bucket.
+    rate_limit m_limit{};
+    /// The current number of tokens, fractional so the refill is continuous.
+    double m_tokens{0};
+    /// The last time the bucket was refilled.
+    time_point m_last_refill{0};
+
+    /**
+     * Adds the tokens accumulated since the last refill.
+     */
+    auto refill(time_point now) -> void;
+};
+
+} // namespace lift
@@ -0,0 +1,182 @@
+#include "lift/body_sink.hpp"
+#include "lift/response.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace lift
+{
+auto body_sink::start(const request& /*req*/, const response& /*resp*/) -> void
+{
+}
+
+auto body_sink::finish(const request& /*req*/, const response& /*resp*/) -> void
+{
+}
+
+ndjson_decoder::ndjson_decoder(record_handler_type handler, std::size_t max_record_bytes)
+    : m_handler(std::move(handler)),
+      m_max_record_bytes(max_record_bytes)
+{
+}
+
+auto ndjson_decoder::write(const request& /*req*/, std::string_view chunk) -> bool
+{
+    while (!chunk.empty())
+    {
+        auto newline = chunk.find('\n');
+        auto line    = chunk.substr(0, newline);
+        if (m_partial.size() + line.size() > m_max_record_bytes)
+        {
+            return false;
+        }
+
+        if (newline == std::string_view::npos)
+        {
+            m_partial.append(chunk);
+            return true;
+        }
+        chunk.remove_prefix(newline + 1);
+
+        // Lines wholly inside the chunk are delivered without being copied.
+        if (m_partial.empty())
+        {
+            if (!deliver(line))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            m_partial.append(line);
+            auto ok = deliver(m_partial);
+            m_partial.clear();
+            if (!ok)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+auto ndjson_decoder::finish(const request& /*req*/, const response& resp) -> void
+{
+    if (resp.lift_status() == lift_status::success && !m_partial.empty())
+    {
+        deliver(m_partial);
+    }
+    m_partial.clear();
+}
+
+auto ndjson_decoder::deliver(std::string_view line) -> bool
+{
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+    if (line.empty())
+    {
+        return true;
+    }
+
+    ++m_records;
+    return m_handler(line);
+}
+
+length_prefixed_decoder::length_prefixed_decoder(
+    record_handler_type handler, uint8_t prefix_bytes, std::size_t max_record_bytes)
+    : m_handler(std::move(handler)),
+      m_prefix_bytes(prefix_bytes),
+      m_max_record_bytes(max_record_bytes)
+{
+    if (m_prefix_bytes != 1 && m_prefix_bytes != 2 && m_prefix_bytes != 4 && m_prefix_bytes != 8)
+    {
+        throw std::invalid_argument{"lift::length_prefixed_decoder prefix_bytes must be 1, 2, 4 or 8."};
+    }
+}
+
+auto length_prefixed_decoder::write(const request& /*req*/, std::string_view chunk) -> bool
+{
+    // Complete the record spanning chunks first, it is the only one that needs to be copied.
+    if (!m_partial.empty())
+    {
+        if (m_partial.size() < m_prefix_bytes)
+        {
+            auto take = std::min<std::size_t>(m_prefix_bytes - m_partial.size(), chunk.size());
+            m_partial.append(chunk.substr(0, take));
+            chunk.remove_prefix(take);
+            if (m_partial.size() < m_prefix_bytes)
+            {
+                return true;
+            }
+        }
+
+        auto size = record_size(m_partial).value();
+        if (size > m_max_record_bytes)
+        {
+            return false;
+        }
+
+        auto take = std::min<std::size_t>(m_prefix_bytes + size - m_partial.size(), chunk.size());
+        m_partial.append(chunk.substr(0, take));
+        chunk.remove_prefix(take);
+        if (m_partial.size() < m_prefix_bytes + size)
+        {
+            return true;
+        }
+
+        ++m_records;
+        auto ok = m_handler(std::string_view{m_partial}.substr(m_prefix_bytes));
+        m_partial.clear();
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    while (auto size = record_size(chunk))
+    {
+        if (size.value() > m_max_record_bytes)
+        {
+            return false;
+        }
+        if (chunk.size() < m_prefix_bytes + size.value())
+        {
+            break;
+        }
+
+        ++m_records;
+        if (!m_handler(chunk.substr(m_prefix_bytes, size.value())))
+        {
+            return false;
+        }
+        chunk.remove_prefix(m_prefix_bytes + size.value());
+    }
+
+    m_partial.append(chunk);
+    return true;
+}
+
+auto length_prefixed_decoder::finish(const request& /*req*/, const response& /*resp*/) -> void
+{
+    m_truncated = !m_partial.empty();
+    m_partial.clear();
+}
+
+auto length_prefixed_decoder::record_size(std::string_view data) const -> std::optional<uint64_t>
+{
+    if (data.size() < m_prefix_bytes)
+    {
+        return std::nullopt;
+    }
+
+    uint64_t size = 0;
+    for (uint8_t i = 0; i < m_prefix_bytes; ++i)
+    {
+        size = (size << 8) | static_cast<uint8_t>(data[i]);
+    }
+    return size;
+}
+
+} // namespace lift
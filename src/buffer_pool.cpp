@@ -0,0 +1,136 @@
+#include "lift/buffer_pool.hpp"
+
+#include <sys/mman.h>
+
+#include <new>
+
+namespace lift
+{
+/// Transparent huge pages are 2 MiB on the platforms that support them.
+static constexpr std::size_t huge_page_bytes = 2 * 1024 * 1024;
+/// Pooled buffers are cache line aligned.
+static constexpr std::size_t cache_line_bytes = 64;
+
+buffer_pool::buffer_pool(buffer_pool_options options) : m_options(options)
+{
+    // Size classes are powers of two from the minimum up to the maximum buffer size.
+    std::size_t min_bytes = cache_line_bytes;
+    while (min_bytes < m_options.m_min_buffer_bytes)
+    {
+        min_bytes <<= 1;
+    }
+    m_options.m_min_buffer_bytes = min_bytes;
+
+    std::size_t classes = 0;
+    for (auto bytes = min_bytes; bytes <= m_options.m_max_buffer_bytes && bytes != 0; bytes <<= 1)
+    {
+        ++classes;
+    }
+    m_idle.resize(classes);
+}
+
+buffer_pool::~buffer_pool()
+{
+    for (std::size_t index = 0; index < m_idle.size(); ++index)
+    {
+        auto bytes = class_bytes(index);
+        for (auto* buffer : m_idle[index])
+        {
+            ::operator delete(buffer, bytes, std::align_val_t{alignment(bytes)});
+        }
+    }
+}
+
+auto buffer_pool::allocate(std::size_t bytes) -> void*
+{
+    auto index = size_class(bytes);
+    if (index == m_idle.size())
+    {
+        return ::operator new(bytes);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard{m_lock};
+        auto&                       idle = m_idle[index];
+        if (!idle.empty())
+        {
+            auto* buffer = idle.back();
+            idle.pop_back();
+            m_idle_bytes -= class_bytes(index);
+            m_hits.fetch_add(1, std::memory_order_release);
+            return buffer;
+        }
+    }
+
+    m_misses.fetch_add(1, std::memory_order_release);
+    auto  class_size = class_bytes(index);
+    auto* buffer     = ::operator new(class_size, std::align_val_t{alignment(class_size)});
+    if (m_options.m_huge_pages && class_size >= huge_page_bytes)
+    {
+        // Best effort, the kernel may not support transparent huge pages.
+        (void)::madvise(buffer, class_size, MADV_HUGEPAGE);
+    }
+    return buffer;
+}
+
+auto buffer_pool::deallocate(void* buffer, std::size_t bytes) -> void
+{
+    auto index = size_class(bytes);
+    if (index == m_idle.size())
+    {
+        ::operator delete(buffer, bytes);
+        return;
+    }
+
+    auto class_size = class_bytes(index);
+    {
+        std::lock_guard<std::mutex> guard{m_lock};
+        if (m_idle_bytes + class_size <= m_options.m_max_idle_bytes)
+        {
+            m_idle[index].push_back(buffer);
+            m_idle_bytes += class_size;
+            return;
+        }
+    }
+
+    ::operator delete(buffer, class_size, std::align_val_t{alignment(class_size)});
+}
+
+auto buffer_pool::lease_bytes(std::size_t bytes) const -> std::size_t
+{
+    auto index = size_class(bytes);
+    return (index == m_idle.size()) ? bytes : class_bytes(index);
+}
+
+auto buffer_pool::idle_bytes() const -> std::size_t
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    return m_idle_bytes;
+}
+
+auto buffer_pool::size_class(std::size_t bytes) const -> std::size_t
+{
+    if (bytes < m_options.m_min_buffer_bytes || bytes > m_options.m_max_buffer_bytes)
+    {
+        return m_idle.size();
+    }
+
+    std::size_t index = 0;
+    while (index < m_idle.size() && class_bytes(index) < bytes)
+    {
+        ++index;
+    }
+    return index;
+}
+
+auto buffer_pool::class_bytes(std::size_t index) const -> std::size_t
+{
+    return m_options.m_min_buffer_bytes << index;
+}
+
+auto buffer_pool::alignment(std::size_t bytes) const -> std::size_t
+{
+    return (m_options.m_huge_pages && bytes >= huge_page_bytes) ? huge_page_bytes : cache_line_bytes;
+}
+
+} // namespace lift
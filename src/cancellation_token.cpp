@@ -0,0 +1,15 @@
+#include "lift/cancellation_token.hpp"
+#include "lift/client.hpp"
+
+namespace lift
+{
+cancellation_token::cancellation_token(client& c, uint64_t request_id) : m_client(&c), m_request_id(request_id)
+{
+}
+
+auto cancellation_token::cancel() const -> void
+{
+    m_client->cancel_request(m_request_id);
+}
+
+} // namespace lift
@@ -0,0 +1,132 @@
+#include "lift/circuit_breaker.hpp"
+
+#include <algorithm>
+
+namespace lift
+{
+using namespace std::string_literals;
+
+static const std::string circuit_breaker_state_closed    = "closed"s;
+static const std::string circuit_breaker_state_open      = "open"s;
+static const std::string circuit_breaker_state_half_open = "half_open"s;
+
+auto to_string(circuit_breaker_state state) -> const std::string&
+{
+    switch (state)
+    {
+        case circuit_breaker_state::open:
+            return circuit_breaker_state_open;
+        case circuit_breaker_state::half_open:
+            return circuit_breaker_state_half_open;
+        case circuit_breaker_state::closed:
+        default:
+            return circuit_breaker_state_closed;
+    }
+}
+
+circuit_breaker::circuit_breaker(circuit_breaker_policy policy)
+    : m_policy(std::move(policy)),
+      m_outcomes(std::max<uint32_t>(m_policy.m_window_size, 1), false)
+{
+}
+
+auto circuit_breaker::allow(time_point now) -> bool
+{
+    if (m_state == circuit_breaker_state::open)
+    {
+        if (now < m_opened_at + static_cast<time_point>(m_policy.m_open_duration.count()))
+        {
+            return false;
+        }
+        transition(now, circuit_breaker_state::half_open);
+    }
+
+    if (m_state == circuit_breaker_state::half_open)
+    {
+        if (m_probes_in_flight >= m_policy.m_half_open_max_probes ||
+            (m_last_probe_at != 0 &&
+             now < m_last_probe_at + static_cast<time_point>(m_policy.m_half_open_probe_interval.count())))
+        {
+            return false;
+        }
+
+        ++m_probes_in_flight;
+        // Zero is reserved to mean no probe has been sent yet.
+        m_last_probe_at = std::max<time_point>(now, 1);
+    }
+
+    return true;
+}
+
+auto circuit_breaker::record(time_point now, bool failure) -> void
+{
+    switch (m_state)
+    {
+        case circuit_breaker_state::closed:
+        {
+            auto window = static_cast<uint32_t>(m_outcomes.size());
+            auto index  = static_cast<std::size_t>(m_outcome_count % window);
+            if (m_outcome_count >= window && m_outcomes[index])
+            {
+                --m_failure_count;
+            }
+            m_outcomes[index] = failure;
+            if (failure)
+            {
+                ++m_failure_count;
+            }
+            ++m_outcome_count;
+
+            auto samples   = std::min<uint64_t>(m_outcome_count, window);
+            auto threshold = m_policy.m_failure_rate_threshold * static_cast<double>(samples);
+            if (samples >= m_policy.m_min_requests && static_cast<double>(m_failure_count) >= threshold)
+            {
+                transition(now, circuit_breaker_state::open);
+            }
+        }
+        break;
+        case circuit_breaker_state::half_open:
+            abandon();
+            if (failure)
+            {
+                transition(now, circuit_breaker_state::open);
+            }
+            else if (++m_probe_successes >= m_policy.m_half_open_success_threshold)
+            {
+                transition(now, circuit_breaker_state::closed);
+            }
+            break;
+        case circuit_breaker_state::open:
+            // Requests that started before the breaker opened don't change anything.
+            break;
+    }
+}
+
+auto circuit_breaker::abandon() -> void
+{
+    if (m_state == circuit_breaker_state::half_open && m_probes_in_flight > 0)
+    {
+        --m_probes_in_flight;
+    }
+}
+
+auto circuit_breaker::transition(time_point now, circuit_breaker_state state) -> void
+{
+    m_state            = state;
+    m_probes_in_flight = 0;
+    m_probe_successes  = 0;
+    m_last_probe_at    = 0;
+
+    if (state == circuit_breaker_state::open)
+    {
+        m_opened_at = now;
+    }
+    else if (state == circuit_breaker_state::closed)
+    {
+        std::fill(m_outcomes.begin(), m_outcomes.end(), false);
+        m_outcome_count = 0;
+        m_failure_count = 0;
+    }
+}
+
+} // namespace lift
@@ -4,7 +4,10 @@
 #include <curl/curl.h>
 #include <curl/multi.h>
 
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <ctime>
 #include <thread>
 
 using namespace std::chrono_literals;
@@ -69,6 +72,29 @@ private:
     curl_socket_t m_sock_fd{CURL_SOCKET_BAD};
 };
 
+class request_source
+{
+public:
+    request_source(
+        client::request_source_type source, request::async_callback_type callback, std::size_t concurrency)
+        : m_source(std::move(source)),
+          m_callback(std::move(callback)),
+          m_concurrency(concurrency)
+    {
+    }
+
+    /// The user's request source functor.
+    client::request_source_type m_source{nullptr};
+    /// The on complete handler applied to each request pulled from the source.
+    request::async_callback_type m_callback{nullptr};
+    /// The maximum number of in flight requests for this source.
+    std::size_t m_concurrency{1};
+    /// The current number of in flight requests for this source.
+    std::size_t m_in_flight{0};
+    /// Has the source returned nullptr signaling it has no more requests?
+    bool m_exhausted{false};
+};
+
 auto curl_start_timeout(CURLM* cmh, long timeout_ms, void* user_data) -> void;
 
 auto curl_handle_socket_actions(CURL* curl, curl_socket_t socket, int action, void* user_data, void* socketp) -> int;
@@ -83,13 +109,34 @@ auto on_uv_requests_accept_async(uv_async_t* handle) -> void;
 
 auto on_uv_shutdown_async(uv_async_t* handle) -> void;
 
+auto on_uv_decoded_async(uv_async_t* handle) -> void;
+
 auto on_uv_timesup_callback(uv_timer_t* handle) -> void;
 
+auto on_uv_hedge_callback(uv_timer_t* handle) -> void;
+
+auto on_uv_retry_callback(uv_timer_t* handle) -> void;
+
+auto on_uv_rate_limit_callback(uv_timer_t* handle) -> void;
+
+auto on_uv_wait_timeout_callback(uv_timer_t* handle) -> void;
+
 client::client(options opts)
     : m_connect_timeout(std::move(opts.connect_timeout)),
       m_curl_context_ready(),
       m_resolve_hosts(std::move(opts.resolve_hosts).value_or(std::vector<resolve_host>{})),
-      m_on_thread_callback(std::move(opts.on_thread_callback))
+      m_on_thread_callback(std::move(opts.on_thread_callback)),
+      m_hedge_budget_percent(opts.hedge_budget_percent),
+      m_retry_budget_percent(opts.retry_budget_percent),
+      m_circuit_breaker_policy(std::move(opts.circuit_breaker)),
+      m_on_circuit_breaker_callback(std::move(opts.on_circuit_breaker_callback)),
+      m_concurrency_limit_policy(std::move(opts.concurrency_limit)),
+      m_host_rate_limit(std::move(opts.host_rate_limit)),
+      m_single_flight_headers(std::move(opts.single_flight_headers)),
+      m_buffer_pool(std::move(opts.buffer_pool)),
+      m_cache(std::move(opts.cache)),
+      m_spill_options(std::move(opts.spill)),
+      m_decode_pool(std::move(opts.decode_pool))
 {
     global_init();
 
@@ -106,12 +153,43 @@ client::client(options opts)
     uv_async_init(&m_uv_loop, &m_uv_async_shutdown_pipe, on_uv_shutdown_async);
     m_uv_async_shutdown_pipe.data = this;
 
+    uv_async_init(&m_uv_loop, &m_uv_async_decoded, on_uv_decoded_async);
+    m_uv_async_decoded.data = this;
+
     uv_timer_init(&m_uv_loop, &m_uv_timer_curl);
     m_uv_timer_curl.data = this;
 
     uv_timer_init(&m_uv_loop, &m_uv_timer_timeout);
     m_uv_timer_timeout.data = this;
 
+    uv_timer_init(&m_uv_loop, &m_uv_timer_hedge);
+    m_uv_timer_hedge.data = this;
+
+    uv_timer_init(&m_uv_loop, &m_uv_timer_retry);
+    m_uv_timer_retry.data = this;
+
+    uv_timer_init(&m_uv_loop, &m_uv_timer_rate_limit);
+    m_uv_timer_rate_limit.data = this;
+
+    uv_timer_init(&m_uv_loop, &m_uv_timer_wait_timeout);
+    m_uv_timer_wait_timeout.data = this;
+
+    // The buckets start full as of the loop's initial time.
+    auto now = uv_now(&m_uv_loop);
+    if (opts.global_rate_limit.has_value())
+    {
+        m_global_bucket.emplace(opts.global_rate_limit.value(), now);
+    }
+    for (const auto& [tag, limit] : opts.tag_rate_limits)
+    {
+        m_tag_buckets.try_emplace(tag, limit, now);
+    }
+    if (opts.host_idle_timeout.has_value())
+    {
+        m_host_idle_timeout  = static_cast<uint64_t>(opts.host_idle_timeout.value().count());
+        m_next_host_eviction = now + m_host_idle_timeout.value();
+    }
+
     curl_multi_setopt(m_cmh, CURLMOPT_SOCKETFUNCTION, curl_handle_socket_actions);
     curl_multi_setopt(m_cmh, CURLMOPT_SOCKETDATA, this);
     curl_multi_setopt(m_cmh, CURLMOPT_TIMERFUNCTION, curl_start_timeout);
@@ -178,7 +256,7 @@ auto client::start_request(request_ptr&& request_ptr) -> request::async_future_t
     return future;
 }
 
-auto client::start_request(request_ptr&& request_ptr, request::async_callback_type callback) -> void
+auto client::start_request(request_ptr&& request_ptr, request::async_callback_type callback) -> cancellation_token
 {
     if (request_ptr == nullptr)
     {
@@ -189,8 +267,24 @@ auto client::start_request(request_ptr&& request_ptr, request::async_callback_ty
         throw std::runtime_error{"lift::client::start_request (callback) The callback cannot be nullptr."};
     }
 
+    cancellation_token token{*this, request_ptr->id()};
     request_ptr->async_callback(std::move(callback));
     start_request_common(std::move(request_ptr));
+    return token;
+}
+
+auto client::start_cancellable_request(request_ptr&& request_ptr)
+    -> std::pair<request::async_future_type, cancellation_token>
+{
+    if (request_ptr == nullptr)
+    {
+        throw std::runtime_error{"lift::client::start_cancellable_request The request_ptr cannot be nullptr."};
+    }
+
+    cancellation_token token{*this, request_ptr->id()};
+    auto               future = request_ptr->async_future();
+    start_request_common(std::move(request_ptr));
+    return {std::move(future), token};
 }
 
 auto client::start_request_common(request_ptr&& request_ptr) -> void
@@ -201,6 +295,11 @@ auto client::start_request_common(request_ptr&& request_ptr) -> void
         return;
     }
 
+    if (m_cache != nullptr && serve_from_cache(request_ptr))
+    {
+        return;
+    }
+
     // Do this now so that the event loop takes into account 'pending' requests as well.
     m_active_request_count.fetch_add(1, std::memory_order_release);
 
@@ -211,6 +310,217 @@ auto client::start_request_common(request_ptr&& request_ptr) -> void
     uv_async_send(&m_uv_async);
 }
 
+auto client::serve_from_cache(request_ptr& request_ptr) -> bool
+{
+    auto key = cache_policy::key(*request_ptr);
+    if (!key.has_value())
+    {
+        // Unsafe methods invalidate the stored response for their url, RFC 9111 section 4.4.
+        if (request_ptr->method() != http::method::get && request_ptr->method() != http::method::head)
+        {
+            const auto& url = request_ptr->url();
+            m_cache->erase(std::string_view{url}.substr(0, url.find('#')));
+        }
+        return false;
+    }
+
+    if (cache_policy::bypass(*request_ptr))
+    {
+        return false;
+    }
+
+    auto entry = m_cache->find(key.value());
+    if (entry != nullptr && !entry->matches(*request_ptr))
+    {
+        entry = nullptr;
+    }
+
+    auto now = std::chrono::system_clock::now();
+    if (entry != nullptr)
+    {
+        bool fresh = cache_policy::fresh(*entry, *request_ptr, now);
+        bool stale_while_revalidate =
+            !fresh && !cache_policy::requires_validation(*request_ptr) && entry->stale_while_revalidate(now);
+
+        if (fresh || stale_while_revalidate)
+        {
+            m_cache_hits.fetch_add(1, std::memory_order_release);
+
+            auto handler = std::move(request_ptr->m_on_complete_handler.m_object).value();
+
+            if (stale_while_revalidate && entry->has_validator())
+            {
+                bool revalidating = false;
+                {
+                    std::lock_guard<std::mutex> guard{m_cache_lock};
+                    revalidating = !m_cache_revalidating.emplace(key.value()).second;
+                }
+
+                if (!revalidating)
+                {
+                    // The handler has already been taken so the copy won't steal it.
+                    auto revalidate_ptr = std::make_unique<request>(*request_ptr);
+                    revalidate_ptr->m_on_complete_handler.m_object = request::async_handlers_type{std::monostate{}};
+                    cache_policy::add_validators(*entry, *revalidate_ptr);
+                    cache_on_complete(*revalidate_ptr, std::move(key).value(), entry, true);
+                    m_cache_revalidations.fetch_add(1, std::memory_order_release);
+
+                    m_active_request_count.fetch_add(1, std::memory_order_release);
+                    {
+                        std::lock_guard<std::mutex> guard{m_pending_requests_lock};
+                        m_pending_requests.emplace_back(std::move(revalidate_ptr));
+                    }
+                    uv_async_send(&m_uv_async);
+                }
+            }
+
+            notify(handler, std::move(request_ptr), cache_policy::serve(*entry));
+            return true;
+        }
+
+        if (entry->has_validator())
+        {
+            cache_policy::add_validators(*entry, *request_ptr);
+            m_cache_revalidations.fetch_add(1, std::memory_order_release);
+            cache_on_complete(*request_ptr, std::move(key).value(), std::move(entry), false);
+            return false;
+        }
+    }
+
+    m_cache_misses.fetch_add(1, std::memory_order_release);
+    cache_on_complete(*request_ptr, std::move(key).value(), nullptr, false);
+    return false;
+}
+
+auto client::cache_on_complete(request& request, std::string key, cache_entry_ptr entry, bool background) -> void
+{
+    // The promise type can't be copied into a std::function so the user's handler is shared instead.
+    auto handler = std::make_shared<request::async_handlers_type>(
+        std::move(request.m_on_complete_handler.m_object).value());
+
+    request.m_on_complete_handler.m_object = request::async_handlers_type{request::async_callback_type{
+        [this, key = std::move(key), entry = std::move(entry), handler, background](
+            lift::request_ptr request_ptr, response response)
+        {
+            auto now = std::chrono::system_clock::now();
+            if (response.lift_status() == lift_status::success)
+            {
+                if (entry != nullptr && response.status_code() == http::status_code::http_304_not_modified)
+                {
+                    auto [updated, updated_entry] = cache_policy::revalidate(*request_ptr, *entry, response, now);
+                    response                      = std::move(updated);
+                    if (updated_entry != nullptr)
+                    {
+                        m_cache->store(key, std::move(updated_entry));
+                    }
+                    else
+                    {
+                        m_cache->erase(key);
+                    }
+                }
+                else if (auto new_entry = cache_policy::make_entry(*request_ptr, response, now); new_entry != nullptr)
+                {
+                    m_cache->store(key, std::move(new_entry));
+                }
+                else if (static_cast<uint16_t>(response.status_code()) < 400)
+                {
+                    // The stored response has been superseded by one that can't be stored.
+                    m_cache->erase(key);
+                }
+            }
+
+            if (background)
+            {
+                std::lock_guard<std::mutex> guard{m_cache_lock};
+                m_cache_revalidating.erase(key);
+            }
+
+            notify(*handler, std::move(request_ptr), std::move(response));
+        }}};
+}
+
+auto client::start_request_source(
+    request_source_type source, request::async_callback_type callback, std::size_t concurrency) -> void
+{
+    if (source == nullptr)
+    {
+        throw std::runtime_error{"lift::client::start_request_source The source cannot be nullptr."};
+    }
+    if (callback == nullptr)
+    {
+        throw std::runtime_error{"lift::client::start_request_source The callback cannot be nullptr."};
+    }
+    if (concurrency == 0)
+    {
+        throw std::runtime_error{"lift::client::start_request_source The concurrency must be greater than zero."};
+    }
+
+    // There are no requests to notify of a failed start, the source is simply never pulled from.
+    if (m_is_stopping.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    // The source itself counts as an active request until it is exhausted and fully completed.
+    m_active_request_count.fetch_add(1, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> guard{m_pending_requests_lock};
+        m_pending_request_sources.emplace_back(
+            std::make_unique<request_source>(std::move(source), std::move(callback), concurrency));
+    }
+    uv_async_send(&m_uv_async);
+}
+
+auto client::start_download(
+    std::string url, std::filesystem::path path, download_callback_type callback, ranged_download_options options)
+    -> void
+{
+    if (callback == nullptr)
+    {
+        throw std::runtime_error{"lift::client::start_download The callback cannot be nullptr."};
+    }
+
+    impl::start_ranged_download(
+        [this](request_ptr request_ptr, request::async_callback_type request_callback)
+        { start_request(std::move(request_ptr), std::move(request_callback)); },
+        std::move(url),
+        std::move(path),
+        std::move(callback),
+        std::move(options));
+}
+
+auto client::start_download(std::string url, std::filesystem::path path, ranged_download_options options)
+    -> std::future<ranged_download_result>
+{
+    auto promise = std::make_shared<std::promise<ranged_download_result>>();
+    auto future  = promise->get_future();
+    start_download(
+        std::move(url),
+        std::move(path),
+        [promise](ranged_download_result result) { promise->set_value(std::move(result)); },
+        std::move(options));
+    return future;
+}
+
+auto client::cancel_request(uint64_t request_id) -> void
+{
+    {
+        std::lock_guard<std::mutex> guard{m_pending_requests_lock};
+        m_pending_cancel_ids.emplace_back(request_id);
+    }
+    uv_async_send(&m_uv_async);
+}
+
+auto client::cancel_requests(std::string tag) -> void
+{
+    {
+        std::lock_guard<std::mutex> guard{m_pending_requests_lock};
+        m_pending_cancel_tags.emplace_back(std::move(tag));
+    }
+    uv_async_send(&m_uv_async);
+}
+
 auto client::run() -> void
 {
     if (m_on_thread_callback != nullptr)
@@ -274,205 +584,1593 @@ auto client::check_actions(curl_socket_t socket, int event_bitmask) -> void
     }
 }
 
-auto client::complete_request_normal(executor_ptr exe_ptr, CURLcode curl_code) -> void
+auto client::add_request(request_ptr&& request_ptr, request_source* source) -> void
 {
-    auto& exe = *exe_ptr.get();
+    if (m_single_flight_headers.has_value() && join_flight(request_ptr, source))
+    {
+        return;
+    }
 
-    if (exe.m_on_complete_handler_processed == false)
+    if (!m_concurrency_limit_policy.has_value() && !m_global_bucket.has_value() && !m_host_rate_limit.has_value()
+        && m_tag_buckets.empty())
     {
-        // Don't run this logic twice ever.
-        exe.m_on_complete_handler_processed = true;
-        // Since the request completed remove it from the timeout set if it is there.
-        remove_timeout(exe);
+        execute_request(std::move(request_ptr), source, false);
+        return;
+    }
 
-        // Ownership over the async_handlers_type must be 'owned' here, otherwise when the request
-        // is moved below it will move out from under us and cause a segfault due to the custom
-        // 'copy_but_actually_move' object wrapper.
-        auto on_complete_handler = std::move(exe.m_request_async->m_on_complete_handler.m_object).value();
+    // Requests already waiting go first, nobody jumps the host's queue.
+    auto& host    = find_host_state(request_ptr->url());
+    auto  outcome = host.queue_empty() ? try_admit(host, *request_ptr) : admission::concurrency_limited;
+    if (outcome != admission::admitted)
+    {
+        // The request's timeout covers its wait in the queue, a request held back behind a slow or rate
+        // limited host still completes on time.
+        impl::queued_request queued{std::move(request_ptr), source};
+        add_wait_timeout(queued, impl::url_host(queued.m_request->url()), true);
+        if (outcome == admission::rate_limited)
+        {
+            queued.m_rate_limited = true;
+            m_requests_rate_limited.fetch_add(1, std::memory_order_release);
+            auto wait = rate_limit_wait(host, *queued.m_request);
+            if (outlives_deadline(queued, wait))
+            {
+                // The rate limit can't admit the request before it times out, there is no point holding it.
+                remove_wait_timeout(queued);
+                complete_request_aborted(queued, lift_status::timeout);
+                return;
+            }
+            schedule_rate_limit(wait);
+        }
+        host.enqueue(std::move(queued));
+        m_requests_queued.fetch_add(1, std::memory_order_release);
+        return;
+    }
 
-        if (std::holds_alternative<request::async_callback_type>(on_complete_handler))
+    execute_request(std::move(request_ptr), source, host.limiter().has_value());
+}
+
+auto client::single_flight_key(const request& request) const -> std::optional<std::string>
+{
+    // Only requests without side effects can share a response, and only if the response is received in full
+    // without the request streaming, capturing part of or declining it, in the same encoding and with the
+    // digest the request asked for.
+    if (request.method() != http::method::get || !request.data().empty() || !request.mime_fields().empty() ||
+        request.body_sink() != nullptr || request.capture().has_value() || request.has_headers_handler() ||
+        !request.content_decoding() || request.integrity().has_value())
+    {
+        return std::nullopt;
+    }
+
+    auto iequals = [](std::string_view a, std::string_view b)
+    {
+        return a.size() == b.size() && std::equal(
+                                           a.begin(),
+                                           a.end(),
+                                           b.begin(),
+                                           [](char x, char y)
+                                           {
+                                               return std::tolower(static_cast<unsigned char>(x)) ==
+                                                      std::tolower(static_cast<unsigned char>(y));
+                                           });
+    };
+
+    std::string key{http::to_string(request.method())};
+    key.append(" ");
+    key.append(request.url());
+    for (const auto& name : m_single_flight_headers.value())
+    {
+        key.append("\n");
+        for (const auto& header : request.headers())
         {
-            exe.copy_curl_to_response(curl_code);
+            if (iequals(header.name(), name))
+            {
+                key.append(header.value());
+                break;
+            }
+        }
+    }
+    return key;
+}
 
-            auto& callback = std::get<request::async_callback_type>(on_complete_handler);
-            callback(std::move(exe.m_request_async), std::move(exe.m_response));
+auto client::join_flight(request_ptr& request_ptr, request_source* source) -> bool
+{
+    auto key = single_flight_key(*request_ptr);
+    if (!key.has_value())
+    {
+        return false;
+    }
+
+    auto iter = m_flights.find(key.value());
+    if (iter != m_flights.end())
+    {
+        // The waiter times out on its own deadline, not the leader's.
+        impl::queued_request waiter{std::move(request_ptr), source};
+        add_wait_timeout(waiter, key.value(), false);
+        iter->second.m_waiters.emplace_back(std::move(waiter));
+        m_requests_coalesced.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    // Lead a new flight, the user's handler is invoked by complete_flight() after the waiters are notified.
+    auto& handler = request_ptr->m_on_complete_handler.m_object;
+    iter          = m_flights.try_emplace(key.value()).first;
+    iter->second.m_handler = std::move(handler).value();
+    handler                = request::async_handlers_type{request::async_callback_type{
+        [this, key = std::move(key).value()](lift::request_ptr leader, response leader_response)
+        { complete_flight(key, std::move(leader), std::move(leader_response)); }}};
+    return false;
+}
+
+auto client::complete_flight(const std::string& key, request_ptr leader, response leader_response) -> void
+{
+    auto node   = m_flights.extract(key);
+    auto& entry = node.mapped();
+
+    if (!entry.m_waiters.empty())
+    {
+        if (leader_response.lift_status() == lift_status::cancelled)
+        {
+            // The waiters weren't cancelled, re-add them on the next loop iteration and one will take the lead.
+            for (auto& waiter : entry.m_waiters)
+            {
+                remove_wait_timeout(waiter);
+                m_flight_orphans.emplace_back(std::move(waiter));
+            }
+            uv_async_send(&m_uv_async);
         }
-        else if (std::holds_alternative<request::async_promise_type>(on_complete_handler))
+        else
         {
-            exe.copy_curl_to_response(curl_code);
+            // Every waiter gets its own copy of the response metadata but the body is shared.
+            leader_response.share_data();
 
-            auto& promise = std::get<request::async_promise_type>(on_complete_handler);
-            promise.set_value(std::make_pair(std::move(exe.m_request_async), std::move(exe.m_response)));
+            for (auto& waiter : entry.m_waiters)
+            {
+                remove_wait_timeout(waiter);
+                auto handler = std::move(waiter.m_request->m_on_complete_handler.m_object).value();
+                notify(handler, std::move(waiter.m_request), leader_response);
+
+                if (waiter.m_source != nullptr)
+                {
+                    --waiter.m_source->m_in_flight;
+                    uv_async_send(&m_uv_async);
+                }
+                m_active_request_count.fetch_sub(1, std::memory_order_release);
+            }
         }
-        // else do nothing for std::monostate, the user doesn't want to be notified or this request
-        // has timedout but was allowed to finish establishing a connection.
     }
 
-    return_executor(std::move(exe_ptr));
-    m_active_request_count.fetch_sub(1, std::memory_order_release);
+    notify(entry.m_handler, std::move(leader), std::move(leader_response));
+}
+
+auto client::add_wait_timeout(impl::queued_request& waiter, std::string key, bool host_queue) -> void
+{
+    if (!waiter.m_deadline.has_value())
+    {
+        const auto& timeout = waiter.m_request->timeout();
+        if (!timeout.has_value())
+        {
+            return;
+        }
+        waiter.m_deadline = uv_now(&m_uv_loop) + static_cast<time_point>(timeout.value().count());
+    }
+
+    m_wait_timeouts.emplace(
+        waiter.m_deadline.value(), impl::wait_timeout{std::move(key), waiter.m_request.get(), host_queue});
+    update_wait_timeouts();
+}
+
+auto client::remove_wait_timeout(const impl::queued_request& waiter) -> void
+{
+    if (!waiter.m_deadline.has_value())
+    {
+        return;
+    }
+
+    auto [first, last] = m_wait_timeouts.equal_range(waiter.m_deadline.value());
+    for (auto iter = first; iter != last; ++iter)
+    {
+        if (iter->second.m_request == waiter.m_request.get())
+        {
+            m_wait_timeouts.erase(iter);
+            break;
+        }
+    }
+    update_wait_timeouts();
+}
+
+auto client::update_wait_timeouts() -> void
+{
+    uv_timer_stop(&m_uv_timer_wait_timeout);
+
+    if (!m_wait_timeouts.empty())
+    {
+        auto now   = uv_now(&m_uv_loop);
+        auto first = m_wait_timeouts.begin()->first;
+
+        uv_timer_start(
+            &m_uv_timer_wait_timeout, on_uv_wait_timeout_callback, (first > now) ? first - now : 0, 0);
+    }
+}
+
+auto client::complete_wait_timeouts() -> void
+{
+    auto now = uv_now(&m_uv_loop);
+
+    while (!m_wait_timeouts.empty())
+    {
+        auto iter = m_wait_timeouts.begin();
+        if (iter->first > now)
+        {
+            // Everything past this point has more time to wait.
+            break;
+        }
+
+        auto timed_out = std::move(iter->second);
+        m_wait_timeouts.erase(iter);
+
+        auto matches = [&timed_out](const request& r) { return &r == timed_out.m_request; };
+        if (timed_out.m_host_queue)
+        {
+            // The request is still waiting to be admitted, it never touched curl.
+            if (auto host = m_hosts.find(timed_out.m_key); host != m_hosts.end())
+            {
+                for (auto& expired : host->second.extract_queued(matches))
+                {
+                    m_requests_queued.fetch_sub(1, std::memory_order_release);
+                    complete_queued_timeout(expired);
+                }
+            }
+            continue;
+        }
+
+        auto flight = m_flights.find(timed_out.m_key);
+        if (flight == m_flights.end())
+        {
+            continue;
+        }
+
+        auto& waiters = flight->second.m_waiters;
+        auto  waiter  = std::find_if(
+            waiters.begin(),
+            waiters.end(),
+            [&matches](const impl::queued_request& w) { return matches(*w.m_request); });
+        if (waiter != waiters.end())
+        {
+            auto expired = std::move(*waiter);
+            waiters.erase(waiter);
+            complete_request_aborted(expired, lift_status::timeout);
+        }
+    }
+
+    update_wait_timeouts();
+}
+
+auto client::notify(request::async_handlers_type& handler, request_ptr request_ptr, response response) -> void
+{
+    if (std::holds_alternative<request::async_callback_type>(handler))
+    {
+        auto& callback = std::get<request::async_callback_type>(handler);
+        callback(std::move(request_ptr), std::move(response));
+    }
+    else if (std::holds_alternative<request::async_promise_type>(handler))
+    {
+        auto& promise = std::get<request::async_promise_type>(handler);
+        promise.set_value(std::make_pair(std::move(request_ptr), std::move(response)));
+    }
+    // else do nothing for std::monostate, the user doesn't want to be notified.
+}
+
+auto client::try_admit(impl::host_state& host, const request& request) -> admission
+{
+    auto          now = uv_now(&m_uv_loop);
+    token_bucket* tag_bucket{nullptr};
+    if (request.tag().has_value())
+    {
+        auto iter = m_tag_buckets.find(request.tag().value());
+        if (iter != m_tag_buckets.end())
+        {
+            tag_bucket = &iter->second;
+        }
+    }
+
+    // Only take tokens once every limit has room, otherwise a blocked request would drain the other buckets.
+    if ((m_global_bucket.has_value() && !m_global_bucket->available(now))
+        || (host.bucket().has_value() && !host.bucket()->available(now))
+        || (tag_bucket != nullptr && !tag_bucket->available(now)))
+    {
+        return admission::rate_limited;
+    }
+
+    if (host.limiter().has_value() && !host.limiter()->try_acquire())
+    {
+        return admission::concurrency_limited;
+    }
+
+    if (m_global_bucket.has_value())
+    {
+        m_global_bucket->consume();
+    }
+    if (host.bucket().has_value())
+    {
+        host.bucket()->consume();
+    }
+    if (tag_bucket != nullptr)
+    {
+        tag_bucket->consume();
+    }
+
+    return admission::admitted;
+}
+
+auto client::rate_limit_wait(impl::host_state& host, const request& request) -> uint64_t
+{
+    auto     now  = uv_now(&m_uv_loop);
+    uint64_t wait = 0;
+    if (m_global_bucket.has_value())
+    {
+        wait = std::max(wait, m_global_bucket->wait_time(now));
+    }
+    if (host.bucket().has_value())
+    {
+        wait = std::max(wait, host.bucket()->wait_time(now));
+    }
+    if (request.tag().has_value())
+    {
+        auto iter = m_tag_buckets.find(request.tag().value());
+        if (iter != m_tag_buckets.end())
+        {
+            wait = std::max(wait, iter->second.wait_time(now));
+        }
+    }
+    return wait;
+}
+
+auto client::complete_queued_timeout(impl::queued_request& queued) -> void
+{
+    if (queued.m_retry != nullptr)
+    {
+        // A retry is completed through its executor, it still holds the curl handle.
+        queued.m_retry->m_request_async = std::move(queued.m_request);
+        complete_request_aborted(*queued.m_retry, lift_status::timeout);
+    }
+    else
+    {
+        complete_request_aborted(queued, lift_status::timeout);
+    }
+}
+
+auto client::outlives_deadline(const impl::queued_request& queued, uint64_t wait) -> bool
+{
+    return queued.m_deadline.has_value() &&
+           (wait == token_bucket::never || uv_now(&m_uv_loop) + wait > queued.m_deadline.value());
+}
+
+auto client::schedule_rate_limit(uint64_t wait) -> void
+{
+    // A zero rate never admits anything, the waiting requests can only time out or be cancelled.
+    if (wait == token_bucket::never)
+    {
+        return;
+    }
+
+    // Always wait at least a millisecond so the timer can't spin on a bucket that is about to refill.
+    wait      = std::max(wait, uint64_t{1});
+    auto wake = uv_now(&m_uv_loop) + wait;
+    if (!m_rate_limit_wake.has_value() || wake < m_rate_limit_wake.value())
+    {
+        m_rate_limit_wake = wake;
+        uv_timer_start(&m_uv_timer_rate_limit, on_uv_rate_limit_callback, wait, 0);
+    }
+}
+
+auto client::execute_request(request_ptr&& request_ptr, request_source* source, bool concurrency_acquired) -> void
+{
+    auto executor_ptr = acquire_executor();
+    executor_ptr->start_async(std::move(request_ptr));
+    executor_ptr->m_request_source       = source;
+    executor_ptr->m_start_time           = uv_now(&m_uv_loop);
+    executor_ptr->m_concurrency_acquired = concurrency_acquired;
+    if (concurrency_acquired)
+    {
+        // Cache the host now, the slot is released after the request has been handed back to the user.
+        find_host_state(*executor_ptr);
+    }
+
+    if (!circuit_breaker_admit(*executor_ptr))
+    {
+        // The host is considered down, fail immediately without ever touching curl.
+        complete_request_aborted(*executor_ptr.release(), lift_status::circuit_open);
+        return;
+    }
+
+    executor_ptr->prepare();
+    ++m_requests_started;
+
+    // This must be done before adding to the CURLM* object,
+    // if not its possible a very fast request could complete
+    // before this gets into the multi-map!
+    add_timeout(*executor_ptr);
+
+    auto curl_code = curl_multi_add_handle(m_cmh, executor_ptr->m_curl_handle);
+
+    if (curl_code != CURLM_OK && curl_code != CURLM_CALL_MULTI_PERFORM)
+    {
+        /**
+         * If curl_multi_add_handle fails then notify the user that the request failed to start
+         * immediately.  This will return the just acquired executor back into the pool.
+         */
+        complete_request_normal(std::move(executor_ptr), CURLcode::CURLE_SEND_ERROR);
+    }
+    else
+    {
+        add_cancellable(*executor_ptr);
+        add_hedge(*executor_ptr);
+
+        /**
+         * Drop the unique_ptr safety around the request_ptr while it is being
+         * processed by curl.  When curl is finished completing the request
+         * it will be put back into a request object for the client to use.
+         */
+        (void)executor_ptr.release();
+
+        /**
+         * Immediately call curl's check action to get the current request moving.
+         * Curl appears to have an internal queue and if it gets too long it might
+         * drop requests.
+         */
+        check_actions();
+    }
+}
+
+auto client::drain_host_queues() -> void
+{
+    for (auto& [name, host] : m_hosts)
+    {
+        while (!host.queue_empty())
+        {
+            auto& front   = host.front();
+            auto  outcome = try_admit(host, *front.m_request);
+            if (outcome == admission::rate_limited)
+            {
+                if (!front.m_rate_limited)
+                {
+                    front.m_rate_limited = true;
+                    m_requests_rate_limited.fetch_add(1, std::memory_order_release);
+                }
+
+                auto wait = rate_limit_wait(host, *front.m_request);
+                if (outlives_deadline(front, wait))
+                {
+                    // Fail it now rather than holding it until its deadline, the next request may have longer.
+                    auto expired = host.dequeue();
+                    m_requests_queued.fetch_sub(1, std::memory_order_release);
+                    remove_wait_timeout(expired);
+                    complete_queued_timeout(expired);
+                    continue;
+                }
+                schedule_rate_limit(wait);
+                break;
+            }
+            if (outcome == admission::concurrency_limited)
+            {
+                break;
+            }
+
+            auto queued = host.dequeue();
+            m_requests_queued.fetch_sub(1, std::memory_order_release);
+            remove_wait_timeout(queued);
+            if (queued.m_retry != nullptr)
+            {
+                queued.m_retry->m_request_async        = std::move(queued.m_request);
+                queued.m_retry->m_concurrency_acquired = host.limiter().has_value();
+                execute_retry(*queued.m_retry);
+            }
+            else
+            {
+                execute_request(std::move(queued.m_request), queued.m_source, host.limiter().has_value());
+            }
+        }
+    }
+}
+
+auto client::pull_request_sources() -> void
+{
+    const bool stopping = m_is_stopping.load(std::memory_order_acquire);
+
+    for (auto& source_ptr : m_request_sources)
+    {
+        auto& source = *source_ptr;
+        while (!stopping && !source.m_exhausted && source.m_in_flight < source.m_concurrency)
+        {
+            lift::request_ptr request_ptr{nullptr};
+            try
+            {
+                request_ptr = source.m_source();
+            }
+            catch (...)
+            {
+                // This is the event loop thread, a throwing source ends the source rather than the process.
+                // Its in flight requests still complete normally.
+                request_ptr = nullptr;
+            }
+
+            if (request_ptr == nullptr)
+            {
+                source.m_exhausted = true;
+                break;
+            }
+
+            request_ptr->async_callback(source.m_callback);
+
+            // A cache hit completes immediately and never counts against the source's concurrency.
+            if (m_cache != nullptr && serve_from_cache(request_ptr))
+            {
+                continue;
+            }
+
+            ++source.m_in_flight;
+            m_active_request_count.fetch_add(1, std::memory_order_release);
+            add_request(std::move(request_ptr), &source);
+        }
+    }
+
+    // Release any sources that will never produce another request and have nothing left in flight.
+    auto released = std::remove_if(
+        m_request_sources.begin(),
+        m_request_sources.end(),
+        [stopping](const request_source_ptr& source_ptr)
+        { return (stopping || source_ptr->m_exhausted) && source_ptr->m_in_flight == 0; });
+    auto released_count = static_cast<std::size_t>(std::distance(released, m_request_sources.end()));
+    m_request_sources.erase(released, m_request_sources.end());
+    m_active_request_count.fetch_sub(released_count, std::memory_order_release);
+}
+
+auto client::complete_request_normal(executor_ptr exe_ptr, CURLcode curl_code) -> void
+{
+    auto& exe = *exe_ptr.get();
+
+    if (exe.m_hedge_iterator.has_value())
+    {
+        remove_hedge(exe);
+    }
+
+    if (exe.m_circuit_breaker_admitted || exe.m_concurrency_acquired)
+    {
+        auto failure = is_host_failure(exe.m_curl_handle, curl_code);
+        circuit_breaker_record(exe, failure);
+
+        if (exe.m_concurrency_acquired)
+        {
+            double total_time = 0;
+            curl_easy_getinfo(exe.m_curl_handle, CURLINFO_TOTAL_TIME, &total_time);
+
+            auto& host = find_host_state(exe);
+            host.limiter()->sample(
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>{total_time}),
+                failure);
+            host.concurrency_limit(host.limiter()->limit());
+        }
+    }
+
+    if (exe.m_is_hedge || exe.m_hedge_peer != nullptr)
+    {
+        if (!complete_request_hedged(exe, curl_code))
+        {
+            // This executor lost the race and the user will be notified by its peer.
+            return_executor(std::move(exe_ptr));
+            return;
+        }
+    }
+    else if (
+        exe.m_request_async->hedge().has_value() && exe.m_request_async->hedge().value().m_percentile.has_value() &&
+        executor::convert(curl_code) == lift_status::success)
+    {
+        // Only hosts with percentile based hedging need their latencies tracked.
+        double total_time = 0;
+        curl_easy_getinfo(exe.m_curl_handle, CURLINFO_TOTAL_TIME, &total_time);
+        find_host_state(exe.m_request_async->url())
+            .record_latency(
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>{total_time}));
+    }
+
+    if (exe.m_on_complete_handler_processed == false && add_retry(exe, curl_code))
+    {
+        // The executor is kept and re-used when the retry's backoff expires.
+        exe_ptr.release();
+        return;
+    }
+
+    // Set if the response is being decoded on the decode pool, the request completes once it is delivered.
+    bool offloaded{false};
+    if (exe.m_on_complete_handler_processed == false)
+    {
+        // Don't run this logic twice ever.
+        exe.m_on_complete_handler_processed = true;
+        // Since the request completed remove it from the timeout set if it is there.
+        remove_timeout(exe);
+
+        // Ownership over the async_handlers_type must be 'owned' here, otherwise when the request
+        // is moved below it will move out from under us and cause a segfault due to the custom
+        // 'copy_but_actually_move' object wrapper.
+        auto on_complete_handler = std::move(exe.m_request_async->m_on_complete_handler.m_object).value();
+
+        // Always copied so the request's body sink is finished even if nobody is notified.
+        exe.copy_curl_to_response(curl_code);
+        exe.finish_body_sink();
+
+        if (exe.m_response.content_encoded() && exe.offloads_decoding() &&
+            !std::holds_alternative<std::monostate>(on_complete_handler))
+        {
+            if (exe.m_response.data_size() >= m_decode_pool->options().m_min_offload_bytes)
+            {
+                decode_offloaded(
+                    std::move(on_complete_handler), std::move(exe.m_request_async), std::move(exe.m_response));
+                offloaded = true;
+            }
+            else
+            {
+                decode_response(exe.m_response);
+            }
+        }
+
+        // Nothing is notified for std::monostate, the user doesn't want to be notified or this request
+        // has timedout but was allowed to finish establishing a connection.
+        if (!offloaded)
+        {
+            notify(on_complete_handler, std::move(exe.m_request_async), std::move(exe.m_response));
+        }
+    }
+
+    if (exe.m_request_source != nullptr)
+    {
+        --exe.m_request_source->m_in_flight;
+        // Pull the replacement request(s) on the next loop iteration rather than recursing into curl here.
+        uv_async_send(&m_uv_async);
+    }
+
+    return_executor(std::move(exe_ptr));
+    if (!offloaded)
+    {
+        m_active_request_count.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+auto client::decode_offloaded(request::async_handlers_type handler, request_ptr request_ptr, response response)
+    -> void
+{
+    // std::function must be copyable, the promise in the handler isn't, so the job shares ownership of the request.
+    auto decoded = std::make_shared<decoded_request>(
+        decoded_request{std::move(handler), std::move(request_ptr), std::move(response)});
+    m_decode_pool->submit(
+        [this, decoded]()
+        {
+            decode_response(decoded->m_response);
+
+            {
+                std::lock_guard<std::mutex> guard{m_decoded_lock};
+                m_decoded_requests.emplace_back(std::move(*decoded));
+            }
+            uv_async_send(&m_uv_async_decoded);
+        });
+}
+
+auto client::decode_response(response& response) const -> void
+{
+    auto curl_code = response.decode_in_place(m_decode_pool->options().m_max_decoded_bytes);
+    if (curl_code != CURLE_OK)
+    {
+        response.m_curl_code   = curl_code;
+        response.m_lift_status = (curl_code == CURLE_FILESIZE_EXCEEDED) ? lift_status::download_error
+                                                                        : executor::convert(curl_code);
+    }
+}
+
+auto client::complete_request_hedged(executor& exe, CURLcode curl_code) -> bool
+{
+    auto* peer = exe.m_hedge_peer;
+
+    if (peer != nullptr)
+    {
+        exe.m_hedge_peer   = nullptr;
+        peer->m_hedge_peer = nullptr;
+
+        if (executor::convert(curl_code) != lift_status::success)
+        {
+            // The peer is still running and might succeed, let it deliver the final response.  If this is the
+            // original request then ownership of the user's request is handed over to the hedged duplicate.
+            if (!exe.m_is_hedge)
+            {
+                remove_timeout(exe);
+                remove_cancellable(exe);
+                peer->m_hedge_original = std::move(exe.m_request_async);
+                peer->m_request_source = exe.m_request_source;
+                add_cancellable(*peer);
+            }
+            return false;
+        }
+
+        // This executor won the race, cancel the peer's transfer.
+        auto peer_ptr = abort_executor(*peer);
+        if (exe.m_is_hedge)
+        {
+            exe.m_hedge_original = std::move(peer->m_request_async);
+            exe.m_request_source = peer->m_request_source;
+        }
+        return_executor(std::move(peer_ptr));
+    }
+
+    if (exe.m_is_hedge)
+    {
+        // Deliver the user's original request, the copy stays alive until the executor is reset
+        // since the curl handle still points into its data.
+        std::swap(exe.m_request_async, exe.m_hedge_original);
+        m_hedges_won.fetch_add(1, std::memory_order_release);
+    }
+
+    return true;
+}
+
+auto client::add_retry(executor& exe, CURLcode curl_code) -> bool
+{
+    const auto& policy = exe.m_request->retry();
+    if (!policy.has_value() || exe.m_is_hedge || exe.m_attempt >= policy.value().m_max_attempts)
+    {
+        return false;
+    }
+
+    // Body bytes already written to the request's sink can't be taken back, and a body too large for the
+    // request's capture policy or declined by its headers handler will be again.
+    if (exe.m_body_bytes_streamed > 0 || exe.m_response.m_body_truncated || exe.m_headers_aborted)
+    {
+        return false;
+    }
+
+    bool retryable = false;
+    auto status    = executor::convert(curl_code);
+    if (status == lift_status::success)
+    {
+        long http_response_code = 0;
+        curl_easy_getinfo(exe.m_curl_handle, CURLINFO_RESPONSE_CODE, &http_response_code);
+        auto  status_code = http::to_enum(static_cast<uint16_t>(http_response_code));
+        auto& codes       = policy.value().m_retry_on_status_codes;
+        retryable         = std::find(codes.begin(), codes.end(), status_code) != codes.end();
+    }
+    else
+    {
+        auto& statuses = policy.value().m_retry_on_lift_status;
+        retryable      = std::find(statuses.begin(), statuses.end(), status) != statuses.end();
+    }
+
+    if (!retryable)
+    {
+        return false;
+    }
+
+    // Retries are capped as a percentage of all the requests started so a brownout isn't amplified.
+    auto issued = m_retries_issued.load(std::memory_order_acquire);
+    if (static_cast<double>(issued + 1) > static_cast<double>(m_requests_started) * m_retry_budget_percent / 100.0)
+    {
+        return false;
+    }
+
+    // Exponential backoff capped at the max backoff, the shift is bounded to avoid overflow.
+    const auto& base_backoff = policy.value().m_base_backoff;
+    const auto& max_backoff  = policy.value().m_max_backoff;
+    auto        shift        = std::min<uint32_t>(exe.m_attempt - 1, 30);
+    auto        backoff      = std::min<int64_t>(base_backoff.count() * (int64_t{1} << shift), max_backoff.count());
+    if (policy.value().m_jitter && backoff > 0)
+    {
+        backoff = std::uniform_int_distribution<int64_t>{0, backoff}(m_retry_jitter);
+    }
+
+    if (policy.value().m_respect_retry_after)
+    {
+        if (auto retry_after = exe.m_response.retry_after(); retry_after.has_value())
+        {
+            auto retry_after_ms = static_cast<int64_t>(retry_after.value().count());
+
+            // The server wants the client to wait longer than it is willing to, deliver the response instead.
+            if (retry_after_ms > max_backoff.count())
+            {
+                return false;
+            }
+            backoff = std::max(backoff, retry_after_ms);
+        }
+    }
+
+    // A retry that can't start before the request's deadline would only time out, deliver this response instead.
+    if (exe.m_deadline.has_value() && uv_now(&m_uv_loop) + static_cast<time_point>(backoff) >= exe.m_deadline.value())
+    {
+        return false;
+    }
+
+    // The backoff doesn't hold the host's concurrency slot, start_retry() acquires one again.
+    if (exe.m_concurrency_acquired)
+    {
+        auto& host = find_host_state(exe);
+        host.limiter()->release();
+        exe.m_concurrency_acquired = false;
+        if (!host.queue_empty())
+        {
+            uv_async_send(&m_uv_async);
+        }
+    }
+
+    remove_timeout(exe);
+    ++exe.m_attempt;
+
+    // The failed attempt's body, possibly spilled into a file, is dropped before the next attempt.
+    exe.release_body();
+    exe.m_hasher.reset();
+    exe.m_response            = response{m_buffer_pool};
+    exe.m_headers_complete    = false;
+    exe.m_spill_early         = false;
+    exe.m_body_bytes_streamed = 0;
+
+    time_point tp        = uv_now(&m_uv_loop) + static_cast<time_point>(backoff);
+    exe.m_retry_iterator = m_retries.emplace(tp, &exe);
+    update_retries();
+
+    m_retries_issued.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+auto client::update_retries() -> void
+{
+    uv_timer_stop(&m_uv_timer_retry);
+
+    if (!m_retries.empty())
+    {
+        auto now   = uv_now(&m_uv_loop);
+        auto first = m_retries.begin()->first;
+
+        uv_timer_start(&m_uv_timer_retry, on_uv_retry_callback, (first > now) ? first - now : 0, 0);
+    }
+}
+
+auto client::start_retry(executor& exe) -> void
+{
+    if (!m_concurrency_limit_policy.has_value() && !m_global_bucket.has_value() && !m_host_rate_limit.has_value()
+        && m_tag_buckets.empty())
+    {
+        execute_retry(exe);
+        return;
+    }
+
+    // The retry is admitted like a new request, if the host is busy or rate limited it waits at the back
+    // of the host's queue.
+    auto& host    = find_host_state(exe);
+    auto  outcome = host.queue_empty() ? try_admit(host, *exe.m_request) : admission::concurrency_limited;
+    if (outcome != admission::admitted)
+    {
+        // The retry waits against the request's original deadline.
+        impl::queued_request queued{std::move(exe.m_request_async), exe.m_request_source};
+        queued.m_rate_limited = (outcome == admission::rate_limited);
+        queued.m_retry        = &exe;
+        queued.m_deadline     = exe.m_deadline;
+
+        if (outcome == admission::rate_limited)
+        {
+            m_requests_rate_limited.fetch_add(1, std::memory_order_release);
+            auto wait = rate_limit_wait(host, *exe.m_request);
+            if (outlives_deadline(queued, wait))
+            {
+                complete_queued_timeout(queued);
+                return;
+            }
+            schedule_rate_limit(wait);
+        }
+
+        add_wait_timeout(queued, impl::url_host(queued.m_request->url()), true);
+        host.enqueue(std::move(queued));
+        m_requests_queued.fetch_add(1, std::memory_order_release);
+        return;
+    }
+
+    exe.m_concurrency_acquired = host.limiter().has_value();
+    execute_retry(exe);
+}
+
+auto client::execute_retry(executor& exe) -> void
+{
+    if (!circuit_breaker_admit(exe))
+    {
+        complete_request_aborted(exe, lift_status::circuit_open);
+        return;
+    }
+
+    exe.m_start_time = uv_now(&m_uv_loop);
+
+    // The curl handle still has every option set from the previous attempt, it only needs
+    // its timeout re-applied before being added back into the curl multi handle.
+    add_timeout(exe);
+
+    auto curl_code = curl_multi_add_handle(m_cmh, exe.m_curl_handle);
+    if (curl_code != CURLM_OK && curl_code != CURLM_CALL_MULTI_PERFORM)
+    {
+        complete_request_normal(executor_ptr{&exe}, CURLcode::CURLE_SEND_ERROR);
+    }
+    else
+    {
+        check_actions();
+    }
+}
+
+auto client::complete_request_timeout(executor& exe) -> void
+{
+    /**
+     * NOTE: This function doesn't remove the request from the curl multi handle nor does it
+     *       return the executor to the pool.  That is because this function is still allowing
+     *       for curl to complete to establish http connections for extremely *low* timeout values.
+     *
+     *       This function expects that complete_request_normal will eventually be called by curl
+     *       to properly cleanup and finish the request and allow for the http connection to fully
+     *       establish.
+     */
+
+    // Call on complete if it exists and hasn't been called before.
+    if (exe.m_on_complete_handler_processed == false)
+    {
+        // Don't run this logic twice ever.
+        exe.m_on_complete_handler_processed = true;
+
+        // Ownership over the async_handlers_type must be 'owned' here, otherwise when the request
+        // is moved below it will move out from under us and cause a segfault due to the custom
+        // 'copy_but_actually_move' object wrapper.
+        auto on_complete_handler = std::move(exe.m_request_async->m_on_complete_handler.m_object).value();
+
+        // Removing the timesup is done in the uv timesup callback so it can prune
+        // every single item that has timesup'ed.  Doing it here will cause 1 item
+        // per loop iteration to be removed if there are multiple items with the same timesup value.
+        // remove_timeout(exe);
+
+        if (std::holds_alternative<request::async_callback_type>(on_complete_handler))
+        {
+            auto copy = complete_request_timeout_common(exe);
+
+            auto& callback = std::get<request::async_callback_type>(on_complete_handler);
+            callback(std::move(copy), std::move(exe.m_response));
+        }
+        else if (std::holds_alternative<request::async_promise_type>(on_complete_handler))
+        {
+            auto copy = complete_request_timeout_common(exe);
+
+            auto& promise = std::get<request::async_promise_type>(on_complete_handler);
+            promise.set_value(std::make_pair(std::move(copy), std::move(exe.m_response)));
+        }
+        // else do nothing for std::monostate, the user doesn't want to be notified.
+
+        circuit_breaker_record(exe, true);
+
+        // The user has their response, any pending or running hedge is no longer useful.
+        if (exe.m_hedge_iterator.has_value())
+        {
+            remove_hedge(exe);
+        }
+        if (exe.m_hedge_peer != nullptr)
+        {
+            auto* peer         = exe.m_hedge_peer;
+            exe.m_hedge_peer   = nullptr;
+            peer->m_hedge_peer = nullptr;
+            return_executor(abort_executor(*peer));
+        }
+    }
+}
+
+auto client::complete_request_timeout_common(executor& exe) -> request_ptr
+{
+    exe.m_response.m_lift_status = lift::lift_status::timeout;
+    exe.set_timesup_response(exe.m_request->timeout().value());
+    exe.finish_body_sink();
+
+    // IMPORTANT! Copying here is required _OR_ shared ownership must be added as libcurl
+    // maintains char* type pointers into the request data structure.  There is no guarantee
+    // after moving into user land that it will stay alive long enough until curl finishes its
+    // own timeout.  Shared ownership would most likely require locks as well since any curl
+    // handle still in the curl multi handle could be mutated by curl at any moment, copying
+    // seems far safer.
+
+    // IMPORTANT! The request's async completion handler object is _MOVED_ from the original
+    // object into the copied object.  After making this copy the original object must not invoke
+    // any async handlers (future or callback).
+    auto copy_ptr = std::make_unique<request>(*exe.m_request_async);
+    return copy_ptr;
+}
+
+auto client::add_timeout(executor& exe) -> void
+{
+    auto* request = exe.m_request;
+    if (request->timeout().has_value())
+    {
+        // Every attempt shares the first attempt's deadline, a retry only gets the time that is left.
+        auto now = uv_now(&m_uv_loop);
+        if (!exe.m_deadline.has_value())
+        {
+            exe.m_deadline = now + static_cast<time_point>(request->timeout().value().count());
+        }
+        auto timeout = std::chrono::milliseconds{std::max<int64_t>(
+            static_cast<int64_t>(exe.m_deadline.value()) - static_cast<int64_t>(now), 1)};
+
+        std::optional<std::chrono::milliseconds> connect_timeout{std::nullopt};
+        if (request->connect_timeout().has_value())
+        {
+            // Prefer the individual connect timeout over the event loop default.
+            connect_timeout = request->connect_timeout().value();
+        }
+        else if (m_connect_timeout.has_value())
+        {
+            connect_timeout = m_connect_timeout;
+        }
+
+        if (connect_timeout.has_value())
+        {
+            if (connect_timeout.value() > timeout)
+            {
+                time_point tp          = now + static_cast<time_point>(timeout.count());
+                exe.m_timeout_iterator = m_timeouts.emplace(tp, &exe);
+
+                update_timeouts();
+
+                curl_easy_setopt(
+                    exe.m_curl_handle, CURLOPT_TIMEOUT_MS, static_cast<long>(connect_timeout.value().count()));
+            }
+            else
+            {
+                // If the user set a longer timeout on the individual request, just let curl handle it.
+                curl_easy_setopt(exe.m_curl_handle, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+            }
+        }
+        else
+        {
+            curl_easy_setopt(exe.m_curl_handle, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+        }
+    }
+}
+
+auto client::remove_timeout(executor& exe) -> std::multimap<uint64_t, executor*>::iterator
+{
+    if (exe.m_timeout_iterator.has_value())
+    {
+        auto iter = exe.m_timeout_iterator.value();
+        auto next = m_timeouts.erase(iter);
+        exe.m_timeout_iterator.reset();
+
+        // Anytime an item is removed the timesup timer might need to be adjusted.
+        update_timeouts();
+
+        return next;
+    }
+    else
+    {
+        // This is probably a logic error if the passed in executor doesn't
+        // have a timeout, we'll update the timeouts to be sture we are triggering
+        // at the correct next timeout and return the end() so as not to go into
+        // an infinite loop if this is the first item.
+        update_timeouts();
+        return m_timeouts.end();
+    }
+}
+
+auto client::update_timeouts() -> void
+{
+    // TODO only change if it needs to change, this will probably require
+    // an iterator to the item just added or removed to properly skip
+    // setting the timer every single time.
+
+    if (!m_timeouts.empty())
+    {
+        auto now   = uv_now(&m_uv_loop);
+        auto first = m_timeouts.begin()->first;
+
+        // If the first item is already 'expired' setting the timer to zero
+        // will trigger uv to call its callback on the next loop iteration.
+        // Otherwise set the difference to how many milliseconds are between
+        // first and now.
+        uint64_t timer_value{0};
+        if (first > now)
+        {
+            timer_value = first - now;
+        }
+
+        uv_timer_stop(&m_uv_timer_timeout);
+        uv_timer_start(&m_uv_timer_timeout, on_uv_timesup_callback, timer_value, 0);
+    }
+    else
+    {
+        uv_timer_stop(&m_uv_timer_timeout);
+    }
+}
+
+auto client::abort_executor(executor& exe) -> executor_ptr
+{
+    curl_multi_remove_handle(m_cmh, exe.m_curl_handle);
+
+    if (exe.m_timeout_iterator.has_value())
+    {
+        remove_timeout(exe);
+    }
+    if (exe.m_hedge_iterator.has_value())
+    {
+        remove_hedge(exe);
+    }
+    if (exe.m_retry_iterator.has_value())
+    {
+        m_retries.erase(exe.m_retry_iterator.value());
+        exe.m_retry_iterator.reset();
+        update_retries();
+    }
+
+    return executor_ptr{&exe};
+}
+
+auto client::add_cancellable(executor& exe) -> void
+{
+    exe.m_cancel_iterator = m_cancellables.emplace(exe.m_request->id(), &exe);
+}
+
+auto client::remove_cancellable(executor& exe) -> void
+{
+    if (exe.m_cancel_iterator.has_value())
+    {
+        m_cancellables.erase(exe.m_cancel_iterator.value());
+        exe.m_cancel_iterator.reset();
+    }
+}
+
+auto client::cancel_executors(const std::vector<uint64_t>& ids, const std::vector<std::string>& tags) -> void
+{
+    std::vector<executor*> cancelling{};
+
+    for (const auto& id : ids)
+    {
+        auto [first, last] = m_cancellables.equal_range(id);
+        for (auto iter = first; iter != last; ++iter)
+        {
+            cancelling.emplace_back(iter->second);
+        }
+    }
+
+    if (!tags.empty())
+    {
+        for (const auto& [id, exe] : m_cancellables)
+        {
+            const auto& tag = exe->m_request->tag();
+            if (tag.has_value() && std::find(tags.begin(), tags.end(), tag.value()) != tags.end())
+            {
+                cancelling.emplace_back(exe);
+            }
+        }
+    }
+
+    auto matches = [&](const request& r)
+    {
+        return std::find(ids.begin(), ids.end(), r.id()) != ids.end() ||
+               (r.tag().has_value() && std::find(tags.begin(), tags.end(), r.tag().value()) != tags.end());
+    };
+
+    // Requests waiting on an identical in flight request have no executor yet, they never touched curl.
+    for (auto& [key, entry] : m_flights)
+    {
+        auto& waiters   = entry.m_waiters;
+        auto  cancelled = std::stable_partition(
+            waiters.begin(), waiters.end(), [&](const impl::queued_request& w) { return !matches(*w.m_request); });
+        for (auto iter = cancelled; iter != waiters.end(); ++iter)
+        {
+            remove_wait_timeout(*iter);
+            m_requests_cancelled.fetch_add(1, std::memory_order_release);
+            complete_request_aborted(*iter, lift_status::cancelled);
+        }
+        waiters.erase(cancelled, waiters.end());
+    }
+
+    // Neither do requests still waiting in a host's queue.
+    if (m_requests_queued.load(std::memory_order_acquire) > 0)
+    {
+        for (auto& [name, host] : m_hosts)
+        {
+            for (auto& queued : host.extract_queued(matches))
+            {
+                m_requests_queued.fetch_sub(1, std::memory_order_release);
+                remove_wait_timeout(queued);
+                if (queued.m_retry != nullptr)
+                {
+                    // A retry is still registered as cancellable, it is completed through its executor below.
+                    queued.m_retry->m_request_async = std::move(queued.m_request);
+                    cancelling.emplace_back(queued.m_retry);
+                }
+                else
+                {
+                    m_requests_cancelled.fetch_add(1, std::memory_order_release);
+                    complete_request_aborted(queued, lift_status::cancelled);
+                }
+            }
+        }
+    }
+
+    // A request could be cancelled by both its identifier and its tag, or be found queued as a retry,
+    // only complete it once.
+    std::sort(cancelling.begin(), cancelling.end());
+    cancelling.erase(std::unique(cancelling.begin(), cancelling.end()), cancelling.end());
+
+    for (auto* exe : cancelling)
+    {
+        if (complete_request_aborted(*exe, lift_status::cancelled))
+        {
+            m_requests_cancelled.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+auto client::complete_request_aborted(executor& exe, lift_status status) -> bool
+{
+    // Only the executor delivering the response is registered, any hedge racing it is simply discarded.
+    if (exe.m_hedge_peer != nullptr)
+    {
+        auto* peer         = exe.m_hedge_peer;
+        exe.m_hedge_peer   = nullptr;
+        peer->m_hedge_peer = nullptr;
+        return_executor(abort_executor(*peer));
+    }
+
+    auto exe_ptr = abort_executor(exe);
+
+    if (exe.m_is_hedge)
+    {
+        // The original request was handed over to this hedge, deliver it instead of the copy.
+        std::swap(exe.m_request_async, exe.m_hedge_original);
+    }
+
+    // If the request has already timed out to the user there is nobody left to notify, the
+    // transfer is simply stopped early.
+    bool notified = false;
+    if (exe.m_on_complete_handler_processed == false)
+    {
+        exe.m_on_complete_handler_processed = true;
+        notified                            = true;
+
+        auto on_complete_handler = std::move(exe.m_request_async->m_on_complete_handler.m_object).value();
+
+        exe.copy_curl_to_response(CURLcode::CURLE_ABORTED_BY_CALLBACK);
+        exe.m_response.m_lift_status = status;
+        exe.finish_body_sink();
+
+        if (std::holds_alternative<request::async_callback_type>(on_complete_handler))
+        {
+            auto& callback = std::get<request::async_callback_type>(on_complete_handler);
+            callback(std::move(exe.m_request_async), std::move(exe.m_response));
+        }
+        else if (std::holds_alternative<request::async_promise_type>(on_complete_handler))
+        {
+            auto& promise = std::get<request::async_promise_type>(on_complete_handler);
+            promise.set_value(std::make_pair(std::move(exe.m_request_async), std::move(exe.m_response)));
+        }
+    }
+
+    if (exe.m_request_source != nullptr)
+    {
+        --exe.m_request_source->m_in_flight;
+        uv_async_send(&m_uv_async);
+    }
+
+    return_executor(std::move(exe_ptr));
+    m_active_request_count.fetch_sub(1, std::memory_order_release);
+    return notified;
+}
+
+auto client::complete_request_aborted(impl::queued_request& queued, lift_status status) -> void
+{
+    auto handler = std::move(queued.m_request->m_on_complete_handler.m_object).value();
+
+    response response{m_buffer_pool};
+    response.m_lift_status  = status;
+    response.m_num_attempts = 0;
+    if (status == lift_status::timeout)
+    {
+        response.m_status_code = http::status_code::http_504_gateway_timeout;
+        response.m_total_time  = static_cast<uint32_t>(queued.m_request->timeout().value_or(0ms).count());
+    }
+    notify(handler, std::move(queued.m_request), std::move(response));
+
+    if (queued.m_source != nullptr)
+    {
+        --queued.m_source->m_in_flight;
+        uv_async_send(&m_uv_async);
+    }
+    m_active_request_count.fetch_sub(1, std::memory_order_release);
+}
+
+auto client::circuit_breaker_admit(executor& exe) -> bool
+{
+    if (!m_circuit_breaker_policy.has_value())
+    {
+        return true;
+    }
+
+    auto& host = find_host_state(exe);
+    auto  from = host.breaker()->state();
+
+    exe.m_circuit_breaker_admitted = host.breaker()->allow(uv_now(&m_uv_loop));
+    circuit_breaker_changed(exe.m_request->url(), host, from);
+
+    if (!exe.m_circuit_breaker_admitted)
+    {
+        m_circuit_breaker_rejections.fetch_add(1, std::memory_order_release);
+    }
+    return exe.m_circuit_breaker_admitted;
+}
+
+auto client::circuit_breaker_record(executor& exe, bool failure) -> void
+{
+    if (!exe.m_circuit_breaker_admitted)
+    {
+        return;
+    }
+    exe.m_circuit_breaker_admitted = false;
+
+    auto& host = find_host_state(exe);
+    auto  from = host.breaker()->state();
+
+    host.breaker()->record(uv_now(&m_uv_loop), failure);
+    circuit_breaker_changed(exe.m_request->url(), host, from);
+}
+
+auto client::is_host_failure(CURL* curl_handle, CURLcode curl_code) -> bool
+{
+    auto status = executor::convert(curl_code);
+    if (status == lift_status::success)
+    {
+        long http_response_code = 0;
+        curl_easy_getinfo(curl_handle, CURLINFO_RESPONSE_CODE, &http_response_code);
+        return http_response_code >= 500;
+    }
+    return status == lift_status::connect_error || status == lift_status::timeout;
 }
 
-auto client::complete_request_timeout(executor& exe) -> void
+auto client::circuit_breaker_changed(std::string_view url, impl::host_state& host, circuit_breaker_state from) -> void
 {
-    /**
-     * NOTE: This function doesn't remove the request from the curl multi handle nor does it
-     *       return the executor to the pool.  That is because this function is still allowing
-     *       for curl to complete to establish http connections for extremely *low* timeout values.
-     *
-     *       This function expects that complete_request_normal will eventually be called by curl
-     *       to properly cleanup and finish the request and allow for the http connection to fully
-     *       establish.
-     */
-
-    // Call on complete if it exists and hasn't been called before.
-    if (exe.m_on_complete_handler_processed == false)
+    auto to = host.breaker()->state();
+    if (to == from)
     {
-        // Don't run this logic twice ever.
-        exe.m_on_complete_handler_processed = true;
+        return;
+    }
 
-        // Ownership over the async_handlers_type must be 'owned' here, otherwise when the request
-        // is moved below it will move out from under us and cause a segfault due to the custom
-        // 'copy_but_actually_move' object wrapper.
-        auto on_complete_handler = std::move(exe.m_request_async->m_on_complete_handler.m_object).value();
+    host.breaker_state(to);
+    if (to == circuit_breaker_state::open)
+    {
+        m_circuit_breaker_opens.fetch_add(1, std::memory_order_release);
+    }
 
-        // Removing the timesup is done in the uv timesup callback so it can prune
-        // every single item that has timesup'ed.  Doing it here will cause 1 item
-        // per loop iteration to be removed if there are multiple items with the same timesup value.
-        // remove_timeout(exe);
+    if (m_on_circuit_breaker_callback != nullptr)
+    {
+        m_on_circuit_breaker_callback(impl::url_host(url), from, to);
+    }
+}
 
-        if (std::holds_alternative<request::async_callback_type>(on_complete_handler))
-        {
-            auto copy = complete_request_timeout_common(exe);
+auto client::host_circuit_breaker_state(std::string_view host) const -> circuit_breaker_state
+{
+    std::lock_guard<std::mutex> guard{m_hosts_lock};
+    auto                        iter = m_hosts.find(impl::host_key(host));
+    return (iter != m_hosts.end()) ? iter->second.breaker_state() : circuit_breaker_state::closed;
+}
 
-            auto& callback = std::get<request::async_callback_type>(on_complete_handler);
-            callback(std::move(copy), std::move(exe.m_response));
-        }
-        else if (std::holds_alternative<request::async_promise_type>(on_complete_handler))
-        {
-            auto copy = complete_request_timeout_common(exe);
+auto client::host_concurrency_limit(std::string_view host) const -> std::optional<uint32_t>
+{
+    if (!m_concurrency_limit_policy.has_value())
+    {
+        return std::nullopt;
+    }
 
-            auto& promise = std::get<request::async_promise_type>(on_complete_handler);
-            promise.set_value(std::make_pair(std::move(copy), std::move(exe.m_response)));
-        }
-        // else do nothing for std::monostate, the user doesn't want to be notified.
+    std::lock_guard<std::mutex> guard{m_hosts_lock};
+    auto                        iter = m_hosts.find(impl::host_key(host));
+    if (iter == m_hosts.end())
+    {
+        // The host hasn't been seen yet, it will start at the initial limit.
+        auto policy = m_concurrency_limit_policy.value();
+        return concurrency_limiter{policy}.limit();
     }
+    return iter->second.concurrency_limit();
 }
 
-auto client::complete_request_timeout_common(executor& exe) -> request_ptr
+auto client::host_requests_queued(std::string_view host) const -> std::size_t
 {
-    exe.m_response.m_lift_status = lift::lift_status::timeout;
-    exe.set_timesup_response(exe.m_request->timeout().value());
-
-    // IMPORTANT! Copying here is required _OR_ shared ownership must be added as libcurl
-    // maintains char* type pointers into the request data structure.  There is no guarantee
-    // after moving into user land that it will stay alive long enough until curl finishes its
-    // own timeout.  Shared ownership would most likely require locks as well since any curl
-    // handle still in the curl multi handle could be mutated by curl at any moment, copying
-    // seems far safer.
+    std::lock_guard<std::mutex> guard{m_hosts_lock};
+    auto                        iter = m_hosts.find(impl::host_key(host));
+    return (iter != m_hosts.end()) ? iter->second.queued_count() : 0;
+}
 
-    // IMPORTANT! The request's async completion handler object is _MOVED_ from the original
-    // object into the copied object.  After making this copy the original object must not invoke
-    // any async handlers (future or callback).
-    auto copy_ptr = std::make_unique<request>(*exe.m_request_async);
-    return copy_ptr;
+auto client::host_count() const -> std::size_t
+{
+    std::lock_guard<std::mutex> guard{m_hosts_lock};
+    return m_hosts.size();
 }
 
-auto client::add_timeout(executor& exe) -> void
+auto client::find_host_state(executor& exe) -> impl::host_state&
 {
-    auto* request = exe.m_request;
-    if (request->timeout().has_value())
+    if (exe.m_host_state == nullptr)
     {
-        auto timeout = exe.m_request->timeout().value();
+        exe.m_host_state = &find_host_state(exe.m_request->url());
+        exe.m_host_state->add_reference();
+    }
+    return *exe.m_host_state;
+}
 
-        std::optional<std::chrono::milliseconds> connect_timeout{std::nullopt};
-        if (request->connect_timeout().has_value())
+auto client::find_host_state(std::string_view url) -> impl::host_state&
+{
+    auto host = impl::url_host(url);
+    auto iter = m_hosts.find(host);
+    if (iter == m_hosts.end())
+    {
+        std::lock_guard<std::mutex> guard{m_hosts_lock};
+        iter = m_hosts.try_emplace(std::move(host)).first;
+        if (m_circuit_breaker_policy.has_value())
         {
-            // Prefer the individual connect timeout over the event loop default.
-            connect_timeout = request->connect_timeout().value();
+            iter->second.breaker().emplace(m_circuit_breaker_policy.value());
         }
-        else if (m_connect_timeout.has_value())
+        if (m_concurrency_limit_policy.has_value())
         {
-            connect_timeout = m_connect_timeout;
+            iter->second.limiter().emplace(m_concurrency_limit_policy.value());
+            iter->second.concurrency_limit(iter->second.limiter()->limit());
         }
-
-        if (connect_timeout.has_value())
+        if (m_host_rate_limit.has_value())
         {
-            if (connect_timeout.value() > timeout)
-            {
-                auto       now         = uv_now(&m_uv_loop);
-                time_point tp          = now + static_cast<time_point>(timeout.count());
-                exe.m_timeout_iterator = m_timeouts.emplace(tp, &exe);
+            iter->second.bucket().emplace(m_host_rate_limit.value(), uv_now(&m_uv_loop));
+        }
+    }
+    iter->second.touch(uv_now(&m_uv_loop));
+    return iter->second;
+}
 
-                update_timeouts();
+auto client::evict_idle_hosts() -> void
+{
+    auto now = uv_now(&m_uv_loop);
+    if (!m_host_idle_timeout.has_value() || now < m_next_host_eviction)
+    {
+        return;
+    }
+    m_next_host_eviction = now + m_host_idle_timeout.value();
 
-                curl_easy_setopt(
-                    exe.m_curl_handle, CURLOPT_TIMEOUT_MS, static_cast<long>(connect_timeout.value().count()));
-            }
-            else
+    std::lock_guard<std::mutex> guard{m_hosts_lock};
+    for (auto iter = m_hosts.begin(); iter != m_hosts.end();)
+    {
+        iter = iter->second.evictable(now, m_host_idle_timeout.value()) ? m_hosts.erase(iter) : std::next(iter);
+    }
+}
+
+auto client::add_hedge(executor& exe) -> void
+{
+    // Two transfers can't both write into the request's body sink or call its headers handler.
+    const auto& policy = exe.m_request->hedge();
+    if (!policy.has_value() || exe.m_request->body_sink() != nullptr || exe.m_request->has_headers_handler())
+    {
+        return;
+    }
+
+    // A duplicate is only safe if applying the request twice has the same effect as applying it once.
+    switch (exe.m_request->method())
+    {
+        case http::method::get:
+        case http::method::head:
+        case http::method::options:
+            break;
+        case http::method::put:
+        case http::method::delete_t:
+            if (!policy.value().m_idempotent_writes)
             {
-                // If the user set a longer timeout on the individual request, just let curl handle it.
-                curl_easy_setopt(exe.m_curl_handle, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+                return;
             }
-        }
-        else
+            break;
+        default:
+            return;
+    }
+
+    auto delay = policy.value().m_delay;
+    if (policy.value().m_percentile.has_value())
+    {
+        auto observed =
+            find_host_state(exe.m_request->url()).latency_percentile(policy.value().m_percentile.value());
+        if (observed.has_value())
         {
-            curl_easy_setopt(exe.m_curl_handle, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+            delay = observed.value();
         }
     }
+
+    time_point tp        = exe.m_start_time + static_cast<time_point>(delay.count());
+    exe.m_hedge_iterator = m_hedges.emplace(tp, &exe);
+    update_hedges();
 }
 
-auto client::remove_timeout(executor& exe) -> std::multimap<uint64_t, executor*>::iterator
+auto client::remove_hedge(executor& exe) -> std::multimap<uint64_t, executor*>::iterator
 {
-    if (exe.m_timeout_iterator.has_value())
-    {
-        auto iter = exe.m_timeout_iterator.value();
-        auto next = m_timeouts.erase(iter);
-        exe.m_timeout_iterator.reset();
+    auto next = m_hedges.erase(exe.m_hedge_iterator.value());
+    exe.m_hedge_iterator.reset();
+    update_hedges();
+    return next;
+}
 
-        // Anytime an item is removed the timesup timer might need to be adjusted.
-        update_timeouts();
+auto client::update_hedges() -> void
+{
+    uv_timer_stop(&m_uv_timer_hedge);
 
-        return next;
-    }
-    else
+    if (!m_hedges.empty())
     {
-        // This is probably a logic error if the passed in executor doesn't
-        // have a timeout, we'll update the timeouts to be sture we are triggering
-        // at the correct next timeout and return the end() so as not to go into
-        // an infinite loop if this is the first item.
-        update_timeouts();
-        return m_timeouts.end();
+        auto now   = uv_now(&m_uv_loop);
+        auto first = m_hedges.begin()->first;
+
+        uv_timer_start(&m_uv_timer_hedge, on_uv_hedge_callback, (first > now) ? first - now : 0, 0);
     }
 }
 
-auto client::update_timeouts() -> void
+auto client::start_hedge(executor& exe) -> void
 {
-    // TODO only change if it needs to change, this will probably require
-    // an iterator to the item just added or removed to properly skip
-    // setting the timer every single time.
+    // The original request has already timed out to the user, nothing left to hedge.
+    if (exe.m_on_complete_handler_processed)
+    {
+        return;
+    }
 
-    if (!m_timeouts.empty())
+    // Hedges are capped as a percentage of all the requests started to limit the extra load.
+    auto issued = m_hedges_issued.load(std::memory_order_acquire);
+    if (static_cast<double>(issued + 1) > static_cast<double>(m_requests_started) * m_hedge_budget_percent / 100.0)
     {
-        auto now   = uv_now(&m_uv_loop);
-        auto first = m_timeouts.begin()->first;
+        return;
+    }
 
-        // If the first item is already 'expired' setting the timer to zero
-        // will trigger uv to call its callback on the next loop iteration.
-        // Otherwise set the difference to how many milliseconds are between
-        // first and now.
-        uint64_t timer_value{0};
-        if (first > now)
-        {
-            timer_value = first - now;
-        }
+    // Copying the request moves its on complete handler into the copy, the original must keep it.
+    auto hedge_request                            = std::make_unique<request>(*exe.m_request_async);
+    exe.m_request_async->m_on_complete_handler    = std::move(hedge_request->m_on_complete_handler);
+    hedge_request->m_on_complete_handler.m_object = request::async_handlers_type{std::monostate{}};
 
-        uv_timer_stop(&m_uv_timer_timeout);
-        uv_timer_start(&m_uv_timer_timeout, on_uv_timesup_callback, timer_value, 0);
+    const auto& policy = exe.m_request->hedge().value();
+    if (policy.m_alternate_url.has_value())
+    {
+        hedge_request->url(policy.m_alternate_url.value());
     }
-    else
+
+    // The hedge is admitted like any other request but never queued, by the time it would be admitted
+    // the original request has probably completed.
+    auto& host = find_host_state(hedge_request->url());
+    if (!host.queue_empty() || try_admit(host, *hedge_request) != admission::admitted)
     {
-        uv_timer_stop(&m_uv_timer_timeout);
+        return;
+    }
+
+    auto hedge_ptr = acquire_executor();
+    hedge_ptr->start_async(std::move(hedge_request));
+    hedge_ptr->m_is_hedge             = true;
+    hedge_ptr->m_start_time           = uv_now(&m_uv_loop);
+    hedge_ptr->m_concurrency_acquired = host.limiter().has_value();
+    find_host_state(*hedge_ptr);
+
+    if (!circuit_breaker_admit(*hedge_ptr))
+    {
+        // Releases the concurrency slot, the original request is still running.
+        return_executor(std::move(hedge_ptr));
+        return;
+    }
+
+    hedge_ptr->prepare();
+
+    // The hedge is bound by whatever time the original request has remaining.
+    if (const auto& timeout = hedge_ptr->m_request->timeout(); timeout.has_value())
+    {
+        auto elapsed   = static_cast<int64_t>(hedge_ptr->m_start_time - exe.m_start_time);
+        auto remaining = std::max<int64_t>(1, static_cast<int64_t>(timeout.value().count()) - elapsed);
+        curl_easy_setopt(hedge_ptr->m_curl_handle, CURLOPT_TIMEOUT_MS, static_cast<long>(remaining));
+    }
+
+    auto curl_code = curl_multi_add_handle(m_cmh, hedge_ptr->m_curl_handle);
+    if (curl_code != CURLM_OK && curl_code != CURLM_CALL_MULTI_PERFORM)
+    {
+        return_executor(std::move(hedge_ptr));
+        return;
     }
+
+    exe.m_hedge_peer        = hedge_ptr.get();
+    hedge_ptr->m_hedge_peer = &exe;
+    m_hedges_issued.fetch_add(1, std::memory_order_release);
+
+    (void)hedge_ptr.release();
+    check_actions();
 }
 
 auto client::acquire_executor() -> std::unique_ptr<executor>
@@ -495,6 +2193,26 @@ auto client::acquire_executor() -> std::unique_ptr<executor>
 
 auto client::return_executor(std::unique_ptr<executor> executor_ptr) -> void
 {
+    remove_cancellable(*executor_ptr);
+    if (executor_ptr->m_circuit_breaker_admitted)
+    {
+        // The attempt was aborted without an outcome, e.g. it lost a hedge race or was cancelled.
+        find_host_state(*executor_ptr).breaker()->abandon();
+    }
+    if (executor_ptr->m_concurrency_acquired)
+    {
+        auto& host = find_host_state(*executor_ptr);
+        host.limiter()->release();
+        if (!host.queue_empty())
+        {
+            // Start the next queued request(s) on the next loop iteration rather than recursing into curl here.
+            uv_async_send(&m_uv_async);
+        }
+    }
+    if (executor_ptr->m_host_state != nullptr)
+    {
+        executor_ptr->m_host_state->remove_reference(uv_now(&m_uv_loop));
+    }
     executor_ptr->reset();
     m_executors.push_back(std::move(executor_ptr));
 }
@@ -617,6 +2335,8 @@ auto on_uv_requests_accept_async(uv_async_t* handle) -> void
 {
     auto* c = static_cast<client*>(handle->data);
 
+    c->evict_idle_hosts();
+
     /**
      * This lock must not have any "curl_*" functions called
      * while it is held, curl has its own internal locks and
@@ -628,48 +2348,53 @@ auto on_uv_requests_accept_async(uv_async_t* handle) -> void
         std::lock_guard<std::mutex> guard{c->m_pending_requests_lock};
         // swap so we can release the lock as quickly as possible
         c->m_grabbed_requests.swap(c->m_pending_requests);
+
+        for (auto& source_ptr : c->m_pending_request_sources)
+        {
+            c->m_request_sources.emplace_back(std::move(source_ptr));
+        }
+        c->m_pending_request_sources.clear();
+
+        c->m_grabbed_cancel_ids.swap(c->m_pending_cancel_ids);
+        c->m_grabbed_cancel_tags.swap(c->m_pending_cancel_tags);
     }
 
     for (auto& request_ptr : c->m_grabbed_requests)
     {
-        auto executor_ptr = c->acquire_executor();
-        executor_ptr->start_async(std::move(request_ptr));
-        executor_ptr->prepare();
-
-        // This must be done before adding to the CURLM* object,
-        // if not its possible a very fast request could complete
-        // before this gets into the multi-map!
-        c->add_timeout(*executor_ptr);
+        c->add_request(std::move(request_ptr));
+    }
 
-        auto curl_code = curl_multi_add_handle(c->m_cmh, executor_ptr->m_curl_handle);
+    c->m_grabbed_requests.clear();
 
-        if (curl_code != CURLM_OK && curl_code != CURLM_CALL_MULTI_PERFORM)
+    // Waiters whose flight was cancelled out from under them.
+    if (!c->m_flight_orphans.empty())
+    {
+        auto orphans = std::move(c->m_flight_orphans);
+        c->m_flight_orphans.clear();
+        for (auto& orphan : orphans)
         {
-            /**
-             * If curl_multi_add_handle fails then notify the user that the request failed to start
-             * immediately.  This will return the just acquired executor back into the pool.
-             */
-            c->complete_request_normal(std::move(executor_ptr), CURLcode::CURLE_SEND_ERROR);
+            c->add_request(std::move(orphan.m_request), orphan.m_source);
         }
-        else
-        {
-            /**
-             * Drop the unique_ptr safety around the request_ptr while it is being
-             * processed by curl.  When curl is finished completing the request
-             * it will be put back into a request object for the client to use.
-             */
-            (void)executor_ptr.release();
+    }
 
-            /**
-             * Immediately call curl's check action to get the current request moving.
-             * Curl appears to have an internal queue and if it gets too long it might
-             * drop requests.
-             */
-            c->check_actions();
-        }
+    if (c->m_requests_queued.load(std::memory_order_acquire) > 0)
+    {
+        c->drain_host_queues();
     }
 
-    c->m_grabbed_requests.clear();
+    if (!c->m_request_sources.empty())
+    {
+        c->pull_request_sources();
+    }
+
+    // Cancellations are applied after accepting requests so a request cancelled immediately after
+    // being started is found executing.
+    if (!c->m_grabbed_cancel_ids.empty() || !c->m_grabbed_cancel_tags.empty())
+    {
+        c->cancel_executors(c->m_grabbed_cancel_ids, c->m_grabbed_cancel_tags);
+        c->m_grabbed_cancel_ids.clear();
+        c->m_grabbed_cancel_tags.clear();
+    }
 }
 
 auto on_uv_shutdown_async(uv_async_t* handle) -> void
@@ -678,10 +2403,39 @@ auto on_uv_shutdown_async(uv_async_t* handle) -> void
 
     uv_timer_stop(&c->m_uv_timer_curl);
     uv_timer_stop(&c->m_uv_timer_timeout);
+    uv_timer_stop(&c->m_uv_timer_hedge);
+    uv_timer_stop(&c->m_uv_timer_retry);
+    uv_timer_stop(&c->m_uv_timer_rate_limit);
+    uv_timer_stop(&c->m_uv_timer_wait_timeout);
     uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_timer_curl), uv_close_callback);
     uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_timer_timeout), uv_close_callback);
+    uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_timer_hedge), uv_close_callback);
+    uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_timer_retry), uv_close_callback);
+    uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_timer_rate_limit), uv_close_callback);
+    uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_timer_wait_timeout), uv_close_callback);
     uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_async), uv_close_callback);
     uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_async_shutdown_pipe), uv_close_callback);
+    uv_close(uv_type_cast<uv_handle_t>(&c->m_uv_async_decoded), uv_close_callback);
+}
+
+auto on_uv_decoded_async(uv_async_t* handle) -> void
+{
+    auto* c = static_cast<client*>(handle->data);
+
+    {
+        std::lock_guard<std::mutex> guard{c->m_decoded_lock};
+        c->m_grabbed_decoded_requests.swap(c->m_decoded_requests);
+    }
+
+    for (auto& decoded : c->m_grabbed_decoded_requests)
+    {
+        client::notify(decoded.m_handler, std::move(decoded.m_request), std::move(decoded.m_response));
+    }
+
+    // The requests stayed active while they were decoded so the client isn't destroyed from under them.
+    auto count = c->m_grabbed_decoded_requests.size();
+    c->m_grabbed_decoded_requests.clear();
+    c->m_active_request_count.fetch_sub(count, std::memory_order_release);
 }
 
 auto on_uv_timesup_callback(uv_timer_t* handle) -> void
@@ -712,4 +2466,61 @@ auto on_uv_timesup_callback(uv_timer_t* handle) -> void
     }
 }
 
+auto on_uv_hedge_callback(uv_timer_t* handle) -> void
+{
+    auto* c   = static_cast<client*>(handle->data);
+    auto  now = uv_now(&c->m_uv_loop);
+
+    while (!c->m_hedges.empty())
+    {
+        auto [tp, exe] = *c->m_hedges.begin();
+        if (tp > now)
+        {
+            // Everything past this point has more time to wait.
+            break;
+        }
+
+        c->remove_hedge(*exe);
+        c->start_hedge(*exe);
+    }
+}
+
+auto on_uv_retry_callback(uv_timer_t* handle) -> void
+{
+    auto* c   = static_cast<client*>(handle->data);
+    auto  now = uv_now(&c->m_uv_loop);
+
+    while (!c->m_retries.empty())
+    {
+        auto iter      = c->m_retries.begin();
+        auto [tp, exe] = *iter;
+        if (tp > now)
+        {
+            // Everything past this point has more time to wait.
+            break;
+        }
+
+        c->m_retries.erase(iter);
+        exe->m_retry_iterator.reset();
+        c->start_retry(*exe);
+    }
+
+    c->update_retries();
+}
+
+auto on_uv_rate_limit_callback(uv_timer_t* handle) -> void
+{
+    auto* c = static_cast<client*>(handle->data);
+
+    // The timer has fired, draining will reschedule it if any host is still rate limited.
+    c->m_rate_limit_wake.reset();
+    c->drain_host_queues();
+}
+
+auto on_uv_wait_timeout_callback(uv_timer_t* handle) -> void
+{
+    auto* c = static_cast<client*>(handle->data);
+    c->complete_wait_timeouts();
+}
+
 } // namespace lift
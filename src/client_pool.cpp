@@ -52,10 +52,49 @@ auto client_pool::start_request(request_ptr&& request_ptr) -> request::async_fut
     return m_clients[index]->start_request(std::move(request_ptr));
 }
 
-auto client_pool::start_request(request_ptr&& request_ptr, request::async_callback_type callback) -> void
+auto client_pool::start_request(request_ptr&& request_ptr, request::async_callback_type callback) -> cancellation_token
 {
     auto index = client_index_advance();
-    m_clients[index]->start_request(std::move(request_ptr), std::move(callback));
+    return m_clients[index]->start_request(std::move(request_ptr), std::move(callback));
+}
+
+auto client_pool::start_cancellable_request(request_ptr&& request_ptr)
+    -> std::pair<request::async_future_type, cancellation_token>
+{
+    auto index = client_index_advance();
+    return m_clients[index]->start_cancellable_request(std::move(request_ptr));
+}
+
+auto client_pool::start_download(
+    std::string url, std::filesystem::path path, download_callback_type callback, ranged_download_options options)
+    -> void
+{
+    if (callback == nullptr)
+    {
+        throw std::runtime_error{"lift::client_pool::start_download The callback cannot be nullptr."};
+    }
+
+    // Each range goes to the next client so the ranges are received on every client's event loop thread.
+    impl::start_ranged_download(
+        [this](request_ptr request_ptr, request::async_callback_type request_callback)
+        { start_request(std::move(request_ptr), std::move(request_callback)); },
+        std::move(url),
+        std::move(path),
+        std::move(callback),
+        std::move(options));
+}
+
+auto client_pool::start_download(std::string url, std::filesystem::path path, ranged_download_options options)
+    -> std::future<ranged_download_result>
+{
+    auto promise = std::make_shared<std::promise<ranged_download_result>>();
+    auto future  = promise->get_future();
+    start_download(
+        std::move(url),
+        std::move(path),
+        [promise](ranged_download_result result) { promise->set_value(std::move(result)); },
+        std::move(options));
+    return future;
 }
 
 } // namespace lift
@@ -0,0 +1,114 @@
+#include "lift/concurrency_limiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lift
+{
+using namespace std::string_literals;
+
+static const std::string concurrency_limit_algorithm_aimd     = "aimd"s;
+static const std::string concurrency_limit_algorithm_gradient = "gradient"s;
+
+auto to_string(concurrency_limit_algorithm algorithm) -> const std::string&
+{
+    switch (algorithm)
+    {
+        case concurrency_limit_algorithm::gradient:
+            return concurrency_limit_algorithm_gradient;
+        case concurrency_limit_algorithm::aimd:
+        default:
+            return concurrency_limit_algorithm_aimd;
+    }
+}
+
+concurrency_limiter::concurrency_limiter(concurrency_limit_policy policy)
+    : m_policy(std::move(policy)),
+      m_limit(static_cast<double>(std::clamp(m_policy.m_initial_limit, m_policy.m_min_limit, m_policy.m_max_limit)))
+{
+}
+
+auto concurrency_limiter::try_acquire() -> bool
+{
+    if (m_in_flight >= limit())
+    {
+        return false;
+    }
+    ++m_in_flight;
+    return true;
+}
+
+auto concurrency_limiter::release() -> void
+{
+    if (m_in_flight > 0)
+    {
+        --m_in_flight;
+    }
+}
+
+auto concurrency_limiter::sample(std::chrono::milliseconds latency, bool failure) -> void
+{
+    // Sub millisecond responses are treated as a millisecond so the ratios below stay meaningful.
+    auto observed = std::max(1.0, static_cast<double>(latency.count()));
+
+    if (!failure)
+    {
+        m_window_min_latency = (m_window_min_latency < 0) ? observed : std::min(m_window_min_latency, observed);
+        if (m_min_latency < 0 || observed < m_min_latency)
+        {
+            m_min_latency = observed;
+        }
+        if (++m_window_samples >= m_policy.m_min_latency_window)
+        {
+            // Let the minimum follow an upstream whose baseline latency has changed.
+            m_min_latency        = m_window_min_latency;
+            m_window_min_latency = -1;
+            m_window_samples     = 0;
+        }
+    }
+
+    const auto min_limit = static_cast<double>(m_policy.m_min_limit);
+    const auto max_limit = static_cast<double>(m_policy.m_max_limit);
+    const auto target    = m_min_latency * m_policy.m_latency_tolerance;
+
+    if (failure || (m_policy.m_algorithm == concurrency_limit_algorithm::aimd && observed > target))
+    {
+        m_limit = std::max(min_limit, m_limit * m_policy.m_backoff_ratio);
+        return;
+    }
+
+    // If less than half the limit is in use the samples say nothing about whether it is too low.
+    const bool utilized = static_cast<double>(m_in_flight) * 2.0 >= m_limit;
+
+    switch (m_policy.m_algorithm)
+    {
+        case concurrency_limit_algorithm::aimd:
+            if (utilized)
+            {
+                m_limit = std::min(max_limit, m_limit + 1.0);
+            }
+            break;
+        case concurrency_limit_algorithm::gradient:
+        {
+            auto gradient  = std::clamp(target / observed, 0.5, 1.0);
+            auto new_limit = m_limit * gradient + std::sqrt(m_limit);
+            new_limit      = m_limit * (1.0 - m_policy.m_smoothing) + new_limit * m_policy.m_smoothing;
+            if (new_limit < m_limit || utilized)
+            {
+                m_limit = std::clamp(new_limit, min_limit, max_limit);
+            }
+        }
+        break;
+    }
+}
+
+auto concurrency_limiter::min_latency() const noexcept -> std::optional<std::chrono::milliseconds>
+{
+    if (m_min_latency < 0)
+    {
+        return std::nullopt;
+    }
+    return std::chrono::milliseconds{static_cast<int64_t>(m_min_latency)};
+}
+
+} // namespace lift
@@ -0,0 +1,61 @@
+#include "lift/decode_pool.hpp"
+
+#include <algorithm>
+
+namespace lift
+{
+decode_pool::decode_pool(decode_pool_options options) : m_options(options)
+{
+    m_options.m_threads = std::max<std::size_t>(m_options.m_threads, 1);
+    m_workers.reserve(m_options.m_threads);
+    for (std::size_t i = 0; i < m_options.m_threads; ++i)
+    {
+        m_workers.emplace_back([this]() { run(); });
+    }
+}
+
+decode_pool::~decode_pool()
+{
+    {
+        std::lock_guard<std::mutex> guard{m_lock};
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+auto decode_pool::submit(job_type job) -> void
+{
+    {
+        std::lock_guard<std::mutex> guard{m_lock};
+        m_jobs.emplace_back(std::move(job));
+    }
+    m_jobs_submitted.fetch_add(1, std::memory_order_release);
+    m_wake.notify_one();
+}
+
+auto decode_pool::run() -> void
+{
+    while (true)
+    {
+        job_type job{nullptr};
+        {
+            std::unique_lock<std::mutex> lock{m_lock};
+            m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+            {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+} // namespace lift
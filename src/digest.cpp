@@ -0,0 +1,622 @@
+#include "lift/digest.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    #include <arm_acle.h>
+#endif
+
+namespace lift
+{
+namespace
+{
+auto iequals(std::string_view a, std::string_view b) -> bool
+{
+    return a.size() == b.size() &&
+           std::equal(
+               a.begin(),
+               a.end(),
+               b.begin(),
+               [](char x, char y)
+               { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+}
+
+auto trim(std::string_view s) -> std::string_view
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+    {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+    {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+auto rotl32(uint32_t x, int r) -> uint32_t
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+auto rotr32(uint32_t x, int r) -> uint32_t
+{
+    return (x >> r) | (x << (32 - r));
+}
+
+auto rotl64(uint64_t x, int r) -> uint64_t
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+auto load_le32(const uint8_t* p) -> uint32_t
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+auto load_be32(const uint8_t* p) -> uint32_t
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+auto load_le64(const uint8_t* p) -> uint64_t
+{
+    return static_cast<uint64_t>(load_le32(p)) | (static_cast<uint64_t>(load_le32(p + 4)) << 32);
+}
+
+auto append_be(std::vector<uint8_t>& out, uint64_t value, std::size_t bytes) -> void
+{
+    for (std::size_t i = bytes; i > 0; --i)
+    {
+        out.push_back(static_cast<uint8_t>(value >> ((i - 1) * 8)));
+    }
+}
+
+// CRC-32C, the reflected Castagnoli polynomial.
+constexpr uint32_t crc32c_polynomial = 0x82F63B78;
+
+constexpr auto make_crc32c_table() -> std::array<uint32_t, 256>
+{
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ crc32c_polynomial : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr auto crc32c_table = make_crc32c_table();
+
+auto crc32c_software(uint32_t crc, const uint8_t* data, std::size_t size) -> uint32_t
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        crc = crc32c_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) auto crc32c_hardware(uint32_t crc, const uint8_t* data, std::size_t size) -> uint32_t
+{
+    uint64_t crc64 = crc;
+    for (; size >= 8; data += 8, size -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+    for (; size > 0; ++data, --size)
+    {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+const bool crc32c_hardware_supported = __builtin_cpu_supports("sse4.2");
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+auto crc32c_hardware(uint32_t crc, const uint8_t* data, std::size_t size) -> uint32_t
+{
+    for (; size >= 8; data += 8, size -= 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; size > 0; ++data, --size)
+    {
+        crc = __crc32cb(crc, *data);
+    }
+    return crc;
+}
+
+const bool crc32c_hardware_supported = true;
+#endif
+
+auto crc32c_update(uint32_t crc, const uint8_t* data, std::size_t size) -> uint32_t
+{
+#if defined(__x86_64__) || (defined(__aarch64__) && defined(__ARM_FEATURE_CRC32))
+    if (crc32c_hardware_supported)
+    {
+        return crc32c_hardware(crc, data, size);
+    }
+#endif
+    return crc32c_software(crc, data, size);
+}
+
+// xxHash64
+constexpr uint64_t xxh_prime1 = 11400714785074694791ULL;
+constexpr uint64_t xxh_prime2 = 14029467366897019727ULL;
+constexpr uint64_t xxh_prime3 = 1609587929392839161ULL;
+constexpr uint64_t xxh_prime4 = 9650029242287828579ULL;
+constexpr uint64_t xxh_prime5 = 2870177450012600261ULL;
+
+auto xxh_round(uint64_t accumulator, uint64_t input) -> uint64_t
+{
+    accumulator += input * xxh_prime2;
+    return rotl64(accumulator, 31) * xxh_prime1;
+}
+
+auto xxh_merge(uint64_t hash, uint64_t accumulator) -> uint64_t
+{
+    hash ^= xxh_round(0, accumulator);
+    return hash * xxh_prime1 + xxh_prime4;
+}
+
+auto xxh_stripe(std::array<uint64_t, 4>& accumulators, const uint8_t* stripe) -> void
+{
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        accumulators[i] = xxh_round(accumulators[i], load_le64(stripe + i * 8));
+    }
+}
+
+// SHA-256
+constexpr std::array<uint32_t, 64> sha256_k{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+auto sha256_compress(std::array<uint32_t, 8>& h, const uint8_t* block) -> void
+{
+    std::array<uint32_t, 64> w;
+    for (std::size_t i = 0; i < 16; ++i)
+    {
+        w[i] = load_be32(block + i * 4);
+    }
+    for (std::size_t i = 16; i < 64; ++i)
+    {
+        auto s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        auto s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i]    = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, hh] = h;
+    for (std::size_t i = 0; i < 64; ++i)
+    {
+        auto s1    = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+        auto ch    = (e & f) ^ (~e & g);
+        auto temp1 = hh + s1 + ch + sha256_k[i] + w[i];
+        auto s0    = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+        auto maj   = (a & b) ^ (a & c) ^ (b & c);
+        auto temp2 = s0 + maj;
+
+        hh = g;
+        g  = f;
+        f  = e;
+        e  = d + temp1;
+        d  = c;
+        c  = b;
+        b  = a;
+        a  = temp1 + temp2;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += hh;
+}
+
+// MD5
+constexpr std::array<uint32_t, 64> md5_k{
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+constexpr std::array<int, 16> md5_shifts{7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+auto md5_compress(std::array<uint32_t, 4>& h, const uint8_t* block) -> void
+{
+    std::array<uint32_t, 16> m;
+    for (std::size_t i = 0; i < 16; ++i)
+    {
+        m[i] = load_le32(block + i * 4);
+    }
+
+    auto [a, b, c, d] = h;
+    for (std::size_t i = 0; i < 64; ++i)
+    {
+        uint32_t    f;
+        std::size_t g;
+        switch (i / 16)
+        {
+            case 0:
+                f = (b & c) | (~b & d);
+                g = i;
+                break;
+            case 1:
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+                break;
+            case 2:
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+                break;
+            default:
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+                break;
+        }
+
+        f = f + a + md5_k[i] + m[g];
+        a = d;
+        d = c;
+        c = b;
+        b = b + rotl32(f, md5_shifts[(i / 16) * 4 + (i % 4)]);
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+}
+
+/**
+ * Buffers partial blocks and compresses every complete 64 byte block.
+ */
+template<typename state_type, typename compress_type>
+auto update_blocks(state_type& state, const uint8_t* data, std::size_t size, compress_type compress) -> void
+{
+    state.m_total += size;
+
+    if (state.m_buffered > 0)
+    {
+        auto take = std::min(size, state.m_block.size() - state.m_buffered);
+        std::memcpy(state.m_block.data() + state.m_buffered, data, take);
+        state.m_buffered += take;
+        data += take;
+        size -= take;
+        if (state.m_buffered < state.m_block.size())
+        {
+            return;
+        }
+        compress(state.m_words, state.m_block.data());
+        state.m_buffered = 0;
+    }
+
+    for (; size >= state.m_block.size(); data += state.m_block.size(), size -= state.m_block.size())
+    {
+        compress(state.m_words, data);
+    }
+
+    std::memcpy(state.m_block.data(), data, size);
+    state.m_buffered = size;
+}
+
+/**
+ * Pads the final block with 0x80, zeros and the message length in bits.
+ */
+template<typename state_type, typename compress_type>
+auto finish_blocks(state_type& state, compress_type compress, bool big_endian_length) -> void
+{
+    auto bits = state.m_total * 8;
+
+    state.m_block[state.m_buffered++] = 0x80;
+    if (state.m_buffered > 56)
+    {
+        std::fill(state.m_block.begin() + state.m_buffered, state.m_block.end(), 0);
+        compress(state.m_words, state.m_block.data());
+        state.m_buffered = 0;
+    }
+    std::fill(state.m_block.begin() + state.m_buffered, state.m_block.begin() + 56, 0);
+
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+        auto shift              = big_endian_length ? (7 - i) * 8 : i * 8;
+        state.m_block[56 + i] = static_cast<uint8_t>(bits >> shift);
+    }
+    compress(state.m_words, state.m_block.data());
+}
+
+auto base64_value(char c) -> int
+{
+    if (c >= 'A' && c <= 'Z')
+    {
+        return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z')
+    {
+        return c - 'a' + 26;
+    }
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0' + 52;
+    }
+    // Both the standard and the URL safe alphabets.
+    if (c == '+' || c == '-')
+    {
+        return 62;
+    }
+    if (c == '/' || c == '_')
+    {
+        return 63;
+    }
+    return -1;
+}
+
+} // namespace
+
+auto to_string(digest_algorithm algorithm) -> std::string_view
+{
+    switch (algorithm)
+    {
+        case digest_algorithm::crc32c:
+            return "crc32c";
+        case digest_algorithm::xxhash64:
+            return "xxh64";
+        case digest_algorithm::sha256:
+            return "sha-256";
+        case digest_algorithm::md5:
+            return "md5";
+    }
+    return "unknown";
+}
+
+hasher::hasher(digest_algorithm algorithm) : m_state(impl::crc32c_state{})
+{
+    switch (algorithm)
+    {
+        case digest_algorithm::crc32c:
+            break;
+        case digest_algorithm::xxhash64:
+        {
+            auto& state          = m_state.emplace<impl::xxhash64_state>();
+            state.m_accumulators = {xxh_prime1 + xxh_prime2, xxh_prime2, 0, 0 - xxh_prime1};
+        }
+        break;
+        case digest_algorithm::sha256:
+        {
+            auto& state   = m_state.emplace<impl::sha256_state>();
+            state.m_words = {
+                0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+        }
+        break;
+        case digest_algorithm::md5:
+        {
+            auto& state   = m_state.emplace<impl::md5_state>();
+            state.m_words = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+        }
+        break;
+    }
+}
+
+auto hasher::update(std::string_view data) -> void
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    auto        size  = data.size();
+
+    if (auto* crc = std::get_if<impl::crc32c_state>(&m_state); crc != nullptr)
+    {
+        crc->m_crc = crc32c_update(crc->m_crc, bytes, size);
+    }
+    else if (auto* xxh = std::get_if<impl::xxhash64_state>(&m_state); xxh != nullptr)
+    {
+        xxh->m_total += size;
+        if (xxh->m_buffered > 0)
+        {
+            auto take = std::min(size, xxh->m_stripe.size() - xxh->m_buffered);
+            std::memcpy(xxh->m_stripe.data() + xxh->m_buffered, bytes, take);
+            xxh->m_buffered += take;
+            bytes += take;
+            size -= take;
+            if (xxh->m_buffered < xxh->m_stripe.size())
+            {
+                return;
+            }
+            xxh_stripe(xxh->m_accumulators, xxh->m_stripe.data());
+            xxh->m_buffered = 0;
+        }
+        for (; size >= xxh->m_stripe.size(); bytes += xxh->m_stripe.size(), size -= xxh->m_stripe.size())
+        {
+            xxh_stripe(xxh->m_accumulators, bytes);
+        }
+        std::memcpy(xxh->m_stripe.data(), bytes, size);
+        xxh->m_buffered = size;
+    }
+    else if (auto* sha = std::get_if<impl::sha256_state>(&m_state); sha != nullptr)
+    {
+        update_blocks(*sha, bytes, size, sha256_compress);
+    }
+    else if (auto* md5 = std::get_if<impl::md5_state>(&m_state); md5 != nullptr)
+    {
+        update_blocks(*md5, bytes, size, md5_compress);
+    }
+}
+
+auto hasher::finish() -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> digest{};
+
+    if (auto* crc = std::get_if<impl::crc32c_state>(&m_state); crc != nullptr)
+    {
+        append_be(digest, crc->m_crc ^ 0xFFFFFFFF, 4);
+    }
+    else if (auto* xxh = std::get_if<impl::xxhash64_state>(&m_state); xxh != nullptr)
+    {
+        const auto& acc = xxh->m_accumulators;
+        uint64_t    hash{0};
+        if (xxh->m_total >= xxh->m_stripe.size())
+        {
+            hash = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+            for (auto a : acc)
+            {
+                hash = xxh_merge(hash, a);
+            }
+        }
+        else
+        {
+            hash = xxh_prime5;
+        }
+        hash += xxh->m_total;
+
+        const auto* p   = xxh->m_stripe.data();
+        auto        rem = xxh->m_buffered;
+        for (; rem >= 8; p += 8, rem -= 8)
+        {
+            hash ^= xxh_round(0, load_le64(p));
+            hash = rotl64(hash, 27) * xxh_prime1 + xxh_prime4;
+        }
+        if (rem >= 4)
+        {
+            hash ^= static_cast<uint64_t>(load_le32(p)) * xxh_prime1;
+            hash = rotl64(hash, 23) * xxh_prime2 + xxh_prime3;
+            p += 4;
+            rem -= 4;
+        }
+        for (; rem > 0; ++p, --rem)
+        {
+            hash ^= *p * xxh_prime5;
+            hash = rotl64(hash, 11) * xxh_prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= xxh_prime2;
+        hash ^= hash >> 29;
+        hash *= xxh_prime3;
+        hash ^= hash >> 32;
+        append_be(digest, hash, 8);
+    }
+    else if (auto* sha = std::get_if<impl::sha256_state>(&m_state); sha != nullptr)
+    {
+        finish_blocks(*sha, sha256_compress, true);
+        for (auto word : sha->m_words)
+        {
+            append_be(digest, word, 4);
+        }
+    }
+    else if (auto* md5 = std::get_if<impl::md5_state>(&m_state); md5 != nullptr)
+    {
+        finish_blocks(*md5, md5_compress, false);
+        for (auto word : md5->m_words)
+        {
+            for (std::size_t i = 0; i < 4; ++i)
+            {
+                digest.push_back(static_cast<uint8_t>(word >> (i * 8)));
+            }
+        }
+    }
+
+    return digest;
+}
+
+auto to_hex(const std::vector<uint8_t>& digest) -> std::string
+{
+    static constexpr char digits[] = "0123456789abcdef";
+
+    std::string hex{};
+    hex.reserve(digest.size() * 2);
+    for (auto byte : digest)
+    {
+        hex.push_back(digits[byte >> 4]);
+        hex.push_back(digits[byte & 0x0F]);
+    }
+    return hex;
+}
+
+auto from_base64(std::string_view encoded) -> std::optional<std::vector<uint8_t>>
+{
+    encoded = trim(encoded);
+    while (!encoded.empty() && encoded.back() == '=')
+    {
+        encoded.remove_suffix(1);
+    }
+    if (encoded.size() % 4 == 1)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<uint8_t> decoded{};
+    decoded.reserve(encoded.size() * 3 / 4);
+
+    uint32_t bits{0};
+    int      bit_count{0};
+    for (auto c : encoded)
+    {
+        auto value = base64_value(c);
+        if (value < 0)
+        {
+            return std::nullopt;
+        }
+        bits = (bits << 6) | static_cast<uint32_t>(value);
+        bit_count += 6;
+        if (bit_count >= 8)
+        {
+            bit_count -= 8;
+            decoded.push_back(static_cast<uint8_t>(bits >> bit_count));
+        }
+    }
+    return decoded;
+}
+
+auto parse_digest_header(std::string_view value, digest_algorithm algorithm) -> std::optional<std::vector<uint8_t>>
+{
+    while (!value.empty())
+    {
+        auto comma = value.find(',');
+        auto entry = trim(value.substr(0, comma));
+        value      = (comma == std::string_view::npos) ? std::string_view{} : value.substr(comma + 1);
+
+        auto equals = entry.find('=');
+        if (equals == std::string_view::npos || !iequals(trim(entry.substr(0, equals)), to_string(algorithm)))
+        {
+            continue;
+        }
+
+        // Repr-Digest wraps the base64 in colons as a structured field byte sequence, Digest doesn't.
+        auto encoded = trim(entry.substr(equals + 1));
+        if (encoded.size() >= 2 && encoded.front() == ':' && encoded.back() == ':')
+        {
+            encoded = encoded.substr(1, encoded.size() - 2);
+        }
+        return from_base64(encoded);
+    }
+    return std::nullopt;
+}
+
+} // namespace lift
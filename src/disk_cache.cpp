@@ -0,0 +1,679 @@
+#include "lift/disk_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace lift
+{
+namespace
+{
+/// Every cache file starts with this magic followed by 8 reserved bytes.  Its version is bumped whenever
+/// the record layout changes, a file of another layout is rejected rather than misread.
+constexpr std::string_view file_magic{"LIFTDC02"};
+constexpr uint64_t         file_header_size = 16;
+
+/// Every record starts with this magic, "LFCR".
+constexpr uint32_t record_magic = 0x5243464c;
+/// The record erases its key rather than storing an entry.
+constexpr uint32_t record_tombstone = 1;
+
+/**
+ * The fixed size header of every record, followed by the key, the encoded entry and the body.
+ * The cache file is only shared between processes on one host so the native layout is used.
+ */
+struct record_header
+{
+    uint32_t m_magic{record_magic};
+    uint32_t m_flags{0};
+    uint32_t m_key_size{0};
+    uint32_t m_meta_size{0};
+    uint64_t m_body_size{0};
+    /// FNV-1a over the key, encoded entry and body, a mismatch means the record was torn by a crash.
+    uint64_t m_checksum{0};
+};
+
+auto fnv1a(uint64_t hash, std::string_view data) -> uint64_t
+{
+    for (auto c : data)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+auto checksum(std::string_view key, std::string_view meta, std::string_view body) -> uint64_t
+{
+    return fnv1a(fnv1a(fnv1a(0xcbf29ce484222325ULL, key), meta), body);
+}
+
+auto write_all(int fd, std::string_view data, uint64_t offset) -> bool
+{
+    while (!data.empty())
+    {
+        auto n = ::pwrite(fd, data.data(), data.size(), static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(n));
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+class meta_writer
+{
+public:
+    template<typename value_type>
+    auto put(value_type value) -> void
+    {
+        m_out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    auto put_string(std::string_view value) -> void
+    {
+        put(static_cast<uint32_t>(value.size()));
+        m_out.append(value);
+    }
+
+    auto put_optional(const std::optional<std::string>& value) -> void
+    {
+        put(static_cast<uint8_t>(value.has_value()));
+        if (value.has_value())
+        {
+            put_string(value.value());
+        }
+    }
+
+    auto str() -> std::string& { return m_out; }
+
+private:
+    std::string m_out{};
+};
+
+class meta_reader
+{
+public:
+    explicit meta_reader(std::string_view in) : m_in(in) {}
+
+    template<typename value_type>
+    auto get() -> value_type
+    {
+        value_type value{};
+        if (m_in.size() < sizeof(value))
+        {
+            m_ok = false;
+            return value;
+        }
+        std::memcpy(&value, m_in.data(), sizeof(value));
+        m_in.remove_prefix(sizeof(value));
+        return value;
+    }
+
+    auto get_string() -> std::string_view
+    {
+        auto size = get<uint32_t>();
+        if (!m_ok || m_in.size() < size)
+        {
+            m_ok = false;
+            return {};
+        }
+        auto value = m_in.substr(0, size);
+        m_in.remove_prefix(size);
+        return value;
+    }
+
+    auto get_optional() -> std::optional<std::string>
+    {
+        if (get<uint8_t>() == 0)
+        {
+            return std::nullopt;
+        }
+        return std::string{get_string()};
+    }
+
+    auto ok() const -> bool { return m_ok; }
+
+private:
+    std::string_view m_in;
+    bool             m_ok{true};
+};
+
+} // namespace
+
+disk_cache::disk_cache(disk_cache_options options) : m_options(std::move(options))
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+
+    if (m_options.m_mode == disk_cache_mode::read_write)
+    {
+        auto lock_path = m_options.m_path;
+        lock_path += ".lock";
+        m_lock_fd = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_lock_fd < 0 || ::flock(m_lock_fd, LOCK_EX | LOCK_NB) != 0)
+        {
+            if (m_lock_fd >= 0)
+            {
+                ::close(m_lock_fd);
+            }
+            throw std::runtime_error{
+                "lift::disk_cache Failed to lock " + lock_path.string() + ", is another process writing to it?"};
+        }
+    }
+
+    try
+    {
+        open_locked();
+    }
+    catch (...)
+    {
+        close_locked();
+        if (m_lock_fd >= 0)
+        {
+            ::close(m_lock_fd);
+        }
+        throw;
+    }
+}
+
+disk_cache::~disk_cache()
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    close_locked();
+    if (m_lock_fd >= 0)
+    {
+        ::close(m_lock_fd);
+    }
+}
+
+auto disk_cache::find(std::string_view key) -> cache_entry_ptr
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    if (m_options.m_mode == disk_cache_mode::shared_read)
+    {
+        refresh_locked();
+    }
+
+    auto iter = m_index.find(key);
+    if (iter == m_index.end())
+    {
+        return nullptr;
+    }
+
+    auto& location = iter->second;
+    if (location.m_entry != nullptr)
+    {
+        return location.m_entry;
+    }
+
+    remap_locked(m_file_bytes);
+    const char*   record = m_mapping.get() + location.m_offset;
+    record_header header{};
+    std::memcpy(&header, record, sizeof(header));
+    std::string_view meta{record + sizeof(header) + header.m_key_size, header.m_meta_size};
+    std::string_view body{meta.data() + meta.size(), static_cast<std::size_t>(header.m_body_size)};
+
+    auto entry = std::make_shared<cache_entry>();
+    if (!decode(meta, *entry))
+    {
+        return nullptr;
+    }
+
+    // The body is served straight out of the mapping, which stays mapped while any response views it.
+    entry->m_response.m_shared_owner = m_mapping;
+    entry->m_response.m_shared_view  = body;
+
+    location.m_entry = entry;
+    return entry;
+}
+
+auto disk_cache::store(std::string_view key, cache_entry_ptr entry) -> void
+{
+    if (m_options.m_mode != disk_cache_mode::read_write)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard{m_lock};
+    auto                        record_size = sizeof(record_header) + key.size() + entry->size();
+    if (m_file_bytes + record_size > m_options.m_max_bytes)
+    {
+        compact_locked(m_options.m_max_bytes / 2);
+    }
+
+    if (m_file_bytes + record_size > m_options.m_max_bytes)
+    {
+        // Too large to ever fit, drop any older version rather than serving it.
+        append_locked(key, nullptr);
+        return;
+    }
+
+    append_locked(key, entry.get());
+}
+
+auto disk_cache::erase(std::string_view key) -> void
+{
+    if (m_options.m_mode != disk_cache_mode::read_write)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard{m_lock};
+    append_locked(key, nullptr);
+}
+
+auto disk_cache::compact() -> void
+{
+    if (m_options.m_mode != disk_cache_mode::read_write)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard{m_lock};
+    compact_locked(m_options.m_max_bytes);
+}
+
+auto disk_cache::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    return m_index.size();
+}
+
+auto disk_cache::file_bytes() const -> uint64_t
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    return m_file_bytes;
+}
+
+auto disk_cache::live_bytes() const -> uint64_t
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    return m_live_bytes;
+}
+
+auto disk_cache::open_locked() -> void
+{
+    const bool writer = m_options.m_mode == disk_cache_mode::read_write;
+
+    m_fd = ::open(m_options.m_path.c_str(), writer ? (O_RDWR | O_CREAT | O_CLOEXEC) : (O_RDONLY | O_CLOEXEC), 0644);
+    if (m_fd < 0)
+    {
+        if (!writer && errno == ENOENT)
+        {
+            // The writer hasn't created the cache file yet.
+            return;
+        }
+        throw std::runtime_error{"lift::disk_cache Failed to open " + m_options.m_path.string()};
+    }
+
+    struct stat st{};
+    ::fstat(m_fd, &st);
+    auto size = static_cast<uint64_t>(st.st_size);
+    m_inode   = static_cast<uint64_t>(st.st_ino);
+
+    if (!writer && size < file_header_size)
+    {
+        // The writer is creating the cache file right now.
+        close_locked();
+        return;
+    }
+
+    if (size == 0)
+    {
+        std::string header{file_magic};
+        header.resize(file_header_size, '\0');
+        if (!write_all(m_fd, header, 0))
+        {
+            throw std::runtime_error{"lift::disk_cache Failed to write " + m_options.m_path.string()};
+        }
+        size = file_header_size;
+    }
+
+    std::string magic(file_magic.size(), '\0');
+    auto        read = ::pread(m_fd, magic.data(), magic.size(), 0);
+    if (size < file_header_size || read != static_cast<ssize_t>(magic.size()) || magic != file_magic)
+    {
+        throw std::runtime_error{"lift::disk_cache " + m_options.m_path.string() + " is not a lift disk cache file."};
+    }
+
+    m_file_bytes = file_header_size;
+    auto valid   = scan_locked();
+
+    // Discard a record torn by a crash so new records are appended right after the last valid one.
+    if (writer && valid < size)
+    {
+        if (::ftruncate(m_fd, static_cast<off_t>(valid)) != 0)
+        {
+            throw std::runtime_error{"lift::disk_cache Failed to truncate " + m_options.m_path.string()};
+        }
+    }
+}
+
+auto disk_cache::close_locked() -> void
+{
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_inode         = 0;
+    m_file_bytes    = 0;
+    m_live_bytes    = 0;
+    m_mapping       = nullptr;
+    m_mapping_bytes = 0;
+    m_index.clear();
+}
+
+auto disk_cache::refresh_locked() -> void
+{
+    struct stat st{};
+    if (::stat(m_options.m_path.c_str(), &st) != 0)
+    {
+        close_locked();
+        return;
+    }
+
+    if (m_fd < 0 || static_cast<uint64_t>(st.st_ino) != m_inode)
+    {
+        // The writer compacted the cache file, or created it, start over with the new file.
+        close_locked();
+        try
+        {
+            open_locked();
+        }
+        catch (const std::exception&)
+        {
+            close_locked();
+        }
+        return;
+    }
+
+    if (static_cast<uint64_t>(st.st_size) > m_file_bytes)
+    {
+        scan_locked();
+    }
+}
+
+auto disk_cache::scan_locked() -> uint64_t
+{
+    struct stat st{};
+    ::fstat(m_fd, &st);
+    auto end = static_cast<uint64_t>(st.st_size);
+    if (end <= m_file_bytes)
+    {
+        return m_file_bytes;
+    }
+
+    // Map everything that is in the file now, a record still being appended is picked up next time.
+    remap_locked(end);
+
+    auto offset = m_file_bytes;
+    while (offset + sizeof(record_header) <= end)
+    {
+        const char*   record = m_mapping.get() + offset;
+        record_header header{};
+        std::memcpy(&header, record, sizeof(header));
+        if (header.m_magic != record_magic)
+        {
+            break;
+        }
+
+        auto size = sizeof(record_header) + uint64_t{header.m_key_size} + header.m_meta_size + header.m_body_size;
+        if (offset + size > end)
+        {
+            break;
+        }
+
+        std::string_view key{record + sizeof(header), header.m_key_size};
+        std::string_view meta{key.data() + key.size(), header.m_meta_size};
+        std::string_view body{meta.data() + meta.size(), static_cast<std::size_t>(header.m_body_size)};
+        if (checksum(key, meta, body) != header.m_checksum)
+        {
+            break;
+        }
+
+        auto iter = m_index.find(key);
+        if (iter != m_index.end())
+        {
+            m_live_bytes -= iter->second.m_size;
+            m_index.erase(iter);
+        }
+        if ((header.m_flags & record_tombstone) == 0)
+        {
+            m_index.emplace(std::string{key}, record_location{offset, size, nullptr});
+            m_live_bytes += size;
+        }
+
+        offset += size;
+    }
+
+    m_file_bytes = offset;
+    return offset;
+}
+
+auto disk_cache::remap_locked(uint64_t bytes) -> void
+{
+    if (m_mapping_bytes >= bytes || m_fd < 0)
+    {
+        return;
+    }
+
+    auto  size = bytes;
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        throw std::runtime_error{"lift::disk_cache Failed to map " + m_options.m_path.string()};
+    }
+
+    // Responses holding views into the previous mapping keep it alive until they are released.
+    auto unmap      = [size](const char* p) { ::munmap(const_cast<char*>(p), size); };
+    m_mapping       = std::shared_ptr<const char>{static_cast<const char*>(addr), unmap};
+    m_mapping_bytes = size;
+}
+
+auto disk_cache::append_locked(std::string_view key, const cache_entry* entry) -> void
+{
+    auto iter = m_index.find(key);
+    if (entry == nullptr && iter == m_index.end())
+    {
+        return;
+    }
+
+    std::string      meta = (entry != nullptr) ? encode(*entry) : std::string{};
+    std::string_view body = (entry != nullptr) ? entry->m_response.data() : std::string_view{};
+
+    record_header header{};
+    header.m_flags     = (entry != nullptr) ? 0 : record_tombstone;
+    header.m_key_size  = static_cast<uint32_t>(key.size());
+    header.m_meta_size = static_cast<uint32_t>(meta.size());
+    header.m_body_size = body.size();
+    header.m_checksum  = checksum(key, meta, body);
+
+    std::string record{};
+    record.reserve(sizeof(header) + key.size() + meta.size() + body.size());
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    record.append(key);
+    record.append(meta);
+    record.append(body);
+
+    if (!write_all(m_fd, record, m_file_bytes))
+    {
+        // Caching is best effort, drop anything partially written so the file stays valid.
+        (void)::ftruncate(m_fd, static_cast<off_t>(m_file_bytes));
+        return;
+    }
+
+    if (iter != m_index.end())
+    {
+        m_live_bytes -= iter->second.m_size;
+        m_index.erase(iter);
+    }
+    if (entry != nullptr)
+    {
+        m_index.emplace(std::string{key}, record_location{m_file_bytes, record.size(), nullptr});
+        m_live_bytes += record.size();
+    }
+    m_file_bytes += record.size();
+}
+
+auto disk_cache::compact_locked(uint64_t keep_bytes) -> void
+{
+    remap_locked(m_file_bytes);
+
+    // Keep the most recently stored records that fit.
+    std::vector<std::pair<const std::string*, record_location*>> records{};
+    records.reserve(m_index.size());
+    for (auto& [key, location] : m_index)
+    {
+        records.emplace_back(&key, &location);
+    }
+    std::sort(
+        records.begin(),
+        records.end(),
+        [](const auto& a, const auto& b) { return a.second->m_offset > b.second->m_offset; });
+
+    uint64_t kept_bytes = 0;
+    auto     kept_end   = records.begin();
+    while (kept_end != records.end() && kept_bytes + kept_end->second->m_size <= keep_bytes)
+    {
+        kept_bytes += kept_end->second->m_size;
+        ++kept_end;
+    }
+    records.erase(kept_end, records.end());
+    std::reverse(records.begin(), records.end());
+
+    auto compact_path = m_options.m_path;
+    compact_path += ".compact";
+    int fd = ::open(compact_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    std::string header{file_magic};
+    header.resize(file_header_size, '\0');
+    bool     ok     = write_all(fd, header, 0);
+    uint64_t offset = file_header_size;
+    std::map<std::string, record_location, std::less<>> index{};
+    for (const auto& [key, location] : records)
+    {
+        if (!ok)
+        {
+            break;
+        }
+        ok = write_all(fd, std::string_view{m_mapping.get() + location->m_offset, location->m_size}, offset);
+        index.emplace(*key, record_location{offset, location->m_size, nullptr});
+        offset += location->m_size;
+    }
+
+    // The new file must be durable before it replaces the old one, otherwise a crash could lose both.
+    if (!ok || ::fsync(fd) != 0 || ::rename(compact_path.c_str(), m_options.m_path.c_str()) != 0)
+    {
+        ::close(fd);
+        ::unlink(compact_path.c_str());
+        return;
+    }
+
+    auto dir    = m_options.m_path.parent_path();
+    int  dir_fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0)
+    {
+        (void)::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+
+    close_locked();
+
+    struct stat st{};
+    ::fstat(fd, &st);
+    m_fd         = fd;
+    m_inode      = static_cast<uint64_t>(st.st_ino);
+    m_file_bytes = offset;
+    m_live_bytes = kept_bytes;
+    m_index      = std::move(index);
+}
+
+auto disk_cache::encode(const cache_entry& entry) -> std::string
+{
+    const auto& response = entry.m_response;
+
+    meta_writer out{};
+    out.put(static_cast<uint16_t>(response.m_status_code));
+    out.put(static_cast<uint8_t>(response.m_version));
+    auto headers = response.headers();
+    out.put(static_cast<uint32_t>(headers.size()));
+    for (const auto& h : headers)
+    {
+        // The header block holds each field as its "<name>: <value>" line, it is re-indexed when decoded.
+        auto length = static_cast<std::size_t>((h.value().data() + h.value().size()) - h.name().data());
+        out.put_string(std::string_view{h.name().data(), length});
+    }
+    out.put(static_cast<uint32_t>(entry.m_vary.size()));
+    for (const auto& [name, value] : entry.m_vary)
+    {
+        out.put_string(name);
+        out.put_string(value);
+    }
+    out.put(static_cast<int64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(entry.m_response_time.time_since_epoch()).count()));
+    out.put(static_cast<int64_t>(entry.m_initial_age.count()));
+    out.put(static_cast<int64_t>(entry.m_freshness_lifetime.count()));
+    out.put(static_cast<int64_t>(entry.m_stale_while_revalidate.count()));
+    out.put(static_cast<uint8_t>(entry.m_no_cache));
+    out.put(static_cast<uint8_t>(entry.m_must_revalidate));
+    out.put_optional(entry.m_etag);
+    out.put_optional(entry.m_last_modified);
+    out.put(static_cast<uint8_t>(response.m_content_encoded));
+    return std::move(out.str());
+}
+
+auto disk_cache::decode(std::string_view meta, cache_entry& entry) -> bool
+{
+    auto& response = entry.m_response;
+
+    meta_reader in{meta};
+    response.m_lift_status = lift_status::success;
+    response.m_status_code = static_cast<http::status_code>(in.get<uint16_t>());
+    response.m_version     = static_cast<http::version>(in.get<uint8_t>());
+
+    auto header_count = in.get<uint32_t>();
+    for (uint32_t i = 0; i < header_count && in.ok(); ++i)
+    {
+        response.add_header(in.get_string());
+    }
+
+    auto vary_count = in.get<uint32_t>();
+    for (uint32_t i = 0; i < vary_count && in.ok(); ++i)
+    {
+        auto name  = in.get_string();
+        auto value = in.get_string();
+        entry.m_vary.emplace_back(std::string{name}, std::string{value});
+    }
+
+    entry.m_response_time          = cache_entry::time_point{std::chrono::milliseconds{in.get<int64_t>()}};
+    entry.m_initial_age            = std::chrono::seconds{in.get<int64_t>()};
+    entry.m_freshness_lifetime     = std::chrono::seconds{in.get<int64_t>()};
+    entry.m_stale_while_revalidate = std::chrono::seconds{in.get<int64_t>()};
+    entry.m_no_cache               = in.get<uint8_t>() != 0;
+    entry.m_must_revalidate        = in.get<uint8_t>() != 0;
+    entry.m_etag                   = in.get_optional();
+    entry.m_last_modified          = in.get_optional();
+    response.m_content_encoded     = in.get<uint8_t>() != 0;
+    return in.ok();
+}
+
+} // namespace lift
@@ -2,6 +2,10 @@
 #include "lift/client.hpp"
 #include "lift/init.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
 namespace lift
 {
 auto curl_write_header(char* buffer, size_t size, size_t nitems, void* user_ptr) -> size_t;
@@ -22,7 +26,7 @@ executor::executor(request* request) : m_request_sync(request), m_request(m_requ
 
 }
 
-executor::executor(client* c) : m_client(c)
+executor::executor(client* c) : m_client(c), m_response(c->m_buffer_pool)
 {
 }
 
@@ -46,6 +50,7 @@ auto executor::perform() -> response
 
     auto curl_error_code = curl_easy_perform(m_curl_handle);
     copy_curl_to_response(curl_error_code);
+    finish_body_sink();
 
     global_cleanup();
 
@@ -278,6 +283,11 @@ auto executor::prepare() -> void
             // strings are copied into libcurl except for POSTFIELDS.
             curl_easy_setopt(m_curl_handle, CURLOPT_ACCEPT_ENCODING, joined.c_str());
         }
+        else if (offloads_decoding())
+        {
+            // Only ask for the encodings the client's decode pool can decode.
+            curl_easy_setopt(m_curl_handle, CURLOPT_ACCEPT_ENCODING, "gzip, deflate");
+        }
         else
         {
             // From the CURL docs (https://curl.haxx.se/libcurl/c/CURLOPT_ACCEPT_ENCODING.html):
@@ -287,6 +297,10 @@ auto executor::prepare() -> void
             curl_easy_setopt(m_curl_handle, CURLOPT_ACCEPT_ENCODING, "");
         }
     }
+    if (!m_request->content_decoding() || offloads_decoding())
+    {
+        curl_easy_setopt(m_curl_handle, CURLOPT_HTTP_CONTENT_DECODING, 0L);
+    }
 
     // Headers
     if (m_curl_request_headers != nullptr)
@@ -391,8 +405,8 @@ auto executor::prepare() -> void
         curl_easy_setopt(m_curl_handle, CURLOPT_DEBUGDATA, this);
     }
 
-    m_response.m_network_error_message[0] = '\0';
-    curl_easy_setopt(m_curl_handle, CURLOPT_ERRORBUFFER, m_response.m_network_error_message);
+    m_curl_error_buffer[0] = '\0';
+    curl_easy_setopt(m_curl_handle, CURLOPT_ERRORBUFFER, m_curl_error_buffer);
     // https://curl.se/libcurl/c/CURLOPT_COOKIEFILE.html
     curl_easy_setopt(
         m_curl_handle, CURLOPT_COOKIEFILE, m_request->m_cookie_file ? m_request->m_cookie_file->string().c_str() : nullptr);
@@ -402,6 +416,10 @@ auto executor::copy_curl_to_response(CURLcode curl_code) -> void
 {
     m_response.m_curl_code   = curl_code;
     m_response.m_lift_status = convert(curl_code);
+    if (curl_code != CURLE_OK && m_curl_error_buffer[0] != '\0')
+    {
+        m_response.m_network_error_message.assign(m_curl_error_buffer);
+    }
 
     long http_response_code = 0;
     curl_easy_getinfo(m_curl_handle, CURLINFO_RESPONSE_CODE, &http_response_code);
@@ -414,7 +432,8 @@ auto executor::copy_curl_to_response(CURLcode curl_code) -> void
     double total_time = 0;
     curl_easy_getinfo(m_curl_handle, CURLINFO_TOTAL_TIME, &total_time);
     // std::duration defaults to seconds, so don't need to duration_cast total time to seconds.
-    m_response.m_total_time = static_cast<uint32_t>(
+    m_response.m_time_to_first_byte = first_byte_time();
+    m_response.m_total_time         = static_cast<uint32_t>(
         std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::duration<double>{total_time}).count());
 
     long connect_count = 0;
@@ -428,6 +447,26 @@ auto executor::copy_curl_to_response(CURLcode curl_code) -> void
     m_response.m_num_redirects = (redirect_count >= std::numeric_limits<uint8_t>::max())
                                      ? std::numeric_limits<uint8_t>::max()
                                      : static_cast<uint8_t>(redirect_count);
+
+    curl_off_t download_size = 0;
+    curl_easy_getinfo(m_curl_handle, CURLINFO_SIZE_DOWNLOAD_T, &download_size);
+    m_response.m_download_size = static_cast<uint64_t>(download_size);
+
+    // curl only decodes the body if it sent an Accept-Encoding and content decoding wasn't disabled.
+    m_response.m_content_encoded =
+        m_response.content_encoding().has_value() &&
+        (!m_request->content_decoding() || !m_request->accept_encodings().has_value() || offloads_decoding());
+
+    m_response.m_num_attempts = (m_attempt >= std::numeric_limits<uint8_t>::max())
+                                    ? std::numeric_limits<uint8_t>::max()
+                                    : static_cast<uint8_t>(m_attempt);
+
+    if (!verify_digest() && m_response.m_lift_status == lift_status::success)
+    {
+        m_response.m_lift_status = lift_status::integrity_mismatch;
+    }
+
+    finish_body();
 }
 
 auto executor::set_timesup_response(std::chrono::milliseconds total_time) -> void
@@ -436,10 +475,269 @@ auto executor::set_timesup_response(std::chrono::milliseconds total_time) -> voi
     m_response.m_total_time    = static_cast<uint32_t>(total_time.count());
     m_response.m_num_connects  = 0;
     m_response.m_num_redirects = 0;
+    m_response.m_num_attempts  = (m_attempt >= std::numeric_limits<uint8_t>::max())
+                                     ? std::numeric_limits<uint8_t>::max()
+                                     : static_cast<uint8_t>(m_attempt);
+}
+
+auto executor::finish_body_sink() -> void
+{
+    if (m_request->m_body_sink != nullptr && !m_body_sink_finished)
+    {
+        m_body_sink_finished = true;
+        m_request->m_body_sink->finish(*m_request, m_response);
+    }
+}
+
+auto executor::captures_header(std::string_view name) const -> bool
+{
+    const auto& capture = m_request->capture();
+    if (!capture.has_value())
+    {
+        return true;
+    }
+
+    switch (capture.value().m_headers)
+    {
+        case header_capture::all:
+            return true;
+        case header_capture::none:
+            return false;
+        case header_capture::allowlist:
+        {
+            auto equal = [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); };
+            for (const auto& allowed : capture.value().m_header_allowlist)
+            {
+                if (allowed.size() == name.size() && std::equal(name.begin(), name.end(), allowed.begin(), equal))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+auto executor::on_headers_complete() -> bool
+{
+    // Trailers after a chunked body end with an empty line as well.
+    if (m_headers_complete)
+    {
+        return true;
+    }
+
+    // Interim responses, e.g. 100 Continue, and redirects that are followed are not the final response.
+    long http_response_code = 0;
+    curl_easy_getinfo(m_curl_handle, CURLINFO_RESPONSE_CODE, &http_response_code);
+    if (http_response_code < 200)
+    {
+        return true;
+    }
+    if (m_request->follow_redirects() && m_hop_has_location && http_response_code >= 300 &&
+        http_response_code < 400 && http_response_code != 304)
+    {
+        return true;
+    }
+
+    m_headers_complete              = true;
+    m_response.m_time_to_first_byte = first_byte_time();
+
+    if (m_request->m_on_headers_handler != nullptr &&
+        m_request->m_on_headers_handler(*m_request, m_response) == header_action::abort)
+    {
+        m_headers_aborted = true;
+        return false;
+    }
+
+    // The headers handler may have switched the body to a sink.
+    if (const auto& sink = m_request->body_sink(); sink != nullptr && !m_body_sink_finished)
+    {
+        sink->start(*m_request, m_response);
+    }
+    return true;
+}
+
+auto executor::first_byte_time() const -> uint32_t
+{
+    curl_off_t first_byte_us = 0;
+    curl_easy_getinfo(m_curl_handle, CURLINFO_STARTTRANSFER_TIME_T, &first_byte_us);
+    return static_cast<uint32_t>(std::min<curl_off_t>(first_byte_us / 1000, std::numeric_limits<uint32_t>::max()));
+}
+
+auto executor::append_body(std::string_view chunk) -> bool
+{
+    if (m_client == nullptr || !m_client->m_spill_options.has_value())
+    {
+        m_response.append_data(chunk);
+        return true;
+    }
+
+    if (!m_spill.is_open())
+    {
+        const auto& options = m_client->m_spill_options.value();
+        if (!m_spill_early && m_body_memory_bytes + chunk.size() <= options.m_memory_threshold_bytes)
+        {
+            auto& memory = m_client->m_body_memory_bytes;
+            if (memory.fetch_add(chunk.size(), std::memory_order_acq_rel) + chunk.size() <= options.m_max_memory_bytes)
+            {
+                m_body_memory_bytes += chunk.size();
+                m_response.append_data(chunk);
+                return true;
+            }
+            memory.fetch_sub(chunk.size(), std::memory_order_acq_rel);
+        }
+
+        // The body is too large to hold in memory, move what has been received so far into the spill file.
+        if (!m_spill.open(options.m_directory))
+        {
+            return false;
+        }
+        for (auto segment : m_response.data_segments())
+        {
+            if (!m_spill.append(segment))
+            {
+                return false;
+            }
+        }
+        m_response.clear_data();
+        m_client->m_body_memory_bytes.fetch_sub(m_body_memory_bytes, std::memory_order_acq_rel);
+        m_body_memory_bytes = 0;
+        m_client->m_bodies_spilled.fetch_add(1, std::memory_order_release);
+    }
+
+    return m_spill.append(chunk);
+}
+
+auto executor::offloads_decoding() const -> bool
+{
+    // A streamed or partially captured body can't be decoded after the fact, and a digest is computed over the
+    // decoded body as curl delivers it.
+    if (m_client == nullptr || m_client->m_decode_pool == nullptr || !m_request->content_decoding() ||
+        !m_request->accept_encodings().has_value() || m_request->body_sink() != nullptr ||
+        m_request->capture().has_value() || m_request->integrity().has_value())
+    {
+        return false;
+    }
+
+    // An empty list asks for every encoding, only the decodable ones are then sent.
+    const auto& encodings = m_request->accept_encodings().value();
+    return std::all_of(
+        encodings.begin(), encodings.end(), [](const std::string& e) { return response::decodable(e); });
+}
+
+auto executor::spill_threshold() const -> std::optional<std::size_t>
+{
+    if (m_client == nullptr || !m_client->m_spill_options.has_value())
+    {
+        return std::nullopt;
+    }
+    return m_client->m_spill_options.value().m_memory_threshold_bytes;
+}
+
+auto executor::body_size() const -> uint64_t
+{
+    return m_spill.is_open() ? m_spill.size() : m_response.data_size();
+}
+
+auto executor::finish_body() -> void
+{
+    if (m_spill.is_open())
+    {
+        auto size = m_spill.size();
+        if (auto mapping = m_spill.map(); mapping != nullptr)
+        {
+            m_response.m_shared_view  = std::string_view{mapping.get(), static_cast<std::size_t>(size)};
+            m_response.m_shared_owner = std::move(mapping);
+        }
+        else if (size > 0 && m_response.m_lift_status == lift_status::success)
+        {
+            m_response.m_lift_status = lift_status::download_error;
+        }
+    }
+    else if (!m_request->segmented_body())
+    {
+        m_response.flatten();
+    }
+    release_body();
+}
+
+auto executor::release_body() -> void
+{
+    m_spill.close();
+    if (m_body_memory_bytes > 0)
+    {
+        m_client->m_body_memory_bytes.fetch_sub(m_body_memory_bytes, std::memory_order_acq_rel);
+        m_body_memory_bytes = 0;
+    }
+}
+
+auto executor::verify_digest() -> bool
+{
+    const auto& integrity = m_request->integrity();
+    if (!integrity.has_value())
+    {
+        return true;
+    }
+
+    const auto& policy = integrity.value();
+    if (!m_hasher.has_value())
+    {
+        // The body was empty.
+        m_hasher.emplace(policy.m_algorithm);
+    }
+    m_response.m_digest = m_hasher->finish();
+    m_hasher.reset();
+
+    if (policy.m_expected_hex.has_value())
+    {
+        const auto& expected = policy.m_expected_hex.value();
+        auto        actual   = to_hex(m_response.m_digest);
+        if (!std::equal(
+                actual.begin(),
+                actual.end(),
+                expected.begin(),
+                expected.end(),
+                [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); }))
+        {
+            return false;
+        }
+    }
+
+    if (policy.m_verify_header)
+    {
+        for (auto name : {"Repr-Digest", "Digest"})
+        {
+            if (auto h = m_response.header(name); h.has_value())
+            {
+                auto expected = parse_digest_header(h.value().value(), policy.m_algorithm);
+                if (expected.has_value() && expected.value() != m_response.m_digest)
+                {
+                    return false;
+                }
+            }
+        }
+
+        if (policy.m_algorithm == digest_algorithm::md5)
+        {
+            if (auto h = m_response.header("Content-MD5"); h.has_value())
+            {
+                if (from_base64(h.value().value()) != m_response.m_digest)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
 }
 
 auto executor::reset() -> void
 {
+    release_body();
+    m_hasher.reset();
+
     if (m_mime_handle != nullptr)
     {
         curl_mime_free(m_mime_handle);
@@ -463,9 +761,28 @@ auto executor::reset() -> void
     m_request_async = nullptr;
     m_request       = nullptr;
 
+    m_request_source = nullptr;
     m_timeout_iterator.reset();
+    m_hedge_iterator.reset();
+    m_hedge_peer     = nullptr;
+    m_is_hedge       = false;
+    m_hedge_original = nullptr;
+    m_start_time     = 0;
+    m_deadline       = std::nullopt;
+    m_attempt        = 1;
+    m_retry_iterator.reset();
+    m_cancel_iterator.reset();
+    m_host_state                    = nullptr;
+    m_circuit_breaker_admitted      = false;
+    m_concurrency_acquired          = false;
+    m_body_bytes_streamed           = 0;
+    m_body_sink_finished            = false;
+    m_headers_complete              = false;
+    m_headers_aborted               = false;
+    m_hop_has_location              = false;
+    m_spill_early                   = false;
     m_on_complete_handler_processed = false;
-    m_response                      = response{};
+    m_response                      = response{(m_client != nullptr) ? m_client->m_buffer_pool : nullptr};
 
     curl_easy_reset(m_curl_handle);
 }
@@ -511,18 +828,12 @@ auto curl_write_header(char* buffer, size_t size, size_t nitems, void* user_ptr)
         return data_length;
     }
 
-    // Ignore empty header lines from curl.
+    // The empty line ends each response's headers.
     if (data_length == 2 && data_view == "\r\n")
     {
-        return data_length;
-    }
-    // Ignore the HTTP/ 'header' line from curl.
-    constexpr size_t HTTPSLASH_LEN = 5;
-    if (data_length >= 4 && data_view.substr(0, HTTPSLASH_LEN) == "HTTP/")
-    {
-        return data_length;
+        // Returning a short count aborts the transfer with CURLE_WRITE_ERROR.
+        return executor_ptr->on_headers_complete() ? data_length : 0;
     }
-
     // Drop the trailing \r\n from the header.
     if (data_length >= 2)
     {
@@ -530,7 +841,65 @@ auto curl_write_header(char* buffer, size_t size, size_t nitems, void* user_ptr)
         data_view.remove_suffix(rm_size);
     }
 
-    response.m_headers.emplace_back(std::string{data_view.data(), data_view.length()});
+    // Each response curl receives, e.g. every redirect that is followed, starts with its status line.
+    constexpr std::string_view http_slash{"HTTP/"};
+    if (data_view.substr(0, http_slash.size()) == http_slash)
+    {
+        executor_ptr->m_hop_has_location = false;
+        executor_ptr->m_spill_early      = false;
+        executor_ptr->m_hasher.reset();
+        response.add_status_line(
+            data_view, executor_ptr->m_request->header_retention() == header_retention::all_hops);
+        return data_length;
+    }
+
+    auto colon = data_view.find(':');
+    auto name  = data_view.substr(0, colon);
+
+    // curl follows the redirect if the response has a Location, even if the capture policy drops it.
+    constexpr std::string_view location{"location"};
+    if (name.size() == location.size() &&
+        std::equal(
+            location.begin(),
+            location.end(),
+            name.begin(),
+            [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); }))
+    {
+        executor_ptr->m_hop_has_location = true;
+    }
+
+    // Presize the body so it is received without reallocating, HEAD responses carry a length but no body.
+    const auto& request = *executor_ptr->m_request;
+    if (request.buffer_body() && request.method() != http::method::head && colon != std::string_view::npos &&
+        response::to_known_header(name) == response::known_header::content_length)
+    {
+        auto value = data_view.substr(colon + 1);
+        value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
+
+        uint64_t size = 0;
+        if (std::from_chars(value.data(), value.data() + value.size(), size).ec == std::errc{})
+        {
+            if (const auto& capture = request.capture(); capture.has_value())
+            {
+                size = std::min(size, capture.value().m_max_body_bytes.value_or(size));
+            }
+
+            // A body that will be spilled anyway goes straight into the spill file rather than through memory.
+            if (auto threshold = executor_ptr->spill_threshold(); threshold.has_value() && size > threshold.value())
+            {
+                executor_ptr->m_spill_early = true;
+            }
+            else
+            {
+                response.reserve_data(size);
+            }
+        }
+    }
+
+    if (executor_ptr->captures_header(name))
+    {
+        response.add_header(data_view);
+    }
 
     return data_length; // return original size for curl to continue processing
 }
@@ -543,9 +912,57 @@ auto curl_write_data(void* buffer, size_t size, size_t nitems, void* user_ptr) -
 
     std::string_view from{static_cast<const char*>(buffer), data_length};
 
-    std::copy(from.begin(), from.end(), std::back_inserter(response.m_data));
+    // Every chunk is hashed as it arrives, even the bytes a capture policy or a sink doesn't keep.
+    if (const auto& integrity = executor_ptr->m_request->integrity(); integrity.has_value())
+    {
+        if (!executor_ptr->m_hasher.has_value())
+        {
+            executor_ptr->m_hasher.emplace(integrity.value().m_algorithm);
+        }
+        executor_ptr->m_hasher->update(from);
+    }
+
+    const auto& sink = executor_ptr->m_request->body_sink();
+    if (sink != nullptr)
+    {
+        // The user already has their response, e.g. it timed out, nobody is left to read the body.
+        if (executor_ptr->m_body_sink_finished)
+        {
+            return data_length;
+        }
+
+        executor_ptr->m_body_bytes_streamed += data_length;
+        if (!sink->write(*executor_ptr->m_request, from))
+        {
+            // Returning a short count aborts the transfer with CURLE_WRITE_ERROR.
+            return 0;
+        }
+
+        if (!executor_ptr->m_request->buffer_body())
+        {
+            return data_length;
+        }
+    }
+
+    if (const auto& capture = executor_ptr->m_request->capture();
+        capture.has_value() && capture.value().m_max_body_bytes.has_value())
+    {
+        auto max_bytes = capture.value().m_max_body_bytes.value();
+        auto kept      = executor_ptr->body_size();
+        if (kept + from.size() > max_bytes)
+        {
+            response.m_body_truncated = true;
+            if (!executor_ptr->append_body(from.substr(0, max_bytes - std::min<uint64_t>(kept, max_bytes))))
+            {
+                return 0;
+            }
+            // Returning a short count aborts the transfer with CURLE_WRITE_ERROR.
+            return (capture.value().m_body_overflow == body_overflow::abort) ? 0 : data_length;
+        }
+    }
 
-    return data_length;
+    // Returning a short count aborts the transfer with CURLE_WRITE_ERROR.
+    return executor_ptr->append_body(from) ? data_length : 0;
 }
 
 auto curl_xfer_info(
@@ -0,0 +1,190 @@
+#include "lift/file_sink.hpp"
+#include "lift/response.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+namespace lift
+{
+/// O_DIRECT requires the buffer, file offset and size of each write to be aligned to the logical block size.
+static constexpr std::size_t write_alignment = 4096;
+
+static auto align_up(std::size_t bytes) -> std::size_t
+{
+    return (bytes + write_alignment - 1) / write_alignment * write_alignment;
+}
+
+auto file_sink::aligned_delete::operator()(char* buffer) const -> void
+{
+    ::operator delete(buffer, std::align_val_t{write_alignment});
+}
+
+file_sink::file_sink(const std::filesystem::path& path, file_sink_options options)
+    : m_owns_fd(true),
+      m_options(options)
+{
+    constexpr int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    if (m_options.m_direct_io)
+    {
+        // Not every file system supports O_DIRECT, e.g. tmpfs, fall back to buffered writes.
+        m_fd        = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        m_direct_io = (m_fd != -1);
+    }
+    if (m_fd == -1)
+    {
+        m_fd = ::open(path.c_str(), flags, 0644);
+    }
+    if (m_fd == -1)
+    {
+        throw std::runtime_error{"lift::file_sink Failed to open " + path.string()};
+    }
+
+    m_options.m_batch_bytes = align_up(std::max<std::size_t>(m_options.m_batch_bytes, 1));
+    m_buffer.reset(static_cast<char*>(::operator new(m_options.m_batch_bytes, std::align_val_t{write_alignment})));
+}
+
+file_sink::file_sink(int fd, uint64_t offset, file_sink_options options)
+    : m_fd(fd),
+      m_options(options),
+      m_offset(offset)
+{
+    auto flags = ::fcntl(m_fd, F_GETFL);
+    if (flags == -1)
+    {
+        throw std::runtime_error{"lift::file_sink The file descriptor is invalid."};
+    }
+    if ((flags & O_DIRECT) != 0)
+    {
+        throw std::runtime_error{"lift::file_sink The file descriptor cannot be open with O_DIRECT."};
+    }
+
+    m_options.m_batch_bytes = align_up(std::max<std::size_t>(m_options.m_batch_bytes, 1));
+    m_buffer.reset(static_cast<char*>(::operator new(m_options.m_batch_bytes, std::align_val_t{write_alignment})));
+}
+
+file_sink::~file_sink()
+{
+    if (m_owns_fd && m_fd != -1)
+    {
+        ::close(m_fd);
+    }
+}
+
+auto file_sink::start(const request& /*req*/, const response& resp) -> void
+{
+    if (m_options.m_preallocate && m_bytes_received == 0)
+    {
+        if (auto length = resp.content_length(); length.has_value() && length.value() > 0)
+        {
+            // Best effort, fallocate() fails rather than writing zeros on file systems that don't support it.
+            (void)::fallocate(m_fd, 0, static_cast<off_t>(m_offset), static_cast<off_t>(length.value()));
+        }
+    }
+}
+
+auto file_sink::write(const request& /*req*/, std::string_view chunk) -> bool
+{
+    if (m_error != 0)
+    {
+        return false;
+    }
+
+    if (m_options.m_crc32)
+    {
+        for (auto remaining = chunk; !remaining.empty();)
+        {
+            auto n  = std::min<std::size_t>(remaining.size(), 1024 * 1024 * 1024);
+            m_crc32 = static_cast<uint32_t>(
+                ::crc32(m_crc32, reinterpret_cast<const Bytef*>(remaining.data()), static_cast<uInt>(n)));
+            remaining.remove_prefix(n);
+        }
+    }
+    m_bytes_received += chunk.size();
+
+    // A chunk of at least a whole batch is written without being copied when writes don't need to be aligned.
+    if (!m_direct_io && m_buffered == 0 && chunk.size() >= m_options.m_batch_bytes)
+    {
+        if (!write_at(chunk.data(), chunk.size(), m_offset + m_bytes_written))
+        {
+            return false;
+        }
+        m_bytes_written += chunk.size();
+        return true;
+    }
+
+    while (!chunk.empty())
+    {
+        auto n = std::min(m_options.m_batch_bytes - m_buffered, chunk.size());
+        std::memcpy(m_buffer.get() + m_buffered, chunk.data(), n);
+        m_buffered += n;
+        chunk.remove_prefix(n);
+
+        if (m_buffered == m_options.m_batch_bytes && !flush(m_buffered))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto file_sink::finish(const request& /*req*/, const response& /*resp*/) -> void
+{
+    if (m_buffered > 0 && m_error == 0)
+    {
+        auto bytes = m_buffered;
+        if (m_direct_io)
+        {
+            // The final partial batch is padded to the alignment, the padding is truncated away below.
+            bytes = align_up(m_buffered);
+            std::memset(m_buffer.get() + m_buffered, 0, bytes - m_buffered);
+        }
+        flush(bytes);
+    }
+
+    // Drops the O_DIRECT padding and any blocks preallocated beyond the body.
+    if (m_owns_fd && ::ftruncate(m_fd, static_cast<off_t>(m_offset + m_bytes_written)) != 0 && m_error == 0)
+    {
+        m_error = errno;
+    }
+}
+
+auto file_sink::flush(std::size_t bytes) -> bool
+{
+    if (!write_at(m_buffer.get(), bytes, m_offset + m_bytes_written))
+    {
+        return false;
+    }
+    m_bytes_written += m_buffered;
+    m_buffered = 0;
+    return true;
+}
+
+auto file_sink::write_at(const char* data, std::size_t size, uint64_t offset) -> bool
+{
+    while (size > 0)
+    {
+        auto written = ::pwrite(m_fd, data, size, static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            m_error = errno;
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+} // namespace lift
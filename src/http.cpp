@@ -1,7 +1,33 @@
 #include "lift/http.hpp"
 
+#include <algorithm>
+#include <cctype>
+
 namespace lift::http
 {
+namespace
+{
+auto iequals(std::string_view a, std::string_view b) -> bool
+{
+    auto equal = [](unsigned char x, unsigned char y) { return std::tolower(x) == std::tolower(y); };
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), equal);
+}
+
+auto trim(std::string_view value) -> std::string_view
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+    {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+} // namespace
+
 auto to_string(method m) -> const std::string&
 {
     switch (m)
@@ -432,4 +458,44 @@ auto to_string(connection_type ct) -> const std::string&
     }
 }
 
+auto to_content_type(std::string_view value) -> content_type
+{
+    value = trim(value.substr(0, value.find(';')));
+    if (value.empty())
+    {
+        return content_type::no_content;
+    }
+
+    // Media types are case insensitive, RFC 9110 section 8.3.1.
+    for (auto ct = static_cast<uint16_t>(content_type::text_css);
+         ct <= static_cast<uint16_t>(content_type::application_x_www_form_urlencoded);
+         ++ct)
+    {
+        if (iequals(value, to_string(static_cast<content_type>(ct))))
+        {
+            return static_cast<content_type>(ct);
+        }
+    }
+    return content_type::unknown;
+}
+
+auto to_connection_type(std::string_view value) -> std::optional<connection_type>
+{
+    while (!value.empty())
+    {
+        auto comma  = value.find(',');
+        auto option = trim(value.substr(0, comma));
+        value       = (comma == std::string_view::npos) ? std::string_view{} : value.substr(comma + 1);
+
+        for (auto ct : {connection_type::close, connection_type::keep_alive, connection_type::upgrade})
+        {
+            if (iequals(option, to_string(ct)))
+            {
+                return ct;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
 } // namespace lift::http
@@ -15,6 +15,9 @@ static const std::string lift_status_response_empty        = "response_empty"s;
 static const std::string lift_status_error                 = "error"s;
 static const std::string lift_status_error_failed_to_start = "error_failed_to_start"s;
 static const std::string lift_status_download_error        = "download_error"s;
+static const std::string lift_status_cancelled             = "cancelled"s;
+static const std::string lift_status_circuit_open          = "circuit_open"s;
+static const std::string lift_status_integrity_mismatch    = "integrity_mismatch"s;
 
 auto to_string(lift_status status) -> const std::string&
 {
@@ -40,6 +43,12 @@ auto to_string(lift_status status) -> const std::string&
             return lift_status_download_error;
         case lift_status::error_failed_to_start:
             return lift_status_error_failed_to_start;
+        case lift_status::cancelled:
+            return lift_status_cancelled;
+        case lift_status::circuit_open:
+            return lift_status_circuit_open;
+        case lift_status::integrity_mismatch:
+            return lift_status_integrity_mismatch;
         case lift_status::error:
         default:
             return lift_status_error;
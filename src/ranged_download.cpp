@@ -0,0 +1,482 @@
+#include "lift/ranged_download.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace lift::impl
+{
+namespace
+{
+struct byte_range
+{
+    /// The offset in the object, and the file, the range starts at.
+    uint64_t m_offset{0};
+    /// The number of bytes in the range, or std::nullopt for the entire object without a Range header.
+    std::optional<uint64_t> m_length{std::nullopt};
+    /// The number of times this range has been retried.
+    uint32_t m_retries{0};
+};
+
+/// What identifies the version of the object being downloaded, every range must come from the same version.
+struct object_version
+{
+    /// The object's strong ETag, a weak ETag can't validate byte ranges.
+    std::optional<std::string> m_etag{std::nullopt};
+    /// The object's Last-Modified date.
+    std::optional<std::string> m_last_modified{std::nullopt};
+    /// The object's size in bytes.
+    uint64_t m_size{0};
+
+    /**
+     * @return The If-Range validator, the ETag if the object has a strong one otherwise its Last-Modified date.
+     */
+    auto validator() const -> const std::optional<std::string>&
+    {
+        return m_etag.has_value() ? m_etag : m_last_modified;
+    }
+
+    /**
+     * @param range The range that was requested.
+     * @param response The range's 206 response.
+     * @return Is the range from this version of the object, and does it start where it was asked to?
+     */
+    auto matches(const byte_range& range, const response& response) const -> bool
+    {
+        auto etag = response.etag();
+        if (m_etag.has_value() && etag.has_value() && etag.value() != m_etag.value())
+        {
+            return false;
+        }
+
+        auto last_modified = response.last_modified();
+        if (m_last_modified.has_value() && last_modified.has_value() &&
+            last_modified.value() != m_last_modified.value())
+        {
+            return false;
+        }
+
+        // Content-Range: bytes <first>-<last>/<size>, the size is * if the server doesn't know it.
+        auto content_range = response.header("Content-Range");
+        if (!content_range.has_value())
+        {
+            return true;
+        }
+
+        auto value = content_range.value().value();
+        if (value.substr(0, 6) != "bytes ")
+        {
+            return false;
+        }
+        value.remove_prefix(6);
+
+        uint64_t first = 0;
+        if (std::from_chars(value.data(), value.data() + value.size(), first).ec != std::errc{} ||
+            first != range.m_offset)
+        {
+            return false;
+        }
+
+        auto slash = value.find('/');
+        if (slash == std::string_view::npos)
+        {
+            return false;
+        }
+        value.remove_prefix(slash + 1);
+
+        uint64_t size = 0;
+        return value == "*" ||
+               (std::from_chars(value.data(), value.data() + value.size(), size).ec == std::errc{} && size == m_size);
+    }
+};
+
+auto accepts_byte_ranges(const response& response) -> bool
+{
+    auto accept_ranges = response.header("Accept-Ranges");
+    if (!accept_ranges.has_value())
+    {
+        return false;
+    }
+
+    std::string value{accept_ranges.value().value()};
+    std::transform(
+        value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value.find("bytes") != std::string::npos;
+}
+
+class ranged_download : public std::enable_shared_from_this<ranged_download>
+{
+public:
+    ranged_download(
+        request_starter_type    starter,
+        std::string             url,
+        std::filesystem::path   path,
+        download_callback_type  callback,
+        ranged_download_options options)
+        : m_starter(std::move(starter)),
+          m_url(std::move(url)),
+          m_path(std::move(path)),
+          m_callback(std::move(callback)),
+          m_options(std::move(options))
+    {
+        m_options.m_connections     = std::max<std::size_t>(m_options.m_connections, 1);
+        m_options.m_min_range_bytes = std::max<uint64_t>(m_options.m_min_range_bytes, 1);
+        m_options.m_max_range_bytes = std::max(m_options.m_max_range_bytes, m_options.m_min_range_bytes);
+        m_range_bytes =
+            std::clamp(m_options.m_initial_range_bytes, m_options.m_min_range_bytes, m_options.m_max_range_bytes);
+    }
+
+    ranged_download(const ranged_download&)                    = delete;
+    ranged_download(ranged_download&&)                         = delete;
+    auto operator=(const ranged_download&) -> ranged_download& = delete;
+    auto operator=(ranged_download&&) -> ranged_download&      = delete;
+
+    ~ranged_download()
+    {
+        if (m_fd != -1)
+        {
+            ::close(m_fd);
+        }
+    }
+
+    auto start() -> void
+    {
+        auto head = std::make_unique<request>(m_url, m_options.m_timeout);
+        head->method(http::method::head);
+        m_starter(
+            std::move(head),
+            [self = shared_from_this()](request_ptr, response response) { self->on_head(std::move(response)); });
+    }
+
+private:
+    using pending_type = std::pair<request_ptr, request::async_callback_type>;
+
+    /// Starts each of the download's requests.
+    request_starter_type m_starter{nullptr};
+    /// The object to download.
+    std::string m_url{};
+    /// The file the object is written into.
+    std::filesystem::path m_path{};
+    /// Invoked once with the download's result.
+    download_callback_type m_callback{nullptr};
+    /// The download's concurrency, range sizing and retry options.
+    ranged_download_options m_options{};
+    /// When the download started.
+    std::chrono::steady_clock::time_point m_start_time{std::chrono::steady_clock::now()};
+
+    /// Guards the members below, ranges complete on every thread the starter's requests complete on.
+    std::mutex m_lock{};
+    /// The file the object is written into.
+    int m_fd{-1};
+    /// The ranges waiting to be requested, retries are requested before new ranges.
+    std::deque<byte_range> m_queued{};
+    /// The offset of the first byte not yet part of a range.
+    uint64_t m_next_offset{0};
+    /// The size of the next range, adapted to the throughput of the completed ranges.
+    uint64_t m_range_bytes{0};
+    /// The number of bytes in completed ranges.
+    uint64_t m_completed_bytes{0};
+    /// The number of range requests executing.
+    std::size_t m_in_flight{0};
+    /// Has every byte of the object been written?
+    bool m_body_complete{false};
+    /// Has a range failed beyond its retries?  No more ranges are requested.
+    bool m_failed{false};
+    /// Has the callback been handed the result?
+    bool m_completed{false};
+    /// The download's aggregate result.
+    ranged_download_result m_result{};
+    /// The version of the object the HEAD request found, each range is validated against it.
+    object_version m_version{};
+
+    auto on_head(response head) -> void
+    {
+        std::vector<pending_type>             pending{};
+        std::optional<ranged_download_result> result{};
+        {
+            std::lock_guard<std::mutex> guard{m_lock};
+            m_result.m_status_code = head.status_code();
+
+            if (head.lift_status() != lift_status::success)
+            {
+                fail(head);
+            }
+            else
+            {
+                m_fd      = ::open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                auto size = head.content_length();
+                if (m_fd == -1)
+                {
+                    m_failed               = true;
+                    m_result.m_lift_status = lift_status::error;
+                }
+                else if (
+                    head.status_code() == http::status_code::http_200_ok && size.has_value() && size.value() > 0 &&
+                    accepts_byte_ranges(head))
+                {
+                    m_result.m_ranged = true;
+                    m_result.m_size   = size.value();
+                    m_version.m_size  = size.value();
+                    if (auto etag = head.etag(); etag.has_value() && etag.value().substr(0, 2) != "W/")
+                    {
+                        m_version.m_etag = std::string{etag.value()};
+                    }
+                    if (auto last_modified = head.last_modified(); last_modified.has_value())
+                    {
+                        m_version.m_last_modified = std::string{last_modified.value()};
+                    }
+                    // Best effort, the ranges are written into the file's blocks rather than extending it piecemeal.
+                    (void)::fallocate(m_fd, 0, 0, static_cast<off_t>(size.value()));
+                    (void)::ftruncate(m_fd, static_cast<off_t>(size.value()));
+                }
+                else
+                {
+                    // Either the server can't serve ranges of the object or the HEAD was refused, a single GET decides.
+                    m_queued.push_back(byte_range{});
+                }
+            }
+
+            pending = next_requests();
+            result  = take_result();
+        }
+        issue(std::move(pending), std::move(result));
+    }
+
+    auto on_range(const byte_range& range, const file_sink& sink, bool changed, response response) -> void
+    {
+        std::vector<pending_type>             pending{};
+        std::optional<ranged_download_result> result{};
+        {
+            std::lock_guard<std::mutex> guard{m_lock};
+            --m_in_flight;
+            m_result.m_bytes_received += response.download_size();
+
+            auto written = sink.bytes_written();
+            if (sink.error() != 0)
+            {
+                // The file can't be written, e.g. the disk is full, retrying won't help.
+                m_failed               = true;
+                m_result.m_lift_status = lift_status::error;
+            }
+            else if (changed)
+            {
+                // The object changed since the HEAD request, its ranges can't be stitched together.
+                m_failed                  = true;
+                m_result.m_object_changed = true;
+                m_result.m_status_code    = response.status_code();
+                m_result.m_lift_status    = lift_status::error;
+            }
+            else if (range.m_length.has_value() && written >= range.m_length.value())
+            {
+                adapt_range_bytes(range.m_length.value(), response.total_time());
+                m_completed_bytes += range.m_length.value();
+                m_body_complete = (m_completed_bytes >= m_result.m_size);
+            }
+            else if (!range.m_length.has_value() && response.lift_status() == lift_status::success)
+            {
+                m_result.m_size        = written;
+                m_result.m_status_code = response.status_code();
+                m_body_complete        = true;
+                (void)::ftruncate(m_fd, static_cast<off_t>(written));
+            }
+            else if (!m_failed && retryable(range, response))
+            {
+                ++m_result.m_retries;
+                auto retry = range;
+                ++retry.m_retries;
+                if (retry.m_length.has_value())
+                {
+                    // Resume the range from the last byte written.
+                    m_completed_bytes += written;
+                    retry.m_offset += written;
+                    retry.m_length = retry.m_length.value() - written;
+                }
+                m_queued.push_front(retry);
+            }
+            else if (!m_failed)
+            {
+                fail(response);
+            }
+
+            pending = next_requests();
+            result  = take_result();
+        }
+        issue(std::move(pending), std::move(result));
+    }
+
+    auto retryable(const byte_range& range, const response& response) const -> bool
+    {
+        if (range.m_retries >= m_options.m_max_range_retries || response.lift_status() == lift_status::cancelled ||
+            response.lift_status() == lift_status::error_failed_to_start)
+        {
+            return false;
+        }
+
+        // Transfer failures and server errors are retried, any other status won't change on a retry.
+        auto code = static_cast<uint32_t>(response.status_code());
+        return code == static_cast<uint32_t>(http::status_code::http_unknown) || code == expected_status(range) ||
+               code >= 500;
+    }
+
+    auto fail(const response& response) -> void
+    {
+        m_failed               = true;
+        m_result.m_status_code = response.status_code();
+        m_result.m_lift_status =
+            (response.lift_status() == lift_status::success) ? lift_status::error : response.lift_status();
+    }
+
+    auto adapt_range_bytes(uint64_t length, std::chrono::milliseconds elapsed) -> void
+    {
+        // The size that would have taken the target time at this range's throughput, smoothed over ranges.
+        auto elapsed_ms = static_cast<uint64_t>(std::max<int64_t>(elapsed.count(), 1));
+        auto target     = length * static_cast<uint64_t>(m_options.m_target_range_time.count()) / elapsed_ms;
+        m_range_bytes =
+            std::clamp((m_range_bytes + target) / 2, m_options.m_min_range_bytes, m_options.m_max_range_bytes);
+    }
+
+    auto next_range_bytes() const -> uint64_t
+    {
+        // Near the end the ranges shrink so every connection stays busy and the final ranges finish together.
+        auto remaining = m_result.m_size - m_next_offset;
+        auto share     = std::max(m_options.m_min_range_bytes, remaining / m_options.m_connections);
+        return std::min({m_range_bytes, share, remaining});
+    }
+
+    static auto expected_status(const byte_range& range) -> uint32_t
+    {
+        return static_cast<uint32_t>(
+            range.m_length.has_value() ? http::status_code::http_206_partial_content : http::status_code::http_200_ok);
+    }
+
+    auto next_requests() -> std::vector<pending_type>
+    {
+        std::vector<pending_type> pending{};
+        while (!m_failed && m_in_flight < m_options.m_connections)
+        {
+            byte_range range{};
+            if (!m_queued.empty())
+            {
+                range = m_queued.front();
+                m_queued.pop_front();
+            }
+            else if (m_result.m_ranged && m_next_offset < m_result.m_size)
+            {
+                range = byte_range{m_next_offset, next_range_bytes(), 0};
+                m_next_offset += range.m_length.value();
+            }
+            else
+            {
+                break;
+            }
+
+            pending.emplace_back(range_request(range));
+            ++m_in_flight;
+            ++m_result.m_requests;
+        }
+        return pending;
+    }
+
+    auto range_request(const byte_range& range) -> pending_type
+    {
+        auto sink    = std::make_shared<file_sink>(m_fd, range.m_offset, m_options.m_sink);
+        auto request = std::make_unique<lift::request>(m_url, m_options.m_timeout);
+        request->body_sink(sink);
+        if (range.m_length.has_value())
+        {
+            auto last = range.m_offset + range.m_length.value() - 1;
+            request->header("Range", "bytes=" + std::to_string(range.m_offset) + "-" + std::to_string(last));
+            // If the object has changed the server sends all of it with a 200 rather than a range of the new version.
+            if (const auto& validator = m_version.validator(); validator.has_value())
+            {
+                request->header("If-Range", validator.value());
+            }
+        }
+
+        // A server that ignores the Range, or an error page, must not be written into the file, nor may a range
+        // of a different version of the object.
+        auto expected = expected_status(range);
+        auto changed  = std::make_shared<bool>(false);
+        request->headers_handler(
+            [expected, range, version = m_version, changed](lift::request&, const response& response)
+            {
+                auto code = static_cast<uint32_t>(response.status_code());
+                if (range.m_length.has_value())
+                {
+                    auto full = static_cast<uint32_t>(http::status_code::http_200_ok);
+                    *changed  = (code == expected && !version.matches(range, response)) ||
+                               (code == full && version.validator().has_value());
+                }
+                return (code == expected && !*changed) ? header_action::proceed : header_action::abort;
+            });
+
+        auto callback = [self = shared_from_this(), range, sink, changed](request_ptr, response response)
+        { self->on_range(range, *sink, *changed, std::move(response)); };
+        return pending_type{std::move(request), std::move(callback)};
+    }
+
+    auto take_result() -> std::optional<ranged_download_result>
+    {
+        if (m_completed || m_in_flight > 0 || (!m_failed && !m_body_complete))
+        {
+            return std::nullopt;
+        }
+
+        m_completed = true;
+        if (m_fd != -1)
+        {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+
+        if (!m_failed)
+        {
+            m_result.m_lift_status = lift_status::success;
+        }
+        m_result.m_total_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - m_start_time);
+        return m_result;
+    }
+
+    /**
+     * Starts the requests and delivers the result outside of the lock, a request that fails to start
+     * completes on this thread.
+     */
+    auto issue(std::vector<pending_type> pending, std::optional<ranged_download_result> result) -> void
+    {
+        for (auto& [request, callback] : pending)
+        {
+            m_starter(std::move(request), std::move(callback));
+        }
+
+        if (result.has_value())
+        {
+            m_callback(std::move(result.value()));
+        }
+    }
+};
+
+} // namespace
+
+auto start_ranged_download(
+    request_starter_type    starter,
+    std::string             url,
+    std::filesystem::path   path,
+    download_callback_type  callback,
+    ranged_download_options options) -> void
+{
+    auto download = std::make_shared<ranged_download>(
+        std::move(starter), std::move(url), std::move(path), std::move(callback), std::move(options));
+    download->start();
+}
+
+} // namespace lift::impl
@@ -2,6 +2,8 @@
 #include "lift/const.hpp"
 #include "lift/executor.hpp"
 
+#include <atomic>
+
 namespace lift
 {
 using namespace std::string_literals;
@@ -54,6 +56,12 @@ auto to_string(debug_info_type type) -> const std::string&
     }
 }
 
+auto request::next_id() -> uint64_t
+{
+    static std::atomic<uint64_t> g_next_id{1};
+    return g_next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
 request::request(std::string url, std::optional<std::chrono::milliseconds> timeout)
     : m_timeout(std::move(timeout)),
       m_url(std::move(url))
@@ -78,6 +86,18 @@ auto request::transfer_progress_handler(std::optional<transfer_progress_handler_
     }
 }
 
+auto request::headers_handler(std::optional<headers_handler_type> headers_handler) -> void
+{
+    if (headers_handler.has_value() && headers_handler.value())
+    {
+        m_on_headers_handler = std::move(headers_handler.value());
+    }
+    else
+    {
+        m_on_headers_handler = nullptr;
+    }
+}
+
 auto request::follow_redirects(bool follow_redirects, std::optional<uint64_t> max_redirects) -> void
 {
     if (follow_redirects)
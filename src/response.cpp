@@ -1,46 +1,748 @@
 #include "lift/response.hpp"
 #include "lift/const.hpp"
+#include "lift/digest.hpp"
 
-#include <functional>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <ctime>
+#include <limits>
+#include <utility>
 
 namespace lift
 {
-response::response()
+namespace
+{
+auto to_lower(char c) -> unsigned char
+{
+    return static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+auto iequals(std::string_view a, std::string_view b) -> bool
+{
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return to_lower(x) == to_lower(y); });
+}
+
+/**
+ * @return The FNV-1a hash of the header name folded to lower case.
+ */
+auto header_name_hash(std::string_view name) -> std::size_t
+{
+    uint32_t hash = 2166136261U;
+    for (auto c : name)
+    {
+        hash ^= to_lower(c);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+auto trim(std::string_view value) -> std::string_view
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+    {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+/**
+ * Reserves room for at least bytes in the buffer, a buffer leased from a pool gets the capacity of its
+ * entire size class so its tail isn't left unused.
+ * @param buffer The buffer to reserve.
+ * @param bytes The number of bytes the buffer needs room for.
+ */
+template<typename buffer_type>
+auto reserve_lease(buffer_type& buffer, std::size_t bytes) -> void
+{
+    buffer.reserve(bytes);
+}
+
+template<typename type>
+auto reserve_lease(std::vector<type, pool_allocator<type>>& buffer, std::size_t bytes) -> void
+{
+    auto        allocator = buffer.get_allocator();
+    const auto& pool      = allocator.pool();
+    buffer.reserve((pool != nullptr) ? pool->lease_bytes(bytes) : bytes);
+}
+
+/**
+ * @param in The compressed bytes.
+ * @param window_bits The zlib window bits, they select the gzip, zlib or raw deflate format.
+ * @param out An empty buffer the bytes are inflated into, it carries the allocator to use.
+ * @param max_bytes The most bytes the data may inflate to.
+ * @param[out] exceeded Set to true if the data inflates to more than max_bytes.
+ * @return The inflated bytes, or std::nullopt if they are corrupt, truncated or larger than max_bytes.
+ */
+template<typename buffer_type>
+auto inflate_data(std::string_view in, int window_bits, buffer_type out, std::size_t max_bytes, bool& exceeded)
+    -> std::optional<buffer_type>
+{
+    z_stream stream{};
+    if (inflateInit2(&stream, window_bits) != Z_OK)
+    {
+        return std::nullopt;
+    }
+
+    int result = Z_OK;
+    while (result != Z_STREAM_END)
+    {
+        if (stream.avail_in == 0)
+        {
+            if (in.empty())
+            {
+                break;
+            }
+            auto n          = std::min<std::size_t>(in.size(), std::numeric_limits<uInt>::max());
+            stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+            stream.avail_in = static_cast<uInt>(n);
+            in.remove_prefix(n);
+        }
+
+        // Grow geometrically, compressed text is commonly a quarter of its decoded size.
+        auto used  = out.size();
+        auto chunk = std::clamp<std::size_t>(std::max(used, in.size() * 4), 16 * 1024, 64 * 1024 * 1024);
+        if (chunk > max_bytes - used)
+        {
+            // One byte past the limit is enough to tell that the data is too large.
+            chunk = max_bytes - used + 1;
+        }
+        if (used + chunk > out.capacity())
+        {
+            reserve_lease(out, used + chunk);
+        }
+        out.resize(used + chunk);
+        stream.next_out  = reinterpret_cast<Bytef*>(out.data() + used);
+        stream.avail_out = static_cast<uInt>(chunk);
+
+        result = inflate(&stream, Z_NO_FLUSH);
+        out.resize(out.size() - stream.avail_out);
+        if (out.size() > max_bytes)
+        {
+            exceeded = true;
+            inflateEnd(&stream);
+            return std::nullopt;
+        }
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+        {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+
+    if (result != Z_STREAM_END)
+    {
+        return std::nullopt;
+    }
+    return out;
+}
+
+/**
+ * @param in The encoded bytes.
+ * @param coding A single content coding.
+ * @param out An empty buffer the bytes are decoded into, it carries the allocator to use.
+ * @param max_bytes The most bytes the data may decode to.
+ * @param[out] exceeded Set to true if the data decodes to more than max_bytes.
+ * @return The decoded bytes, or std::nullopt if the coding isn't supported, the bytes are corrupt or they
+ *         decode to more than max_bytes.
+ */
+template<typename buffer_type>
+auto decode_coding(
+    std::string_view in, std::string_view coding, const buffer_type& out, std::size_t max_bytes, bool& exceeded)
+    -> std::optional<buffer_type>
+{
+    if (iequals(coding, "gzip") || iequals(coding, "x-gzip"))
+    {
+        return inflate_data(in, MAX_WBITS + 16, out, max_bytes, exceeded);
+    }
+    if (iequals(coding, "deflate"))
+    {
+        // "deflate" is the zlib format, RFC 9110 section 8.4.1.2, but some servers send raw deflate.
+        if (auto decoded = inflate_data(in, MAX_WBITS, out, max_bytes, exceeded);
+            decoded.has_value() || exceeded)
+        {
+            return decoded;
+        }
+        return inflate_data(in, -MAX_WBITS, out, max_bytes, exceeded);
+    }
+    return std::nullopt;
+}
+
+/**
+ * @param encoding A Content-Encoding value.
+ * @return The codings to undo, last applied first, without any identity codings.
+ */
+auto to_codings(std::string_view encoding) -> std::vector<std::string_view>
+{
+    std::vector<std::string_view> codings{};
+    while (!encoding.empty())
+    {
+        auto comma  = encoding.find(',');
+        auto coding = trim(encoding.substr(0, comma));
+        if (!coding.empty() && !iequals(coding, "identity"))
+        {
+            codings.push_back(coding);
+        }
+        encoding.remove_prefix((comma == std::string_view::npos) ? encoding.size() : comma + 1);
+    }
+    std::reverse(codings.begin(), codings.end());
+    return codings;
+}
+
+/**
+ * @param body The encoded body.
+ * @param codings The codings to undo in order.
+ * @param out An empty buffer the body is decoded into, it carries the allocator to use.
+ * @param max_bytes The most bytes the body, or any intermediate coding of it, may decode to.
+ * @param[out] exceeded Set to true if the body decodes to more than max_bytes.
+ * @return The decoded body, or std::nullopt if a coding isn't supported, the body is corrupt or it decodes
+ *         to more than max_bytes.
+ */
+template<typename buffer_type>
+auto decode_codings(
+    std::string_view                     body,
+    const std::vector<std::string_view>& codings,
+    const buffer_type&                   out,
+    std::size_t                          max_bytes,
+    bool&                                exceeded) -> std::optional<buffer_type>
+{
+    std::optional<buffer_type> decoded{std::nullopt};
+    for (auto coding : codings)
+    {
+        auto next = decode_coding(body, coding, out, max_bytes, exceeded);
+        if (!next.has_value())
+        {
+            return std::nullopt;
+        }
+        decoded = std::move(next);
+        body    = std::string_view{decoded.value().data(), decoded.value().size()};
+    }
+    return decoded;
+}
+
+} // namespace
+
+response::response() = default;
+
+response::response(std::shared_ptr<buffer_pool> pool) : response()
 {
-    m_network_error_message[0] = '\0';
-    m_headers.reserve(header_default_count);
+    m_data         = data_buffer{pool_allocator<char>{std::move(pool)}};
+    m_header_block = data_buffer{m_data.get_allocator()};
 }
 
-auto response::header(std::string_view name) const -> std::optional<std::reference_wrapper<const lift::header>>
+auto response::header(std::string_view name) const -> std::optional<header_view>
 {
-    for (const auto& header : m_headers)
+    auto headers = this->headers();
+
+    auto hash = header_name_hash(name);
+    for (std::size_t probe = 0; probe < header_index_slots; ++probe)
+    {
+        auto slot = m_header_index[(hash + probe) & (header_index_slots - 1)];
+        if (slot == 0)
+        {
+            break;
+        }
+        if (auto h = headers[slot - 1]; iequals(h.name(), name))
+        {
+            return h;
+        }
+    }
+
+    // Responses with more fields than are indexed are rare, the remainder is scanned.
+    for (std::size_t i = header_index_max_count; i < headers.size(); ++i)
     {
-        if (header.name() == name)
+        if (auto h = headers[i]; iequals(h.name(), name))
         {
-            return std::optional{std::cref(header)};
+            return h;
         }
     }
 
     return std::nullopt;
 }
 
+auto response::add_header(std::string_view name, std::string_view value) -> header_view
+{
+    if (m_header_offsets.empty())
+    {
+        reserve_lease(m_header_block, header_default_memory_bytes);
+        m_header_offsets.reserve(header_default_count);
+    }
+
+    header_offsets offsets{};
+    offsets.m_name_offset = static_cast<uint32_t>(m_header_block.size());
+    offsets.m_name_size   = static_cast<uint32_t>(name.size());
+    m_header_block.insert(m_header_block.end(), name.begin(), name.end());
+    m_header_block.push_back(':');
+    m_header_block.push_back(' ');
+    offsets.m_value_offset = static_cast<uint32_t>(m_header_block.size());
+    offsets.m_value_size   = static_cast<uint32_t>(value.size());
+    m_header_block.insert(m_header_block.end(), value.begin(), value.end());
+
+    // The index and known headers are relative to the final hop's first header field.
+    auto index = m_header_offsets.size() - m_final_hop_header;
+    m_header_offsets.push_back(offsets);
+
+    if (index < header_index_max_count)
+    {
+        auto headers = this->headers();
+        auto hash    = header_name_hash(name);
+        for (std::size_t probe = 0; probe < header_index_slots; ++probe)
+        {
+            auto& slot = m_header_index[(hash + probe) & (header_index_slots - 1)];
+            if (slot == 0)
+            {
+                slot = static_cast<uint8_t>(index + 1);
+                break;
+            }
+            // Only the first field with a name is indexed.
+            if (iequals(headers[slot - 1].name(), name))
+            {
+                break;
+            }
+        }
+    }
+
+    if (auto known = to_known_header(name); known.has_value())
+    {
+        auto& field = m_known_headers[static_cast<std::size_t>(known.value())];
+        if (field == 0 && index < std::numeric_limits<uint16_t>::max())
+        {
+            field = static_cast<uint16_t>(index + 1);
+            switch (known.value())
+            {
+                case known_header::content_length:
+                {
+                    uint64_t size{0};
+                    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), size);
+                    if (ec == std::errc{} && end == value.data() + value.size())
+                    {
+                        m_content_length = size;
+                    }
+                }
+                break;
+                case known_header::content_type:
+                    m_content_type = http::to_content_type(value);
+                    break;
+                case known_header::connection:
+                    m_connection = http::to_connection_type(value);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return headers()[index];
+}
+
+auto response::add_header(std::string_view field) -> header_view
+{
+    auto colon = field.find(':');
+    if (colon == std::string_view::npos)
+    {
+        return add_header(field, std::string_view{});
+    }
+    return add_header(field.substr(0, colon), trim(field.substr(colon + 1)));
+}
+
+auto response::add_status_line(std::string_view status_line, bool keep_previous_hops) -> void
+{
+    // Every status line after the first starts the headers of a redirect or of the response after an
+    // interim response, the previous hop's header fields are dropped in place unless they are kept.
+    if (m_status_code != http::status_code::http_unknown)
+    {
+        if (keep_previous_hops)
+        {
+            m_header_hops.push_back(header_hop{m_final_hop_header, m_status_code});
+            m_final_hop_header = static_cast<uint32_t>(m_header_offsets.size());
+            clear_header_index();
+        }
+        else
+        {
+            clear_headers();
+        }
+
+        // A redirect's body is never delivered, don't hold onto a buffer presized for it.
+        if (m_data.empty() && m_data_segments.empty() && m_data.capacity() > 0)
+        {
+            m_data = data_buffer{m_data.get_allocator()};
+        }
+    }
+
+    // "HTTP/1.1 200 OK", HTTP/2 and later have no minor version, e.g. "HTTP/2 200".
+    auto space    = status_line.find(' ');
+    auto protocol = status_line.substr(0, space);
+    if (protocol == "HTTP/1.0")
+    {
+        m_version = http::version::v1_0;
+    }
+    else if (protocol == "HTTP/1.1")
+    {
+        m_version = http::version::v1_1;
+    }
+    else if (protocol == "HTTP/2" || protocol == "HTTP/2.0")
+    {
+        m_version = http::version::v2_0;
+    }
+
+    uint16_t code{0};
+    auto     rest = (space == std::string_view::npos) ? std::string_view{} : status_line.substr(space + 1);
+    if (std::from_chars(rest.data(), rest.data() + rest.size(), code).ec == std::errc{})
+    {
+        m_status_code = http::to_enum(code);
+    }
+}
+
+auto response::hop_headers(std::size_t hop) const -> header_range
+{
+    auto first = static_cast<std::size_t>(m_final_hop_header);
+    auto last  = m_header_offsets.size();
+    if (hop < m_header_hops.size())
+    {
+        first = m_header_hops[hop].m_first_header;
+        last  = (hop + 1 < m_header_hops.size()) ? m_header_hops[hop + 1].m_first_header : m_final_hop_header;
+    }
+
+    return header_range{
+        std::string_view{m_header_block.data(), m_header_block.size()}, m_header_offsets.data() + first, last - first};
+}
+
+auto response::hop_status_code(std::size_t hop) const -> http::status_code
+{
+    return (hop < m_header_hops.size()) ? m_header_hops[hop].m_status_code : m_status_code;
+}
+
+auto response::clear_headers() -> void
+{
+    m_header_block.clear();
+    m_header_offsets.clear();
+    m_header_hops.clear();
+    m_final_hop_header = 0;
+    clear_header_index();
+}
+
+auto response::clear_header_index() -> void
+{
+    m_header_index.fill(0);
+    m_known_headers.fill(0);
+    m_content_length = std::nullopt;
+    m_content_type   = http::content_type::no_content;
+    m_connection     = std::nullopt;
+}
+
+auto response::to_known_header(std::string_view name) -> std::optional<known_header>
+{
+    // A perfect hash, (size * 3 + first * 5 + last) % 8 of the lower case name gives each known header
+    // its own slot so a name is only ever compared with the one candidate in its slot.
+    static constexpr std::array<std::pair<std::string_view, known_header>, 8> names{{
+        {"content-type", known_header::content_type},
+        {"content-length", known_header::content_length},
+        {"cache-control", known_header::cache_control},
+        {"connection", known_header::connection},
+        {"etag", known_header::etag},
+        {"retry-after", known_header::retry_after},
+        {"content-encoding", known_header::content_encoding},
+        {"last-modified", known_header::last_modified},
+    }};
+
+    if (name.empty())
+    {
+        return std::nullopt;
+    }
+
+    auto slot = (name.size() * 3 + to_lower(name.front()) * 5 + to_lower(name.back())) & (names.size() - 1);
+    if (const auto& [candidate, known] = names[slot]; iequals(name, candidate))
+    {
+        return known;
+    }
+    return std::nullopt;
+}
+
+auto response::known_header_field(known_header known) const -> std::optional<header_view>
+{
+    auto field = m_known_headers[static_cast<std::size_t>(known)];
+    if (field == 0)
+    {
+        return std::nullopt;
+    }
+    return headers()[field - 1];
+}
+
+auto response::etag() const -> std::optional<std::string_view>
+{
+    if (auto field = known_header_field(known_header::etag); field.has_value())
+    {
+        return field.value().value();
+    }
+    return std::nullopt;
+}
+
+auto response::last_modified() const -> std::optional<std::string_view>
+{
+    if (auto field = known_header_field(known_header::last_modified); field.has_value())
+    {
+        return field.value().value();
+    }
+    return std::nullopt;
+}
+
+auto response::content_encoding() const -> std::optional<std::string_view>
+{
+    if (auto field = known_header_field(known_header::content_encoding); field.has_value())
+    {
+        return field.value().value();
+    }
+    return std::nullopt;
+}
+
+auto response::cache_control() const -> std::optional<std::string_view>
+{
+    if (auto field = known_header_field(known_header::cache_control); field.has_value())
+    {
+        return field.value().value();
+    }
+    return std::nullopt;
+}
+
+auto response::retry_after() const -> std::optional<std::chrono::milliseconds>
+{
+    auto field = known_header_field(known_header::retry_after);
+    if (!field.has_value())
+    {
+        return std::nullopt;
+    }
+
+    // Either a number of seconds or a date, RFC 9110 section 10.2.3.
+    auto     value = field.value().value();
+    uint64_t seconds{0};
+    if (auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), seconds);
+        ec == std::errc{} && end == value.data() + value.size())
+    {
+        return std::chrono::seconds{static_cast<int64_t>(std::min<uint64_t>(seconds, int64_t{1} << 31))};
+    }
+
+    if (auto date = curl_getdate(std::string{value}.c_str(), nullptr); date != -1)
+    {
+        return std::chrono::seconds{std::max<int64_t>(0, static_cast<int64_t>(date - std::time(nullptr)))};
+    }
+    return std::nullopt;
+}
+
+auto response::data() const -> std::string_view
+{
+    if (m_shared_owner != nullptr)
+    {
+        return m_shared_view;
+    }
+
+    // Only a request that asked for a segmented body can get here with more than one segment.
+    if (m_data.empty() && !m_data_segments.empty())
+    {
+        return std::string_view{m_data_segments.front().data(), m_data_segments.front().size()};
+    }
+    return std::string_view{m_data.data(), m_data.size()};
+}
+
+auto response::data() -> std::string_view
+{
+    flatten();
+    return std::as_const(*this).data();
+}
+
+auto response::decode_data(std::optional<std::size_t> max_bytes) const -> std::optional<std::string>
+{
+    // A segmented payload is joined into the copy rather than flattening this response.
+    std::string joined{};
+    if (m_shared_owner == nullptr && !m_data_segments.empty())
+    {
+        joined.reserve(data_size());
+        for (auto segment : data_segments())
+        {
+            joined.append(segment);
+        }
+    }
+    auto body = joined.empty() ? data() : std::string_view{joined};
+
+    auto encoding = content_encoding();
+    auto codings  = (m_content_encoded && encoding.has_value()) ? to_codings(encoding.value())
+                                                                : std::vector<std::string_view>{};
+    if (codings.empty())
+    {
+        return joined.empty() ? std::string{body} : std::move(joined);
+    }
+    bool exceeded = false;
+    return decode_codings(
+        body, codings, std::string{}, max_bytes.value_or(std::numeric_limits<std::size_t>::max()), exceeded);
+}
+
+auto response::decode_in_place(std::optional<std::size_t> max_bytes) -> CURLcode
+{
+    auto encoding = content_encoding();
+    auto codings  = (m_content_encoded && encoding.has_value()) ? to_codings(encoding.value())
+                                                                : std::vector<std::string_view>{};
+    if (!codings.empty())
+    {
+        bool exceeded = false;
+        auto decoded  = decode_codings(
+            data(),
+            codings,
+            data_buffer{m_data.get_allocator()},
+            max_bytes.value_or(std::numeric_limits<std::size_t>::max()),
+            exceeded);
+        if (!decoded.has_value())
+        {
+            return exceeded ? CURLE_FILESIZE_EXCEEDED : CURLE_BAD_CONTENT_ENCODING;
+        }
+
+        m_data = std::move(decoded.value());
+        m_data_segments.clear();
+        m_shared_owner = nullptr;
+        m_shared_view  = std::string_view{};
+    }
+    m_content_encoded = false;
+    return CURLE_OK;
+}
+
+auto response::digest_hex() const -> std::string
+{
+    return to_hex(m_digest);
+}
+
+auto response::decodable(std::string_view coding) -> bool
+{
+    return iequals(coding, "gzip") || iequals(coding, "x-gzip") || iequals(coding, "deflate") ||
+           iequals(coding, "identity");
+}
+
+auto response::data_segments() const -> std::vector<std::string_view>
+{
+    std::vector<std::string_view> segments{};
+    if (m_shared_owner != nullptr)
+    {
+        segments.emplace_back(m_shared_view);
+        return segments;
+    }
+
+    segments.reserve(m_data_segments.size() + 1);
+    if (!m_data.empty())
+    {
+        segments.emplace_back(m_data.data(), m_data.size());
+    }
+    for (const auto& segment : m_data_segments)
+    {
+        segments.emplace_back(segment.data(), segment.size());
+    }
+    return segments;
+}
+
+auto response::data_size() const -> std::size_t
+{
+    if (m_shared_owner != nullptr)
+    {
+        return m_shared_view.size();
+    }
+
+    auto size = m_data.size();
+    for (const auto& segment : m_data_segments)
+    {
+        size += segment.size();
+    }
+    return size;
+}
+
+auto response::share_data() -> void
+{
+    if (m_shared_owner == nullptr)
+    {
+        flatten();
+        auto shared    = std::make_shared<const data_buffer>(std::move(m_data));
+        m_shared_view  = std::string_view{shared->data(), shared->size()};
+        m_shared_owner = std::move(shared);
+        m_data.clear();
+    }
+}
+
+auto response::reserve_data(uint64_t size) -> void
+{
+    // Only the first body is presized, e.g. a redirect's body is never delivered so nothing was appended.
+    if (m_data.empty() && m_data_segments.empty() && size <= body_presize_max_bytes)
+    {
+        reserve_lease(m_data, static_cast<std::size_t>(size));
+    }
+}
+
+auto response::append_data(std::string_view chunk) -> void
+{
+    auto append = [&chunk](data_buffer& to)
+    {
+        auto n = std::min(to.capacity() - to.size(), chunk.size());
+        to.insert(to.end(), chunk.data(), chunk.data() + n);
+        chunk.remove_prefix(n);
+    };
+
+    append(m_data_segments.empty() ? m_data : m_data_segments.back());
+    if (!chunk.empty())
+    {
+        // The current buffer is full, chain a larger segment rather than reallocating and moving the data.
+        auto previous = m_data_segments.empty() ? m_data.capacity() : m_data_segments.back().capacity();
+        auto capacity = std::clamp<std::size_t>(previous * 2, body_segment_min_bytes, body_segment_max_bytes);
+        reserve_lease(m_data_segments.emplace_back(m_data.get_allocator()), std::max(capacity, chunk.size()));
+        append(m_data_segments.back());
+    }
+}
+
+auto response::clear_data() -> void
+{
+    m_data = data_buffer{m_data.get_allocator()};
+    m_data_segments.clear();
+}
+
+auto response::flatten() -> void
+{
+    if (m_data_segments.empty())
+    {
+        return;
+    }
+
+    if (m_data.empty() && m_data_segments.size() == 1)
+    {
+        m_data = std::move(m_data_segments.front());
+    }
+    else
+    {
+        reserve_lease(m_data, data_size());
+        for (const auto& segment : m_data_segments)
+        {
+            m_data.insert(m_data.end(), segment.begin(), segment.end());
+        }
+    }
+    m_data_segments.clear();
+}
+
 std::string_view response::network_error_message() const
 {
     return std::string_view(
-        m_network_error_message[0] != '\0' ? m_network_error_message : curl_easy_strerror(m_curl_code));
+        !m_network_error_message.empty() ? m_network_error_message.c_str() : curl_easy_strerror(m_curl_code));
 }
 
 auto operator<<(std::ostream& os, const response& r) -> std::ostream&
 {
     os << lift::http::to_string(r.m_version) << ' ' << lift::http::to_string(r.m_status_code) << "\r\n";
-    for (const auto& header : r.m_headers)
+    for (const auto& header : r.headers())
     {
         os << header << "\r\n";
     }
     os << "\r\n";
-    if (!r.m_data.empty())
+    for (auto segment : r.data_segments())
     {
-        os << std::string_view{r.m_data.data(), r.m_data.size()};
+        os << segment;
     }
 
     return os;
@@ -0,0 +1,534 @@
+#include "lift/response_cache.hpp"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+namespace lift
+{
+namespace
+{
+/// The response status codes that are cacheable by default, RFC 9110 section 15.1.
+constexpr std::array<uint16_t, 11> heuristically_cacheable{200, 203, 204, 300, 301, 308, 404, 405, 410, 414, 501};
+
+/// Heuristic freshness is capped at a day so a long unmodified resource isn't served stale for weeks.
+constexpr std::chrono::seconds heuristic_freshness_max{24 * 60 * 60};
+
+/**
+ * The Cache-Control directives a private cache acts upon.
+ */
+struct cache_control
+{
+    bool                                m_no_store{false};
+    bool                                m_no_cache{false};
+    bool                                m_must_revalidate{false};
+    std::optional<std::chrono::seconds> m_max_age{std::nullopt};
+    std::optional<std::chrono::seconds> m_stale_while_revalidate{std::nullopt};
+};
+
+auto iequals(std::string_view a, std::string_view b) -> bool
+{
+    return a.size() == b.size() &&
+           std::equal(
+               a.begin(),
+               a.end(),
+               b.begin(),
+               [](char x, char y)
+               { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+}
+
+auto trim(std::string_view value) -> std::string_view
+{
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+    {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+    {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+auto to_lower(std::string_view value) -> std::string
+{
+    std::string lower{value};
+    std::transform(
+        lower.begin(),
+        lower.end(),
+        lower.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower;
+}
+
+/**
+ * @return The comma joined values of every header with the name, or std::nullopt if there are none.
+ */
+template<typename header_container_type>
+auto find_header(const header_container_type& headers, std::string_view name) -> std::optional<std::string>
+{
+    std::optional<std::string> value{std::nullopt};
+    for (const auto& h : headers)
+    {
+        if (iequals(h.name(), name))
+        {
+            if (value.has_value())
+            {
+                value.value().append(", ");
+                value.value().append(h.value());
+            }
+            else
+            {
+                value = std::string{h.value()};
+            }
+        }
+    }
+    return value;
+}
+
+auto parse_seconds(std::string_view value) -> std::optional<std::chrono::seconds>
+{
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+    {
+        value = value.substr(1, value.size() - 2);
+    }
+    auto is_digit = [](unsigned char c) { return std::isdigit(c) != 0; };
+    if (value.empty() || !std::all_of(value.begin(), value.end(), is_digit))
+    {
+        return std::nullopt;
+    }
+    // Clamp absurdly large values rather than overflowing, RFC 9111 section 1.2.2.
+    if (value.size() > 9)
+    {
+        return std::chrono::seconds{int64_t{1} << 31};
+    }
+    return std::chrono::seconds{std::stoll(std::string{value})};
+}
+
+template<typename header_container_type>
+auto parse_cache_control(const header_container_type& headers) -> cache_control
+{
+    cache_control cc{};
+    auto          value = find_header(headers, "Cache-Control");
+    if (!value.has_value())
+    {
+        return cc;
+    }
+
+    std::string_view directives{value.value()};
+    while (!directives.empty())
+    {
+        auto             comma     = directives.find(',');
+        std::string_view directive = trim(directives.substr(0, comma));
+        directives = (comma == std::string_view::npos) ? std::string_view{} : directives.substr(comma + 1);
+
+        auto             equals = directive.find('=');
+        std::string_view name   = trim(directive.substr(0, equals));
+        std::string_view arg{};
+        if (equals != std::string_view::npos)
+        {
+            arg = trim(directive.substr(equals + 1));
+        }
+
+        if (iequals(name, "no-store"))
+        {
+            cc.m_no_store = true;
+        }
+        else if (iequals(name, "no-cache"))
+        {
+            cc.m_no_cache = true;
+        }
+        else if (iequals(name, "must-revalidate") || iequals(name, "proxy-revalidate"))
+        {
+            cc.m_must_revalidate = true;
+        }
+        else if (iequals(name, "max-age"))
+        {
+            cc.m_max_age = parse_seconds(arg);
+        }
+        else if (iequals(name, "stale-while-revalidate"))
+        {
+            cc.m_stale_while_revalidate = parse_seconds(arg);
+        }
+    }
+    return cc;
+}
+
+auto parse_date(const std::optional<std::string>& value) -> std::optional<cache_entry::time_point>
+{
+    if (!value.has_value())
+    {
+        return std::nullopt;
+    }
+    auto date = curl_getdate(value.value().c_str(), nullptr);
+    if (date == -1)
+    {
+        return std::nullopt;
+    }
+    return std::chrono::system_clock::from_time_t(date);
+}
+
+auto vary_values(const request& request, const std::vector<std::string>& names)
+    -> std::vector<std::pair<std::string, std::string>>
+{
+    std::vector<std::pair<std::string, std::string>> values{};
+    values.reserve(names.size());
+    for (const auto& name : names)
+    {
+        values.emplace_back(name, find_header(request.headers(), name).value_or(std::string{}));
+    }
+    return values;
+}
+
+} // namespace
+
+auto cache_entry::age(time_point now) const -> std::chrono::seconds
+{
+    auto resident = std::chrono::duration_cast<std::chrono::seconds>(now - m_response_time);
+    return m_initial_age + std::max(resident, std::chrono::seconds{0});
+}
+
+auto cache_entry::fresh(time_point now) const -> bool
+{
+    return !m_no_cache && age(now) < m_freshness_lifetime;
+}
+
+auto cache_entry::stale_while_revalidate(time_point now) const -> bool
+{
+    return !m_no_cache && !m_must_revalidate && age(now) < m_freshness_lifetime + m_stale_while_revalidate;
+}
+
+auto cache_entry::matches(const request& request) const -> bool
+{
+    for (const auto& [name, value] : m_vary)
+    {
+        if (find_header(request.headers(), name).value_or(std::string{}) != value)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto cache_entry::size() const -> std::size_t
+{
+    auto bytes = sizeof(cache_entry) + m_response.data().size();
+    for (const auto& h : m_response.headers())
+    {
+        bytes += sizeof(header_offsets) + h.name().size() + h.value().size() + 2;
+    }
+    for (const auto& [name, value] : m_vary)
+    {
+        bytes += name.size() + value.size();
+    }
+    return bytes;
+}
+
+memory_cache::memory_cache(std::size_t max_bytes) : m_max_bytes(max_bytes)
+{
+}
+
+auto memory_cache::find(std::string_view key) -> cache_entry_ptr
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    auto                        iter = m_entries.find(key);
+    if (iter == m_entries.end())
+    {
+        return nullptr;
+    }
+
+    // Most recently used moves to the front.
+    m_lru.splice(m_lru.begin(), m_lru, iter->second);
+    return iter->second->second;
+}
+
+auto memory_cache::store(std::string_view key, cache_entry_ptr entry) -> void
+{
+    auto entry_bytes = entry->size() + key.size();
+
+    std::lock_guard<std::mutex> guard{m_lock};
+    if (auto iter = m_entries.find(key); iter != m_entries.end())
+    {
+        erase_locked(iter);
+    }
+
+    if (entry_bytes > m_max_bytes)
+    {
+        return;
+    }
+
+    while (m_bytes + entry_bytes > m_max_bytes && !m_lru.empty())
+    {
+        erase_locked(m_entries.find(m_lru.back().first));
+        ++m_evictions;
+    }
+
+    m_lru.emplace_front(std::string{key}, std::move(entry));
+    m_entries.emplace(m_lru.front().first, m_lru.begin());
+    m_bytes += entry_bytes;
+}
+
+auto memory_cache::erase(std::string_view key) -> void
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    if (auto iter = m_entries.find(key); iter != m_entries.end())
+    {
+        erase_locked(iter);
+    }
+}
+
+auto memory_cache::size() const -> std::size_t
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    return m_entries.size();
+}
+
+auto memory_cache::bytes() const -> std::size_t
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    return m_bytes;
+}
+
+auto memory_cache::evictions() const -> uint64_t
+{
+    std::lock_guard<std::mutex> guard{m_lock};
+    return m_evictions;
+}
+
+auto memory_cache::erase_locked(std::map<std::string, lru_list::iterator, std::less<>>::iterator iter) -> void
+{
+    m_bytes -= iter->second->second->size() + iter->first.size();
+    m_lru.erase(iter->second);
+    m_entries.erase(iter);
+}
+
+tiered_cache::tiered_cache(std::shared_ptr<response_cache> near, std::shared_ptr<response_cache> far)
+    : m_near(std::move(near)),
+      m_far(std::move(far))
+{
+}
+
+auto tiered_cache::find(std::string_view key) -> cache_entry_ptr
+{
+    auto entry = m_near->find(key);
+    if (entry == nullptr)
+    {
+        entry = m_far->find(key);
+        if (entry != nullptr)
+        {
+            m_near->store(key, entry);
+        }
+    }
+    return entry;
+}
+
+auto tiered_cache::store(std::string_view key, cache_entry_ptr entry) -> void
+{
+    m_near->store(key, entry);
+    m_far->store(key, std::move(entry));
+}
+
+auto tiered_cache::erase(std::string_view key) -> void
+{
+    m_near->erase(key);
+    m_far->erase(key);
+}
+
+auto cache_policy::key(const request& request) -> std::optional<std::string>
+{
+    if (request.method() != http::method::get || !request.data().empty() || !request.mime_fields().empty())
+    {
+        return std::nullopt;
+    }
+
+    // The fragment is never sent to the server so it can't change the response.
+    const auto& url = request.url();
+    return url.substr(0, url.find('#'));
+}
+
+auto cache_policy::bypass(const request& request) -> bool
+{
+    // A body streamed into a sink is never buffered so there is nothing to store or serve it from, a
+    // partially captured response is neither complete enough to store nor what the request asked to be served,
+    // a request with a headers handler expects its handler to see the response's headers arrive, and a
+    // request that doesn't decode its body would store, or be served, a body in the wrong encoding, and a
+    // request with an integrity policy expects the body it verifies to be the one received.
+    return request.body_sink() != nullptr || request.capture().has_value() || request.has_headers_handler() ||
+           !request.content_decoding() || request.integrity().has_value() ||
+           parse_cache_control(request.headers()).m_no_store;
+}
+
+auto cache_policy::fresh(const cache_entry& entry, const request& request, time_point now) -> bool
+{
+    auto cc = parse_cache_control(request.headers());
+    if (cc.m_no_cache)
+    {
+        return false;
+    }
+    if (cc.m_max_age.has_value() && entry.age(now) > cc.m_max_age.value())
+    {
+        return false;
+    }
+    return entry.fresh(now);
+}
+
+auto cache_policy::requires_validation(const request& request) -> bool
+{
+    return parse_cache_control(request.headers()).m_no_cache;
+}
+
+auto cache_policy::add_validators(const cache_entry& entry, request& request) -> void
+{
+    if (entry.m_etag.has_value())
+    {
+        request.header("If-None-Match", entry.m_etag.value());
+    }
+    if (entry.m_last_modified.has_value())
+    {
+        request.header("If-Modified-Since", entry.m_last_modified.value());
+    }
+}
+
+auto cache_policy::make_entry(const request& request, response& response, time_point now) -> cache_entry_ptr
+{
+    if (response.lift_status() != lift_status::success || bypass(request))
+    {
+        return nullptr;
+    }
+
+    auto status = static_cast<uint16_t>(response.status_code());
+    if (std::find(heuristically_cacheable.begin(), heuristically_cacheable.end(), status) ==
+        heuristically_cacheable.end())
+    {
+        return nullptr;
+    }
+
+    auto cc = parse_cache_control(response.headers());
+    if (cc.m_no_store)
+    {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<cache_entry>();
+
+    // A Vary of * means the response depends on something other than the request headers.
+    std::vector<std::string> vary_names{};
+    if (auto vary = find_header(response.headers(), "Vary"); vary.has_value())
+    {
+        std::string_view names{vary.value()};
+        while (!names.empty())
+        {
+            auto comma = names.find(',');
+            auto name  = trim(names.substr(0, comma));
+            names      = (comma == std::string_view::npos) ? std::string_view{} : names.substr(comma + 1);
+            if (name == "*")
+            {
+                return nullptr;
+            }
+            if (!name.empty())
+            {
+                vary_names.emplace_back(to_lower(name));
+            }
+        }
+    }
+    entry->m_vary = vary_values(request, vary_names);
+
+    auto date          = parse_date(find_header(response.headers(), "Date")).value_or(now);
+    auto expires       = find_header(response.headers(), "Expires");
+    auto last_modified = find_header(response.headers(), "Last-Modified");
+
+    entry->m_response_time = now;
+    entry->m_initial_age   = std::max(
+        std::chrono::duration_cast<std::chrono::seconds>(now - date),
+        parse_seconds(trim(find_header(response.headers(), "Age").value_or(std::string{})))
+            .value_or(std::chrono::seconds{0}));
+    entry->m_initial_age = std::max(entry->m_initial_age, std::chrono::seconds{0});
+
+    if (cc.m_max_age.has_value())
+    {
+        entry->m_freshness_lifetime = cc.m_max_age.value();
+    }
+    else if (expires.has_value())
+    {
+        // An invalid Expires, like "0", means already expired.
+        auto expires_at             = parse_date(expires).value_or(date);
+        entry->m_freshness_lifetime = std::max(
+            std::chrono::duration_cast<std::chrono::seconds>(expires_at - date), std::chrono::seconds{0});
+    }
+    else if (auto modified_at = parse_date(last_modified); modified_at.has_value() && modified_at.value() < date)
+    {
+        // Heuristic freshness of 10% of the time since the resource was last modified, RFC 9111 section 4.2.2.
+        entry->m_freshness_lifetime = std::min(
+            std::chrono::duration_cast<std::chrono::seconds>(date - modified_at.value()) / 10,
+            heuristic_freshness_max);
+    }
+
+    entry->m_stale_while_revalidate = cc.m_stale_while_revalidate.value_or(std::chrono::seconds{0});
+    entry->m_no_cache               = cc.m_no_cache;
+    entry->m_must_revalidate        = cc.m_must_revalidate;
+    entry->m_etag                   = response.etag();
+    entry->m_last_modified          = last_modified;
+
+    // Nothing to gain from storing a response that can neither be served nor revalidated.
+    if (entry->m_freshness_lifetime == std::chrono::seconds{0} && entry->m_stale_while_revalidate.count() == 0 &&
+        !entry->has_validator())
+    {
+        return nullptr;
+    }
+
+    // The body is shared rather than copied between the user's response and the stored response.
+    response.share_data();
+    entry->m_response = response;
+
+    return entry;
+}
+
+auto cache_policy::revalidate(
+    const request& request, const cache_entry& entry, const response& not_modified, time_point now)
+    -> std::pair<response, cache_entry_ptr>
+{
+    // The stored response with its headers updated by the 304, RFC 9111 section 3.2.
+    // Content-Length describes the empty 304 body, not the stored body.
+    auto replaced = [&](std::string_view name)
+    { return !iequals(name, "Content-Length") && not_modified.header(name).has_value(); };
+
+    response updated = entry.m_response;
+    updated.clear_headers();
+    for (const auto& h : entry.m_response.headers())
+    {
+        if (!replaced(h.name()))
+        {
+            updated.add_header(h.name(), h.value());
+        }
+    }
+    for (const auto& h : not_modified.headers())
+    {
+        if (!iequals(h.name(), "Content-Length"))
+        {
+            updated.add_header(h.name(), h.value());
+        }
+    }
+
+    updated.m_total_time    = not_modified.m_total_time;
+    updated.m_num_connects  = not_modified.m_num_connects;
+    updated.m_num_redirects = not_modified.m_num_redirects;
+    updated.m_num_attempts  = not_modified.m_num_attempts;
+
+    auto updated_entry = make_entry(request, updated, now);
+    return {std::move(updated), std::move(updated_entry)};
+}
+
+auto cache_policy::serve(const cache_entry& entry) -> response
+{
+    response served = entry.m_response;
+    // Nothing went over the network.
+    served.m_total_time    = 0;
+    served.m_num_connects  = 0;
+    served.m_num_redirects = 0;
+    served.m_num_attempts  = 0;
+    return served;
+}
+
+} // namespace lift
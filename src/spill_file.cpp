@@ -0,0 +1,94 @@
+#include "lift/spill_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+namespace lift
+{
+spill_file::~spill_file()
+{
+    close();
+}
+
+auto spill_file::open(const std::filesystem::path& directory) -> bool
+{
+    close();
+
+    std::error_code ec{};
+    auto            path = directory.empty() ? std::filesystem::temp_directory_path(ec) : directory;
+    if (ec)
+    {
+        return false;
+    }
+
+    m_fd = ::open(path.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (m_fd == -1)
+    {
+        // Not every file system supports O_TMPFILE, create a named file and unlink it straight away.
+        std::string name = (path / "lift_spill_XXXXXX").string();
+        m_fd             = ::mkostemp(name.data(), O_CLOEXEC);
+        if (m_fd == -1)
+        {
+            return false;
+        }
+        ::unlink(name.c_str());
+    }
+    return true;
+}
+
+auto spill_file::append(std::string_view data) -> bool
+{
+    while (!data.empty())
+    {
+        auto written = ::pwrite(m_fd, data.data(), data.size(), static_cast<off_t>(m_size));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+        m_size += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+auto spill_file::map() -> std::shared_ptr<const char>
+{
+    std::shared_ptr<const char> mapping{nullptr};
+    if (m_fd != -1 && m_size > 0)
+    {
+        auto  size = static_cast<std::size_t>(m_size);
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            // The body is read front to back far more often than it is read randomly.
+            ::madvise(addr, size, MADV_SEQUENTIAL);
+            auto unmap = [size](const char* p) { ::munmap(const_cast<char*>(p), size); };
+            mapping    = std::shared_ptr<const char>{static_cast<const char*>(addr), unmap};
+        }
+    }
+
+    // The mapping keeps the unlinked file's blocks alive, the descriptor is no longer needed.
+    close();
+    return mapping;
+}
+
+auto spill_file::close() -> void
+{
+    if (m_fd != -1)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+}
+
+} // namespace lift
@@ -0,0 +1,56 @@
+#include "lift/token_bucket.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lift
+{
+token_bucket::token_bucket(rate_limit limit, time_point now)
+    : m_limit(limit),
+      m_tokens(std::max(1.0, limit.m_burst)),
+      m_last_refill(now)
+{
+    m_limit.m_burst = m_tokens;
+}
+
+auto token_bucket::available(time_point now) -> bool
+{
+    refill(now);
+    return m_tokens >= 1.0;
+}
+
+auto token_bucket::try_acquire(time_point now) -> bool
+{
+    if (!available(now))
+    {
+        return false;
+    }
+    consume();
+    return true;
+}
+
+auto token_bucket::wait_time(time_point now) -> uint64_t
+{
+    refill(now);
+    if (m_tokens >= 1.0)
+    {
+        return 0;
+    }
+    if (m_limit.m_requests_per_second <= 0.0)
+    {
+        return never;
+    }
+    return static_cast<uint64_t>(std::ceil((1.0 - m_tokens) * 1000.0 / m_limit.m_requests_per_second));
+}
+
+auto token_bucket::refill(time_point now) -> void
+{
+    if (now > m_last_refill)
+    {
+        auto elapsed  = static_cast<double>(now - m_last_refill) / 1000.0;
+        m_tokens      = std::min(m_limit.m_burst, m_tokens + elapsed * m_limit.m_requests_per_second);
+        m_last_refill = now;
+    }
+}
+
+} // namespace lift
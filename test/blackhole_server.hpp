@@ -0,0 +1,44 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+
+/**
+ * A listening socket that never accepts or responds, requests to it hang until they time out.
+ */
+class blackhole_server
+{
+public:
+    blackhole_server()
+    {
+        m_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = 0;
+        ::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(m_fd, 16);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        m_port = ntohs(addr.sin_port);
+    }
+    ~blackhole_server() { ::close(m_fd); }
+
+    blackhole_server(const blackhole_server&)                    = delete;
+    blackhole_server(blackhole_server&&)                         = delete;
+    auto operator=(const blackhole_server&) -> blackhole_server& = delete;
+    auto operator=(blackhole_server&&) -> blackhole_server&      = delete;
+
+    auto url() const -> std::string { return "http://127.0.0.1:" + std::to_string(m_port) + "/"; }
+
+private:
+    int      m_fd{-1};
+    uint16_t m_port{0};
+};
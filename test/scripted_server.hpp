@@ -0,0 +1,133 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * A tiny HTTP/1.1 server on the loopback interface that answers every request with whatever its
+ * handler returns, this lets tests control response headers and bodies exactly.  Each connection
+ * serves a single request and is then closed.
+ */
+class scripted_server
+{
+public:
+    /// Given the raw request head (request line and headers) returns the raw response to write.
+    using handler_type = std::function<std::string(const std::string& request_head)>;
+
+    explicit scripted_server(handler_type handler) : m_handler(std::move(handler))
+    {
+        m_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = 0;
+        ::bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(m_fd, 64);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        m_port = ntohs(addr.sin_port);
+
+        m_thread = std::thread{[this] { run(); }};
+    }
+
+    ~scripted_server()
+    {
+        m_stopping = true;
+        m_thread.join();
+        ::close(m_fd);
+    }
+
+    scripted_server(const scripted_server&)                    = delete;
+    scripted_server(scripted_server&&)                         = delete;
+    auto operator=(const scripted_server&) -> scripted_server& = delete;
+    auto operator=(scripted_server&&) -> scripted_server&      = delete;
+
+    auto url(const std::string& path = "/") const -> std::string
+    {
+        return "http://127.0.0.1:" + std::to_string(m_port) + path;
+    }
+
+    /**
+     * @return The number of requests served.
+     */
+    auto requests() const -> uint64_t { return m_requests.load(); }
+
+    /**
+     * Builds a raw response with a Content-Length and Connection: close.
+     * @param status The status line's code and reason, e.g. "200 OK".
+     * @param headers Extra "Name: value\r\n" header lines.
+     * @param body The response body.
+     */
+    static auto response(const std::string& status, const std::string& headers, const std::string& body)
+        -> std::string
+    {
+        return "HTTP/1.1 " + status + "\r\nContent-Length: " + std::to_string(body.size()) +
+               "\r\nConnection: close\r\n" + headers + "\r\n" + body;
+    }
+
+private:
+    int                   m_fd{-1};
+    uint16_t              m_port{0};
+    handler_type          m_handler;
+    std::atomic<bool>     m_stopping{false};
+    std::atomic<uint64_t> m_requests{0};
+    std::thread           m_thread{};
+
+    auto run() -> void
+    {
+        while (!m_stopping)
+        {
+            pollfd pfd{m_fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 10) <= 0)
+            {
+                continue;
+            }
+
+            int client_fd = ::accept(m_fd, nullptr, nullptr);
+            if (client_fd < 0)
+            {
+                continue;
+            }
+
+            std::string head{};
+            char        buffer[4096];
+            while (head.find("\r\n\r\n") == std::string::npos)
+            {
+                auto n = ::recv(client_fd, buffer, sizeof(buffer), 0);
+                if (n <= 0)
+                {
+                    break;
+                }
+                head.append(buffer, static_cast<std::size_t>(n));
+            }
+
+            // Counted before responding so the client never sees a response before its request is counted.
+            ++m_requests;
+
+            auto        raw     = m_handler(head);
+            std::size_t written = 0;
+            while (written < raw.size())
+            {
+                auto n = ::send(client_fd, raw.data() + written, raw.size() - written, MSG_NOSIGNAL);
+                if (n <= 0)
+                {
+                    break;
+                }
+                written += static_cast<std::size_t>(n);
+            }
+
+            ::close(client_fd);
+        }
+    }
+};
@@ -0,0 +1,176 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <atomic>
+
+namespace
+{
+/// Records every chunk written and how the sink was finished.
+class recording_sink final : public lift::body_sink
+{
+public:
+    explicit recording_sink(std::size_t abort_after = 0) : m_abort_after(abort_after) {}
+
+    auto write(const lift::request&, std::string_view chunk) -> bool override
+    {
+        m_body.append(chunk);
+        return m_abort_after == 0 || m_body.size() < m_abort_after;
+    }
+
+    auto finish(const lift::request&, const lift::response& resp) -> void override
+    {
+        ++m_finished;
+        m_status = resp.lift_status();
+    }
+
+    std::size_t       m_abort_after{0};
+    std::string       m_body{};
+    std::atomic<int>  m_finished{0};
+    lift::lift_status m_status{lift::lift_status::building};
+};
+
+auto make_server(std::string body) -> std::unique_ptr<scripted_server>
+{
+    return std::make_unique<scripted_server>([body = std::move(body)](const std::string&)
+                                             { return scripted_server::response("200 OK", "", body); });
+}
+
+} // namespace
+
+TEST_CASE("ndjson_decoder decodes lines split across chunks")
+{
+    const std::string body{"{\"a\":1}\n\n{\"b\":2}\r\n{\"c\":3}\n"};
+    lift::request     request{"http://localhost/"};
+
+    // Every possible split point between two chunks.
+    for (std::size_t split = 0; split <= body.size(); ++split)
+    {
+        std::vector<std::string> lines{};
+        lift::ndjson_decoder     decoder{[&](std::string_view line)
+                                     {
+                                         lines.emplace_back(line);
+                                         return true;
+                                     }};
+
+        REQUIRE(decoder.write(request, std::string_view{body}.substr(0, split)));
+        REQUIRE(decoder.write(request, std::string_view{body}.substr(split)));
+        REQUIRE(lines == std::vector<std::string>{"{\"a\":1}", "{\"b\":2}", "{\"c\":3}"});
+        REQUIRE(decoder.records() == 3);
+    }
+
+    lift::ndjson_decoder limited{[](std::string_view) { return true; }, 4};
+    REQUIRE(limited.write(request, "1234\n"));
+    REQUIRE_FALSE(limited.write(request, "12345"));
+}
+
+TEST_CASE("length_prefixed_decoder decodes records split across chunks")
+{
+    std::string body{};
+    for (const std::string record : {"one", "", "three"})
+    {
+        body.push_back('\0');
+        body.push_back(static_cast<char>(record.size()));
+        body.append(record);
+    }
+    lift::request request{"http://localhost/"};
+
+    for (std::size_t split = 0; split <= body.size(); ++split)
+    {
+        std::vector<std::string>      records{};
+        lift::length_prefixed_decoder decoder{
+            [&](std::string_view record)
+            {
+                records.emplace_back(record);
+                return true;
+            },
+            2};
+
+        REQUIRE(decoder.write(request, std::string_view{body}.substr(0, split)));
+        REQUIRE(decoder.write(request, std::string_view{body}.substr(split)));
+        decoder.finish(request, lift::response{});
+        REQUIRE(records == std::vector<std::string>{"one", "", "three"});
+        REQUIRE_FALSE(decoder.truncated());
+    }
+
+    lift::length_prefixed_decoder truncated{[](std::string_view) { return true; }, 1};
+    REQUIRE(truncated.write(request, std::string_view{"\x05" "abc"}));
+    truncated.finish(request, lift::response{});
+    REQUIRE(truncated.truncated());
+
+    REQUIRE_THROWS_AS(lift::length_prefixed_decoder([](std::string_view) { return true; }, 3), std::invalid_argument);
+}
+
+TEST_CASE("Body sink streams the response body instead of buffering it")
+{
+    std::string body{};
+    for (int i = 0; i < 10000; ++i)
+    {
+        body.append("{\"record\":" + std::to_string(i) + "}\n");
+    }
+    body.append("{\"last\":true}");
+    auto server = make_server(body);
+
+    lift::client client{};
+
+    uint64_t records = 0;
+    auto     decoder = std::make_shared<lift::ndjson_decoder>(
+        [&](std::string_view)
+        {
+            ++records;
+            return true;
+        });
+    auto request = std::make_unique<lift::request>(server->url(), std::chrono::seconds{5});
+    request->body_sink(decoder);
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+    REQUIRE(response.data().empty());
+    REQUIRE(response.header("Content-Length").has_value());
+    // The unterminated final line is delivered once the transfer succeeds.
+    REQUIRE(records == 10001);
+
+    // The body can be buffered as well.
+    auto sink = std::make_shared<recording_sink>();
+    request   = std::make_unique<lift::request>(server->url(), std::chrono::seconds{5});
+    request->body_sink(sink, true);
+    auto [req2, buffered] = client.start_request(std::move(request)).get();
+    REQUIRE(buffered.data() == body);
+    REQUIRE(sink->m_body == body);
+    REQUIRE(sink->m_finished == 1);
+    REQUIRE(sink->m_status == lift::lift_status::success);
+}
+
+TEST_CASE("Body sink can abort the transfer")
+{
+    auto server = make_server(std::string(64 * 1024, 'x'));
+    auto sink   = std::make_shared<recording_sink>(1);
+
+    lift::client client{};
+    auto         request = std::make_unique<lift::request>(server->url(), std::chrono::seconds{5});
+    request->body_sink(sink);
+    request->retry(lift::retry_policy{});
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::download_error);
+    // Nothing already written to the sink is written twice by a retry.
+    REQUIRE(response.num_attempts() == 1);
+    REQUIRE(sink->m_finished == 1);
+    REQUIRE(sink->m_status == lift::lift_status::download_error);
+}
+
+TEST_CASE("Body sink with a synchronous request")
+{
+    auto server = make_server("synchronous");
+    auto sink   = std::make_shared<recording_sink>();
+
+    lift::request request{server->url(), std::chrono::seconds{5}};
+    request.body_sink(sink);
+    auto response = request.perform();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.data().empty());
+    REQUIRE(sink->m_body == "synchronous");
+    REQUIRE(sink->m_finished == 1);
+}
@@ -0,0 +1,70 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+TEST_CASE("buffer_pool recycles buffers by size class")
+{
+    lift::buffer_pool pool{lift::buffer_pool_options{4096, 64 * 1024, 64 * 1024, false}};
+
+    auto* a = pool.allocate(5000);
+    REQUIRE(pool.misses() == 1);
+    pool.deallocate(a, 5000);
+    REQUIRE(pool.idle_bytes() == 8192);
+
+    // Any size in the same class re-uses the idle buffer.
+    auto* b = pool.allocate(8000);
+    REQUIRE(b == a);
+    REQUIRE(pool.hits() == 1);
+    REQUIRE(pool.idle_bytes() == 0);
+    pool.deallocate(b, 8000);
+
+    // Leases are the size of their size class.
+    REQUIRE(pool.lease_bytes(5000) == 8192);
+    REQUIRE(pool.lease_bytes(4096) == 4096);
+    REQUIRE(pool.lease_bytes(100) == 100);
+    REQUIRE(pool.lease_bytes(128 * 1024) == 128 * 1024);
+
+    // Sizes outside of the size classes aren't pooled.
+    auto* small = pool.allocate(100);
+    auto* large = pool.allocate(128 * 1024);
+    pool.deallocate(small, 100);
+    pool.deallocate(large, 128 * 1024);
+    REQUIRE(pool.idle_bytes() == 8192);
+    REQUIRE(pool.misses() == 1);
+
+    // Idle buffers beyond the cap are freed.
+    std::vector<void*> buffers{};
+    for (int i = 0; i < 3; ++i)
+    {
+        buffers.push_back(pool.allocate(64 * 1024));
+    }
+    for (auto* buffer : buffers)
+    {
+        pool.deallocate(buffer, 64 * 1024);
+    }
+    REQUIRE(pool.idle_bytes() <= 64 * 1024);
+}
+
+TEST_CASE("buffer_pool recycles response bodies")
+{
+    std::string     body(100 * 1024, 'x');
+    scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", "", body); }};
+
+    auto                  pool = std::make_shared<lift::buffer_pool>();
+    lift::client::options options{};
+    options.buffer_pool = pool;
+    lift::client client{std::move(options)};
+
+    for (int i = 0; i < 10; ++i)
+    {
+        auto [req, response] =
+            client.start_request(std::make_unique<lift::request>(server.url(), std::chrono::seconds{5})).get();
+        REQUIRE(response.data() == body);
+    }
+
+    // The body's and header block's buffers are returned when each response is dropped and re-used by the next request.
+    REQUIRE(pool->misses() == 2);
+    REQUIRE(pool->hits() == 18);
+    REQUIRE(pool->idle_bytes() == 128 * 1024 + lift::header_default_memory_bytes);
+}
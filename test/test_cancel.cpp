@@ -0,0 +1,181 @@
+#include "blackhole_server.hpp"
+#include "catch_amalgamated.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+TEST_CASE("Cancel a hung request with its token")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{};
+
+    std::atomic<bool>              completed{false};
+    std::atomic<lift::lift_status> status{lift::lift_status::building};
+
+    auto request = std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{10});
+    auto token   = client.start_request(
+        std::move(request),
+        [&](lift::request_ptr, lift::response response)
+        {
+            status.store(response.lift_status());
+            completed.store(true);
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    REQUIRE_FALSE(completed.load());
+
+    token.cancel();
+
+    while (!client.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    REQUIRE(completed.load());
+    REQUIRE(status.load() == lift::lift_status::cancelled);
+    REQUIRE(client.requests_cancelled() == 1);
+}
+
+TEST_CASE("Cancel a hung request with its future")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{};
+
+    auto request    = std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{10});
+    auto request_id = request->id();
+    auto future     = client.start_request(std::move(request));
+
+    client.cancel_request(request_id);
+
+    auto [req, response] = future.get();
+    REQUIRE(req->id() == request_id);
+    REQUIRE(response.lift_status() == lift::lift_status::cancelled);
+}
+
+TEST_CASE("Cancel a hung request with its future's token")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{};
+
+    auto request         = std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{10});
+    auto [future, token] = client.start_cancellable_request(std::move(request));
+
+    token.cancel();
+
+    auto [req, response] = future.get();
+    REQUIRE(req->id() == token.request_id());
+    REQUIRE(response.lift_status() == lift::lift_status::cancelled);
+}
+
+TEST_CASE("Cancel a request waiting in its host's queue")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{lift::client::options{.global_rate_limit = lift::rate_limit{.m_requests_per_second = 0.1}}};
+
+    auto running = client.start_request(std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{1}));
+    auto [queued, token] =
+        client.start_cancellable_request(std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{10}));
+
+    while (client.requests_rate_limited() == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    token.cancel();
+
+    auto [req, response] = queued.get();
+    REQUIRE(response.lift_status() == lift::lift_status::cancelled);
+    // The request never started a transfer.
+    REQUIRE(response.status_code() == lift::http::status_code::http_unknown);
+    REQUIRE(response.num_attempts() == 0);
+    REQUIRE(client.requests_cancelled() == 1);
+
+    REQUIRE(running.get().second.lift_status() == lift::lift_status::timeout);
+}
+
+TEST_CASE("Cancel requests in bulk by tag")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{};
+
+    std::vector<lift::request::async_future_type> cancelled{};
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+        auto request = std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{10});
+        request->tag("batch");
+        cancelled.emplace_back(client.start_request(std::move(request)));
+    }
+
+    auto untagged = client.start_request(std::make_unique<lift::request>(
+        "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{10}));
+
+    client.cancel_requests("batch");
+
+    for (auto& future : cancelled)
+    {
+        auto [req, response] = future.get();
+        REQUIRE(req->tag().value() == "batch");
+        REQUIRE(response.lift_status() == lift::lift_status::cancelled);
+    }
+
+    auto [req, response] = untagged.get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(client.requests_cancelled() == 10);
+}
+
+TEST_CASE("Cancel a request waiting on its retry backoff")
+{
+    lift::client client{lift::client::options{.retry_budget_percent = 1000.0}};
+
+    // The timeout outlasts the backoff, otherwise the request wouldn't be retried.
+    auto request = std::make_unique<lift::request>(
+        "http://" + nginx_hostname + ":" + nginx_port_str + "/not/here", std::chrono::seconds{30});
+    lift::retry_policy policy{};
+    policy.m_max_attempts          = 3;
+    policy.m_retry_on_status_codes = {lift::http::status_code::http_404_not_found};
+    policy.m_base_backoff          = std::chrono::seconds{10};
+    policy.m_max_backoff           = std::chrono::seconds{10};
+    policy.m_jitter                = false;
+    request->retry(std::move(policy));
+
+    auto request_id = request->id();
+    auto future     = client.start_request(std::move(request));
+
+    while (client.retries_issued() == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    client.cancel_request(request_id);
+
+    auto [req, response] = future.get();
+    REQUIRE(response.lift_status() == lift::lift_status::cancelled);
+    REQUIRE(response.num_attempts() == 2);
+}
+
+TEST_CASE("Cancel a completed request does nothing")
+{
+    lift::client client{};
+
+    auto request    = std::make_unique<lift::request>("http://" + nginx_hostname + ":" + nginx_port_str + "/");
+    auto request_id = request->id();
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+
+    client.cancel_request(request_id);
+
+    while (!client.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    REQUIRE(client.requests_cancelled() == 0);
+}
@@ -0,0 +1,83 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+namespace
+{
+auto make_server(std::string body) -> std::unique_ptr<scripted_server>
+{
+    return std::make_unique<scripted_server>(
+        [body = std::move(body)](const std::string&)
+        { return scripted_server::response("200 OK", "ETag: \"v1\"\r\nX-Other: other\r\n", body); });
+}
+
+} // namespace
+
+TEST_CASE("Capture policy status only")
+{
+    auto server = make_server(std::string(64 * 1024, 'x'));
+
+    lift::request request{server->url(), std::chrono::seconds{5}};
+    request.capture(lift::capture_policy{lift::header_capture::none, {}, 0});
+    auto response = request.perform();
+
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+    REQUIRE(response.headers().empty());
+    REQUIRE(response.data().empty());
+    REQUIRE(response.body_truncated());
+    // The transfer stats still account for everything received.
+    REQUIRE(response.download_size() == 64 * 1024);
+}
+
+TEST_CASE("Capture policy header allowlist")
+{
+    auto server = make_server("body");
+
+    lift::request request{server->url(), std::chrono::seconds{5}};
+    request.capture(lift::capture_policy{lift::header_capture::allowlist, {"etag", "Content-Length"}});
+    auto response = request.perform();
+
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.headers().size() == 2);
+    REQUIRE(response.etag() == std::optional<std::string_view>{"\"v1\""});
+    REQUIRE(response.content_length() == std::optional<uint64_t>{4});
+    REQUIRE_FALSE(response.header("X-Other").has_value());
+    REQUIRE(response.data() == "body");
+    REQUIRE_FALSE(response.body_truncated());
+}
+
+TEST_CASE("Capture policy truncates the body")
+{
+    auto server = make_server(std::string(100 * 1024, 'x'));
+
+    lift::client client{};
+    auto         request = std::make_unique<lift::request>(server->url(), std::chrono::seconds{5});
+    request->capture(lift::capture_policy{lift::header_capture::all, {}, 1000});
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.data() == std::string(1000, 'x'));
+    REQUIRE(response.body_truncated());
+    REQUIRE(response.download_size() == 100 * 1024);
+    REQUIRE(response.header("ETag").has_value());
+}
+
+TEST_CASE("Capture policy aborts an oversized body")
+{
+    auto server = make_server(std::string(100 * 1024, 'x'));
+
+    lift::client client{};
+    auto         request = std::make_unique<lift::request>(server->url(), std::chrono::seconds{5});
+    request->capture(lift::capture_policy{lift::header_capture::all, {}, 1000, lift::body_overflow::abort});
+    request->retry(lift::retry_policy{});
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::download_error);
+    REQUIRE(response.body_truncated());
+    REQUIRE(response.data().size() <= 1000);
+    // An oversized body would be oversized again, it isn't retried.
+    REQUIRE(response.num_attempts() == 1);
+    REQUIRE(server->requests() == 1);
+}
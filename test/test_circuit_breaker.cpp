@@ -0,0 +1,145 @@
+#include "catch_amalgamated.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <mutex>
+#include <vector>
+
+static auto make_circuit_breaker_policy() -> lift::circuit_breaker_policy
+{
+    lift::circuit_breaker_policy policy{};
+    policy.m_window_size                 = 4;
+    policy.m_min_requests                = 2;
+    policy.m_failure_rate_threshold      = 0.5;
+    policy.m_open_duration               = std::chrono::milliseconds{1000};
+    policy.m_half_open_max_probes        = 1;
+    policy.m_half_open_probe_interval    = std::chrono::milliseconds{100};
+    policy.m_half_open_success_threshold = 2;
+    return policy;
+}
+
+TEST_CASE("circuit_breaker opens on failure rate")
+{
+    lift::circuit_breaker breaker{make_circuit_breaker_policy()};
+
+    REQUIRE(breaker.allow(1));
+    breaker.record(1, true);
+    // Not enough samples yet to open.
+    REQUIRE(breaker.state() == lift::circuit_breaker_state::closed);
+
+    REQUIRE(breaker.allow(2));
+    breaker.record(2, false);
+    REQUIRE(breaker.state() == lift::circuit_breaker_state::open);
+
+    REQUIRE_FALSE(breaker.allow(3));
+    REQUIRE_FALSE(breaker.allow(1000));
+}
+
+TEST_CASE("circuit_breaker stays closed below the failure rate")
+{
+    lift::circuit_breaker breaker{make_circuit_breaker_policy()};
+
+    for (uint64_t now = 1; now <= 100; ++now)
+    {
+        REQUIRE(breaker.allow(now));
+        // One in four failures is below the 50% threshold.
+        breaker.record(now, now % 4 == 0);
+    }
+    REQUIRE(breaker.state() == lift::circuit_breaker_state::closed);
+}
+
+TEST_CASE("circuit_breaker half open probes are rate limited")
+{
+    lift::circuit_breaker breaker{make_circuit_breaker_policy()};
+
+    breaker.record(1, true);
+    breaker.record(1, true);
+    REQUIRE(breaker.state() == lift::circuit_breaker_state::open);
+
+    // The open duration has elapsed, a single probe is let through.
+    REQUIRE(breaker.allow(1001));
+    REQUIRE(breaker.state() == lift::circuit_breaker_state::half_open);
+    REQUIRE_FALSE(breaker.allow(1001));
+
+    breaker.record(1050, false);
+    REQUIRE(breaker.state() == lift::circuit_breaker_state::half_open);
+    // The probe completed but the next is not allowed until the probe interval elapses.
+    REQUIRE_FALSE(breaker.allow(1050));
+    REQUIRE(breaker.allow(1101));
+    breaker.record(1102, false);
+    REQUIRE(breaker.state() == lift::circuit_breaker_state::closed);
+}
+
+TEST_CASE("circuit_breaker half open probe failure re-opens")
+{
+    lift::circuit_breaker breaker{make_circuit_breaker_policy()};
+
+    breaker.record(1, true);
+    breaker.record(1, true);
+    REQUIRE(breaker.allow(1001));
+    breaker.record(1002, true);
+    REQUIRE(breaker.state() == lift::circuit_breaker_state::open);
+    REQUIRE_FALSE(breaker.allow(1500));
+    REQUIRE(breaker.allow(2002));
+}
+
+TEST_CASE("circuit_breaker abandoned probe frees its slot")
+{
+    lift::circuit_breaker breaker{make_circuit_breaker_policy()};
+
+    breaker.record(1, true);
+    breaker.record(1, true);
+    REQUIRE(breaker.allow(1001));
+    breaker.abandon();
+    REQUIRE(breaker.allow(1101));
+}
+
+TEST_CASE("Client circuit breaker fails fast once open")
+{
+    using event_type = std::pair<lift::circuit_breaker_state, lift::circuit_breaker_state>;
+    std::mutex               events_lock{};
+    std::vector<event_type>  events{};
+    std::vector<std::string> hosts{};
+
+    lift::client::options options{};
+    options.circuit_breaker                         = make_circuit_breaker_policy();
+    options.circuit_breaker.value().m_open_duration = std::chrono::seconds{60};
+    options.on_circuit_breaker_callback =
+        [&](std::string_view host, lift::circuit_breaker_state from, lift::circuit_breaker_state to)
+    {
+        std::lock_guard<std::mutex> guard{events_lock};
+        hosts.emplace_back(host);
+        events.emplace_back(from, to);
+    };
+    lift::client client{std::move(options)};
+
+    // Nothing should be listening on port 1, each attempt is a connect error.
+    for (std::size_t i = 0; i < 2; ++i)
+    {
+        auto [req, response] =
+            client.start_request(std::make_unique<lift::request>("http://127.0.0.1:1/", std::chrono::seconds{1})).get();
+        REQUIRE(response.lift_status() == lift::lift_status::connect_error);
+    }
+
+    REQUIRE(client.host_circuit_breaker_state("127.0.0.1:1") == lift::circuit_breaker_state::open);
+    REQUIRE(client.circuit_breaker_opens() == 1);
+
+    auto [req, response] =
+        client.start_request(std::make_unique<lift::request>("http://127.0.0.1:1/", std::chrono::seconds{1})).get();
+    REQUIRE(response.lift_status() == lift::lift_status::circuit_open);
+    REQUIRE(client.circuit_breaker_rejections() == 1);
+
+    // Other hosts are unaffected.
+    auto nginx_host = nginx_hostname + ":" + nginx_port_str;
+    auto [ok_req, ok_response] =
+        client.start_request(std::make_unique<lift::request>("http://" + nginx_host + "/", std::chrono::seconds{1}))
+            .get();
+    REQUIRE(ok_response.lift_status() == lift::lift_status::success);
+    REQUIRE(client.host_circuit_breaker_state(nginx_host) == lift::circuit_breaker_state::closed);
+
+    std::lock_guard<std::mutex> guard{events_lock};
+    REQUIRE(events.size() == 1);
+    REQUIRE(hosts[0] == "127.0.0.1:1");
+    REQUIRE(events[0].first == lift::circuit_breaker_state::closed);
+    REQUIRE(events[0].second == lift::circuit_breaker_state::open);
+}
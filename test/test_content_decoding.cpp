@@ -0,0 +1,178 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include "test_helpers.hpp"
+#include <lift/lift.hpp>
+
+#include <zlib.h>
+
+namespace
+{
+/**
+ * @param window_bits 31 for gzip, 15 for zlib or -15 for raw deflate.
+ */
+auto compress(const std::string& in, int window_bits) -> std::string
+{
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, static_cast<uLong>(in.size())), '\0');
+    stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.avail_in  = static_cast<uInt>(in.size());
+    stream.next_out  = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+auto encoded_response(const std::string& encoding, const std::string& body) -> std::string
+{
+    return scripted_server::response("200 OK", "Content-Encoding: " + encoding + "\r\n", body);
+}
+
+} // namespace
+
+TEST_CASE("Content decoding disabled delivers the encoded body")
+{
+    auto            body    = make_body(256 * 1024);
+    auto            encoded = compress(body, MAX_WBITS + 16);
+    std::string     head{};
+    scripted_server server{[&](const std::string& request_head)
+                           {
+                               head = request_head;
+                               return encoded_response("gzip", encoded);
+                           }};
+
+    lift::request request{server.url(), std::chrono::seconds{5}};
+    request.accept_encoding(std::vector<std::string>{"gzip"});
+    REQUIRE(request.content_decoding());
+    request.content_decoding(false);
+
+    auto response = request.perform();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.content_encoding() == "gzip");
+    REQUIRE(response.content_encoded());
+    REQUIRE(response.data() == encoded);
+    REQUIRE(response.decode_data() == body);
+
+    // curl still asks for the encoding, it just doesn't decode it.
+    REQUIRE(head.find("Accept-Encoding: gzip") != std::string::npos);
+}
+
+TEST_CASE("Content decoding enabled delivers the decoded body")
+{
+    auto            body    = make_body(256 * 1024);
+    auto            encoded = compress(body, MAX_WBITS + 16);
+    scripted_server server{[&](const std::string&) { return encoded_response("gzip", encoded); }};
+
+    lift::client client{};
+    auto         request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+    request->accept_encoding(std::vector<std::string>{"gzip"});
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.content_encoding() == "gzip");
+    REQUIRE_FALSE(response.content_encoded());
+    REQUIRE(response.data() == body);
+    REQUIRE(response.decode_data() == body);
+}
+
+TEST_CASE("Encoded bodies are decoded on demand")
+{
+    auto body = make_body(64 * 1024);
+
+    struct encoding
+    {
+        std::string m_name;
+        std::string m_encoded;
+    };
+
+    std::vector<encoding> encodings{
+        {"gzip", compress(body, MAX_WBITS + 16)},
+        {"x-gzip", compress(body, MAX_WBITS + 16)},
+        {"deflate", compress(body, MAX_WBITS)},
+        {"deflate", compress(body, -MAX_WBITS)},
+        {"gzip, identity", compress(body, MAX_WBITS + 16)},
+        {"deflate, gzip", compress(compress(body, MAX_WBITS), MAX_WBITS + 16)},
+    };
+
+    for (const auto& [name, encoded] : encodings)
+    {
+        scripted_server server{[&](const std::string&) { return encoded_response(name, encoded); }};
+
+        // Without an Accept-Encoding curl doesn't decode a body the server encoded anyway.
+        lift::request request{server.url(), std::chrono::seconds{5}};
+        auto          response = request.perform();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.content_encoded());
+        REQUIRE(response.data() == encoded);
+        REQUIRE(response.decode_data() == body);
+    }
+}
+
+TEST_CASE("Encoded bodies that can't be decoded")
+{
+    auto body    = make_body(64 * 1024);
+    auto encoded = compress(body, MAX_WBITS + 16);
+
+    SECTION("Unsupported encoding")
+    {
+        scripted_server server{[&](const std::string&) { return encoded_response("br", encoded); }};
+
+        lift::request request{server.url(), std::chrono::seconds{5}};
+        request.content_decoding(false);
+        auto response = request.perform();
+        REQUIRE(response.content_encoded());
+        REQUIRE_FALSE(response.decode_data().has_value());
+    }
+
+    SECTION("Truncated body")
+    {
+        auto            truncated = encoded.substr(0, encoded.size() / 2);
+        scripted_server server{[&](const std::string&) { return encoded_response("gzip", truncated); }};
+
+        lift::request request{server.url(), std::chrono::seconds{5}};
+        request.content_decoding(false);
+        auto response = request.perform();
+        REQUIRE(response.data() == truncated);
+        REQUIRE_FALSE(response.decode_data().has_value());
+    }
+
+    SECTION("Body larger than the decode limit")
+    {
+        scripted_server server{[&](const std::string&) { return encoded_response("gzip", encoded); }};
+
+        lift::request request{server.url(), std::chrono::seconds{5}};
+        request.content_decoding(false);
+        auto response = request.perform();
+        REQUIRE_FALSE(response.decode_data(body.size() - 1).has_value());
+        REQUIRE(response.decode_data(body.size()) == body);
+    }
+}
+
+TEST_CASE("Requests without content decoding are not coalesced")
+{
+    auto            body    = make_body(1024);
+    auto            encoded = compress(body, MAX_WBITS + 16);
+    scripted_server server{[&](const std::string&) { return encoded_response("gzip", encoded); }};
+
+    lift::client::options options{};
+    options.single_flight_headers = std::vector<std::string>{};
+    lift::client client{std::move(options)};
+
+    std::vector<lift::request::async_future_type> futures{};
+    for (int i = 0; i < 4; ++i)
+    {
+        auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        request->content_decoding(false);
+        futures.push_back(client.start_request(std::move(request)));
+    }
+    for (auto& future : futures)
+    {
+        auto [req, response] = future.get();
+        REQUIRE(response.data() == encoded);
+    }
+    REQUIRE(client.requests_coalesced() == 0);
+    REQUIRE(server.requests() == 4);
+}
@@ -0,0 +1,162 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include "test_helpers.hpp"
+#include <lift/lift.hpp>
+
+#include <zlib.h>
+
+namespace
+{
+auto gzip(const std::string& in) -> std::string
+{
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, static_cast<uLong>(in.size())), '\0');
+    stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    stream.avail_in  = static_cast<uInt>(in.size());
+    stream.next_out  = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+auto gzip_response(const std::string& encoded) -> std::string
+{
+    return scripted_server::response("200 OK", "Content-Encoding: gzip\r\n", encoded);
+}
+
+auto decode_client(std::shared_ptr<lift::decode_pool> pool) -> std::unique_ptr<lift::client>
+{
+    lift::client::options options{};
+    options.decode_pool = std::move(pool);
+    return std::make_unique<lift::client>(std::move(options));
+}
+
+} // namespace
+
+TEST_CASE("decode_pool runs every submitted job")
+{
+    std::atomic<uint64_t> ran{0};
+    {
+        lift::decode_pool pool{lift::decode_pool_options{4}};
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.submit([&ran]() { ran.fetch_add(1); });
+        }
+    }
+    REQUIRE(ran.load() == 100);
+
+    // At least one worker is always started.
+    {
+        lift::decode_pool pool{lift::decode_pool_options{0}};
+        REQUIRE(pool.options().m_threads == 1);
+        pool.submit([&ran]() { ran.fetch_add(1); });
+        REQUIRE(pool.jobs_submitted() == 1);
+    }
+    REQUIRE(ran.load() == 101);
+}
+
+TEST_CASE("Large encoded responses are decoded on the decode pool")
+{
+    auto            body    = make_body(2 * 1024 * 1024);
+    auto            encoded = gzip(body);
+    std::string     head{};
+    scripted_server server{[&](const std::string& request_head)
+                           {
+                               head = request_head;
+                               return gzip_response(encoded);
+                           }};
+
+    auto pool   = std::make_shared<lift::decode_pool>(lift::decode_pool_options{2, 1024});
+    auto client = decode_client(pool);
+
+    auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+    request->accept_encoding_all_available();
+
+    std::promise<lift::response> delivered{};
+    client->start_request(
+        std::move(request),
+        [&delivered](lift::request_ptr, lift::response response) { delivered.set_value(std::move(response)); });
+    auto response = delivered.get_future().get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.content_encoding() == "gzip");
+    REQUIRE_FALSE(response.content_encoded());
+    REQUIRE(response.data() == body);
+    REQUIRE(pool->jobs_submitted() == 1);
+
+    // Only the encodings the pool can decode are asked for.
+    REQUIRE(head.find("Accept-Encoding: gzip, deflate\r\n") != std::string::npos);
+}
+
+TEST_CASE("Small encoded responses are decoded on the event loop")
+{
+    auto            body    = make_body(16 * 1024);
+    auto            encoded = gzip(body);
+    scripted_server server{[&](const std::string&) { return gzip_response(encoded); }};
+
+    auto pool   = std::make_shared<lift::decode_pool>(lift::decode_pool_options{1, 64 * 1024});
+    auto client = decode_client(pool);
+
+    auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+    request->accept_encoding(std::vector<std::string>{"gzip"});
+    auto [req, response] = client->start_request(std::move(request)).get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE_FALSE(response.content_encoded());
+    REQUIRE(response.data() == body);
+    REQUIRE(pool->jobs_submitted() == 0);
+}
+
+TEST_CASE("Encoded responses the decode pool can't decode")
+{
+    auto body    = make_body(256 * 1024);
+    auto encoded = gzip(body);
+    auto pool    = std::make_shared<lift::decode_pool>(lift::decode_pool_options{1, 1});
+
+    SECTION("Corrupt body fails like curl would")
+    {
+        auto            corrupt = encoded.substr(0, encoded.size() / 2);
+        scripted_server server{[&](const std::string&) { return gzip_response(corrupt); }};
+
+        auto client  = decode_client(pool);
+        auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        request->accept_encoding(std::vector<std::string>{"gzip"});
+        auto [req, response] = client->start_request(std::move(request)).get();
+
+        REQUIRE(response.lift_status() == lift::lift_status::error);
+        REQUIRE(pool->jobs_submitted() == 1);
+    }
+
+    SECTION("Body decoding past the pool's limit fails with a download error")
+    {
+        scripted_server server{[&](const std::string&) { return gzip_response(encoded); }};
+
+        auto bounded = std::make_shared<lift::decode_pool>(lift::decode_pool_options{1, 1, body.size() - 1});
+        auto client  = decode_client(bounded);
+        auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        request->accept_encoding(std::vector<std::string>{"gzip"});
+        auto [req, response] = client->start_request(std::move(request)).get();
+
+        REQUIRE(response.lift_status() == lift::lift_status::download_error);
+        REQUIRE(bounded->jobs_submitted() == 1);
+    }
+
+    SECTION("Encodings the pool doesn't support are decoded by curl")
+    {
+        scripted_server server{[&](const std::string&) { return gzip_response(encoded); }};
+
+        auto client  = decode_client(pool);
+        auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        request->accept_encoding(std::vector<std::string>{"gzip", "br"});
+        auto [req, response] = client->start_request(std::move(request)).get();
+
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE_FALSE(response.content_encoded());
+        REQUIRE(response.data() == body);
+        REQUIRE(pool->jobs_submitted() == 0);
+    }
+}
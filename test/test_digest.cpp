@@ -0,0 +1,165 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include "test_helpers.hpp"
+#include <lift/lift.hpp>
+
+namespace
+{
+auto hex_digest(lift::digest_algorithm algorithm, std::string_view data) -> std::string
+{
+    lift::hasher hasher{algorithm};
+    hasher.update(data);
+    return lift::to_hex(hasher.finish());
+}
+
+auto perform(const std::string& url, lift::integrity_policy policy) -> lift::response
+{
+    lift::request request{url, std::chrono::seconds{5}};
+    request.integrity(std::move(policy));
+    return request.perform();
+}
+
+constexpr std::array<lift::digest_algorithm, 4> algorithms{
+    lift::digest_algorithm::crc32c,
+    lift::digest_algorithm::xxhash64,
+    lift::digest_algorithm::sha256,
+    lift::digest_algorithm::md5};
+
+} // namespace
+
+TEST_CASE("Digests match their known vectors")
+{
+    REQUIRE(hex_digest(lift::digest_algorithm::crc32c, "") == "00000000");
+    REQUIRE(hex_digest(lift::digest_algorithm::crc32c, "123456789") == "e3069283");
+    REQUIRE(hex_digest(lift::digest_algorithm::xxhash64, "") == "ef46db3751d8e999");
+    REQUIRE(hex_digest(lift::digest_algorithm::xxhash64, "abc") == "44bc2cf5ad770999");
+    REQUIRE(
+        hex_digest(lift::digest_algorithm::sha256, "") ==
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    REQUIRE(
+        hex_digest(lift::digest_algorithm::sha256, "abc") ==
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    REQUIRE(
+        hex_digest(lift::digest_algorithm::sha256, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    REQUIRE(hex_digest(lift::digest_algorithm::md5, "") == "d41d8cd98f00b204e9800998ecf8427e");
+    REQUIRE(hex_digest(lift::digest_algorithm::md5, "abc") == "900150983cd24fb0d6963f7d28e17f72");
+}
+
+TEST_CASE("Digests are the same however the data is split")
+{
+    auto body = make_body(100 * 1024 + 13);
+    for (auto algorithm : algorithms)
+    {
+        auto expected = hex_digest(algorithm, body);
+        for (std::size_t chunk_size : {1, 3, 31, 64, 65, 4096})
+        {
+            lift::hasher hasher{algorithm};
+            REQUIRE(hasher.algorithm() == algorithm);
+            for (std::size_t offset = 0; offset < body.size(); offset += chunk_size)
+            {
+                hasher.update(std::string_view{body}.substr(offset, chunk_size));
+            }
+            REQUIRE(lift::to_hex(hasher.finish()) == expected);
+        }
+    }
+}
+
+TEST_CASE("Digest headers are parsed")
+{
+    REQUIRE(lift::from_base64("kAFQmDzST7DWlj99KOF/cg==") == lift::from_base64("kAFQmDzST7DWlj99KOF_cg"));
+    REQUIRE(lift::from_base64("not base64!") == std::nullopt);
+    REQUIRE(lift::from_base64("a") == std::nullopt);
+
+    auto md5 = lift::from_base64("kAFQmDzST7DWlj99KOF/cg==");
+    REQUIRE(md5.has_value());
+    REQUIRE(lift::to_hex(md5.value()) == "900150983cd24fb0d6963f7d28e17f72");
+
+    // RFC 9530 Repr-Digest and RFC 3230 Digest.
+    auto sha256 = lift::parse_digest_header(
+        "md5=:kAFQmDzST7DWlj99KOF/cg==:, sha-256=:ungWv48Bz+pBQUDeXa4iI7ADYaOWF3qctBD/YfIAFa0=:",
+        lift::digest_algorithm::sha256);
+    REQUIRE(sha256.has_value());
+    REQUIRE(lift::to_hex(sha256.value()) == hex_digest(lift::digest_algorithm::sha256, "abc"));
+    REQUIRE(
+        lift::parse_digest_header("MD5=kAFQmDzST7DWlj99KOF/cg==", lift::digest_algorithm::md5) ==
+        lift::from_base64("kAFQmDzST7DWlj99KOF/cg=="));
+    REQUIRE(lift::parse_digest_header("md5=kAFQmDzST7DWlj99KOF/cg==", lift::digest_algorithm::crc32c) == std::nullopt);
+}
+
+TEST_CASE("Response bodies are hashed as they are received")
+{
+    auto            body = make_body(3 * 1024 * 1024 + 7);
+    scripted_server server{[&](const std::string&) { return chunked_response(body); }};
+
+    for (auto algorithm : algorithms)
+    {
+        auto expected = hex_digest(algorithm, body);
+        auto response = perform(server.url(), lift::integrity_policy{algorithm, expected, false});
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.data() == body);
+        REQUIRE(response.digest_hex() == expected);
+    }
+
+    SECTION("A different expected digest fails the request")
+    {
+        auto response =
+            perform(server.url(), lift::integrity_policy{lift::digest_algorithm::crc32c, "00000000", false});
+        REQUIRE(response.lift_status() == lift::lift_status::integrity_mismatch);
+        REQUIRE(response.digest_hex() == hex_digest(lift::digest_algorithm::crc32c, body));
+    }
+
+    SECTION("The expected digest is case insensitive")
+    {
+        auto expected = hex_digest(lift::digest_algorithm::sha256, body);
+        std::transform(expected.begin(), expected.end(), expected.begin(), ::toupper);
+        auto response = perform(server.url(), lift::integrity_policy{lift::digest_algorithm::sha256, expected, false});
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+    }
+
+    SECTION("Requests without an integrity policy have no digest")
+    {
+        lift::request request{server.url(), std::chrono::seconds{5}};
+        auto          response = request.perform();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.digest().empty());
+    }
+}
+
+TEST_CASE("Response bodies are verified against their digest headers")
+{
+    std::string     headers{};
+    scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", headers, "abc"); }};
+
+    lift::integrity_policy sha256{lift::digest_algorithm::sha256, std::nullopt, true};
+    lift::integrity_policy md5{lift::digest_algorithm::md5, std::nullopt, true};
+
+    SECTION("Repr-Digest")
+    {
+        headers = "Repr-Digest: sha-256=:ungWv48Bz+pBQUDeXa4iI7ADYaOWF3qctBD/YfIAFa0=:\r\n";
+        REQUIRE(perform(server.url(), sha256).lift_status() == lift::lift_status::success);
+
+        headers = "Repr-Digest: sha-256=:X48E9qOokqqrvdts8nOJRJN3OWDUoyWxBf7kbu9DBPE=:\r\n";
+        REQUIRE(perform(server.url(), sha256).lift_status() == lift::lift_status::integrity_mismatch);
+
+        // Only verified when the policy asks for it.
+        sha256.m_verify_header = false;
+        REQUIRE(perform(server.url(), sha256).lift_status() == lift::lift_status::success);
+    }
+
+    SECTION("Content-MD5")
+    {
+        headers = "Content-MD5: kAFQmDzST7DWlj99KOF/cg==\r\n";
+        REQUIRE(perform(server.url(), md5).lift_status() == lift::lift_status::success);
+
+        headers = "Content-MD5: 1B2M2Y8AsgTpgAmY7PhCfg==\r\n";
+        REQUIRE(perform(server.url(), md5).lift_status() == lift::lift_status::integrity_mismatch);
+    }
+
+    SECTION("A header without the algorithm isn't verified")
+    {
+        headers = "Digest: md5=1B2M2Y8AsgTpgAmY7PhCfg==\r\n";
+        REQUIRE(perform(server.url(), sha256).lift_status() == lift::lift_status::success);
+    }
+}
@@ -0,0 +1,208 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace
+{
+/// A cache file path unique to this process, it is removed along with its lock file on destruction.
+struct temp_cache_path
+{
+    explicit temp_cache_path(const std::string& name)
+        : m_path(std::filesystem::temp_directory_path() / ("lift_" + name + "_" + std::to_string(::getpid())))
+    {
+        remove();
+    }
+
+    ~temp_cache_path() { remove(); }
+
+    auto remove() -> void
+    {
+        std::error_code ec{};
+        std::filesystem::remove(m_path, ec);
+        std::filesystem::remove(m_path.string() + ".lock", ec);
+        std::filesystem::remove(m_path.string() + ".compact", ec);
+    }
+
+    std::filesystem::path m_path;
+};
+
+auto open_cache(const temp_cache_path& path, lift::disk_cache_mode mode = lift::disk_cache_mode::read_write)
+    -> std::shared_ptr<lift::disk_cache>
+{
+    return std::make_shared<lift::disk_cache>(lift::disk_cache_options{path.m_path, mode});
+}
+
+/// GETs every url through a client using the given cache.
+auto fetch(std::shared_ptr<lift::response_cache> cache, const std::vector<std::string>& urls) -> void
+{
+    lift::client::options options{};
+    options.cache = std::move(cache);
+    lift::client client{std::move(options)};
+    for (const auto& url : urls)
+    {
+        auto [req, response] =
+            client.start_request(std::make_unique<lift::request>(url, std::chrono::seconds{5})).get();
+        REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+    }
+}
+
+auto make_server() -> std::unique_ptr<scripted_server>
+{
+    return std::make_unique<scripted_server>(
+        [](const std::string& head)
+        {
+            auto path = head.substr(4, head.find(' ', 4) - 4);
+            return scripted_server::response("200 OK", "Cache-Control: max-age=60\r\n", "body of " + path);
+        });
+}
+
+} // namespace
+
+TEST_CASE("disk_cache persists responses across instances")
+{
+    temp_cache_path path{"persist"};
+    auto            server = make_server();
+
+    fetch(open_cache(path), {server->url("/a"), server->url("/b")});
+    REQUIRE(server->requests() == 2);
+
+    auto cache = open_cache(path);
+    REQUIRE(cache->size() == 2);
+
+    // Hits view the body in the mapping, the same bytes are returned for every lookup.
+    auto entry = cache->find(server->url("/a"));
+    REQUIRE(entry != nullptr);
+    REQUIRE(entry->m_response.data() == "body of /a");
+    REQUIRE(cache->find(server->url("/a"))->m_response.data().data() == entry->m_response.data().data());
+
+    fetch(cache, {server->url("/a"), server->url("/b")});
+    REQUIRE(server->requests() == 2);
+
+    // Tombstones survive re-opening the cache file.
+    cache->erase(server->url("/a"));
+    cache = nullptr;
+    cache = open_cache(path);
+    REQUIRE(cache->size() == 1);
+    REQUIRE(cache->find(server->url("/a")) == nullptr);
+    REQUIRE(cache->find(server->url("/b")) != nullptr);
+
+    // The entry outlives the cache and its mapping.
+    entry = cache->find(server->url("/b"));
+    cache = nullptr;
+    REQUIRE(entry->m_response.data() == "body of /b");
+}
+
+TEST_CASE("disk_cache discards a torn record")
+{
+    temp_cache_path path{"torn"};
+    auto            server = make_server();
+
+    fetch(open_cache(path), {server->url("/a"), server->url("/b")});
+
+    // Simulate a crash mid append of the last record.
+    std::filesystem::resize_file(path.m_path, std::filesystem::file_size(path.m_path) - 3);
+
+    auto cache = open_cache(path);
+    REQUIRE(cache->size() == 1);
+    REQUIRE(cache->find(server->url("/a")) != nullptr);
+    REQUIRE(cache->find(server->url("/b")) == nullptr);
+    REQUIRE(cache->file_bytes() == std::filesystem::file_size(path.m_path));
+
+    // New records are appended after the last valid record.
+    fetch(cache, {server->url("/b")});
+    cache = nullptr;
+    REQUIRE(open_cache(path)->size() == 2);
+}
+
+TEST_CASE("disk_cache rejects a file of another layout")
+{
+    temp_cache_path path{"layout"};
+    auto            server = make_server();
+
+    fetch(open_cache(path), {server->url("/a")});
+
+    // A file written with an older record layout carries an older magic.
+    {
+        std::fstream file{path.m_path, std::ios::in | std::ios::out | std::ios::binary};
+        file.write("LIFTDC01", 8);
+    }
+
+    REQUIRE_THROWS_AS(open_cache(path), std::runtime_error);
+}
+
+TEST_CASE("disk_cache compaction drops dead records")
+{
+    temp_cache_path path{"compact"};
+    auto            server = make_server();
+    auto            cache  = open_cache(path);
+
+    fetch(cache, {server->url("/a"), server->url("/b"), server->url("/c")});
+    cache->erase(server->url("/b"));
+    REQUIRE(cache->live_bytes() < cache->file_bytes());
+
+    auto before = cache->file_bytes();
+    auto entry  = cache->find(server->url("/a"));
+    cache->compact();
+    REQUIRE(cache->file_bytes() < before);
+    REQUIRE(cache->file_bytes() == std::filesystem::file_size(path.m_path));
+    REQUIRE(cache->size() == 2);
+
+    // Responses served before compaction keep viewing the old mapping.
+    REQUIRE(entry->m_response.data() == "body of /a");
+    REQUIRE(cache->find(server->url("/c"))->m_response.data() == "body of /c");
+
+    cache = nullptr;
+    cache = open_cache(path);
+    REQUIRE(cache->size() == 2);
+    REQUIRE(cache->find(server->url("/a"))->m_response.data() == "body of /a");
+}
+
+TEST_CASE("disk_cache shares a cache file with readers")
+{
+    temp_cache_path path{"shared"};
+    auto            server = make_server();
+
+    // Readers can open before the writer creates the cache file.
+    auto reader = open_cache(path, lift::disk_cache_mode::shared_read);
+    REQUIRE(reader->find(server->url("/a")) == nullptr);
+
+    auto writer = open_cache(path);
+    REQUIRE_THROWS_AS(open_cache(path), std::runtime_error);
+
+    fetch(writer, {server->url("/a")});
+    REQUIRE(reader->find(server->url("/a"))->m_response.data() == "body of /a");
+
+    // Readers never write.
+    reader->erase(server->url("/a"));
+    REQUIRE(writer->size() == 1);
+
+    // Readers pick up appends and the replaced file after compaction.
+    fetch(writer, {server->url("/b")});
+    writer->erase(server->url("/a"));
+    writer->compact();
+    REQUIRE(reader->find(server->url("/a")) == nullptr);
+    REQUIRE(reader->find(server->url("/b"))->m_response.data() == "body of /b");
+
+    // A client can serve from a reader.
+    fetch(reader, {server->url("/b")});
+    REQUIRE(server->requests() == 2);
+}
+
+TEST_CASE("tiered_cache promotes disk hits into memory")
+{
+    temp_cache_path path{"tiered"};
+    auto            server = make_server();
+
+    fetch(open_cache(path), {server->url("/a")});
+
+    auto memory = std::make_shared<lift::memory_cache>();
+    auto tiered = std::make_shared<lift::tiered_cache>(memory, open_cache(path));
+    fetch(tiered, {server->url("/a"), server->url("/b")});
+    REQUIRE(server->requests() == 2);
+    REQUIRE(memory->size() == 2);
+}
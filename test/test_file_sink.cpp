@@ -0,0 +1,96 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include "test_helpers.hpp"
+#include <lift/lift.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace
+{
+auto crc32_of(const std::string& body) -> uint32_t
+{
+    return static_cast<uint32_t>(
+        ::crc32(0, reinterpret_cast<const Bytef*>(body.data()), static_cast<uInt>(body.size())));
+}
+
+} // namespace
+
+TEST_CASE("file_sink writes the body into a file")
+{
+    auto            body = make_body(3 * 1024 * 1024 + 7);
+    scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", "", body); }};
+
+    for (bool direct_io : {false, true})
+    {
+        temp_file_path          path{"file_sink"};
+        lift::file_sink_options options{64 * 1024, direct_io};
+        options.m_crc32 = direct_io;
+        auto sink       = std::make_shared<lift::file_sink>(path.m_path, options);
+
+        lift::client client{};
+        auto         request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        request->body_sink(sink);
+
+        auto [req, response] = client.start_request(std::move(request)).get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.data().empty());
+        REQUIRE(response.download_size() == body.size());
+
+        REQUIRE(sink->error() == 0);
+        REQUIRE(sink->bytes_written() == body.size());
+        // The CRC-32 is only computed when asked for.
+        REQUIRE(sink->crc32() == (direct_io ? crc32_of(body) : 0));
+        REQUIRE(std::filesystem::file_size(path.m_path) == body.size());
+        REQUIRE(read_file(path.m_path) == body);
+    }
+}
+
+TEST_CASE("file_sink writes the body at an offset of an open file")
+{
+    auto            body = make_body(100 * 1024);
+    scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", "", body); }};
+
+    temp_file_path path{"file_sink_offset"};
+    int            fd = ::open(path.m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    REQUIRE(fd != -1);
+    REQUIRE(::pwrite(fd, "header", 6, 0) == 6);
+
+    auto sink = std::make_shared<lift::file_sink>(fd, 6, lift::file_sink_options{4096});
+
+    lift::request request{server.url(), std::chrono::seconds{5}};
+    request.body_sink(sink);
+    auto response = request.perform();
+    ::close(fd);
+
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(sink->bytes_written() == body.size());
+    REQUIRE(read_file(path.m_path) == "header" + body);
+}
+
+TEST_CASE("file_sink can't open the file")
+{
+    REQUIRE_THROWS_AS(lift::file_sink{"/nonexistent/directory/file"}, std::runtime_error);
+}
+
+TEST_CASE("file_sink rejects file descriptors it can't write through")
+{
+    SECTION("Invalid file descriptor")
+    {
+        REQUIRE_THROWS_AS(lift::file_sink(-1, 0), std::runtime_error);
+    }
+
+    SECTION("File descriptor open with O_DIRECT")
+    {
+        // Not every file system supports O_DIRECT, e.g. tmpfs, there is nothing to reject without it.
+        temp_file_path path{"file_sink_direct"};
+        int            fd = ::open(path.m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        if (fd != -1)
+        {
+            REQUIRE_THROWS_AS(lift::file_sink(fd, 0), std::runtime_error);
+            ::close(fd);
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
 #include "setup.hpp"
 #include <lift/lift.hpp>
 
@@ -116,3 +117,174 @@ TEST_CASE("header parsing : from full strings")
         REQUIRE(h.value() == " x  ");
     }
 }
+
+TEST_CASE("header response lookup is case insensitive")
+{
+    scripted_server server{
+        [](const std::string&)
+        {
+            return scripted_server::response(
+                "200 OK",
+                "Content-Type: text/plain\r\nETag:   \"v1\"  \r\nX-Repeated: first\r\nx-repeated: second\r\n",
+                "body");
+        }};
+
+    lift::request request{server.url(), std::chrono::seconds{5}};
+    auto          response = request.perform();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+
+    REQUIRE(response.header("content-type").value().value() == "text/plain");
+    REQUIRE(response.header("CONTENT-LENGTH").value().value() == "4");
+    REQUIRE(response.header("Content-Length").value().name() == "Content-Length");
+    REQUIRE(response.header("etag").value().value() == "\"v1\"");
+    REQUIRE(response.header("X-Repeated").value().value() == "first");
+    REQUIRE_FALSE(response.header("X-Missing").has_value());
+
+    std::vector<std::string> values{};
+    for (const auto& header : response.headers())
+    {
+        if (header.name() == "X-Repeated" || header.name() == "x-repeated")
+        {
+            values.emplace_back(header.value());
+        }
+    }
+    REQUIRE(values == std::vector<std::string>{"first", "second"});
+
+    // Copies have their own header block.
+    auto copy = response;
+    response  = lift::response{};
+    REQUIRE(copy.header("content-type").value().value() == "text/plain");
+}
+
+TEST_CASE("header response lookup beyond the indexed headers")
+{
+    constexpr std::size_t N_HEADERS = lift::header_index_max_count * 3;
+
+    std::string headers{};
+    for (std::size_t i = 0; i < N_HEADERS; ++i)
+    {
+        headers.append("X-Name-" + std::to_string(i) + ": value" + std::to_string(i) + "\r\n");
+    }
+    scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", headers, ""); }};
+
+    lift::request request{server.url(), std::chrono::seconds{5}};
+    auto          response = request.perform();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+
+    for (std::size_t i = 0; i < N_HEADERS; ++i)
+    {
+        auto header = response.header("x-name-" + std::to_string(i));
+        REQUIRE(header.has_value());
+        REQUIRE(header.value().value() == "value" + std::to_string(i));
+    }
+    REQUIRE_FALSE(response.header("x-name-" + std::to_string(N_HEADERS)).has_value());
+}
+
+TEST_CASE("header response well known headers are typed")
+{
+    scripted_server server{
+        [](const std::string&)
+        {
+            return scripted_server::response(
+                "503 Service Unavailable",
+                "content-type: Application/JSON; charset=utf-8\r\nETag: \"abc\"\r\nCache-Control: max-age=60\r\n"
+                "Retry-After: 120\r\nLast-Modified: Wed, 21 Oct 2015 07:28:00 GMT\r\nX-Other: value\r\n",
+                "{}");
+        }};
+
+    lift::request request{server.url(), std::chrono::seconds{5}};
+    auto          response = request.perform();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+
+    REQUIRE(response.content_length() == std::optional<uint64_t>{2});
+    REQUIRE(response.content_type() == lift::http::content_type::application_json);
+    REQUIRE(response.connection() == lift::http::connection_type::close);
+    REQUIRE(response.etag() == std::optional<std::string_view>{"\"abc\""});
+    REQUIRE(response.cache_control() == std::optional<std::string_view>{"max-age=60"});
+    REQUIRE(response.retry_after() == std::optional<std::chrono::milliseconds>{std::chrono::seconds{120}});
+    REQUIRE(response.last_modified() == std::optional<std::string_view>{"Wed, 21 Oct 2015 07:28:00 GMT"});
+}
+
+TEST_CASE("header response well known headers are absent")
+{
+    scripted_server server{
+        [](const std::string&)
+        { return std::string{"HTTP/1.1 204 No Content\r\nConnection: keep-alive\r\nRetry-After: soon\r\n\r\n"}; }};
+
+    lift::request request{server.url(), std::chrono::seconds{5}};
+    auto          response = request.perform();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+
+    REQUIRE_FALSE(response.content_length().has_value());
+    REQUIRE(response.content_type() == lift::http::content_type::no_content);
+    REQUIRE(response.connection() == lift::http::connection_type::keep_alive);
+    REQUIRE_FALSE(response.etag().has_value());
+    REQUIRE_FALSE(response.cache_control().has_value());
+    REQUIRE_FALSE(response.retry_after().has_value());
+    REQUIRE_FALSE(response.last_modified().has_value());
+}
+
+TEST_CASE("header http content and connection types from strings")
+{
+    REQUIRE(lift::http::to_content_type("text/html") == lift::http::content_type::text_html);
+    REQUIRE(lift::http::to_content_type(" IMAGE/PNG ; q=1") == lift::http::content_type::image_png);
+    REQUIRE(lift::http::to_content_type("application/x-unknown") == lift::http::content_type::unknown);
+    REQUIRE(lift::http::to_content_type("") == lift::http::content_type::no_content);
+
+    REQUIRE(lift::http::to_connection_type("Upgrade") == lift::http::connection_type::upgrade);
+    REQUIRE(lift::http::to_connection_type("foo, Close") == lift::http::connection_type::close);
+    REQUIRE_FALSE(lift::http::to_connection_type("foo").has_value());
+}
+
+TEST_CASE("header response keeps only the final hop's headers")
+{
+    scripted_server server{
+        [&](const std::string& head)
+        {
+            if (head.find("GET /final ") != std::string::npos)
+            {
+                return scripted_server::response("200 OK", "X-Hop: final\r\n", "final");
+            }
+            return scripted_server::response(
+                "302 Found", "X-Hop: redirect\r\nLocation: /final\r\nCache-Control: no-store\r\n", "moved");
+        }};
+
+    {
+        lift::request request{server.url("/start"), std::chrono::seconds{5}};
+        auto          response = request.perform();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+        REQUIRE(response.data() == "final");
+
+        REQUIRE(response.header_hops() == 1);
+        REQUIRE(response.header("X-Hop").value().value() == "final");
+        REQUIRE_FALSE(response.header("Location").has_value());
+        REQUIRE_FALSE(response.cache_control().has_value());
+        REQUIRE(response.content_length() == std::optional<uint64_t>{5});
+        REQUIRE(response.headers().size() == 3);
+    }
+
+    {
+        lift::request request{server.url("/start"), std::chrono::seconds{5}};
+        request.header_retention(lift::header_retention::all_hops);
+        auto response = request.perform();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.data() == "final");
+
+        REQUIRE(response.header_hops() == 2);
+        REQUIRE(response.hop_status_code(0) == lift::http::status_code::http_302_found);
+        REQUIRE(response.hop_status_code(1) == lift::http::status_code::http_200_ok);
+
+        auto redirect = response.hop_headers(0);
+        REQUIRE(redirect.size() == 5);
+        REQUIRE(redirect[0].name() == "Content-Length");
+        REQUIRE(redirect[3].value() == "/final");
+
+        // The lookups only ever see the final hop.
+        REQUIRE(response.headers().size() == 3);
+        REQUIRE(response.hop_headers(1)[2].value() == "final");
+        REQUIRE(response.header("X-Hop").value().value() == "final");
+        REQUIRE_FALSE(response.header("Location").has_value());
+        REQUIRE_FALSE(response.cache_control().has_value());
+    }
+}
@@ -0,0 +1,108 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+namespace
+{
+/// Collects the body written to it.
+class string_sink final : public lift::body_sink
+{
+public:
+    auto write(const lift::request&, std::string_view chunk) -> bool override
+    {
+        m_body.append(chunk);
+        return true;
+    }
+
+    auto finish(const lift::request&, const lift::response&) -> void override {}
+
+    std::string m_body{};
+};
+
+} // namespace
+
+TEST_CASE("Headers handler aborts the transfer")
+{
+    scripted_server server{[](const std::string&)
+                           { return scripted_server::response("404 Not Found", "", std::string(256 * 1024, 'x')); }};
+
+    lift::client client{};
+    auto         request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+    request->retry(lift::retry_policy{});
+
+    int calls = 0;
+    request->headers_handler(
+        [&](lift::request&, const lift::response& response)
+        {
+            ++calls;
+            return (response.status_code() == lift::http::status_code::http_404_not_found)
+                       ? lift::header_action::abort
+                       : lift::header_action::proceed;
+        });
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(calls == 1);
+    REQUIRE(response.lift_status() == lift::lift_status::download_error);
+    REQUIRE(response.status_code() == lift::http::status_code::http_404_not_found);
+    REQUIRE(response.content_length() == std::optional<uint64_t>{256 * 1024});
+    REQUIRE(response.data().empty());
+    // The headers would be declined again, it isn't retried.
+    REQUIRE(response.num_attempts() == 1);
+}
+
+TEST_CASE("Headers handler switches to a body sink")
+{
+    std::string     body(64 * 1024, 'x');
+    scripted_server server{[&](const std::string&)
+                           { return scripted_server::response("200 OK", "Content-Type: text/csv\r\n", body); }};
+
+    auto sink = std::make_shared<string_sink>();
+
+    lift::request request{server.url(), std::chrono::seconds{5}};
+    request.headers_handler(
+        [&](lift::request& r, const lift::response& response)
+        {
+            if (response.content_type() == lift::http::content_type::text_csv)
+            {
+                r.body_sink(sink);
+            }
+            return lift::header_action::proceed;
+        });
+
+    auto response = request.perform();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.data().empty());
+    REQUIRE(sink->m_body == body);
+}
+
+TEST_CASE("Headers handler is only called for the final response")
+{
+    scripted_server server{
+        [](const std::string& head)
+        {
+            if (head.find("GET /final ") != std::string::npos)
+            {
+                return scripted_server::response("200 OK", "", "final");
+            }
+            return scripted_server::response("301 Moved Permanently", "Location: /final\r\n", "");
+        }};
+
+    lift::client client{};
+    auto         request = std::make_unique<lift::request>(server.url("/start"), std::chrono::seconds{5});
+
+    std::vector<lift::http::status_code> codes{};
+    request->headers_handler(
+        [&](lift::request&, const lift::response& response)
+        {
+            codes.push_back(response.status_code());
+            REQUIRE(response.data().empty());
+            return lift::header_action::proceed;
+        });
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.data() == "final");
+    REQUIRE(codes == std::vector<lift::http::status_code>{lift::http::status_code::http_200_ok});
+    REQUIRE(response.time_to_first_byte() <= response.total_time());
+}
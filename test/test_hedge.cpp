@@ -0,0 +1,133 @@
+#include "blackhole_server.hpp"
+#include "catch_amalgamated.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <chrono>
+#include <thread>
+
+TEST_CASE("Hedge to an alternate url wins over a hung request")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{lift::client::options{.hedge_budget_percent = 100.0}};
+
+    auto request = std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{5});
+    request->hedge(lift::hedge_policy{
+        .m_delay         = std::chrono::milliseconds{10},
+        .m_alternate_url = "http://" + nginx_hostname + ":" + nginx_port_str + "/"});
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+    // The user's original request is always returned, not the hedged copy.
+    REQUIRE(req->url() == blackhole.url());
+    REQUIRE(client.hedges_issued() == 1);
+    REQUIRE(client.hedges_won() == 1);
+
+    while (!client.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+}
+
+TEST_CASE("Hedge is not issued when the budget is exhausted")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{lift::client::options{.hedge_budget_percent = 0.0}};
+
+    auto request = std::make_unique<lift::request>(blackhole.url(), std::chrono::milliseconds{100});
+    request->hedge(lift::hedge_policy{
+        .m_delay         = std::chrono::milliseconds{10},
+        .m_alternate_url = "http://" + nginx_hostname + ":" + nginx_port_str + "/"});
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::timeout);
+    REQUIRE(client.hedges_issued() == 0);
+    REQUIRE(client.hedges_won() == 0);
+}
+
+TEST_CASE("Hedge many requests against the same url")
+{
+    constexpr std::size_t COUNT = 100;
+
+    lift::client client{lift::client::options{.hedge_budget_percent = 50.0}};
+
+    std::vector<lift::request_ptr> requests{};
+    for (std::size_t i = 0; i < COUNT; ++i)
+    {
+        auto request = std::make_unique<lift::request>(
+            "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{1});
+        request->hedge(lift::hedge_policy{.m_delay = std::chrono::milliseconds{0}, .m_percentile = 90.0});
+        requests.emplace_back(std::move(request));
+    }
+
+    auto futures = client.start_requests(std::move(requests));
+    for (auto& f : futures)
+    {
+        auto [req, response] = f.get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+    }
+
+    REQUIRE(client.hedges_issued() <= COUNT / 2);
+    REQUIRE(client.hedges_won() <= client.hedges_issued());
+}
+
+TEST_CASE("Hedge is only issued for idempotent methods")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{lift::client::options{.hedge_budget_percent = 100.0}};
+
+    auto request = std::make_unique<lift::request>(blackhole.url(), std::chrono::milliseconds{100});
+    request->method(lift::http::method::post);
+    request->hedge(lift::hedge_policy{
+        .m_delay         = std::chrono::milliseconds{10},
+        .m_alternate_url = "http://" + nginx_hostname + ":" + nginx_port_str + "/"});
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::timeout);
+    REQUIRE(client.hedges_issued() == 0);
+
+    SECTION("PUT is only hedged when opted in")
+    {
+        request = std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{5});
+        request->method(lift::http::method::put);
+        request->hedge(lift::hedge_policy{
+            .m_delay             = std::chrono::milliseconds{10},
+            .m_alternate_url     = "http://" + nginx_hostname + ":" + nginx_port_str + "/",
+            .m_idempotent_writes = true});
+
+        auto [put_req, put_response] = client.start_request(std::move(request)).get();
+        REQUIRE(put_response.lift_status() == lift::lift_status::success);
+        REQUIRE(client.hedges_issued() == 1);
+    }
+
+    while (!client.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+}
+
+TEST_CASE("Hedge is not issued when the rate limit is exhausted")
+{
+    blackhole_server blackhole{};
+
+    lift::client client{lift::client::options{
+        .hedge_budget_percent = 100.0, .global_rate_limit = lift::rate_limit{.m_requests_per_second = 1.0}}};
+
+    auto request = std::make_unique<lift::request>(blackhole.url(), std::chrono::milliseconds{100});
+    request->hedge(lift::hedge_policy{
+        .m_delay         = std::chrono::milliseconds{10},
+        .m_alternate_url = "http://" + nginx_hostname + ":" + nginx_port_str + "/"});
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::timeout);
+    REQUIRE(client.hedges_issued() == 0);
+}
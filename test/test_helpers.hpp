@@ -0,0 +1,76 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+/**
+ * @param size The number of bytes in the body.
+ * @param stride How far each byte steps through the alphabet from the previous byte.
+ * @return A body of lowercase letters that repeats every 26 bytes.
+ */
+inline auto make_body(std::size_t size, std::size_t stride = 1) -> std::string
+{
+    std::string body(size, '\0');
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        body[i] = static_cast<char>('a' + ((i * stride) % 26));
+    }
+    return body;
+}
+
+/**
+ * @param body The body to send.
+ * @return A raw 200 response sending the body in 10000 byte chunks, so its length isn't known up front.
+ */
+inline auto chunked_response(const std::string& body) -> std::string
+{
+    std::string raw{"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n"};
+    for (std::size_t offset = 0; offset < body.size(); offset += 10000)
+    {
+        auto chunk = std::string_view{body}.substr(offset, 10000);
+        char size[32];
+        std::snprintf(size, sizeof(size), "%zx\r\n", chunk.size());
+        raw.append(size);
+        raw.append(chunk);
+        raw.append("\r\n");
+    }
+    raw.append("0\r\n\r\n");
+    return raw;
+}
+
+/// A file path unique to this process, it is removed on destruction.
+struct temp_file_path
+{
+    explicit temp_file_path(const std::string& name)
+        : m_path(std::filesystem::temp_directory_path() / ("lift_" + name + "_" + std::to_string(::getpid())))
+    {
+        std::error_code ec{};
+        std::filesystem::remove(m_path, ec);
+    }
+
+    ~temp_file_path()
+    {
+        std::error_code ec{};
+        std::filesystem::remove(m_path, ec);
+    }
+
+    std::filesystem::path m_path;
+};
+
+/**
+ * @param path The file to read.
+ * @return The file's entire contents, empty if it can't be read.
+ */
+inline auto read_file(const std::filesystem::path& path) -> std::string
+{
+    std::ifstream in{path, std::ios::binary};
+    return std::string{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
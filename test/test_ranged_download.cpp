@@ -0,0 +1,238 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include "test_helpers.hpp"
+#include <lift/lift.hpp>
+
+#include <limits>
+
+namespace
+{
+/// Serves an object, and byte ranges of it when asked, like a static file server.
+struct object_server
+{
+    explicit object_server(std::string body, bool accept_ranges = true)
+        : m_body(std::move(body)),
+          m_accept_ranges(accept_ranges),
+          m_server([this](const std::string& head) { return serve(head); })
+    {
+    }
+
+    auto serve(const std::string& head) -> std::string
+    {
+        std::string accept_ranges = m_accept_ranges ? "Accept-Ranges: bytes\r\n" : "";
+        if (head.rfind("HEAD ", 0) == 0)
+        {
+            return "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(m_body.size()) +
+                   "\r\nConnection: close\r\nETag: " + m_etag + "\r\n" + accept_ranges + "\r\n";
+        }
+
+        auto range = head.find("Range: bytes=");
+        if (!m_accept_ranges || range == std::string::npos)
+        {
+            ++m_full_requests;
+            return scripted_server::response("200 OK", accept_ranges, m_body);
+        }
+
+        ++m_range_requests;
+        if (m_range_requests > m_change_after_ranges)
+        {
+            m_etag = "\"v2\"";
+        }
+
+        // A range of an older version of the object gets all of the current version.
+        if (auto if_range = head.find("If-Range: "); if_range != std::string::npos)
+        {
+            ++m_if_range_requests;
+            if (m_honor_if_range && head.compare(if_range + 10, m_etag.size(), m_etag) != 0)
+            {
+                ++m_full_requests;
+                return scripted_server::response("200 OK", "ETag: " + m_etag + "\r\n" + accept_ranges, m_body);
+            }
+        }
+
+        auto first = std::stoull(head.substr(range + 13));
+        auto last  = std::stoull(head.substr(head.find('-', range) + 1));
+        auto slice = m_body.substr(first, last - first + 1);
+        auto raw   = scripted_server::response(
+            "206 Partial Content",
+            "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) + "/" +
+                std::to_string(m_body.size()) + "\r\nETag: " + m_etag + "\r\n",
+            slice);
+
+        if (m_fail_ranges > 0)
+        {
+            --m_fail_ranges;
+            if (m_fail_with_status)
+            {
+                return scripted_server::response("503 Service Unavailable", "", "");
+            }
+            // Drop the connection halfway through the range's body.
+            raw.resize(raw.size() - slice.size() / 2);
+        }
+        return raw;
+    }
+
+    std::string     m_body;
+    bool            m_accept_ranges{true};
+    std::string     m_etag{"\"v1\""};
+    uint64_t        m_full_requests{0};
+    uint64_t        m_range_requests{0};
+    uint64_t        m_if_range_requests{0};
+    uint64_t        m_fail_ranges{0};
+    bool            m_fail_with_status{false};
+    uint64_t        m_change_after_ranges{std::numeric_limits<uint64_t>::max()};
+    bool            m_honor_if_range{true};
+    scripted_server m_server;
+};
+
+auto small_ranges() -> lift::ranged_download_options
+{
+    lift::ranged_download_options options{};
+    options.m_connections         = 3;
+    options.m_initial_range_bytes = 256 * 1024;
+    options.m_min_range_bytes     = 64 * 1024;
+    options.m_max_range_bytes     = 1024 * 1024;
+    options.m_timeout             = std::chrono::seconds{10};
+    return options;
+}
+
+} // namespace
+
+TEST_CASE("Ranged downloads write every range into the file")
+{
+    object_server  server{make_body(5 * 1024 * 1024 + 123, 7)};
+    temp_file_path path{"ranged"};
+
+    lift::client client{};
+    auto         result = client.start_download(server.m_server.url(), path.m_path, small_ranges()).get();
+    REQUIRE(result.m_lift_status == lift::lift_status::success);
+    REQUIRE(result.m_status_code == lift::http::status_code::http_200_ok);
+    REQUIRE(result.m_ranged);
+    REQUIRE(result.m_size == server.m_body.size());
+    REQUIRE(result.m_bytes_received == server.m_body.size());
+    REQUIRE(result.m_retries == 0);
+    REQUIRE(result.m_requests == server.m_range_requests);
+    REQUIRE_FALSE(result.m_object_changed);
+    // Every range is only valid for the object the HEAD request found.
+    REQUIRE(server.m_if_range_requests == server.m_range_requests);
+    // No range is larger than the maximum.
+    REQUIRE(result.m_requests >= 6);
+    REQUIRE(server.m_full_requests == 0);
+    REQUIRE(read_file(path.m_path) == server.m_body);
+}
+
+TEST_CASE("Ranged downloads spread their ranges over a client pool")
+{
+    object_server  server{make_body(3 * 1024 * 1024 + 1, 7)};
+    temp_file_path path{"ranged_pool"};
+
+    lift::client_pool                          pool{lift::client_pool::options{3, nullptr}};
+    std::promise<lift::ranged_download_result> promise{};
+    pool.start_download(
+        server.m_server.url(),
+        path.m_path,
+        [&](lift::ranged_download_result result) { promise.set_value(std::move(result)); },
+        small_ranges());
+
+    auto result = promise.get_future().get();
+    REQUIRE(result.m_lift_status == lift::lift_status::success);
+    REQUIRE(result.m_ranged);
+    REQUIRE(read_file(path.m_path) == server.m_body);
+}
+
+TEST_CASE("Ranged downloads retry failed ranges")
+{
+    object_server  server{make_body(2 * 1024 * 1024 + 5, 7)};
+    temp_file_path path{"ranged_retry"};
+    lift::client   client{};
+
+    SECTION("A dropped connection resumes the range")
+    {
+        server.m_fail_ranges = 2;
+        auto result          = client.start_download(server.m_server.url(), path.m_path, small_ranges()).get();
+        REQUIRE(result.m_lift_status == lift::lift_status::success);
+        REQUIRE(result.m_retries == 2);
+        // Only the missing half of each dropped range is requested again.
+        REQUIRE(result.m_bytes_received < server.m_body.size() * 2);
+        REQUIRE(read_file(path.m_path) == server.m_body);
+    }
+
+    SECTION("A server error retries the range")
+    {
+        server.m_fail_ranges      = 1;
+        server.m_fail_with_status = true;
+        auto result               = client.start_download(server.m_server.url(), path.m_path, small_ranges()).get();
+        REQUIRE(result.m_lift_status == lift::lift_status::success);
+        REQUIRE(result.m_retries == 1);
+        REQUIRE(read_file(path.m_path) == server.m_body);
+    }
+
+    SECTION("A range that keeps failing fails the download")
+    {
+        server.m_fail_ranges        = 1000;
+        server.m_fail_with_status   = true;
+        auto options                = small_ranges();
+        options.m_max_range_retries = 1;
+        auto result                 = client.start_download(server.m_server.url(), path.m_path, options).get();
+        REQUIRE(result.m_lift_status != lift::lift_status::success);
+        REQUIRE(result.m_status_code == lift::http::status_code::http_503_service_unavailable);
+    }
+}
+
+TEST_CASE("Ranged downloads fail if the object changes")
+{
+    object_server  server{make_body(2 * 1024 * 1024 + 5, 7)};
+    temp_file_path path{"ranged_changed"};
+    lift::client   client{};
+
+    server.m_change_after_ranges = 2;
+
+    SECTION("The server sends the new version instead of the range")
+    {
+        auto result = client.start_download(server.m_server.url(), path.m_path, small_ranges()).get();
+        REQUIRE(result.m_lift_status == lift::lift_status::error);
+        REQUIRE(result.m_object_changed);
+        REQUIRE(result.m_status_code == lift::http::status_code::http_200_ok);
+        REQUIRE(server.m_full_requests > 0);
+    }
+
+    SECTION("The server sends a range of the new version")
+    {
+        server.m_honor_if_range = false;
+        auto result             = client.start_download(server.m_server.url(), path.m_path, small_ranges()).get();
+        REQUIRE(result.m_lift_status == lift::lift_status::error);
+        REQUIRE(result.m_object_changed);
+        REQUIRE(result.m_status_code == lift::http::status_code::http_206_partial_content);
+        REQUIRE(server.m_full_requests == 0);
+    }
+}
+
+TEST_CASE("Ranged downloads fall back to a single request")
+{
+    object_server  server{make_body(1024 * 1024 + 9, 7), false};
+    temp_file_path path{"ranged_single"};
+
+    lift::client client{};
+    auto         result = client.start_download(server.m_server.url(), path.m_path, small_ranges()).get();
+    REQUIRE(result.m_lift_status == lift::lift_status::success);
+    REQUIRE_FALSE(result.m_ranged);
+    REQUIRE(result.m_requests == 1);
+    REQUIRE(result.m_size == server.m_body.size());
+    REQUIRE(server.m_range_requests == 0);
+    REQUIRE(read_file(path.m_path) == server.m_body);
+}
+
+TEST_CASE("Ranged downloads of a missing object fail")
+{
+    scripted_server server{[](const std::string&)
+                           { return scripted_server::response("404 Not Found", "", "not found"); }};
+    temp_file_path  path{"ranged_missing"};
+
+    lift::client client{};
+    auto         result = client.start_download(server.url(), path.m_path, small_ranges()).get();
+    REQUIRE(result.m_lift_status != lift::lift_status::success);
+    REQUIRE(result.m_status_code == lift::http::status_code::http_404_not_found);
+    // The error page isn't written into the file.
+    REQUIRE(read_file(path.m_path).empty());
+}
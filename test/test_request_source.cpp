@@ -0,0 +1,114 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+TEST_CASE("Request source pulls all requests with bounded concurrency")
+{
+    constexpr std::size_t COUNT       = 100;
+    constexpr std::size_t CONCURRENCY = 4;
+
+    lift::client client{};
+
+    // Both the source and the callback are invoked on the client's event loop thread.
+    std::size_t              pulled{0};
+    std::size_t              in_flight{0};
+    std::size_t              max_in_flight{0};
+    std::atomic<std::size_t> completed{0};
+
+    client.start_request_source(
+        [&]() -> lift::request_ptr
+        {
+            if (pulled == COUNT)
+            {
+                return nullptr;
+            }
+            ++pulled;
+            ++in_flight;
+            max_in_flight = std::max(max_in_flight, in_flight);
+            return std::make_unique<lift::request>(
+                "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{1});
+        },
+        [&](lift::request_ptr, lift::response response)
+        {
+            --in_flight;
+            REQUIRE(response.lift_status() == lift::lift_status::success);
+            REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+            completed.fetch_add(1, std::memory_order_release);
+        },
+        CONCURRENCY);
+
+    while (!client.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+
+    REQUIRE(completed.load(std::memory_order_acquire) == COUNT);
+    REQUIRE(pulled == COUNT);
+    REQUIRE(max_in_flight <= CONCURRENCY);
+}
+
+TEST_CASE("Request source that is immediately exhausted")
+{
+    lift::client client{};
+
+    client.start_request_source(
+        []() -> lift::request_ptr { return nullptr; }, [](lift::request_ptr, lift::response) {}, 1);
+
+    while (!client.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    REQUIRE(client.empty());
+}
+
+TEST_CASE("Request source that throws is treated as exhausted")
+{
+    scripted_server server{[](const std::string&) { return scripted_server::response("200 OK", "", "ok"); }};
+    lift::client    client{};
+
+    std::size_t              pulled{0};
+    std::atomic<std::size_t> completed{0};
+
+    client.start_request_source(
+        [&]() -> lift::request_ptr
+        {
+            if (pulled == 3)
+            {
+                throw std::runtime_error{"source failed"};
+            }
+            ++pulled;
+            return std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        },
+        [&](lift::request_ptr, lift::response response)
+        {
+            REQUIRE(response.lift_status() == lift::lift_status::success);
+            completed.fetch_add(1, std::memory_order_release);
+        },
+        2);
+
+    while (!client.empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    // The requests pulled before the throw still complete.
+    REQUIRE(pulled == 3);
+    REQUIRE(completed.load(std::memory_order_acquire) == 3);
+}
+
+TEST_CASE("Request source invalid arguments")
+{
+    lift::client client{};
+
+    REQUIRE_THROWS(client.start_request_source(nullptr, [](lift::request_ptr, lift::response) {}, 1));
+    REQUIRE_THROWS(client.start_request_source([]() -> lift::request_ptr { return nullptr; }, nullptr, 1));
+    REQUIRE_THROWS(client.start_request_source(
+        []() -> lift::request_ptr { return nullptr; }, [](lift::request_ptr, lift::response) {}, 0));
+}
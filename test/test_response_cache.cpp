@@ -0,0 +1,201 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+static auto make_cache_client(std::shared_ptr<lift::response_cache> cache) -> std::unique_ptr<lift::client>
+{
+    lift::client::options options{};
+    options.cache = std::move(cache);
+    return std::make_unique<lift::client>(std::move(options));
+}
+
+static auto get(lift::client& client, const std::string& url, std::optional<std::string> accept = std::nullopt)
+    -> lift::response
+{
+    auto request = std::make_unique<lift::request>(url, std::chrono::seconds{5});
+    if (accept.has_value())
+    {
+        request->header("Accept", accept.value());
+    }
+    auto [req, response] = client.start_request(std::move(request)).get();
+    return response;
+}
+
+TEST_CASE("memory_cache evicts the least recently used entry")
+{
+    auto               entry = std::make_shared<lift::cache_entry>();
+    lift::memory_cache cache{2 * (entry->size() + 1)};
+
+    cache.store("a", entry);
+    cache.store("b", entry);
+    REQUIRE(cache.size() == 2);
+
+    // Touching a makes b the least recently used.
+    REQUIRE(cache.find("a") != nullptr);
+    cache.store("c", entry);
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.evictions() == 1);
+    REQUIRE(cache.find("a") != nullptr);
+    REQUIRE(cache.find("b") == nullptr);
+    REQUIRE(cache.find("c") != nullptr);
+
+    cache.erase("a");
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.bytes() == entry->size() + 1);
+}
+
+TEST_CASE("Response cache serves fresh responses without the network")
+{
+    scripted_server server{[](const std::string&)
+                           { return scripted_server::response("200 OK", "Cache-Control: max-age=60\r\n", "cached"); }};
+    auto            client = make_cache_client(std::make_shared<lift::memory_cache>());
+
+    auto first = get(*client, server.url());
+    REQUIRE(first.status_code() == lift::http::status_code::http_200_ok);
+    REQUIRE(first.data() == "cached");
+
+    // Hits complete on the calling thread before start_request returns.
+    bool completed = false;
+    client->start_request(
+        std::make_unique<lift::request>(server.url(), std::chrono::seconds{5}),
+        [&](lift::request_ptr, lift::response response)
+        {
+            completed = true;
+            REQUIRE(response.data() == "cached");
+            REQUIRE(response.num_attempts() == 0);
+        });
+    REQUIRE(completed);
+
+    REQUIRE(server.requests() == 1);
+    REQUIRE(client->cache_hits() == 1);
+    REQUIRE(client->cache_misses() == 1);
+}
+
+TEST_CASE("Response cache serves requests pulled from a request source")
+{
+    scripted_server server{[](const std::string&)
+                           { return scripted_server::response("200 OK", "Cache-Control: max-age=60\r\n", "cached"); }};
+    auto            client = make_cache_client(std::make_shared<lift::memory_cache>());
+
+    REQUIRE(get(*client, server.url()).data() == "cached");
+
+    std::size_t              pulled{0};
+    std::atomic<std::size_t> completed{0};
+    client->start_request_source(
+        [&]() -> lift::request_ptr
+        {
+            if (pulled == 5)
+            {
+                return nullptr;
+            }
+            ++pulled;
+            return std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        },
+        [&](lift::request_ptr, lift::response response)
+        {
+            REQUIRE(response.data() == "cached");
+            REQUIRE(response.num_attempts() == 0);
+            completed.fetch_add(1, std::memory_order_release);
+        },
+        1);
+
+    while (!client->empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    REQUIRE(completed.load(std::memory_order_acquire) == 5);
+    REQUIRE(server.requests() == 1);
+    REQUIRE(client->cache_hits() == 5);
+}
+
+TEST_CASE("Response cache revalidates stale responses")
+{
+    scripted_server server{[](const std::string& head)
+                           {
+                               if (head.find("If-None-Match: \"v1\"") != std::string::npos)
+                               {
+                                   return scripted_server::response(
+                                       "304 Not Modified", "ETag: \"v1\"\r\nCache-Control: max-age=60\r\n", "");
+                               }
+                               return scripted_server::response(
+                                   "200 OK", "ETag: \"v1\"\r\nCache-Control: no-cache\r\n", "body");
+                           }};
+    auto            client = make_cache_client(std::make_shared<lift::memory_cache>());
+
+    REQUIRE(get(*client, server.url()).data() == "body");
+
+    // The 304 is answered with the stored response.
+    auto revalidated = get(*client, server.url());
+    REQUIRE(revalidated.status_code() == lift::http::status_code::http_200_ok);
+    REQUIRE(revalidated.data() == "body");
+    REQUIRE(client->cache_revalidations() == 1);
+
+    // The 304 refreshed the stored response's freshness.
+    REQUIRE(get(*client, server.url()).data() == "body");
+    REQUIRE(server.requests() == 2);
+    REQUIRE(client->cache_hits() == 1);
+}
+
+TEST_CASE("Response cache serves stale while revalidating")
+{
+    scripted_server server{[](const std::string& head)
+                           {
+                               if (head.find("If-None-Match") != std::string::npos)
+                               {
+                                   return scripted_server::response("304 Not Modified", "ETag: \"v1\"\r\n", "");
+                               }
+                               return scripted_server::response(
+                                   "200 OK", "ETag: \"v1\"\r\nCache-Control: max-age=0, stale-while-revalidate=60\r\n",
+                                   "stale");
+                           }};
+    auto            client = make_cache_client(std::make_shared<lift::memory_cache>());
+
+    REQUIRE(get(*client, server.url()).data() == "stale");
+    REQUIRE(get(*client, server.url()).data() == "stale");
+    REQUIRE(client->cache_hits() == 1);
+    REQUIRE(client->cache_revalidations() == 1);
+
+    // The revalidation runs in the background.
+    while (server.requests() != 2 || !client->empty())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+}
+
+TEST_CASE("Response cache honors Vary and no-store")
+{
+    scripted_server server{[](const std::string& head)
+                           {
+                               if (head.find("GET /no-store") != std::string::npos)
+                               {
+                                   return scripted_server::response("200 OK", "Cache-Control: no-store\r\n", "x");
+                               }
+                               return scripted_server::response(
+                                   "200 OK", "Cache-Control: max-age=60\r\nVary: Accept\r\n", "varied");
+                           }};
+    auto            cache  = std::make_shared<lift::memory_cache>();
+    auto            client = make_cache_client(cache);
+
+    get(*client, server.url(), "text/html");
+    get(*client, server.url(), "application/json");
+    get(*client, server.url(), "application/json");
+    REQUIRE(server.requests() == 2);
+    REQUIRE(client->cache_hits() == 1);
+
+    get(*client, server.url("/no-store"));
+    get(*client, server.url("/no-store"));
+    REQUIRE(server.requests() == 4);
+    REQUIRE(cache->size() == 1);
+
+    // Unsafe methods invalidate the stored response.
+    auto post = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+    post->data("data");
+    client->start_request(std::move(post)).get();
+    REQUIRE(cache->size() == 0);
+}
@@ -0,0 +1,94 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include "test_helpers.hpp"
+#include <lift/lift.hpp>
+
+TEST_CASE("Response data is presized from Content-Length")
+{
+    auto            body = make_body(3 * 1024 * 1024 + 7);
+    scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", "", body); }};
+
+    lift::request request{server.url(), std::chrono::seconds{5}};
+    auto          response = request.perform();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+
+    // Received into the single presized buffer.
+    REQUIRE(response.data_segments().size() == 1);
+    REQUIRE(response.data_size() == body.size());
+    REQUIRE(response.data() == body);
+}
+
+TEST_CASE("Response data of unknown length is flattened on completion")
+{
+    auto            body = make_body(3 * 1024 * 1024 + 7);
+    scripted_server server{[&](const std::string&) { return chunked_response(body); }};
+
+    SECTION("Synchronous")
+    {
+        lift::request request{server.url(), std::chrono::seconds{5}};
+        const auto&   response = request.perform();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.data_segments().size() == 1);
+        REQUIRE(response.data() == body);
+    }
+
+    SECTION("A small body read through a const reference")
+    {
+        scripted_server small_server{[](const std::string&) { return chunked_response("hello"); }};
+        lift::request   request{small_server.url(), std::chrono::seconds{5}};
+        const auto&     response = request.perform();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.data() == "hello");
+    }
+
+    SECTION("Asynchronous")
+    {
+        lift::client client{};
+        auto [req, response] =
+            client.start_request(std::make_unique<lift::request>(server.url(), std::chrono::seconds{5})).get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+
+        const auto& const_response = response;
+        REQUIRE(const_response.data_segments().size() == 1);
+        REQUIRE(const_response.data() == body);
+    }
+}
+
+TEST_CASE("Response data of unknown length is chained in segments")
+{
+    auto            body = make_body(3 * 1024 * 1024 + 7);
+    scripted_server server{[&](const std::string&) { return chunked_response(body); }};
+
+    lift::client client{};
+    auto         request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+    request->segmented_body(true);
+    auto [req, response] = client.start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+
+    auto segments = response.data_segments();
+    REQUIRE(segments.size() > 1);
+    REQUIRE(response.data_size() == body.size());
+
+    std::string joined{};
+    for (const auto& segment : segments)
+    {
+        REQUIRE(segment.size() <= lift::body_segment_max_bytes);
+        joined.append(segment);
+    }
+    REQUIRE(joined == body);
+
+    // A const response can't flatten itself, it views the first segment.
+    const auto& const_response = response;
+    REQUIRE(const_response.data() == segments.front());
+    REQUIRE(const_response.decode_data().value() == body);
+
+    // Flattened on demand.
+    response.flatten();
+    REQUIRE(response.data_segments().size() == 1);
+    REQUIRE(const_response.data() == body);
+
+    // Copies keep their own segments.
+    auto copy = response;
+    REQUIRE(copy.data() == body);
+}
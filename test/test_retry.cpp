@@ -0,0 +1,142 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <chrono>
+#include <thread>
+
+static auto make_retry_policy(std::vector<lift::http::status_code> codes) -> lift::retry_policy
+{
+    lift::retry_policy policy{};
+    policy.m_max_attempts          = 3;
+    policy.m_retry_on_status_codes = std::move(codes);
+    policy.m_base_backoff          = std::chrono::milliseconds{1};
+    policy.m_max_backoff           = std::chrono::milliseconds{10};
+    return policy;
+}
+
+TEST_CASE("Retry status code until max attempts")
+{
+    lift::client client{lift::client::options{.retry_budget_percent = 1000.0}};
+
+    auto request = std::make_unique<lift::request>(
+        "http://" + nginx_hostname + ":" + nginx_port_str + "/not/here", std::chrono::seconds{1});
+    request->retry(make_retry_policy({lift::http::status_code::http_404_not_found}));
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.status_code() == lift::http::status_code::http_404_not_found);
+    REQUIRE(response.num_attempts() == 3);
+    REQUIRE(client.retries_issued() == 2);
+}
+
+TEST_CASE("Retry is not issued for a successful response")
+{
+    lift::client client{lift::client::options{.retry_budget_percent = 1000.0}};
+
+    auto request = std::make_unique<lift::request>(
+        "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{1});
+    request->retry(make_retry_policy({lift::http::status_code::http_404_not_found}));
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+    REQUIRE(response.num_attempts() == 1);
+    REQUIRE(client.retries_issued() == 0);
+}
+
+TEST_CASE("Retry is capped by the client retry budget")
+{
+    lift::client client{lift::client::options{.retry_budget_percent = 0.0}};
+
+    auto request = std::make_unique<lift::request>(
+        "http://" + nginx_hostname + ":" + nginx_port_str + "/not/here", std::chrono::seconds{1});
+    request->retry(make_retry_policy({lift::http::status_code::http_404_not_found}));
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+
+    REQUIRE(response.status_code() == lift::http::status_code::http_404_not_found);
+    REQUIRE(response.num_attempts() == 1);
+    REQUIRE(client.retries_issued() == 0);
+}
+
+TEST_CASE("Retry connect errors")
+{
+    lift::client client{lift::client::options{.retry_budget_percent = 1000.0}};
+
+    // Nothing should be listening on port 1.
+    auto request = std::make_unique<lift::request>("http://127.0.0.1:1/", std::chrono::seconds{1});
+    request->retry(make_retry_policy({}));
+
+    auto [req, response] = client.start_request(std::move(request)).get();
+
+    REQUIRE(response.lift_status() == lift::lift_status::connect_error);
+    REQUIRE(response.num_attempts() == 3);
+}
+
+TEST_CASE("Retry waits on the client rate limits")
+{
+    lift::client client{lift::client::options{
+        .retry_budget_percent = 1000.0,
+        .global_rate_limit    = lift::rate_limit{.m_requests_per_second = 4.0, .m_burst = 1.0}}};
+
+    auto request = std::make_unique<lift::request>(
+        "http://" + nginx_hostname + ":" + nginx_port_str + "/not/here", std::chrono::seconds{5});
+    request->retry(make_retry_policy({lift::http::status_code::http_404_not_found}));
+
+    auto start           = std::chrono::steady_clock::now();
+    auto [req, response] = client.start_request(std::move(request)).get();
+    auto elapsed         = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(response.status_code() == lift::http::status_code::http_404_not_found);
+    REQUIRE(response.num_attempts() == 3);
+    // Each retry waits for a token, the bucket refills every 250ms.
+    REQUIRE(client.requests_rate_limited() == 2);
+    REQUIRE(elapsed >= std::chrono::milliseconds{400});
+}
+
+TEST_CASE("Retries share the request's timeout")
+{
+    // Every attempt takes 150ms to fail.
+    scripted_server server{[](const std::string&)
+                           {
+                               std::this_thread::sleep_for(std::chrono::milliseconds{150});
+                               return scripted_server::response("503 Service Unavailable", "", "");
+                           }};
+
+    lift::client client{lift::client::options{.retry_budget_percent = 1000.0}};
+
+    auto request          = std::make_unique<lift::request>(server.url(), std::chrono::milliseconds{400});
+    auto policy           = make_retry_policy({lift::http::status_code::http_503_service_unavailable});
+    policy.m_max_attempts = 5;
+
+    SECTION("Each retry only gets the time left")
+    {
+        request->retry(policy);
+
+        auto start           = std::chrono::steady_clock::now();
+        auto [req, response] = client.start_request(std::move(request)).get();
+        auto elapsed         = std::chrono::steady_clock::now() - start;
+
+        // Only two attempts fit, the third times out on the request's deadline and there is no time for a fourth.
+        REQUIRE(response.lift_status() == lift::lift_status::timeout);
+        REQUIRE(response.num_attempts() == 3);
+        REQUIRE(elapsed < std::chrono::milliseconds{550});
+    }
+
+    SECTION("A backoff past the deadline returns the last response")
+    {
+        policy.m_base_backoff = std::chrono::seconds{1};
+        policy.m_max_backoff  = std::chrono::seconds{1};
+        policy.m_jitter       = false;
+        request->retry(policy);
+
+        auto [req, response] = client.start_request(std::move(request)).get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.status_code() == lift::http::status_code::http_503_service_unavailable);
+        REQUIRE(response.num_attempts() == 1);
+    }
+}
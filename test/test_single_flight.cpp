@@ -0,0 +1,141 @@
+#include "blackhole_server.hpp"
+#include "catch_amalgamated.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <chrono>
+#include <thread>
+
+static auto make_single_flight_client(std::vector<std::string> headers = {}) -> std::unique_ptr<lift::client>
+{
+    lift::client::options options{};
+    options.single_flight_headers = std::move(headers);
+    return std::make_unique<lift::client>(std::move(options));
+}
+
+TEST_CASE("Single flight coalesces identical requests")
+{
+    auto client = make_single_flight_client();
+
+    std::vector<lift::request_ptr> requests{};
+    for (std::size_t i = 0; i < 10; ++i)
+    {
+        requests.emplace_back(std::make_unique<lift::request>(
+            "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{5}));
+    }
+
+    std::vector<lift::response> responses{};
+    for (auto& future : client->start_requests(std::move(requests)))
+    {
+        auto [req, response] = future.get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+        responses.emplace_back(std::move(response));
+    }
+
+    REQUIRE(client->requests_coalesced() == 9);
+    REQUIRE_FALSE(responses.front().data().empty());
+    for (const auto& response : responses)
+    {
+        // Every response views the exact same body.
+        REQUIRE(response.data().data() == responses.front().data().data());
+    }
+}
+
+TEST_CASE("Single flight keys on the configured headers")
+{
+    auto client = make_single_flight_client({"accept"});
+
+    std::vector<lift::request_ptr> requests{};
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        auto request = std::make_unique<lift::request>(
+            "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{5});
+        request->header("Accept", (i % 2 == 0) ? "text/html" : "application/json");
+        // Unkeyed headers don't make requests distinct.
+        request->header("X-Request-Number", std::to_string(i));
+        requests.emplace_back(std::move(request));
+    }
+
+    // Requests with a body are never coalesced.
+    auto post = std::make_unique<lift::request>(
+        "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{5});
+    post->method(lift::http::method::post);
+    post->data("data");
+    requests.emplace_back(std::move(post));
+
+    for (auto& future : client->start_requests(std::move(requests)))
+    {
+        auto [req, response] = future.get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+    }
+
+    REQUIRE(client->requests_coalesced() == 2);
+}
+
+TEST_CASE("Single flight waiters survive the leader being cancelled")
+{
+    blackhole_server blackhole{};
+    auto             client = make_single_flight_client();
+
+    auto leader = std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{10});
+    auto token  = client->start_request(std::move(leader), [](lift::request_ptr, lift::response) {});
+
+    std::vector<lift::request::async_future_type> futures{};
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        auto request = std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{10});
+        request->tag("waiter");
+        futures.emplace_back(client->start_request(std::move(request)));
+    }
+
+    while (client->requests_coalesced() != 3)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    token.cancel();
+
+    // One of the waiters takes the lead and the others join it again.
+    while (client->requests_coalesced() != 5)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    REQUIRE(client->size() == 3);
+
+    client->cancel_requests("waiter");
+    for (auto& future : futures)
+    {
+        auto [req, response] = future.get();
+        REQUIRE(response.lift_status() == lift::lift_status::cancelled);
+    }
+
+    // The counter is bumped after the user is notified.
+    while (client->requests_cancelled() != 4)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    REQUIRE(client->requests_coalesced() == 5);
+}
+
+TEST_CASE("Single flight waiters time out on their own deadline")
+{
+    blackhole_server blackhole{};
+    auto             client = make_single_flight_client();
+
+    auto [leader, token] =
+        client->start_cancellable_request(std::make_unique<lift::request>(blackhole.url(), std::chrono::seconds{10}));
+
+    auto waiter =
+        client->start_request(std::make_unique<lift::request>(blackhole.url(), std::chrono::milliseconds{50}));
+
+    auto [req, response] = waiter.get();
+    REQUIRE(response.lift_status() == lift::lift_status::timeout);
+    REQUIRE(response.status_code() == lift::http::status_code::http_504_gateway_timeout);
+    REQUIRE(client->requests_coalesced() == 1);
+
+    // The leader keeps going.
+    REQUIRE(leader.wait_for(std::chrono::seconds{0}) == std::future_status::timeout);
+    token.cancel();
+    REQUIRE(leader.get().second.lift_status() == lift::lift_status::cancelled);
+}
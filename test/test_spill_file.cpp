@@ -0,0 +1,173 @@
+#include "catch_amalgamated.hpp"
+#include "scripted_server.hpp"
+#include "setup.hpp"
+#include "test_helpers.hpp"
+#include <lift/lift.hpp>
+
+namespace
+{
+auto spill_client(std::size_t threshold, std::size_t max_memory) -> std::unique_ptr<lift::client>
+{
+    lift::client::options options{};
+    options.spill = lift::spill_options{threshold, max_memory};
+    return std::make_unique<lift::client>(std::move(options));
+}
+
+} // namespace
+
+TEST_CASE("spill_file appends and maps an unlinked file")
+{
+    lift::spill_file file{};
+    REQUIRE_FALSE(file.is_open());
+    REQUIRE(file.open(""));
+    REQUIRE(file.is_open());
+
+    REQUIRE(file.append("hello "));
+    REQUIRE(file.append("world"));
+    REQUIRE(file.size() == 11);
+
+    auto mapping = file.map();
+    REQUIRE_FALSE(file.is_open());
+    REQUIRE(mapping != nullptr);
+    REQUIRE(std::string_view{mapping.get(), 11} == "hello world");
+
+    REQUIRE_FALSE(file.open("/nonexistent/directory"));
+}
+
+TEST_CASE("Small response bodies stay in memory")
+{
+    auto            body = make_body(10 * 1024);
+    scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", "", body); }};
+
+    auto client = spill_client(64 * 1024, 1024 * 1024);
+    auto [req, response] =
+        client->start_request(std::make_unique<lift::request>(server.url(), std::chrono::seconds{5})).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.data() == body);
+    REQUIRE(client->bodies_spilled() == 0);
+    REQUIRE(client->body_memory_bytes() == 0);
+}
+
+TEST_CASE("Response bodies beyond the threshold are spilled")
+{
+    auto body = make_body(3 * 1024 * 1024 + 7);
+
+    SECTION("Content-Length beyond the threshold")
+    {
+        scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", "", body); }};
+
+        auto client = spill_client(64 * 1024, 1024 * 1024);
+        auto [req, response] =
+            client->start_request(std::make_unique<lift::request>(server.url(), std::chrono::seconds{5})).get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(client->bodies_spilled() == 1);
+        REQUIRE(client->body_memory_bytes() == 0);
+        REQUIRE(response.data_size() == body.size());
+        REQUIRE(response.data_segments().size() == 1);
+        REQUIRE(response.data() == body);
+
+        // Copies share the mapping.
+        auto copy = response;
+        REQUIRE(copy.data().data() == response.data().data());
+    }
+
+    SECTION("Unknown length crossing the threshold")
+    {
+        scripted_server server{[&](const std::string&) { return chunked_response(body); }};
+
+        auto client = spill_client(64 * 1024, 1024 * 1024);
+        auto [req, response] =
+            client->start_request(std::make_unique<lift::request>(server.url(), std::chrono::seconds{5})).get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(client->bodies_spilled() == 1);
+        REQUIRE(client->body_memory_bytes() == 0);
+        REQUIRE(response.data() == body);
+    }
+}
+
+TEST_CASE("Response bodies beyond the client's memory cap are spilled")
+{
+    auto            body = make_body(10 * 1024);
+    scripted_server server{[&](const std::string&) { return scripted_server::response("200 OK", "", body); }};
+
+    // Below the threshold but the cap can't hold it.
+    auto client = spill_client(64 * 1024, 1024);
+    auto [req, response] =
+        client->start_request(std::make_unique<lift::request>(server.url(), std::chrono::seconds{5})).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(client->bodies_spilled() == 1);
+    REQUIRE(response.data() == body);
+}
+
+TEST_CASE("Spilled response bodies are truncated by the capture policy")
+{
+    auto            body = make_body(1024 * 1024);
+    scripted_server server{[&](const std::string&) { return chunked_response(body); }};
+
+    auto client  = spill_client(64 * 1024, 1024 * 1024);
+    auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+    request->capture(lift::capture_policy{lift::header_capture::all, {}, 100 * 1024});
+
+    auto [req, response] = client->start_request(std::move(request)).get();
+    REQUIRE(response.lift_status() == lift::lift_status::success);
+    REQUIRE(response.body_truncated());
+    REQUIRE(client->bodies_spilled() == 1);
+    REQUIRE(response.data() == body.substr(0, 100 * 1024));
+}
+
+TEST_CASE("Spilled response bodies of a retried attempt are dropped")
+{
+    auto     failed_body = make_body(1024 * 1024);
+    uint32_t attempts{0};
+
+    lift::client::options options{};
+    options.spill                = lift::spill_options{64 * 1024, 1024 * 1024};
+    options.retry_budget_percent = 1000.0;
+    lift::client client{std::move(options)};
+
+    lift::retry_policy policy{};
+    policy.m_base_backoff = std::chrono::milliseconds{1};
+    policy.m_max_backoff  = std::chrono::milliseconds{10};
+
+    SECTION("The retry's body fits in memory")
+    {
+        auto            body = make_body(10 * 1024, 7);
+        scripted_server server{
+            [&](const std::string&)
+            {
+                return (attempts++ == 0) ? scripted_server::response("503 Service Unavailable", "", failed_body)
+                                         : scripted_server::response("200 OK", "", body);
+            }};
+
+        auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        request->retry(policy);
+        auto [req, response] = client.start_request(std::move(request)).get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.status_code() == lift::http::status_code::http_200_ok);
+        REQUIRE(response.num_attempts() == 2);
+        REQUIRE(client.bodies_spilled() == 1);
+        REQUIRE(client.body_memory_bytes() == 0);
+        REQUIRE(response.data() == body);
+    }
+
+    SECTION("The retry's body is spilled as well")
+    {
+        auto            body = make_body(2 * 1024 * 1024, 7);
+        scripted_server server{
+            [&](const std::string&)
+            {
+                return (attempts++ == 0) ? scripted_server::response("503 Service Unavailable", "", failed_body)
+                                         : chunked_response(body);
+            }};
+
+        auto request = std::make_unique<lift::request>(server.url(), std::chrono::seconds{5});
+        request->retry(policy);
+        auto [req, response] = client.start_request(std::move(request)).get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.num_attempts() == 2);
+        REQUIRE(client.bodies_spilled() == 2);
+        REQUIRE(client.body_memory_bytes() == 0);
+        REQUIRE(response.data_size() == body.size());
+        REQUIRE(response.data() == body);
+    }
+}
@@ -111,3 +111,28 @@ TEST_CASE("SSL functions")
 {
     // TODO, some of these require files.
 }
+
+TEST_CASE("Synchronous network error message")
+{
+    {
+        lift::request request("http://" + nginx_hostname + ":" + nginx_port_str + "/");
+        const auto&   response = request.perform();
+
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+        REQUIRE(response.network_error_message() == curl_easy_strerror(CURLE_OK));
+    }
+
+    {
+        // Nothing listens on port 1, the error buffer's detailed message is kept by the response.
+        lift::request request("http://127.0.0.1:1/", std::chrono::seconds{5});
+        auto          response = request.perform();
+
+        REQUIRE(response.lift_status() == lift::lift_status::connect_error);
+        REQUIRE_FALSE(response.network_error_message().empty());
+        REQUIRE(response.network_error_message() != curl_easy_strerror(CURLE_COULDNT_CONNECT));
+
+        // The message survives the response being moved.
+        auto moved = std::move(response);
+        REQUIRE(moved.network_error_message().find("127.0.0.1") != std::string_view::npos);
+    }
+}
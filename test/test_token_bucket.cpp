@@ -0,0 +1,168 @@
+#include "blackhole_server.hpp"
+#include "catch_amalgamated.hpp"
+#include "setup.hpp"
+#include <lift/lift.hpp>
+
+#include <chrono>
+
+TEST_CASE("token_bucket starts full and refills over time")
+{
+    lift::token_bucket bucket{lift::rate_limit{10.0, 3.0}, 1000};
+
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        REQUIRE(bucket.try_acquire(1000));
+    }
+    REQUIRE_FALSE(bucket.try_acquire(1000));
+    REQUIRE(bucket.wait_time(1000) == 100);
+
+    // Half a token isn't enough.
+    REQUIRE_FALSE(bucket.available(1050));
+    REQUIRE(bucket.wait_time(1050) == 50);
+    REQUIRE(bucket.try_acquire(1100));
+
+    // Idle time never accumulates more than the burst.
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        REQUIRE(bucket.try_acquire(60000));
+    }
+    REQUIRE_FALSE(bucket.try_acquire(60000));
+}
+
+TEST_CASE("token_bucket burst is at least one")
+{
+    lift::token_bucket bucket{lift::rate_limit{1.0, 0.0}, 0};
+    REQUIRE(bucket.limit().m_burst == 1.0);
+    REQUIRE(bucket.try_acquire(0));
+    REQUIRE_FALSE(bucket.try_acquire(0));
+    REQUIRE(bucket.wait_time(0) == 1000);
+}
+
+TEST_CASE("token_bucket with a zero rate never refills")
+{
+    lift::token_bucket bucket{lift::rate_limit{0.0, 1.0}, 0};
+    REQUIRE(bucket.try_acquire(0));
+    REQUIRE_FALSE(bucket.try_acquire(60000));
+    REQUIRE(bucket.wait_time(60000) == lift::token_bucket::never);
+}
+
+TEST_CASE("Client host rate limit spaces out requests")
+{
+    lift::client::options options{};
+    options.host_rate_limit = lift::rate_limit{20.0, 1.0};
+    lift::client client{std::move(options)};
+
+    std::vector<lift::request_ptr> requests{};
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+        requests.emplace_back(std::make_unique<lift::request>(
+            "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{5}));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& future : client.start_requests(std::move(requests)))
+    {
+        auto [req, response] = future.get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // The first request uses the burst, the other four wait 50ms each.
+    REQUIRE(elapsed >= std::chrono::milliseconds{190});
+    REQUIRE(client.requests_rate_limited() == 4);
+    REQUIRE(client.requests_queued() == 0);
+}
+
+TEST_CASE("Client tag rate limit only applies to tagged requests")
+{
+    lift::client::options options{};
+    options.tag_rate_limits.emplace("slow", lift::rate_limit{10.0, 1.0});
+    lift::client client{std::move(options)};
+
+    std::vector<lift::request::async_future_type> futures{};
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        auto request = std::make_unique<lift::request>(
+            "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{5});
+        request->tag("slow");
+        futures.emplace_back(client.start_request(std::move(request)));
+    }
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        auto request = std::make_unique<lift::request>(
+            "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{5});
+        request->tag("fast");
+        futures.emplace_back(client.start_request(std::move(request)));
+    }
+
+    for (auto& future : futures)
+    {
+        auto [req, response] = future.get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+    }
+
+    // Only the two slow requests after the first one waited.
+    REQUIRE(client.requests_rate_limited() >= 2);
+    REQUIRE(client.requests_queued() == 0);
+}
+
+TEST_CASE("Client global rate limit applies across hosts")
+{
+    lift::client::options options{};
+    options.global_rate_limit = lift::rate_limit{20.0, 2.0};
+    lift::client client{std::move(options)};
+
+    std::vector<lift::request_ptr> requests{};
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        requests.emplace_back(std::make_unique<lift::request>(
+            "http://" + nginx_hostname + ":" + nginx_port_str + "/", std::chrono::seconds{5}));
+        requests.emplace_back(std::make_unique<lift::request>(
+            "http://127.0.0.1:" + nginx_port_str + "/", std::chrono::seconds{5}));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& future : client.start_requests(std::move(requests)))
+    {
+        auto [req, response] = future.get();
+        REQUIRE(response.lift_status() == lift::lift_status::success);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // Two requests burst, the remaining six wait 50ms each.
+    REQUIRE(elapsed >= std::chrono::milliseconds{290});
+    REQUIRE(client.requests_rate_limited() == 6);
+}
+
+TEST_CASE("Client rate limit fails requests that would time out waiting")
+{
+    blackhole_server blackhole{};
+
+    double rate{0.0};
+    SECTION("A zero rate never admits another request")
+    {
+        rate = 0.0;
+    }
+    SECTION("A slow rate admits the next request after the timeout")
+    {
+        rate = 1.0;
+    }
+
+    lift::client::options options{};
+    options.global_rate_limit = lift::rate_limit{rate, 1.0};
+    lift::client client{std::move(options)};
+
+    // Takes the only token.
+    auto first = client.start_request(std::make_unique<lift::request>(blackhole.url(), std::chrono::milliseconds{200}));
+
+    // The next token is a second or more away, longer than the request is willing to wait.
+    auto start           = std::chrono::steady_clock::now();
+    auto [req, response] =
+        client.start_request(std::make_unique<lift::request>(blackhole.url(), std::chrono::milliseconds{500})).get();
+    REQUIRE(response.lift_status() == lift::lift_status::timeout);
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds{400});
+    REQUIRE(client.requests_rate_limited() == 1);
+    REQUIRE(client.requests_queued() == 0);
+
+    REQUIRE(first.get().second.lift_status() == lift::lift_status::timeout);
+}